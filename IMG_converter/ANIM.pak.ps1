@@ -0,0 +1,61 @@
+# Fichero: ANIM.pak.ps1
+# Fecha: 18/10/2026 - 02:30
+# Último cambio: Colores en el orden de bytes del panel ($useBigEndian).
+# Descripción: Script de PowerShell que genera el fichero 'ANIM.pak' de cada directorio
+#              de evolución de la SD a partir de sus ficheros 'ANIM_<ACCION>_<n>.bin' y
+#              verifica el resultado (ida y vuelta) con anim_pack.py. Por defecto cada
+#              fotograma se guarda con la codificación más pequeña (RLE o LZ4); con
+#              $encoding = "raw" se genera el pack sin comprimir. Con $useDelta los
+#              fotogramas que cambian poco se guardan como delta del anterior. Con
+#              $useTrim cada fotograma se recorta a su rectángulo visible. Con
+#              $useIndexed cada secuencia se cuantiza a 256 colores (1 byte/píxel + alfa).
+#              Con $useStore los fotogramas repetidos entre evoluciones se guardan una
+#              sola vez en 'SD\diymon\STORE.pak' y cada 'ANIM.pak' contiene solo sus
+#              tablas; hay que copiar a la SD el almacén junto con todos los packs.
+#              Con $useBigEndian los colores RGB565 se guardan en el orden de bytes del
+#              panel: es el formato del firmware compilado con
+#              CONFIG_LVGL_PORT_RGB565_BIG_ENDIAN, que rechaza los packs del otro orden.
+
+# --- INICIO DEL SCRIPT ---
+
+Clear-Host
+
+# --- ENCABEZADO VISUAL ---
+Write-Host "----------------------------------------------------" -ForegroundColor Green
+Write-Host "--- Empaquetador de Animaciones (.BIN -> .PAK)   ---" -ForegroundColor Green
+Write-Host "----------------------------------------------------"
+
+# --- CONFIGURACIÓN DE RUTAS ---
+$currentFolder = $PSScriptRoot
+$packerScript = Join-Path $currentFolder "anim_pack.py"
+$diymonFolder = Join-Path $currentFolder "..\SD\diymon"
+$encoding = "best"   # raw | rle | lz4 | best
+$useDelta = $true
+$useTrim = $true
+$useIndexed = $true
+$useStore = $true
+$useBigEndian = $false   # Igual que CONFIG_LVGL_PORT_RGB565_BIG_ENDIAN en el firmware.
+
+Write-Host "Carpeta de assets: $diymonFolder"
+Write-Host "Empaquetador: $packerScript"
+
+# --- EMPAQUETADO ---
+$commandToRun = "python `"$packerScript`" build `"$diymonFolder`" --encoding $encoding"
+if ($useDelta) { $commandToRun += " --delta" }
+if ($useTrim) { $commandToRun += " --trim" }
+if ($useIndexed) { $commandToRun += " --indexed" }
+if ($useStore) { $commandToRun += " --store" }
+if ($useBigEndian) { $commandToRun += " --big-endian" }
+Write-Host "-> Comando: $commandToRun" -ForegroundColor Gray
+Invoke-Expression $commandToRun
+
+# --- VERIFICACIÓN ---
+$commandToRun = "python `"$packerScript`" verify `"$diymonFolder`""
+Write-Host "-> Comando: $commandToRun" -ForegroundColor Gray
+Invoke-Expression $commandToRun
+
+if ($LASTEXITCODE -eq 0) {
+    Write-Host "¡Empaquetado completado y verificado!" -ForegroundColor Green
+} else {
+    Write-Host "ERROR: La verificación de los packs ha fallado." -ForegroundColor Red
+}
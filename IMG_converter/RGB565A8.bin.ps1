@@ -1,10 +1,14 @@
 # Fichero: RGB565A8.bin.ps1
-# Fecha: 10/08/2025 - 06:00
-# Último cambio: Corregido el parámetro --out para generar ficheros en lugar de carpetas.
+# Fecha: 18/10/2026 - 02:30
+# Último cambio: Fotogramas en el orden de bytes del panel ($useBigEndian).
 # Descripción: Script de PowerShell que procesa cada fichero .png de forma individual. Se ha
 #              corregido el comando de conversión para que especifique solo la carpeta de
 #              salida, permitiendo que la herramienta de LVGL nombre el fichero .bin
 #              automáticamente y evitando la creación de directorios no deseados.
+#              Con $useBigEndian cada .bin generado pasa por rgb565_swap.py: su plano de
+#              color queda en el orden de bytes del panel y la cabecera lo indica, como
+#              lo espera el firmware con CONFIG_LVGL_PORT_RGB565_BIG_ENDIAN (un .bin del
+#              otro orden también se muestra bien, pero se intercambia al cargarlo).
 
 # --- INICIO DEL SCRIPT ---
 
@@ -18,6 +22,8 @@ Write-Host "----------------------------------------------------"
 # --- CONFIGURACIÓN DE RUTAS ---
 $currentFolder = $PSScriptRoot
 $lvglConverterScript = Join-Path $currentFolder "..\components_dependencies\lvgl\scripts\LVGLImage.py"
+$swapScript = Join-Path $currentFolder "rgb565_swap.py"
+$useBigEndian = $false   # Igual que CONFIG_LVGL_PORT_RGB565_BIG_ENDIAN en el firmware.
 
 Write-Host "Carpeta de trabajo: $currentFolder"
 Write-Host "Ruta al conversor: $lvglConverterScript"
@@ -50,6 +56,10 @@ foreach ($file in $pngFiles) {
     
     Invoke-Expression $commandToRun
     
+    if ((Test-Path $expectedOutputFile) -and $useBigEndian) {
+        Invoke-Expression "python `"$swapScript`" bin `"$expectedOutputFile`""
+    }
+
     if (Test-Path $expectedOutputFile) {
         Write-Host "  -> ÉXITO: Archivo `"$($file.BaseName).bin`" creado." -ForegroundColor Green
     } else {
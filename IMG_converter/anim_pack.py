@@ -0,0 +1,1283 @@
+#!/usr/bin/env python3
+# Fichero: anim_pack.py
+# Fecha: 18/10/2026 - 04:00
+# Último cambio: Opción --preblend: secuencias RGB565 opacas premezcladas con el fondo (formato v7).
+# Descripción: Herramienta de host que agrupa los fotogramas 'ANIM_<ACCION>_<n>.bin'
+#              (generados por RGB565A8.bin.ps1) de cada directorio de evolución en un
+#              único fichero 'ANIM.pak' con cabecera, tabla de secuencias, tabla de
+#              fotogramas y payloads alineados a sector. El formato lo lee
+#              components/ui/animation_pack.c.
+#              Cada fotograma puede guardarse en crudo, en RLE (mismo formato que
+#              lv_rle de LVGL, bloques de 2 bytes en RGB565A8) o en un bloque LZ4.
+#              Si la compresión no reduce el tamaño, el fotograma se guarda en crudo.
+#              Con --delta, los fotogramas que cambian poco respecto al anterior se
+#              guardan como delta: lista de rectángulos modificados y sus píxeles,
+#              que el firmware aplica in situ e invalida solo esas zonas. Cada
+#              --keyframe-interval fotogramas (y al inicio de cada secuencia) se
+#              fuerza un fotograma completo.
+#              Con --trim cada fotograma se recorta al rectángulo con alfa distinto de
+#              cero y se guarda su posición dentro del lienzo (150x230); el firmware
+#              solo lee y dibuja ese rectángulo y recoloca el objeto imagen. El
+#              informe indica la reducción media de píxeles.
+#              Con --indexed los colores de cada secuencia se cuantizan a una paleta
+#              de 256 colores RGB565 (corte de la mediana + refinado) y cada píxel se
+#              guarda como índice de 1 byte más su alfa (2 bytes/píxel en lugar de 3).
+#              Las paletas se guardan una vez por pack (las secuencias idénticas la
+#              comparten) y el firmware expande los índices al cargar el fotograma.
+#              Con --store (sobre el directorio 'diymon' completo) los payloads de todas
+#              las evoluciones se guardan una sola vez en 'STORE.pak', direccionados por
+#              el hash SHA-1 de su contenido (bytes almacenados, geometría, formato,
+#              paleta y, en los deltas, el contenido del fotograma base). Cada 'ANIM.pak'
+#              queda reducido a sus tablas, con offsets dentro del almacén. El informe
+#              indica cuántos payloads eran duplicados y los bytes ahorrados.
+#              Si el directorio de evolución contiene 'ANIM.timing', cada fotograma
+#              guarda en la tabla su duración en milisegundos; el reloj de animación
+#              del firmware programa con ella cada fotograma (0 = cadencia por
+#              defecto del player). Formato, una entrada por línea ('#' comenta):
+#                  ANIM_EAT_   120     <- todos los fotogramas de la secuencia
+#                  ANIM_EAT_3  300     <- un fotograma concreto (prevalece)
+#              Con --big-endian los planos de color RGB565 y las paletas se guardan en
+#              el orden de bytes del panel y la cabecera lo indica; es el formato que
+#              espera el firmware compilado con CONFIG_LVGL_PORT_RGB565_BIG_ENDIAN (el
+#              que no intercambia los bytes en cada envío a la pantalla). Los '.bin' de
+#              origen pueden estar en cualquiera de los dos órdenes (RGB565A8.bin.ps1
+#              -BigEndian marca los suyos en la cabecera).
+#              Con --preblend el pack lleva además cada secuencia RGB565A8 premezclada
+#              con el recorte del fondo sobre el que la dibuja el firmware: fotogramas
+#              RGB565 opacos (2 bytes/píxel en lugar de 3, sin mezcla alfa al dibujar),
+#              marcados como premezclados detrás de la secuencia normal. El fondo es el
+#              fichero C del firmware (components/ui/assets/images/BG.c, por defecto) o
+#              un '.bin' de LVGL, siempre indexado I8, y el lienzo se coloca en
+#              --canvas-origin (10,60: abajo y centrado en la pantalla de 170x320). La
+#              cabecera guarda la firma del recorte (CRC32 del rectángulo, la paleta y
+#              los índices); el firmware calcula la misma sobre el fondo que tiene en
+#              pantalla y, si no coincide (fondo personalizado u otra posición), usa
+#              las secuencias RGB565A8. Se recorta y premezcla antes de cuantizar, así
+#              que --indexed solo afecta a las secuencias normales. 'verify' comprueba
+#              las premezcladas contra el mismo fondo.
+#
+# Uso:
+#   python anim_pack.py build  <dir_evolucion|dir_diymon> [--align 512] [--encoding raw|rle|lz4|best]
+#                              [--delta] [--keyframe-interval 8] [--trim] [--indexed] [--store] [--big-endian]
+#                              [--preblend [BG.c|BG.bin]] [--canvas-origin 10,60]
+#   python anim_pack.py verify <dir_evolucion|dir_diymon> [--preblend [BG.c|BG.bin]] [--canvas-origin 10,60]
+#   python anim_pack.py bench  <dir_evolucion|dir_diymon> [--rounds 5]
+#   python anim_pack.py codecs <dir_evolucion|dir_diymon> [--rounds 3] [--spi-mhz 20]
+#
+# 'verify' desempaqueta (y descomprime) cada fotograma y lo compara byte a byte con
+# su '.bin' de origen (prueba de ida y vuelta; en fotogramas indexados, con el
+# '.bin' cuantizado a la paleta del pack). 'bench' compara la latencia de
+# lectura por fotograma entre el formato actual (abrir/seek/leer/cerrar un fichero
+# por fotograma) y el pack (un único fichero abierto, seek + read). 'codecs'
+# compara, por fotograma, los bytes leídos de la SD, el tiempo estimado de
+# transferencia por el bus SPI y el tiempo de descompresión de raw, RLE y LZ4.
+# Con el paquete 'lz4' de Python instalado se usa su implementación en C; si no,
+# una implementación en Python puro (compatible, pero mucho más lenta).
+
+import argparse
+import hashlib
+import os
+import re
+import statistics
+import struct
+import sys
+import time
+import zlib
+
+from rgb565_swap import ARRAY_RE, BYTE_RE, COMMENT_RE, DSC_RE, _eval_int, _field
+
+PACK_FILENAME = "ANIM.pak"
+PACK_MAGIC = 0x4B415044  # "DPAK"
+PACK_VERSION = 7
+PREFIX_LEN = 12
+PACK_FLAG_STORE = 0x0001
+PACK_FLAG_BIG_ENDIAN = 0x0002      # Colores RGB565 en el orden del panel (ANIM_PACK_HDR_FLAG_BIG_ENDIAN).
+SEQ_FLAG_PREBLENDED = 0x0001       # Secuencia RGB565 premezclada con el fondo (ANIM_PACK_SEQ_FLAG_PREBLENDED).
+
+STORE_FILENAME = "STORE.pak"
+STORE_MAGIC = 0x4F545344  # "DSTO"
+STORE_VERSION = 1
+STORE_HEADER = struct.Struct("<IHHII")        # magic, version, align, store_id, payload_count
+
+# Orden de las secuencias dentro del pack (mismos prefijos que usa la UI).
+SEQUENCE_PREFIXES = ["ANIM_IDLE_", "ANIM_EAT_", "ANIM_GYM_", "ANIM_ATK_"]
+
+LVGL_BIN_MAGIC = 0x19
+LVGL_BIN_HEADER = struct.Struct("<BBHHHHH")   # magic, cf, flags, w, h, stride, reserved
+LVGL_BIN_FLAG_BIG_ENDIAN = 0x0100             # LV_IMAGE_FLAGS_USER1: plano de color en el orden del panel.
+PACK_HEADER = struct.Struct("<IHHHHHHHHII")   # magic, version, seq_count, frame_count, align, canvas_w, canvas_h,
+                                              # palette_count, flags, store_id, bg_signature
+PACK_SEQ = struct.Struct("<12sHHHH")          # prefix, first_frame, frame_count, palette, flags
+PALETTE_SIZE = 256
+PALETTE = struct.Struct("<%dH" % PALETTE_SIZE)  # Colores RGB565
+NO_PALETTE = 0xFFFF
+PACK_FRAME = struct.Struct("<IIIHHHHHBBH")    # offset, size, raw_size, x, y, w, h, stride, cf, encoding, duration_ms
+TIMING_FILENAME = "ANIM.timing"
+MAX_DURATION_MS = 0xFFFF
+
+ENC_RAW = 0
+ENC_RLE = 1
+ENC_LZ4 = 2
+ENCODING_NAMES = {ENC_RAW: "raw", ENC_RLE: "rle", ENC_LZ4: "lz4"}
+ENC_MASK = 0x0F
+FLAG_DELTA = 0x80
+
+DELTA_HEADER = struct.Struct("<HH")           # rect_count, reserved
+DELTA_RECT = struct.Struct("<HHHH")           # x, y, w, h
+DELTA_MAX_RECTS = 8        # ANIM_DIRTY_MAX_AREAS en animation_loader.h
+DELTA_ROW_GAP = 4          # Filas sin cambios que se absorben dentro de un mismo rectángulo.
+DELTA_MAX_RATIO = 1 / 3    # Un delta mayor que esta fracción del fotograma se guarda completo.
+
+LV_COLOR_FORMAT_I8 = 0x0A
+LV_COLOR_FORMAT_RGB565 = 0x12
+LV_COLOR_FORMAT_RGB565A8 = 0x14
+
+# Fondo de la pantalla principal y posición del lienzo (ui_action_animations_create: 150x230 abajo y
+# centrado, 30 px sobre el borde, en la pantalla de 170x320).
+DEFAULT_BACKGROUND = os.path.join(os.path.dirname(os.path.abspath(__file__)), os.pardir,
+                                  "components", "ui", "assets", "images", "BG.c")
+DEFAULT_CANVAS_ORIGIN = "10,60"
+BG_PALETTE_SIZE = 256
+LV_COLOR_MIX_ROUND_OFS = 128   # CONFIG_LV_COLOR_MIX_ROUND_OFS del sdkconfig (lv_color_mix).
+
+try:
+    import lz4.block as lz4_block
+except ImportError:
+    lz4_block = None
+
+
+# --- RLE compatible con lv_rle ---
+# Byte de control: con el bit 7 activo le siguen (ctrl & 0x7F) bloques literales;
+# si no, un único bloque que se repite 'ctrl' veces.
+
+def rle_block_size(cf):
+    # Igual que el decodificador .bin de LVGL: RGB565A8 y RGB565 se comprimen en bloques de 2 bytes
+    # (los índices I8 y su plano alfa, en bloques de 1 byte).
+    return 2 if cf in (LV_COLOR_FORMAT_RGB565A8, LV_COLOR_FORMAT_RGB565) else 1
+
+
+def rle_compress(data, blk):
+    if len(data) % blk:
+        raise ValueError("el tamaño de los datos no es múltiplo del bloque RLE")
+    units = [bytes(data[i:i + blk]) for i in range(0, len(data), blk)]
+    n = len(units)
+    out = bytearray()
+
+    def flush_literals(start, end):
+        while start < end:
+            count = min(127, end - start)
+            out.append(0x80 | count)
+            out.extend(b"".join(units[start:start + count]))
+            start += count
+
+    lit_start = 0
+    i = 0
+    while i < n:
+        j = i + 1
+        while j < n and j - i < 127 and units[j] == units[i]:
+            j += 1
+        # Una repetición de 3 o más bloques sale más barata que dejarla en el literal.
+        if j - i >= 3:
+            flush_literals(lit_start, i)
+            out.append(j - i)
+            out.extend(units[i])
+            lit_start = j
+        i = j
+    flush_literals(lit_start, n)
+    return bytes(out)
+
+
+def rle_decompress(data, blk, raw_size):
+    out = bytearray()
+    i = 0
+    while i < len(data):
+        ctrl = data[i]
+        i += 1
+        if ctrl & 0x80:
+            count = (ctrl & 0x7F) * blk
+            out += data[i:i + count]
+            i += count
+        else:
+            out += data[i:i + blk] * ctrl
+            i += blk
+    if len(out) != raw_size:
+        raise ValueError(f"RLE: {len(out)} bytes descomprimidos, esperados {raw_size}")
+    return bytes(out)
+
+
+# --- Bloque LZ4 (sin cabecera de trama, como LZ4_decompress_safe) ---
+
+def _lz4_length(out, value):
+    while value >= 255:
+        out.append(255)
+        value -= 255
+    out.append(value)
+
+
+def _lz4_compress_py(src):
+    n = len(src)
+    out = bytearray()
+    table = {}
+    anchor = 0
+    i = 0
+    match_limit = n - 12   # La última secuencia debe empezar 12 bytes antes del final.
+    end_limit = n - 5      # Los últimos 5 bytes siempre son literales.
+    while i < match_limit:
+        key = src[i:i + 4]
+        ref = table.get(key)
+        table[key] = i
+        if ref is None or i - ref > 65535:
+            i += 1
+            continue
+        m = i + 4
+        while m < end_limit and src[m] == src[m - i + ref]:
+            m += 1
+        lit_len = i - anchor
+        match_len = m - i - 4
+        out.append((min(lit_len, 15) << 4) | min(match_len, 15))
+        if lit_len >= 15:
+            _lz4_length(out, lit_len - 15)
+        out += src[anchor:i]
+        out += struct.pack("<H", i - ref)
+        if match_len >= 15:
+            _lz4_length(out, match_len - 15)
+        i = m
+        anchor = i
+    lit_len = n - anchor
+    out.append(min(lit_len, 15) << 4)
+    if lit_len >= 15:
+        _lz4_length(out, lit_len - 15)
+    out += src[anchor:]
+    return bytes(out)
+
+
+def _lz4_decompress_py(src, raw_size):
+    out = bytearray()
+    i = 0
+    n = len(src)
+    while i < n:
+        token = src[i]
+        i += 1
+        lit_len = token >> 4
+        if lit_len == 15:
+            while True:
+                b = src[i]
+                i += 1
+                lit_len += b
+                if b != 255:
+                    break
+        out += src[i:i + lit_len]
+        i += lit_len
+        if i >= n:
+            break
+        offset = src[i] | (src[i + 1] << 8)
+        i += 2
+        match_len = token & 0x0F
+        if match_len == 15:
+            while True:
+                b = src[i]
+                i += 1
+                match_len += b
+                if b != 255:
+                    break
+        match_len += 4
+        start = len(out) - offset
+        if offset <= 0 or start < 0:
+            raise ValueError("LZ4: offset inválido")
+        if offset >= match_len:
+            out += out[start:start + match_len]
+        else:
+            pattern = bytes(out[start:])
+            out += (pattern * (match_len // offset + 1))[:match_len]
+    if len(out) != raw_size:
+        raise ValueError(f"LZ4: {len(out)} bytes descomprimidos, esperados {raw_size}")
+    return bytes(out)
+
+
+def lz4_compress(data):
+    if lz4_block:
+        return lz4_block.compress(bytes(data), store_size=False)
+    return _lz4_compress_py(bytes(data))
+
+
+def lz4_decompress(data, raw_size):
+    if lz4_block:
+        return lz4_block.decompress(bytes(data), uncompressed_size=raw_size)
+    return _lz4_decompress_py(data, raw_size)
+
+
+def encode_bytes(payload, blk, encoding):
+    # Devuelve (codificación, bytes). Si comprimir no reduce el tamaño se guarda en crudo.
+    if encoding == "raw":
+        return ENC_RAW, payload
+    candidates = []
+    if encoding in ("rle", "best"):
+        candidates.append((ENC_RLE, rle_compress(payload, blk)))
+    if encoding in ("lz4", "best"):
+        candidates.append((ENC_LZ4, lz4_compress(payload)))
+    enc, data = min(candidates, key=lambda c: len(c[1]))
+    if len(data) >= len(payload):
+        return ENC_RAW, payload
+    return enc, data
+
+
+def encode_payload(frame, encoding):
+    return encode_bytes(frame.payload, rle_block_size(frame.cf), encoding)
+
+
+def decode_payload(enc, data, cf, raw_size):
+    # Los deltas se comprimen como flujo de bytes (RLE con bloque de 1 byte).
+    blk = 1 if enc & FLAG_DELTA else rle_block_size(cf)
+    method = enc & ENC_MASK
+    if method == ENC_RAW:
+        return bytes(data)
+    if method == ENC_RLE:
+        return rle_decompress(data, blk, raw_size)
+    if method == ENC_LZ4:
+        return lz4_decompress(data, raw_size)
+    raise ValueError(f"codificación {enc} desconocida")
+
+
+# --- Fotogramas delta ---
+
+def _planes(fr):
+    # Geometría de los planos: color con 'stride' y, en RGB565A8, alfa de 1 byte por píxel.
+    has_alpha = fr.cf == LV_COLOR_FORMAT_RGB565A8
+    px_bytes = 2 if has_alpha else max(1, fr.stride // fr.w)
+    return has_alpha, px_bytes, fr.stride * fr.h
+
+
+def _row_span(a, b, px_bytes):
+    if a == b:
+        return None
+    i = 0
+    while a[i] == b[i]:
+        i += 1
+    j = len(a) - 1
+    while a[j] == b[j]:
+        j -= 1
+    return i // px_bytes, j // px_bytes
+
+
+def delta_rects(prev, cur, fr):
+    # Agrupa las filas con cambios en bandas y devuelve como mucho DELTA_MAX_RECTS rectángulos (x0, y0, x1, y1).
+    has_alpha, px_bytes, color_plane = _planes(fr)
+    bands = []
+    for y in range(fr.h):
+        c0 = y * fr.stride
+        span = _row_span(prev[c0:c0 + fr.w * px_bytes], cur[c0:c0 + fr.w * px_bytes], px_bytes)
+        if has_alpha:
+            a0 = color_plane + y * fr.w
+            alpha_span = _row_span(prev[a0:a0 + fr.w], cur[a0:a0 + fr.w], 1)
+            if alpha_span:
+                span = alpha_span if not span else (min(span[0], alpha_span[0]), max(span[1], alpha_span[1]))
+        if not span:
+            continue
+        if bands and y - bands[-1][3] <= DELTA_ROW_GAP + 1:
+            b = bands[-1]
+            bands[-1] = [min(b[0], span[0]), b[1], max(b[2], span[1]), y]
+        else:
+            bands.append([span[0], y, span[1], y])
+
+    def area(r):
+        return (r[2] - r[0] + 1) * (r[3] - r[1] + 1)
+
+    # Fusiona las bandas contiguas que menos área añaden hasta no superar el máximo.
+    while len(bands) > DELTA_MAX_RECTS:
+        best = None
+        for i in range(len(bands) - 1):
+            a, b = bands[i], bands[i + 1]
+            merged = [min(a[0], b[0]), a[1], max(a[2], b[2]), b[3]]
+            cost = area(merged) - area(a) - area(b)
+            if best is None or cost < best[0]:
+                best = (cost, i, merged)
+        _, i, merged = best
+        bands[i:i + 2] = [merged]
+    return [tuple(b) for b in bands]
+
+
+def build_delta(prev, cur, fr, index_of=None):
+    # Con 'index_of' (fotogramas indexados) las filas de color se guardan como índices de paleta.
+    has_alpha, px_bytes, color_plane = _planes(fr)
+    rects = delta_rects(prev, cur, fr)
+    out = bytearray(DELTA_HEADER.pack(len(rects), 0))
+    for x0, y0, x1, y1 in rects:
+        out += DELTA_RECT.pack(x0, y0, x1 - x0 + 1, y1 - y0 + 1)
+    for x0, y0, x1, y1 in rects:
+        for y in range(y0, y1 + 1):
+            c0 = y * fr.stride
+            row = cur[c0 + x0 * px_bytes:c0 + (x1 + 1) * px_bytes]
+            if index_of is not None:
+                row = bytes(index_of[c] for c in struct.unpack("<%dH" % (len(row) // 2), row))
+            out += row
+        if has_alpha:
+            for y in range(y0, y1 + 1):
+                a0 = color_plane + y * fr.w
+                out += cur[a0 + x0:a0 + x1 + 1]
+    dirty_px = sum((x1 - x0 + 1) * (y1 - y0 + 1) for x0, y0, x1, y1 in rects)
+    return bytes(out), dirty_px
+
+
+def apply_delta(prev, delta, fr, palette=None):
+    # Equivalente a animation_pack_apply_delta del firmware.
+    has_alpha, px_bytes, color_plane = _planes(fr)
+    out = bytearray(prev)
+    count, _ = DELTA_HEADER.unpack_from(delta, 0)
+    pos = DELTA_HEADER.size + count * DELTA_RECT.size
+    for i in range(count):
+        x, y, w, h = DELTA_RECT.unpack_from(delta, DELTA_HEADER.size + i * DELTA_RECT.size)
+        if w == 0 or h == 0 or x + w > fr.w or y + h > fr.h:
+            raise ValueError(f"rectángulo {i} del delta fuera del fotograma")
+        for row in range(y, y + h):
+            c0 = row * fr.stride + x * px_bytes
+            if palette is not None:
+                out[c0:c0 + w * 2] = struct.pack("<%dH" % w, *(palette[i] for i in delta[pos:pos + w]))
+                pos += w
+            else:
+                out[c0:c0 + w * px_bytes] = delta[pos:pos + w * px_bytes]
+                pos += w * px_bytes
+        if has_alpha:
+            for row in range(y, y + h):
+                a0 = color_plane + row * fr.w + x
+                out[a0:a0 + w] = delta[pos:pos + w]
+                pos += w
+    if pos > len(delta):
+        raise ValueError("píxeles del delta truncados")
+    return bytes(out)
+
+
+class Frame:
+    def __init__(self, path, cf, w, h, stride, payload, x=0, y=0):
+        self.path = path
+        self.cf = cf
+        self.w = w
+        self.h = h
+        self.stride = stride
+        self.payload = payload
+        self.x = x
+        self.y = y
+        self.canvas_w = x + w
+        self.canvas_h = y + h
+        self.palette = None      # Con --indexed: paleta RGB565 de la secuencia.
+        self.index_of = None     # Color RGB565 -> índice en la paleta.
+
+    def packed_cf(self):
+        return LV_COLOR_FORMAT_I8 if self.palette else self.cf
+
+    def stored_payload(self):
+        # Fotograma indexado: índices (w*h) seguidos del plano alfa (w*h).
+        if not self.palette:
+            return self.payload
+        n = self.w * self.h
+        colors = struct.unpack_from("<%dH" % n, self.payload, 0)
+        indices = bytes(self.index_of[c] for c in colors)
+        return indices + self.payload[self.stride * self.h:self.stride * self.h + n]
+
+    def same_rect(self, other):
+        return (self.x, self.y, self.w, self.h) == (other.x, other.y, other.w, other.h)
+
+
+def trim_frame(fr):
+    # Recorta los márgenes totalmente transparentes (alfa 0) de un fotograma RGB565A8.
+    if fr.cf != LV_COLOR_FORMAT_RGB565A8:
+        return fr
+    color_plane = fr.stride * fr.h
+    alpha = fr.payload[color_plane:color_plane + fr.w * fr.h]
+    rows = [y for y in range(fr.h) if alpha[y * fr.w:(y + 1) * fr.w].strip(b"\0")]
+    if not rows:
+        x0, y0, x1, y1 = 0, 0, 0, 0   # Fotograma vacío: se conserva un único píxel.
+    else:
+        y0, y1 = rows[0], rows[-1]
+        x0, x1 = fr.w, 0
+        for y in rows:
+            row = alpha[y * fr.w:(y + 1) * fr.w]
+            x0 = min(x0, len(row) - len(row.lstrip(b"\0")))
+            x1 = max(x1, len(row.rstrip(b"\0")) - 1)
+    w, h = x1 - x0 + 1, y1 - y0 + 1
+    color = bytearray()
+    for y in range(y0, y1 + 1):
+        c0 = y * fr.stride
+        color += fr.payload[c0 + x0 * 2:c0 + (x1 + 1) * 2]
+    alpha_rows = bytearray()
+    for y in range(y0, y1 + 1):
+        alpha_rows += alpha[y * fr.w + x0:y * fr.w + x1 + 1]
+    payload = bytes(color + alpha_rows)
+    if len(payload) % 2:
+        payload += b"\0"   # El RLE de RGB565A8 trabaja en bloques de 2 bytes.
+    trimmed = Frame(fr.path, fr.cf, w, h, w * 2, payload, x0, y0)
+    trimmed.canvas_w, trimmed.canvas_h = fr.canvas_w, fr.canvas_h
+    return trimmed
+
+
+# --- Paletas (fotogramas indexados) ---
+
+def _rgb565_to_rgb(c):
+    r, g, b = (c >> 11) & 0x1F, (c >> 5) & 0x3F, c & 0x1F
+    return (r << 3 | r >> 2, g << 2 | g >> 4, b << 3 | b >> 2)
+
+
+def _rgb_to_rgb565(rgb):
+    r, g, b = rgb
+    return (r >> 3) << 11 | (g >> 2) << 5 | b >> 3
+
+
+def _nearest(rgb, palette_rgb):
+    best, best_d = 0, None
+    for i, p in enumerate(palette_rgb):
+        d = (rgb[0] - p[0]) ** 2 + (rgb[1] - p[1]) ** 2 + (rgb[2] - p[2]) ** 2
+        if best_d is None or d < best_d:
+            best, best_d = i, d
+    return best
+
+
+def color_histogram(frames):
+    # Píxeles visibles (alfa > 0) de cada color RGB565 en todos los fotogramas.
+    hist = {}
+    for fr in frames:
+        n = fr.w * fr.h
+        colors = struct.unpack_from("<%dH" % n, fr.payload, 0)
+        alpha = fr.payload[fr.stride * fr.h:fr.stride * fr.h + n]
+        for c, a in zip(colors, alpha):
+            if a:
+                hist[c] = hist.get(c, 0) + 1
+    return hist
+
+
+def build_palette(hist, size=PALETTE_SIZE, refine_rounds=3):
+    # Corte de la mediana ponderado por número de píxeles y unas rondas de k-medias.
+    if len(hist) <= size:
+        palette = sorted(hist)
+        return palette + [0] * (size - len(palette))
+    items = [(_rgb565_to_rgb(c), n) for c, n in hist.items()]
+    boxes = [items]
+    while len(boxes) < size:
+        best = None
+        for i, box in enumerate(boxes):
+            if len(box) < 2:
+                continue
+            for axis in range(3):
+                lo = min(rgb[axis] for rgb, _ in box)
+                hi = max(rgb[axis] for rgb, _ in box)
+                score = (hi - lo) * sum(n for _, n in box)
+                if best is None or score > best[0]:
+                    best = (score, i, axis)
+        if best is None:
+            break
+        _, i, axis = best
+        box = sorted(boxes[i], key=lambda item: item[0][axis])
+        half = sum(n for _, n in box) / 2
+        acc, cut = 0, 1
+        for cut, (_, n) in enumerate(box[:-1], start=1):
+            acc += n
+            if acc >= half:
+                break
+        boxes[i:i + 1] = [box[:cut], box[cut:]]
+
+    def mean(group):
+        total = sum(n for _, n in group)
+        return tuple(round(sum(rgb[k] * n for rgb, n in group) / total) for k in range(3))
+
+    centers = [mean(box) for box in boxes]
+    for _ in range(refine_rounds):
+        groups = [[] for _ in centers]
+        for rgb, n in items:
+            groups[_nearest(rgb, centers)].append((rgb, n))
+        centers = [mean(g) if g else c for g, c in zip(groups, centers)]
+    palette = sorted({_rgb_to_rgb565(c) for c in centers})
+    return palette + [0] * (size - len(palette))
+
+
+def quantize_frame(fr, palette, index_of):
+    # Sustituye cada color por el de la paleta más cercano. Los píxeles transparentes
+    # usan el índice 0, así que al expandirlos toman palette[0].
+    n = fr.w * fr.h
+    colors = struct.unpack_from("<%dH" % n, fr.payload, 0)
+    alpha = fr.payload[fr.stride * fr.h:fr.stride * fr.h + n]
+    palette_rgb = [_rgb565_to_rgb(c) for c in palette]
+    out = []
+    for c, a in zip(colors, alpha):
+        if not a:
+            out.append(palette[0])
+            continue
+        if c not in index_of:
+            index_of[c] = _nearest(_rgb565_to_rgb(c), palette_rgb)
+        out.append(palette[index_of[c]])
+    payload = struct.pack("<%dH" % n, *out) + fr.payload[fr.stride * fr.h:]
+    q = Frame(fr.path, fr.cf, fr.w, fr.h, fr.stride, payload, fr.x, fr.y)
+    q.canvas_w, q.canvas_h = fr.canvas_w, fr.canvas_h
+    q.palette = palette
+    q.index_of = {c: i for i, c in enumerate(palette)}
+    return q
+
+
+def quantize_sequence(seq):
+    hist = color_histogram(seq)
+    palette = build_palette(hist)
+    index_of = {}
+    quantized = [quantize_frame(fr, palette, index_of) for fr in seq]
+    # Error medio por canal (escala de 8 bits) ponderado por píxeles visibles.
+    palette_rgb = [_rgb565_to_rgb(c) for c in palette]
+    err = sum(n * sum(abs(a - b) for a, b in zip(_rgb565_to_rgb(c), palette_rgb[index_of[c]])) / 3
+              for c, n in hist.items())
+    return quantized, palette, err / max(1, sum(hist.values()))
+
+
+def expand_indexed(data, w, h, palette):
+    # Equivalente a la expansión in situ del firmware: índices -> plano de color RGB565.
+    n = w * h
+    return struct.pack("<%dH" % n, *(palette[i] for i in data[:n])) + data[n:2 * n]
+
+
+def swap_rgb565(data):
+    # Intercambia los dos bytes de cada color RGB565 (little-endian <-> orden del panel).
+    out = bytearray(data)
+    out[0::2], out[1::2] = data[1::2], data[0::2]
+    return bytes(out)
+
+
+def swap_color_plane(fr):
+    # Fotograma RGB565A8 o RGB565 sin paleta con el plano de color en el otro orden de bytes.
+    if fr.cf not in (LV_COLOR_FORMAT_RGB565A8, LV_COLOR_FORMAT_RGB565) or fr.palette:
+        return fr
+    plane = fr.stride * fr.h
+    swapped = Frame(fr.path, fr.cf, fr.w, fr.h, fr.stride, swap_rgb565(fr.payload[:plane]) + fr.payload[plane:],
+                    fr.x, fr.y)
+    swapped.canvas_w, swapped.canvas_h = fr.canvas_w, fr.canvas_h
+    return swapped
+
+
+def read_lvgl_bin(path):
+    with open(path, "rb") as f:
+        data = f.read()
+    if len(data) < LVGL_BIN_HEADER.size:
+        raise ValueError(f"{path}: fichero demasiado corto")
+    magic, cf, flags, w, h, stride, _ = LVGL_BIN_HEADER.unpack_from(data)
+    if magic != LVGL_BIN_MAGIC:
+        raise ValueError(f"{path}: no es un .bin de LVGL v9 (magic 0x{magic:02x})")
+    payload = data[LVGL_BIN_HEADER.size:]
+    # Algunos .bin exportados llevan bytes de relleno al final: solo se empaquetan los píxeles.
+    expected = stride * h + (w * h if cf == LV_COLOR_FORMAT_RGB565A8 else 0)
+    fr = Frame(path, cf, w, h, stride, payload[:expected])
+    # Internamente los fotogramas se tratan en little-endian; el orden del pack se aplica al generarlo.
+    return swap_color_plane(fr) if flags & LVGL_BIN_FLAG_BIG_ENDIAN else fr
+
+
+# --- Premezcla con el fondo ---
+
+class Background:
+    # Fondo indexado I8: paleta de 256 colores ARGB8888 (B, G, R, A) seguida de un índice por píxel.
+    def __init__(self, path, w, h, stride, data):
+        palette_bytes = BG_PALETTE_SIZE * 4
+        if len(data) < palette_bytes + stride * (h - 1) + w:
+            raise ValueError(f"{path}: fondo I8 truncado")
+        self.path = path
+        self.w = w
+        self.h = h
+        self.stride = stride
+        self.palette_bytes = bytes(data[:palette_bytes])
+        self.indices = bytes(data[palette_bytes:])
+        # Como la tabla del firmware: color de la paleta mezclado sobre negro y pasado a RGB565.
+        self.rgb565 = []
+        for i in range(BG_PALETTE_SIZE):
+            b, g, r, a = self.palette_bytes[i * 4:i * 4 + 4]
+            self.rgb565.append(_rgb_to_rgb565(tuple(((c * a + LV_COLOR_MIX_ROUND_OFS) * 0x8081) >> 23
+                                                    for c in (r, g, b))))
+
+    def index(self, x, y):
+        return self.indices[y * self.stride + x]
+
+
+def rgb565_mix(fg, bg, mix):
+    # lv_color_16_16_mix de LVGL: la mezcla que hace el firmware al dibujar un RGB565A8 sobre RGB565.
+    if mix == 255:
+        return fg
+    if mix == 0:
+        return bg
+    mix = (mix + 4) >> 3
+    bg32 = (bg | bg << 16) & 0x7E0F81F
+    fg32 = (fg | fg << 16) & 0x7E0F81F
+    res = ((((fg32 - bg32) * mix) >> 5) + bg32) & 0x7E0F81F
+    return (res >> 16 | res) & 0xFFFF
+
+
+def read_background(path):
+    # Fondo sobre el que se premezcla: '.bin' de LVGL v9 o fichero C de imágenes (su primer descriptor I8).
+    if path.lower().endswith(".c"):
+        with open(path, encoding="utf-8") as f:
+            code = COMMENT_RE.sub(lambda m: " " * len(m.group(0)), f.read())
+        for dsc in DSC_RE.finditer(code):
+            body = dsc.group(2)
+            if _field(body, "cf") != "LV_COLOR_FORMAT_I8":
+                continue
+            data = re.search(r"\.data\s*=\s*(?:\(.*?\))?\s*&?\s*(\w+)", body)
+            array = re.search(ARRAY_RE.format(name=re.escape(data.group(1))), code, re.S) if data else None
+            if not array:
+                raise ValueError(f"{path}: no se encuentra el array del fondo '{dsc.group(1)}'")
+            values = bytes(int(v, 0) for v in BYTE_RE.findall(array.group(2)))
+            return Background(path, _eval_int(_field(body, "w")), _eval_int(_field(body, "h")),
+                              _eval_int(_field(body, "stride")), values)
+        raise ValueError(f"{path}: no contiene ninguna imagen I8")
+    with open(path, "rb") as f:
+        data = f.read()
+    if len(data) < LVGL_BIN_HEADER.size:
+        raise ValueError(f"{path}: fichero demasiado corto")
+    magic, cf, _, w, h, stride, _ = LVGL_BIN_HEADER.unpack_from(data)
+    if magic != LVGL_BIN_MAGIC or cf != LV_COLOR_FORMAT_I8:
+        raise ValueError(f"{path}: el fondo debe ser un .bin de LVGL v9 en I8")
+    return Background(path, w, h, stride, data[LVGL_BIN_HEADER.size:])
+
+
+def parse_origin(text):
+    try:
+        x, y = (int(v) for v in text.split(","))
+    except ValueError:
+        raise ValueError(f"--canvas-origin espera 'x,y' (no '{text}')")
+    return x, y
+
+
+def background_signature(bg, origin, canvas_w, canvas_h):
+    # Igual que ui_helpers_get_background_signature: rectángulo del lienzo, paleta e índices del recorte.
+    x, y = origin
+    if x < 0 or y < 0 or x + canvas_w > bg.w or y + canvas_h > bg.h:
+        raise ValueError(f"el lienzo de {canvas_w}x{canvas_h} en ({x},{y}) no cabe en el fondo de {bg.w}x{bg.h}")
+    crc = zlib.crc32(struct.pack("<HHHH", x, y, canvas_w, canvas_h))
+    crc = zlib.crc32(bg.palette_bytes, crc)
+    for row in range(y, y + canvas_h):
+        crc = zlib.crc32(bg.indices[row * bg.stride + x:row * bg.stride + x + canvas_w], crc)
+    return crc or 1
+
+
+def preblend_frame(fr, bg, origin):
+    # Fotograma RGB565A8 (little-endian) -> RGB565 opaco con el fondo de debajo ya mezclado.
+    # Se mezcla igual que el compositor del firmware, así que el resultado es idéntico píxel a píxel.
+    n = fr.w * fr.h
+    colors = struct.unpack_from("<%dH" % n, b"".join(
+        fr.payload[y * fr.stride:y * fr.stride + fr.w * 2] for y in range(fr.h)), 0)
+    alpha = fr.payload[fr.stride * fr.h:fr.stride * fr.h + n]
+    ox, oy = origin[0] + fr.x, origin[1] + fr.y
+    out = [rgb565_mix(c, bg.rgb565[bg.index(ox + i % fr.w, oy + i // fr.w)], a)
+           for i, (c, a) in enumerate(zip(colors, alpha))]
+    blended = Frame(fr.path, LV_COLOR_FORMAT_RGB565, fr.w, fr.h, fr.w * 2, struct.pack("<%dH" % n, *out), fr.x, fr.y)
+    blended.canvas_w, blended.canvas_h = fr.canvas_w, fr.canvas_h
+    return blended
+
+
+def list_sequence_files(evo_dir, prefix):
+    # Devuelve los .bin de una secuencia ordenados por número de fotograma.
+    pattern = re.compile(re.escape(prefix) + r"(\d+)\.bin$")
+    found = []
+    for name in os.listdir(evo_dir):
+        m = pattern.match(name)
+        if m:
+            found.append((int(m.group(1)), os.path.join(evo_dir, name)))
+    found.sort()
+    return [p for _, p in found]
+
+
+def evolution_dirs(root):
+    # Acepta tanto un directorio de evolución como el directorio 'diymon' completo.
+    if any(list_sequence_files(root, p) for p in SEQUENCE_PREFIXES):
+        return [root]
+    dirs = []
+    for name in sorted(os.listdir(root)):
+        full = os.path.join(root, name)
+        if os.path.isdir(full) and any(list_sequence_files(full, p) for p in SEQUENCE_PREFIXES):
+            dirs.append(full)
+    return dirs
+
+
+def read_timing(evo_dir):
+    # Duraciones de 'ANIM.timing': nombre de secuencia (prefijo) o de fotograma -> milisegundos.
+    path = os.path.join(evo_dir, TIMING_FILENAME)
+    timing = {}
+    if not os.path.exists(path):
+        return timing
+    with open(path, encoding="utf-8") as f:
+        for n, line in enumerate(f, 1):
+            line = line.split("#", 1)[0].strip()
+            if not line:
+                continue
+            parts = line.split()
+            if len(parts) != 2 or not parts[1].isdigit() or not 0 < int(parts[1]) <= MAX_DURATION_MS:
+                raise ValueError(f"{path}:{n}: se esperaba '<secuencia|fotograma> <ms>' con 1..{MAX_DURATION_MS} ms")
+            timing[parts[0]] = int(parts[1])
+    return timing
+
+
+def frame_duration(timing, prefix, fr):
+    stem = os.path.splitext(os.path.basename(fr.path))[0]
+    return timing.get(stem, timing.get(prefix, 0))
+
+
+def align_up(value, align):
+    return (value + align - 1) // align * align
+
+
+def collect_sequences(evo_dir):
+    sequences = []
+    for prefix in SEQUENCE_PREFIXES:
+        files = list_sequence_files(evo_dir, prefix)
+        if files:
+            sequences.append((prefix, [read_lvgl_bin(p) for p in files]))
+    return sequences
+
+
+class PayloadStore:
+    # Payloads únicos de todas las evoluciones, direccionados por el hash de su contenido.
+    def __init__(self, align):
+        self.align = align
+        self.store_id = struct.unpack("<I", os.urandom(4))[0] or 1
+        self.offsets = {}
+        self.blob = bytearray()
+        self.referenced = 0      # Payloads referenciados por los packs (con repeticiones).
+        self.referenced_bytes = 0
+
+    def add(self, digest, data):
+        padded = align_up(len(data), self.align)
+        self.referenced += 1
+        self.referenced_bytes += padded
+        if digest not in self.offsets:
+            self.offsets[digest] = self.data_start() + len(self.blob)
+            self.blob += data + bytes(padded - len(data))
+        return self.offsets[digest]
+
+    def data_start(self):
+        return align_up(STORE_HEADER.size, self.align)
+
+    def write(self, root):
+        header = STORE_HEADER.pack(STORE_MAGIC, STORE_VERSION, self.align, self.store_id, len(self.offsets))
+        path = os.path.join(root, STORE_FILENAME)
+        with open(path, "wb") as f:
+            f.write(header + bytes(self.data_start() - len(header)) + self.blob)
+        return path
+
+
+def payload_digest(fr, data, raw_size, enc, base_digest):
+    # Identifica el contenido decodificado: dos entradas con el mismo hash producen los mismos
+    # bytes en el búfer del firmware. Un delta depende además del fotograma sobre el que se aplica.
+    h = hashlib.sha1()
+    h.update(struct.pack("<IHHHBB", raw_size, fr.w, fr.h, fr.stride, fr.packed_cf(), enc))
+    if fr.palette:
+        h.update(PALETTE.pack(*fr.palette))
+    if enc & FLAG_DELTA:
+        h.update(base_digest)
+    h.update(data)
+    return h.digest()
+
+
+def build_pack(evo_dir, align, encoding="raw", delta=False, keyframe_interval=8, trim=False, indexed=False,
+               store=None, big_endian=False, preblend=None, canvas_origin=(0, 0)):
+    sequences = collect_sequences(evo_dir)
+    timing = read_timing(evo_dir)
+    if trim:
+        sequences = [(prefix, [trim_frame(fr) for fr in seq]) for prefix, seq in sequences]
+    # Las premezcladas parten de los colores originales (sin cuantizar) y van detrás de las normales.
+    blended = [(prefix, [preblend_frame(fr, preblend, canvas_origin) for fr in seq]) for prefix, seq in sequences
+               if preblend and all(fr.cf == LV_COLOR_FORMAT_RGB565A8 for fr in seq)]
+    bg_signature = 0
+    if blended:
+        bg_signature = background_signature(preblend, canvas_origin, max(fr.canvas_w for _, seq in sequences for fr in seq),
+                                            max(fr.canvas_h for _, seq in sequences for fr in seq))
+    palettes = []
+    seq_palette = []
+    quant_err = []
+    for n, (prefix, seq) in enumerate(sequences):
+        if not indexed or any(fr.cf != LV_COLOR_FORMAT_RGB565A8 for fr in seq):
+            seq_palette.append(NO_PALETTE)
+            continue
+        seq, palette, err = quantize_sequence(seq)
+        sequences[n] = (prefix, seq)
+        quant_err.append(err)
+        if palette not in palettes:
+            palettes.append(palette)
+        seq_palette.append(palettes.index(palette))
+    seq_flags = [0] * len(sequences) + [SEQ_FLAG_PREBLENDED] * len(blended)
+    sequences += blended
+    seq_palette += [NO_PALETTE] * len(blended)
+    if big_endian:
+        # Tras recortar y cuantizar (que trabajan con los colores en little-endian): los deltas y los
+        # hashes del almacén se calculan ya sobre los bytes que leerá el firmware.
+        sequences = [(prefix, [swap_color_plane(fr) for fr in seq]) for prefix, seq in sequences]
+    frames = [fr for _, seq in sequences for fr in seq]
+    canvas_w = max(fr.canvas_w for fr in frames)
+    canvas_h = max(fr.canvas_h for fr in frames)
+
+    tables_size = PACK_HEADER.size + PACK_SEQ.size * len(sequences) + PACK_FRAME.size * len(frames) \
+        + PALETTE.size * len(palettes)
+    offset = align_up(tables_size, align) if store is None else 0
+
+    seq_table = bytearray()
+    frame_table = bytearray()
+    payloads = bytearray()
+    first = 0
+    raw_total = 0
+    stored_total = 0
+    indexed_total = 0
+    delta_count = 0
+    dirty_px_total = 0
+    timed = 0
+    for (prefix, seq), palette, seq_flag in zip(sequences, seq_palette, seq_flags):
+        seq_table += PACK_SEQ.pack(prefix.encode("ascii"), first, len(seq), palette, seq_flag)
+        first += len(seq)
+        digest = b""
+        for i, fr in enumerate(seq):
+            duration = frame_duration(timing, prefix, fr)
+            timed += duration != 0
+            stored = fr.stored_payload()
+            enc, data = encode_bytes(stored, rle_block_size(fr.packed_cf()), encoding)
+            raw_size = len(stored)
+            if delta and i % keyframe_interval != 0 and fr.same_rect(seq[i - 1]):
+                delta_raw, dirty_px = build_delta(seq[i - 1].payload, fr.payload, fr, fr.index_of)
+                if len(delta_raw) <= len(stored) * DELTA_MAX_RATIO:
+                    delta_enc, delta_data = encode_bytes(delta_raw, 1, encoding)
+                    if len(delta_data) < len(data):
+                        enc, data, raw_size = delta_enc | FLAG_DELTA, delta_data, len(delta_raw)
+                        delta_count += 1
+                        dirty_px_total += dirty_px
+            if store is not None:
+                digest = payload_digest(fr, data, raw_size, enc, digest)
+                frame_table += PACK_FRAME.pack(store.add(digest, data), len(data), raw_size, fr.x, fr.y, fr.w, fr.h,
+                                               fr.stride, fr.packed_cf(), enc, duration)
+            else:
+                frame_table += PACK_FRAME.pack(offset, len(data), raw_size, fr.x, fr.y, fr.w, fr.h, fr.stride,
+                                               fr.packed_cf(), enc, duration)
+                padded = align_up(len(data), align)
+                payloads += data + bytes(padded - len(data))
+                offset += padded
+            raw_total += fr.stride * fr.h + (fr.w * fr.h if fr.cf == LV_COLOR_FORMAT_RGB565A8 else 0)
+            stored_total += len(data)
+            indexed_total += len(stored)
+
+    flags, store_id = (PACK_FLAG_STORE, store.store_id) if store is not None else (0, 0)
+    if big_endian:
+        flags |= PACK_FLAG_BIG_ENDIAN
+    header = PACK_HEADER.pack(PACK_MAGIC, PACK_VERSION, len(sequences), len(frames), align, canvas_w, canvas_h,
+                              len(palettes), flags, store_id, bg_signature)
+    palette_bytes = b"".join(PALETTE.pack(*pal) for pal in palettes)
+    tables = header + seq_table + frame_table + (swap_rgb565(palette_bytes) if big_endian else palette_bytes)
+    if store is not None:
+        blob = tables  # Los payloads están en el almacén.
+    else:
+        blob = tables + bytes(align_up(len(tables), align) - len(tables)) + payloads
+
+    out_path = os.path.join(evo_dir, PACK_FILENAME)
+    with open(out_path, "wb") as f:
+        f.write(blob)
+    ratio = stored_total / raw_total if raw_total else 1.0
+    where = f" + payloads en {STORE_FILENAME}" if store is not None else ""
+    order = ", big-endian" if big_endian else ""
+    print(f"{out_path}: {len(sequences)} secuencias, {len(frames)} fotogramas, {len(blob)} bytes{where} "
+          f"({encoding}{order}, payloads al {ratio * 100:.1f}% del tamaño original)")
+    if palettes:
+        print(f"  indexado: {len(palettes)} paletas, fotogramas sin comprimir al {indexed_total / raw_total * 100:.1f}% "
+              f"de RGB565A8, error medio de cuantización {statistics.mean(quant_err):.2f}/255 por canal")
+    if trim:
+        drawn_px = sum(fr.w * fr.h for fr in frames)
+        print(f"  recorte: {drawn_px / len(frames):.0f} píxeles/fotograma de {canvas_w * canvas_h} "
+              f"(reducción {(1 - drawn_px / (len(frames) * canvas_w * canvas_h)) * 100:.1f}%)")
+    if blended:
+        print(f"  premezcla: {len(blended)} secuencias RGB565 sobre '{os.path.basename(preblend.path)}' con el lienzo "
+              f"en {canvas_origin[0]},{canvas_origin[1]} (firma {bg_signature:08x})")
+    elif preblend:
+        print("  aviso: ninguna secuencia RGB565A8 que premezclar")
+    if timing:
+        unused = sorted(set(timing) - {p for p, _ in sequences} -
+                        {os.path.splitext(os.path.basename(fr.path))[0] for fr in frames})
+        print(f"  duraciones: {timed} de {len(frames)} fotogramas con duración propia ({TIMING_FILENAME})")
+        if unused:
+            print(f"  aviso: entradas de {TIMING_FILENAME} sin fotograma: {', '.join(unused)}")
+    if delta_count:
+        full_px = canvas_w * canvas_h
+        print(f"  {delta_count} fotogramas delta; zona redibujada media {dirty_px_total / delta_count / full_px * 100:.1f}% "
+              f"del fotograma")
+    return out_path, sum(fr.w * fr.h for fr in frames), len(frames) * canvas_w * canvas_h, stored_total, raw_total
+
+
+def read_pack(path):
+    with open(path, "rb") as f:
+        data = f.read()
+    magic, version, seq_count, frame_count, align, _, _, palette_count, flags, store_id, bg_signature = \
+        PACK_HEADER.unpack_from(data, 0)
+    if magic != PACK_MAGIC or version != PACK_VERSION:
+        raise ValueError(f"{path}: cabecera de pack inválida")
+    payload_path = path
+    if flags & PACK_FLAG_STORE:
+        # Como el firmware: el almacén está en el directorio padre de la evolución.
+        payload_path = os.path.join(os.path.dirname(os.path.dirname(os.path.abspath(path))), STORE_FILENAME)
+        with open(payload_path, "rb") as f:
+            payload_data = f.read()
+        s_magic, s_version, s_align, s_id, _ = STORE_HEADER.unpack_from(payload_data, 0)
+        if (s_magic, s_version, s_align, s_id) != (STORE_MAGIC, STORE_VERSION, align, store_id):
+            raise ValueError(f"{path}: generado para el almacén {store_id:08x}, '{payload_path}' no coincide")
+    else:
+        payload_data = data
+    pos = PACK_HEADER.size
+    seqs = []
+    for _ in range(seq_count):
+        prefix, first, count, palette, seq_flags = PACK_SEQ.unpack_from(data, pos)
+        seqs.append((prefix.rstrip(b"\0").decode("ascii"), first, count, palette, seq_flags))
+        pos += PACK_SEQ.size
+    frames = []
+    for _ in range(frame_count):
+        frames.append(PACK_FRAME.unpack_from(data, pos))
+        pos += PACK_FRAME.size
+    palettes = []
+    big_endian = bool(flags & PACK_FLAG_BIG_ENDIAN)
+    for _ in range(palette_count):
+        # Las paletas se devuelven siempre con los colores en little-endian.
+        raw = data[pos:pos + PALETTE.size]
+        palettes.append(list(PALETTE.unpack(swap_rgb565(raw) if big_endian else raw)))
+        pos += PALETTE.size
+    return payload_data, align, seqs, frames, palettes, payload_path, big_endian, bg_signature
+
+
+def verify_pack(evo_dir, preblend=None, canvas_origin=(0, 0)):
+    path = os.path.join(evo_dir, PACK_FILENAME)
+    data, align, seqs, frames, palettes, _, big_endian, bg_signature = read_pack(path)
+    timing = read_timing(evo_dir)
+    errors = 0
+    signature_checked = False
+    for prefix, first, count, palette_idx, seq_flags in seqs:
+        blended = bool(seq_flags & SEQ_FLAG_PREBLENDED)
+        if blended and preblend is None:
+            print(f"  ERROR {prefix}: secuencia premezclada; hace falta --preblend para verificarla")
+            errors += 1
+            continue
+        palette = palettes[palette_idx] if palette_idx != NO_PALETTE else None
+        index_of = {}
+        files = list_sequence_files(evo_dir, prefix)
+        if len(files) != count:
+            print(f"  ERROR {prefix}: {count} fotogramas en el pack, {len(files)} en el directorio")
+            errors += 1
+        payload = None
+        for i, src in enumerate(files[:count]):
+            offset, size, raw_size, x, y, w, h, stride, cf, enc, duration = frames[first + i]
+            ref = read_lvgl_bin(src)
+            if duration != frame_duration(timing, prefix, ref):
+                print(f"  ERROR {os.path.basename(src)}: duración {duration} ms en el pack, "
+                      f"{frame_duration(timing, prefix, ref)} ms en {TIMING_FILENAME}")
+                errors += 1
+            if blended and not signature_checked:
+                signature_checked = True
+                expected = background_signature(preblend, canvas_origin, ref.canvas_w, ref.canvas_h)
+                if expected != bg_signature:
+                    print(f"  ERROR firma del fondo {bg_signature:08x} en el pack, {expected:08x} con "
+                          f"'{os.path.basename(preblend.path)}' y el lienzo en {canvas_origin[0]},{canvas_origin[1]}")
+                    errors += 1
+            if (x, y, w, h) != (0, 0, ref.w, ref.h):
+                ref = trim_frame(ref)
+            if blended:
+                ref = preblend_frame(ref, preblend, canvas_origin)
+            ref_cf = ref.cf
+            if cf == LV_COLOR_FORMAT_I8:
+                if palette is None:
+                    print(f"  ERROR {os.path.basename(src)}: fotograma indexado sin paleta")
+                    errors += 1
+                    continue
+                ref = quantize_frame(ref, palette, index_of)
+                ref_cf = LV_COLOR_FORMAT_I8
+            elif big_endian:
+                ref = swap_color_plane(ref)
+            try:
+                decoded = decode_payload(enc, data[offset:offset + size], cf, raw_size)
+                if enc & FLAG_DELTA:
+                    if payload is None:
+                        raise ValueError("la secuencia empieza por un delta")
+                    # Se reconstruye como el firmware: aplicando el delta sobre el fotograma anterior.
+                    payload = apply_delta(payload, decoded, ref, palette if cf == LV_COLOR_FORMAT_I8 else None)
+                elif cf == LV_COLOR_FORMAT_I8:
+                    payload = expand_indexed(decoded, w, h, palette)
+                else:
+                    payload = decoded
+            except (ValueError, IndexError, struct.error) as e:
+                payload = None
+                print(f"  ERROR {os.path.basename(src)}: {e}")
+                errors += 1
+                continue
+            plane_bytes = ref.stride * ref.h + (ref.w * ref.h if ref.cf == LV_COLOR_FORMAT_RGB565A8 else 0)
+            if offset % align or (x, y, w, h, stride, cf) != (ref.x, ref.y, ref.w, ref.h, ref.stride, ref_cf) \
+                    or payload[:plane_bytes] != ref.payload[:plane_bytes]:
+                print(f"  ERROR {os.path.basename(src)}: el contenido empaquetado no coincide")
+                errors += 1
+    status = "OK" if errors == 0 else f"{errors} errores"
+    print(f"{path}: verificación {status}")
+    return errors == 0
+
+
+def time_reads(read_fn, items, rounds):
+    samples = []
+    for _ in range(rounds):
+        for item in items:
+            t0 = time.perf_counter()
+            read_fn(item)
+            samples.append((time.perf_counter() - t0) * 1e6)
+    return samples
+
+
+def report(label, samples):
+    print(f"  {label:<22} media {statistics.mean(samples):8.1f} us  "
+          f"p95 {sorted(samples)[int(len(samples) * 0.95) - 1]:8.1f} us  "
+          f"máx {max(samples):8.1f} us  desv {statistics.pstdev(samples):7.1f} us")
+
+
+def bench_pack(evo_dir, rounds):
+    path = os.path.join(evo_dir, PACK_FILENAME)
+    _, _, seqs, frames, _, payload_path, _, _ = read_pack(path)
+    # Las secuencias premezcladas repiten los mismos .bin: se compara solo con las normales.
+    seqs = [s for s in seqs if not s[4] & SEQ_FLAG_PREBLENDED]
+    files = [p for prefix, _, _, _, _ in seqs for p in list_sequence_files(evo_dir, prefix)]
+    frames = [frames[first + i] for _, first, count, _, _ in seqs for i in range(count)]
+
+    # Formato actual: abrir, saltar la cabecera de 12 bytes, leer y cerrar por fotograma.
+    def per_file(p):
+        with open(p, "rb", buffering=0) as f:
+            f.seek(LVGL_BIN_HEADER.size)
+            f.read()
+
+    pack_file = open(payload_path, "rb", buffering=0)
+
+    def packed(entry):
+        pack_file.seek(entry[0])
+        pack_file.read(entry[1])
+
+    print(f"{evo_dir}: {len(frames)} fotogramas x {rounds} rondas")
+    report("un .bin por fotograma", time_reads(per_file, files, rounds))
+    report("ANIM.pak (seek+read)", time_reads(packed, frames, rounds))
+    pack_file.close()
+
+
+def codecs_bench(evo_dir, rounds, spi_mhz):
+    # Compara raw, RLE y LZ4 sobre los fotogramas de un directorio de evolución.
+    frames = [fr for _, seq in collect_sequences(evo_dir) for fr in seq]
+    results = {}
+    for name, enc in (("raw", ENC_RAW), ("rle", ENC_RLE), ("lz4", ENC_LZ4)):
+        sizes = []
+        decode_us = []
+        for fr in frames:
+            if enc == ENC_RAW:
+                data = fr.payload
+            elif enc == ENC_RLE:
+                data = rle_compress(fr.payload, rle_block_size(fr.cf))
+            else:
+                data = lz4_compress(fr.payload)
+            sizes.append(len(data))
+            samples = []
+            for _ in range(rounds):
+                t0 = time.perf_counter()
+                out = decode_payload(enc, data, fr.cf, len(fr.payload))
+                samples.append((time.perf_counter() - t0) * 1e6)
+            if out != fr.payload:
+                raise ValueError(f"{fr.path}: la ida y vuelta {name} no coincide")
+            decode_us.append(statistics.median(samples))
+        results[name] = (sizes, decode_us)
+
+    raw_mean = statistics.mean(results["raw"][0])
+    print(f"{evo_dir}: {len(frames)} fotogramas, SPI estimado a {spi_mhz} MHz (1 bit)")
+    for name, (sizes, decode_us) in results.items():
+        mean_bytes = statistics.mean(sizes)
+        spi_us = mean_bytes * 8 / spi_mhz
+        print(f"  {name:<4} {mean_bytes:9.0f} bytes/fotograma ({mean_bytes / raw_mean * 100:5.1f}%)  "
+              f"SPI {spi_us:8.0f} us  descompresión host {statistics.mean(decode_us):8.1f} us")
+    return results
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Empaquetador de animaciones DIYMON (ANIM.pak)")
+    parser.add_argument("command", choices=["build", "verify", "bench", "codecs"])
+    parser.add_argument("path", help="Directorio de evolución o directorio 'diymon' completo")
+    parser.add_argument("--align", type=int, default=512, help="Alineación de los payloads (bytes)")
+    parser.add_argument("--rounds", type=int, default=5, help="Rondas de lectura en 'bench' y 'codecs'")
+    parser.add_argument("--encoding", choices=["raw", "rle", "lz4", "best"], default="raw",
+                        help="Codificación de los fotogramas en 'build' ('best' elige la menor por fotograma)")
+    parser.add_argument("--delta", action="store_true",
+                        help="Guardar como delta los fotogramas que cambian poco respecto al anterior")
+    parser.add_argument("--keyframe-interval", type=int, default=8,
+                        help="Cada cuántos fotogramas se fuerza un fotograma completo con --delta")
+    parser.add_argument("--trim", action="store_true",
+                        help="Recortar los márgenes transparentes de cada fotograma")
+    parser.add_argument("--indexed", action="store_true",
+                        help="Cuantizar cada secuencia a una paleta de 256 colores (1 byte/píxel + alfa)")
+    parser.add_argument("--store", action="store_true",
+                        help="Guardar una sola vez los fotogramas repetidos entre evoluciones en 'STORE.pak' "
+                             "(requiere el directorio 'diymon' completo)")
+    parser.add_argument("--big-endian", action="store_true",
+                        help="Guardar los colores RGB565 en el orden de bytes del panel "
+                             "(firmware con CONFIG_LVGL_PORT_RGB565_BIG_ENDIAN)")
+    parser.add_argument("--preblend", nargs="?", const=DEFAULT_BACKGROUND, metavar="FONDO",
+                        help="Añadir las secuencias RGB565A8 premezcladas con el fondo (.c o .bin I8; por defecto "
+                             "el de la pantalla principal) para el firmware con CONFIG_DIYMON_ANIM_PREBLENDED")
+    parser.add_argument("--canvas-origin", default=DEFAULT_CANVAS_ORIGIN, metavar="X,Y",
+                        help="Posición del lienzo de animación sobre el fondo con --preblend")
+    parser.add_argument("--spi-mhz", type=float, default=20.0, help="Reloj SPI de la SD para estimar la transferencia")
+    args = parser.parse_args()
+
+    dirs = evolution_dirs(args.path)
+    if not dirs:
+        print(f"No se encontraron fotogramas ANIM_*.bin en '{args.path}'.")
+        return 1
+
+    preblend, canvas_origin = None, (0, 0)
+    if args.preblend:
+        try:
+            preblend = read_background(args.preblend)
+            canvas_origin = parse_origin(args.canvas_origin)
+        except (OSError, ValueError) as e:
+            print(f"ERROR {e}")
+            return 1
+
+    store = None
+    if args.command == "build" and args.store:
+        if dirs == [args.path]:
+            print("--store necesita el directorio 'diymon' completo: el almacén es común a todas las evoluciones.")
+            return 1
+        store = PayloadStore(args.align)
+
+    if args.command == "codecs" and not lz4_block:
+        print("Aviso: paquete 'lz4' no instalado; LZ4 se mide con la implementación en Python puro.")
+
+    ok = True
+    totals = {}
+    drawn_px = canvas_px = stored_bytes = raw_bytes = 0
+    for d in dirs:
+        if args.command == "build":
+            _, drawn, canvas, stored, raw = build_pack(d, args.align, args.encoding, args.delta,
+                                                       max(1, args.keyframe_interval), args.trim, args.indexed, store,
+                                                       args.big_endian, preblend, canvas_origin)
+            drawn_px += drawn
+            canvas_px += canvas
+            stored_bytes += stored
+            raw_bytes += raw
+        elif args.command == "verify":
+            ok &= verify_pack(d, preblend, canvas_origin)
+        elif args.command == "codecs":
+            for name, (sizes, decode_us) in codecs_bench(d, args.rounds, args.spi_mhz).items():
+                acc = totals.setdefault(name, ([], []))
+                acc[0].extend(sizes)
+                acc[1].extend(decode_us)
+        else:
+            bench_pack(d, args.rounds)
+
+    if store is not None:
+        store_path = store.write(args.path)
+        saved = store.referenced_bytes - len(store.blob)
+        print(f"{store_path}: {len(store.offsets)} payloads únicos de {store.referenced} "
+              f"({store.referenced - len(store.offsets)} duplicados), {len(store.blob) / 1e6:.2f} MB; "
+              f"ahorro {saved / 1e6:.2f} MB ({saved / store.referenced_bytes * 100:.1f}%), almacén {store.store_id:08x}")
+    if args.command == "build" and args.trim and len(dirs) > 1:
+        print(f"Recorte en {len(dirs)} directorios: reducción media de píxeles {(1 - drawn_px / canvas_px) * 100:.1f}%")
+    if args.command == "build" and len(dirs) > 1:
+        print(f"Total: {stored_bytes / 1e6:.2f} MB de payloads frente a {raw_bytes / 1e6:.2f} MB en RGB565A8 "
+              f"({stored_bytes / raw_bytes * 100:.1f}%)")
+
+    if totals:
+        raw_mean = statistics.mean(totals["raw"][0])
+        print(f"Total ({len(totals['raw'][0])} fotogramas):")
+        for name, (sizes, decode_us) in totals.items():
+            print(f"  {name:<4} {statistics.mean(sizes):9.0f} bytes/fotograma "
+                  f"({statistics.mean(sizes) / raw_mean * 100:5.1f}%)  {sum(sizes) / 1e6:6.2f} MB  "
+                  f"descompresión host {statistics.mean(decode_us):8.1f} us")
+    return 0 if ok else 1
+
+
+if __name__ == "__main__":
+    sys.exit(main())
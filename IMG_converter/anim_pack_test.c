@@ -0,0 +1,621 @@
+/* Fichero: IMG_converter/anim_pack_test.c */
+/* Descripción: Prueba de ida y vuelta de host para los packs de animación. Genera un directorio 'diymon' sintético con dos evoluciones de fotogramas RGB565A8 de 150x230 (algunos con bytes de relleno al final, como los exportados), construye con anim_pack.py varias variantes del pack, las abre con el mismo código del firmware (components/ui/animation_pack.c: 'animation_pack_open', validación de tablas y 'animation_pack_find_seq') y compara cada fotograma decodificado byte a byte con el .bin de origen, recortado a la posición del fotograma. Cubre las codificaciones RAW, RLE y LZ4 (también 'best'), los fotogramas delta ('animation_pack_apply_delta') e I8 (expansión de la paleta, también en los deltas), un fotograma LZ4 casi incompresible cuyo margen de descompresión in situ debe caber en ANIM_PACK_DECODE_MARGIN, el almacén compartido, la elección de la secuencia premezclada según la firma del fondo, el pack en memoria ('animation_pack_open_mapped') y la lectura por filas, y comprueba que se rechaza un pack con un fotograma RGB565A8 sin plano alfa o con un stride menor que w*2. Con --scan recorre un directorio 'diymon' real y valida cada '<prefijo><n>.bin' como la comprobación de la SD (animation_integrity.c): 'animation_pack_bin_payload_size' sobre la cabecera y un fichero de al menos 12 bytes más los píxeles; los huecos de la numeración cuentan como defectuosos. El driver 'S:' se sustituye por stdio.
+   Compilar:  gcc -O2 -Wall -Wextra -ffunction-sections -fdata-sections -Wl,--gc-sections -DLV_CONF_SKIP -DLV_USE_LZ4_INTERNAL=1 -DLV_USE_STDLIB_STRING=LV_STDLIB_CLIB -Ihost -I../components_dependencies/lvgl -I../components/ui -o anim_pack_test anim_pack_test.c ../components/ui/animation_pack.c ../components_dependencies/lvgl/src/libs/lz4/lz4.c ../components_dependencies/lvgl/src/misc/lv_color.c ../components_dependencies/lvgl/src/misc/lv_area.c ../components_dependencies/lvgl/src/stdlib/clib/lv_string_clib.c
+              (añadir -DCONFIG_LVGL_PORT_RGB565_BIG_ENDIAN=1 para probar los packs big-endian)
+   Uso:       ./anim_pack_test [--work DIR] [--tool anim_pack.py] [--keep]
+              ./anim_pack_test --scan ../SD/diymon   (solo valida los '.bin' sueltos con la regla del firmware)
+              Sin --work se usa un directorio temporal que se borra si todo sale bien. */
+/* Último cambio: 18/10/2026 - 05:15 */
+#define _GNU_SOURCE
+#include "animation_pack.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <libgen.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#define CANVAS_W        150
+#define CANVAS_H        230
+#define CANVAS_STRIDE   (CANVAS_W * 2)
+#define ALPHA_PLANE     (CANVAS_STRIDE * CANVAS_H)
+#define BIN_PAYLOAD     (ALPHA_PLANE + CANVAS_W * CANVAS_H)
+#define BIN_PADDING     46          // Relleno que traen algunos .bin exportados.
+#define EVOLUTIONS      2
+#define MAX_FRAMES      6
+#define ROW_BAND        16          // Filas por banda en la prueba de lectura por filas.
+#define FRAME_BUF       (CANVAS_W * CANVAS_H * 3 + ANIM_PACK_DECODE_MARGIN) // Como el búfer del cargador.
+
+// Variantes del pack: opciones de anim_pack.py y lo que se comprueba además de los fotogramas.
+#define VARIANT_STORE       0x01    // Payloads en STORE.pak.
+#define VARIANT_PREBLEND    0x02    // Secuencias premezcladas con el fondo por defecto.
+#define VARIANT_RLE         0x04    // Debe haber fotogramas RLE.
+#define VARIANT_LZ4         0x08    // Debe haber fotogramas LZ4.
+#define VARIANT_NEAR_RAW    0x10    // Debe haber un LZ4 completo de al menos NEAR_RAW_PCT % de raw_size.
+#define VARIANT_DELTA       0x20    // Debe haber fotogramas delta.
+#define VARIANT_INDEXED     0x40    // Debe haber fotogramas I8.
+#define VARIANT_CORRUPT     0x80    // Tras comprobarlo, se corrompe una copia del pack y debe rechazarse.
+#define NEAR_RAW_PCT        90
+
+typedef struct {
+    const char *name;
+    const char *args;
+    unsigned flags;
+} variant_t;
+
+static const variant_t s_variants[] = {
+    { "raw",       "--encoding raw",                                VARIANT_CORRUPT },
+    { "recorte",   "--encoding raw --trim",                         0 },
+    { "almacen",   "--encoding raw --store",                        VARIANT_STORE },
+    { "premezcla", "--encoding raw --preblend",                     VARIANT_PREBLEND },
+    { "rle",       "--encoding rle",                                VARIANT_RLE },
+    { "lz4",       "--encoding lz4",                                VARIANT_LZ4 | VARIANT_NEAR_RAW },
+    { "best",      "--encoding best --trim --delta --keyframe-interval 4", VARIANT_DELTA },
+    { "indexado",  "--encoding best --trim --indexed --delta --keyframe-interval 4", VARIANT_DELTA | VARIANT_INDEXED },
+    { "lz4-delta", "--encoding lz4 --trim --delta --store",         VARIANT_STORE | VARIANT_LZ4 | VARIANT_DELTA },
+    { "premezcla-delta", "--encoding rle --trim --delta --preblend", VARIANT_PREBLEND | VARIANT_RLE | VARIANT_DELTA },
+};
+
+// Secuencias sintéticas: 'IDLE' es un sprite con márgenes transparentes y bordes semitransparentes que
+// solo cambia en una zona pequeña (igual en las dos evoluciones); 'EAT' es ruido opaco distinto en cada una.
+typedef struct {
+    const char *prefix;
+    int frames;
+    bool sprite;
+} sequence_t;
+
+static const sequence_t s_sequences[] = {
+    { "ANIM_IDLE_", MAX_FRAMES, true },
+    { "ANIM_EAT_",  3,          false },
+};
+#define SEQ_COUNT (sizeof(s_sequences) / sizeof(s_sequences[0]))
+
+static char s_work[PATH_MAX];
+static char s_diymon[PATH_MAX];
+static char s_tool[PATH_MAX];
+static uint8_t *s_src[EVOLUTIONS][SEQ_COUNT][MAX_FRAMES];
+static uint8_t s_frame[FRAME_BUF];
+static uint8_t s_delta[FRAME_BUF];
+static uint8_t s_band[CANVAS_W * ROW_BAND * 3];
+static unsigned s_checked;
+static unsigned s_errors;
+
+// Fotogramas vistos en la variante en curso, para comprobar que ejercita lo que se espera de ella.
+static struct {
+    unsigned rle, lz4, delta, indexed;
+    bool has_near_raw;
+    animation_pack_frame_t near_raw;    // LZ4 completo con la mayor proporción size/raw_size.
+} s_seen;
+
+#define FAIL(...) do { s_errors++; printf("  ERROR " __VA_ARGS__); printf("\n"); } while (0)
+
+// --- Sustituto del driver 'S:' de LVGL sobre stdio ---
+
+lv_fs_res_t lv_fs_open(lv_fs_file_t *file_p, const char *path, lv_fs_mode_t mode) {
+    (void)mode;
+    if (path[0] && path[1] == ':') path += 2; // Sin letra de unidad: la ruta es del host.
+    static lv_fs_drv_t drv;         // animation_pack_close solo cierra ficheros con driver.
+    FILE *f = fopen(path, "rb");
+    file_p->file_d = f;
+    file_p->drv = f ? &drv : NULL;
+    file_p->cache = NULL;
+    return f ? LV_FS_RES_OK : LV_FS_RES_NOT_EX;
+}
+
+lv_fs_res_t lv_fs_close(lv_fs_file_t *file_p) {
+    if (file_p->file_d) fclose(file_p->file_d);
+    file_p->file_d = NULL;
+    file_p->drv = NULL;
+    return LV_FS_RES_OK;
+}
+
+lv_fs_res_t lv_fs_read(lv_fs_file_t *file_p, void *buf, uint32_t btr, uint32_t *br) {
+    size_t n = fread(buf, 1, btr, file_p->file_d);
+    if (br) *br = (uint32_t)n;
+    return ferror((FILE *)file_p->file_d) ? LV_FS_RES_HW_ERR : LV_FS_RES_OK;
+}
+
+lv_fs_res_t lv_fs_seek(lv_fs_file_t *file_p, uint32_t pos, lv_fs_whence_t whence) {
+    int w = whence == LV_FS_SEEK_END ? SEEK_END : whence == LV_FS_SEEK_CUR ? SEEK_CUR : SEEK_SET;
+    return fseek(file_p->file_d, (long)pos, w) == 0 ? LV_FS_RES_OK : LV_FS_RES_HW_ERR;
+}
+
+lv_fs_res_t lv_fs_tell(lv_fs_file_t *file_p, uint32_t *pos) {
+    long p = ftell(file_p->file_d);
+    if (p < 0) return LV_FS_RES_HW_ERR;
+    *pos = (uint32_t)p;
+    return LV_FS_RES_OK;
+}
+
+// --- Fotogramas de origen ---
+
+static uint16_t rd16(const uint8_t *p) {
+    return (uint16_t)(p[0] | p[1] << 8);
+}
+
+static void wr16(uint8_t *p, uint16_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static uint32_t next_rand(uint32_t *x) {
+    *x = *x * 1664525u + 1013904223u;
+    return *x >> 8;
+}
+
+static void gen_sprite(uint8_t *px, int frame) {
+    static const uint16_t colors[8] = { 0x001F, 0x07E0, 0xF800, 0xFFE0, 0x07FF, 0xF81F, 0x8410, 0xFD20 };
+    memset(px, 0, BIN_PAYLOAD);
+    for (int y = 40; y < 200; y++) {
+        for (int x = 30; x < 120; x++) {
+            uint16_t c = colors[(x / 10 + y / 10) & 7];
+            // Zona que cambia entre fotogramas: se desplaza y cambia de color.
+            if (y >= 80 && y < 86 && x >= 60 + frame * 2 && x < 70 + frame * 2) c = (uint16_t)(0x1082 * (frame + 1));
+            bool edge = x == 30 || x == 119 || y == 40 || y == 199;
+            wr16(px + y * CANVAS_STRIDE + x * 2, c);
+            px[ALPHA_PLANE + y * CANVAS_W + x] = edge ? 128 : 255;
+        }
+    }
+}
+
+static void gen_noise(uint8_t *px, uint32_t seed, int frame) {
+    // Hasta 200 colores por secuencia (cabe en una paleta) y alfa aleatorio: LZ4 apenas lo reduce.
+    // Una franja uniforme de 4 filas asegura que RLE y LZ4 queden por debajo del tamaño crudo.
+    uint16_t colors[200];
+    uint32_t x = seed;
+    for (int i = 0; i < 200; i++) colors[i] = (uint16_t)next_rand(&x);
+    x = seed * 31u + (uint32_t)frame;
+    for (int y = 0; y < CANVAS_H; y++) {
+        for (int i = 0; i < CANVAS_W; i++) {
+            bool band = y < 4;
+            wr16(px + y * CANVAS_STRIDE + i * 2, band ? 0 : colors[next_rand(&x) % 200]);
+            px[ALPHA_PLANE + y * CANVAS_W + i] = band ? 255 : (uint8_t)(1 + next_rand(&x) % 255);
+        }
+    }
+}
+
+static int make_dir(const char *path) {
+    return mkdir(path, 0755) == 0 || errno == EEXIST ? 0 : -1;
+}
+
+static int write_bin(const char *path, const uint8_t *px, uint32_t padding) {
+    lv_image_header_t hdr = {
+        .magic = LV_IMAGE_HEADER_MAGIC,
+        .cf = LV_COLOR_FORMAT_RGB565A8,
+        .w = CANVAS_W,
+        .h = CANVAS_H,
+        .stride = CANVAS_STRIDE,
+    };
+    static const uint8_t pad[BIN_PADDING] = { 0xA5 };
+    FILE *f = fopen(path, "wb");
+    if (!f) return -1;
+    bool ok = fwrite(&hdr, sizeof(hdr), 1, f) == 1 && fwrite(px, BIN_PAYLOAD, 1, f) == 1 &&
+              (padding == 0 || fwrite(pad, padding, 1, f) == 1);
+    return fclose(f) == 0 && ok ? 0 : -1;
+}
+
+static int create_sources(void) {
+    snprintf(s_diymon, sizeof(s_diymon), "%s/diymon", s_work);
+    if (make_dir(s_work) || make_dir(s_diymon)) return -1;
+    for (int e = 0; e < EVOLUTIONS; e++) {
+        char dir[PATH_MAX + 16];
+        snprintf(dir, sizeof(dir), "%s/%d", s_diymon, e + 1);
+        if (make_dir(dir)) return -1;
+        for (size_t s = 0; s < SEQ_COUNT; s++) {
+            for (int i = 0; i < s_sequences[s].frames; i++) {
+                uint8_t *px = malloc(BIN_PAYLOAD);
+                if (!px) return -1;
+                if (s_sequences[s].sprite) {
+                    gen_sprite(px, i);
+                } else {
+                    gen_noise(px, 0x9E3779B9u * (uint32_t)(e + 1), i);
+                }
+                s_src[e][s][i] = px;
+                char path[PATH_MAX + 64];
+                snprintf(path, sizeof(path), "%s/%s%d.bin", dir, s_sequences[s].prefix, i + 1);
+                if (write_bin(path, px, e == 0 && i == 0 ? BIN_PADDING : 0)) return -1;
+            }
+        }
+    }
+    return 0;
+}
+
+// --- Comprobación de los fotogramas decodificados ---
+
+static uint16_t expected_color(uint16_t c) {
+#if CONFIG_LVGL_PORT_RGB565_BIG_ENDIAN
+    return (uint16_t)(c >> 8 | c << 8);
+#else
+    return c;
+#endif
+}
+
+// Compara el fotograma decodificado en 'got' con el origen recortado a (x, y, w, h). Un fotograma
+// premezclado (RGB565) solo se compara en los píxeles opacos: el resto lleva el fondo mezclado. Uno I8
+// se compara en los visibles: los transparentes toman palette[0] al expandirse.
+static bool compare_frame(const animation_pack_frame_t *fr, const uint8_t *got, const uint8_t *src) {
+    bool preblended = fr->cf == LV_COLOR_FORMAT_RGB565;
+    bool indexed = fr->cf == LV_COLOR_FORMAT_I8;
+    if ((uint32_t)fr->x + fr->w > CANVAS_W || (uint32_t)fr->y + fr->h > CANVAS_H) return false;
+    // El recorte solo puede quitar píxeles transparentes.
+    for (int y = 0; y < CANVAS_H; y++) {
+        for (int x = 0; x < CANVAS_W; x++) {
+            bool inside = x >= fr->x && x < fr->x + fr->w && y >= fr->y && y < fr->y + fr->h;
+            if (!inside && src[ALPHA_PLANE + y * CANVAS_W + x]) return false;
+        }
+    }
+    const uint8_t *alpha = got + (uint32_t)fr->stride * fr->h;
+    for (int y = 0; y < fr->h; y++) {
+        for (int x = 0; x < fr->w; x++) {
+            uint32_t s = (uint32_t)(fr->y + y) * CANVAS_W + fr->x + x;
+            uint8_t a = src[ALPHA_PLANE + s];
+            if (!preblended && alpha[y * fr->w + x] != a) return false;
+            if ((preblended && a != 255) || (indexed && a == 0)) continue;
+            if (rd16(got + y * fr->stride + x * 2) != expected_color(rd16(src + s * 2))) return false;
+        }
+    }
+    return true;
+}
+
+// Las bandas de animation_pack_read_rows deben coincidir con las filas del fotograma completo.
+static bool compare_rows(animation_pack_t *pack, const animation_pack_frame_t *fr, const uint16_t *palette) {
+    uint32_t color_plane = (uint32_t)fr->stride * fr->h;
+    for (uint16_t y = 0; y < fr->h; y += ROW_BAND) {
+        uint16_t rows = fr->h - y < ROW_BAND ? fr->h - y : ROW_BAND;
+        if (!animation_pack_read_rows(pack, fr, palette, y, rows, s_band, sizeof(s_band)) ||
+            memcmp(s_band, s_frame + (uint32_t)y * fr->stride, (uint32_t)rows * fr->stride) != 0 ||
+            memcmp(s_band + (uint32_t)rows * fr->stride, s_frame + color_plane + (uint32_t)y * fr->w,
+                   (uint32_t)rows * fr->w) != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void check_sequence(const char *what, animation_pack_t *pack, const animation_pack_seq_t *seq, int evo, size_t s) {
+    const uint16_t *palette = animation_pack_get_palette(pack, seq);
+    for (uint16_t i = 0; i < seq->frame_count; i++) {
+        const animation_pack_frame_t *fr = animation_pack_get_frame(pack, seq, i);
+        bool ok;
+        if (fr->encoding & ANIM_PACK_FLAG_DELTA) {
+            // Como el cargador: el delta se lee aparte (raw_size + margen) y se aplica sobre el anterior.
+            const animation_pack_frame_t *prev = i ? animation_pack_get_frame(pack, seq, i - 1) : NULL;
+            ok = prev && prev->x == fr->x && prev->y == fr->y && prev->w == fr->w && prev->h == fr->h &&
+                 fr->raw_size + ANIM_PACK_DECODE_MARGIN <= sizeof(s_delta) &&
+                 animation_pack_read_frame(pack, fr, palette, s_delta, fr->raw_size + ANIM_PACK_DECODE_MARGIN) &&
+                 animation_pack_apply_delta(fr, palette, s_delta, s_frame, sizeof(s_frame), NULL, 0, NULL);
+            s_seen.delta++;
+        } else {
+            ok = animation_pack_read_frame(pack, fr, palette, s_frame, sizeof(s_frame));
+            if ((fr->encoding & ANIM_PACK_ENC_MASK) == ANIM_PACK_ENC_LZ4 &&
+                (!s_seen.has_near_raw || (uint64_t)fr->size * s_seen.near_raw.raw_size >
+                                         (uint64_t)s_seen.near_raw.size * fr->raw_size)) {
+                s_seen.near_raw = *fr;
+                s_seen.has_near_raw = true;
+            }
+        }
+        s_seen.rle += (fr->encoding & ANIM_PACK_ENC_MASK) == ANIM_PACK_ENC_RLE;
+        s_seen.lz4 += (fr->encoding & ANIM_PACK_ENC_MASK) == ANIM_PACK_ENC_LZ4;
+        s_seen.indexed += fr->cf == LV_COLOR_FORMAT_I8;
+        if (!ok) {
+            FAIL("%s: evolución %d, %s%d no se pudo leer", what, evo + 1, s_sequences[s].prefix, i + 1);
+            return;
+        }
+        s_checked++;
+        if (!compare_frame(fr, s_frame, s_src[evo][s][i])) {
+            FAIL("%s: evolución %d, %s%d distinto del origen", what, evo + 1, s_sequences[s].prefix, i + 1);
+        } else if (animation_pack_frame_has_row_access(fr) && !compare_rows(pack, fr, palette)) {
+            FAIL("%s: evolución %d, %s%d distinto al leerlo por filas", what, evo + 1, s_sequences[s].prefix, i + 1);
+        }
+    }
+}
+
+// Todas las secuencias del pack por su prefijo; 'preblended' indica cuál debe devolver animation_pack_find_seq.
+static void check_pack(const char *what, animation_pack_t *pack, int evo, bool preblended) {
+    for (size_t s = 0; s < SEQ_COUNT; s++) {
+        const animation_pack_seq_t *seq = animation_pack_find_seq(pack, s_sequences[s].prefix);
+        if (!seq || seq->frame_count != s_sequences[s].frames) {
+            FAIL("%s: evolución %d, secuencia %s ausente o incompleta", what, evo + 1, s_sequences[s].prefix);
+        } else if (((seq->flags & ANIM_PACK_SEQ_FLAG_PREBLENDED) != 0) != preblended) {
+            FAIL("%s: evolución %d, %s: animation_pack_find_seq eligió la secuencia %s", what, evo + 1,
+                 s_sequences[s].prefix, preblended ? "normal" : "premezclada");
+        } else {
+            check_sequence(what, pack, seq, evo, s);
+        }
+    }
+}
+
+static uint8_t* read_file(const char *path, uint32_t *size) {
+    FILE *f = fopen(path, "rb");
+    if (!f) return NULL;
+    fseek(f, 0, SEEK_END);
+    long n = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    uint8_t *data = n > 0 ? malloc((size_t)n) : NULL;
+    if (data && fread(data, 1, (size_t)n, f) != (size_t)n) {
+        free(data);
+        data = NULL;
+    }
+    fclose(f);
+    *size = (uint32_t)n;
+    return data;
+}
+
+static void check_evolution(const variant_t *v, int evo) {
+    char dir[PATH_MAX + 16];
+    char what[64];
+    snprintf(dir, sizeof(dir), "S:%s/%d", s_diymon, evo + 1);
+
+    animation_pack_set_background_signature(0);
+    animation_pack_t *pack = animation_pack_open(dir);
+    if (!pack) {
+        FAIL("%s: evolución %d, animation_pack_open rechazó el pack", v->name, evo + 1);
+        return;
+    }
+    if (animation_pack_uses_store(pack) != ((v->flags & VARIANT_STORE) != 0)) {
+        FAIL("%s: evolución %d, el pack %s el almacén", v->name, evo + 1, animation_pack_uses_store(pack) ? "usa" : "no usa");
+    }
+    check_pack(v->name, pack, evo, false);
+
+    if (v->flags & VARIANT_PREBLEND) {
+        uint32_t signature = pack->header.bg_signature;
+        if (signature == 0) FAIL("%s: evolución %d, el pack no trae firma de fondo", v->name, evo + 1);
+        // Con la firma del fondo en pantalla se eligen las premezcladas; con otra, las normales.
+        animation_pack_set_background_signature(signature);
+        snprintf(what, sizeof(what), "%s (con su fondo)", v->name);
+        check_pack(what, pack, evo, true);
+        animation_pack_set_background_signature(signature ^ 1);
+        snprintf(what, sizeof(what), "%s (otro fondo)", v->name);
+        check_pack(what, pack, evo, false);
+        animation_pack_set_background_signature(0);
+    }
+    animation_pack_close(pack);
+
+    // El mismo pack en memoria, como la copia de la partición de assets (solo autocontenido).
+    if (v->flags & VARIANT_STORE) return;
+    char path[PATH_MAX + 32];
+    uint32_t size = 0;
+    snprintf(path, sizeof(path), "%s/%d/%s", s_diymon, evo + 1, ANIM_PACK_FILENAME);
+    uint8_t *data = read_file(path, &size);
+    pack = data ? animation_pack_open_mapped(dir, data, size) : NULL;
+    if (!pack) {
+        FAIL("%s: evolución %d, animation_pack_open_mapped rechazó el pack", v->name, evo + 1);
+    } else {
+        snprintf(what, sizeof(what), "%s (en memoria)", v->name);
+        check_pack(what, pack, evo, false);
+        animation_pack_close(pack);
+    }
+    free(data);
+}
+
+// validate_tables debe rechazar, desde la SD y desde memoria, un fotograma RGB565A8 completo sin su
+// plano alfa (raw_size = stride*h) y uno con un stride menor que w*2.
+static void check_rejected(const variant_t *v) {
+    static const char *const cases[] = { "raw_size sin plano alfa", "stride menor que w*2" };
+    char path[PATH_MAX + 32];
+    uint32_t size = 0;
+    snprintf(path, sizeof(path), "%s/1/%s", s_diymon, ANIM_PACK_FILENAME);
+    uint8_t *data = read_file(path, &size);
+    if (!data || size < sizeof(animation_pack_header_t)) {
+        FAIL("%s: no se pudo leer %s", v->name, path);
+        free(data);
+        return;
+    }
+    animation_pack_header_t hdr;
+    memcpy(&hdr, data, sizeof(hdr));
+    uint32_t table = sizeof(hdr) + (uint32_t)hdr.seq_count * sizeof(animation_pack_seq_t);
+    char dir[PATH_MAX + 16];
+    snprintf(dir, sizeof(dir), "%s/corrupto", s_work);
+    if (make_dir(dir)) {
+        FAIL("%s: no se pudo crear %s", v->name, dir);
+        free(data);
+        return;
+    }
+    snprintf(path, sizeof(path), "%s/%s", dir, ANIM_PACK_FILENAME);
+
+    for (size_t c = 0; c < sizeof(cases) / sizeof(cases[0]); c++) {
+        uint8_t *copy = malloc(size);
+        if (!copy) break;
+        memcpy(copy, data, size);
+        bool patched = false;
+        for (uint16_t i = 0; i < hdr.frame_count && !patched; i++) {
+            animation_pack_frame_t fr;
+            uint8_t *entry = copy + table + (uint32_t)i * sizeof(fr);
+            memcpy(&fr, entry, sizeof(fr));
+            if (fr.cf != LV_COLOR_FORMAT_RGB565A8 || (fr.encoding & ANIM_PACK_FLAG_DELTA)) continue;
+            if (c == 0) {
+                fr.raw_size = (uint32_t)fr.stride * fr.h;
+            } else {
+                fr.stride = (uint16_t)(fr.w * 2 - 2);
+            }
+            memcpy(entry, &fr, sizeof(fr));
+            patched = true;
+        }
+        FILE *f = patched ? fopen(path, "wb") : NULL;
+        bool written = f && fwrite(copy, size, 1, f) == 1;
+        if (f) fclose(f);
+        char lv_dir[PATH_MAX + 32];
+        snprintf(lv_dir, sizeof(lv_dir), "S:%s", dir);
+        animation_pack_t *pack = written ? animation_pack_open(lv_dir) : NULL;
+        animation_pack_t *mapped = written ? animation_pack_open_mapped(lv_dir, copy, size) : NULL;
+        if (!written) {
+            FAIL("%s: no se pudo preparar el pack corrupto (%s)", v->name, cases[c]);
+        } else if (pack || mapped) {
+            FAIL("%s: se aceptó un pack con %s%s", v->name, cases[c], pack ? "" : " (en memoria)");
+        } else {
+            printf("  rechazado el pack con %s\n", cases[c]);
+        }
+        animation_pack_close(pack);
+        animation_pack_close(mapped);
+        free(copy);
+    }
+    free(data);
+}
+
+// La variante debe haber ejercitado lo que promete: codificaciones, deltas, I8 y un LZ4 casi incompresible
+// cuyo margen de descompresión in situ ((size >> 8) + 32) aún cabe en ANIM_PACK_DECODE_MARGIN.
+static void check_coverage(const variant_t *v) {
+    printf("  RLE %u, LZ4 %u, delta %u, I8 %u", s_seen.rle, s_seen.lz4, s_seen.delta, s_seen.indexed);
+    if (s_seen.has_near_raw) {
+        printf("; LZ4 más cercano al crudo: %lu de %lu bytes (%.1f%%), margen in situ %lu de %d",
+               (unsigned long)s_seen.near_raw.size, (unsigned long)s_seen.near_raw.raw_size,
+               100.0 * s_seen.near_raw.size / s_seen.near_raw.raw_size,
+               (unsigned long)((s_seen.near_raw.size >> 8) + 32), ANIM_PACK_DECODE_MARGIN);
+    }
+    printf("\n");
+    if ((v->flags & VARIANT_RLE) && !s_seen.rle) FAIL("%s: ningún fotograma RLE", v->name);
+    if ((v->flags & VARIANT_LZ4) && !s_seen.lz4) FAIL("%s: ningún fotograma LZ4", v->name);
+    if ((v->flags & VARIANT_DELTA) && !s_seen.delta) FAIL("%s: ningún fotograma delta", v->name);
+    if ((v->flags & VARIANT_INDEXED) && !s_seen.indexed) FAIL("%s: ningún fotograma I8", v->name);
+    if ((v->flags & VARIANT_NEAR_RAW) &&
+        (!s_seen.has_near_raw || (uint64_t)s_seen.near_raw.size * 100 < (uint64_t)s_seen.near_raw.raw_size * NEAR_RAW_PCT)) {
+        FAIL("%s: ningún fotograma LZ4 completo con al menos el %d%% de raw_size", v->name, NEAR_RAW_PCT);
+    }
+}
+
+// --- Recorrido de un directorio 'diymon' real (--scan) ---
+
+static const char *const s_scan_prefixes[] = { "ANIM_IDLE_", "ANIM_EAT_", "ANIM_GYM_", "ANIM_ATK_" };
+#define SCAN_PREFIXES (sizeof(s_scan_prefixes) / sizeof(s_scan_prefixes[0]))
+
+// Mismas lecturas que check_bin_frame en animation_integrity.c. 'extra' recibe los bytes sobrantes.
+static bool scan_bin_frame(const char *path, uint32_t *extra) {
+    lv_fs_file_t f;
+    if (lv_fs_open(&f, path, LV_FS_MODE_RD) != LV_FS_RES_OK) return false;
+    lv_image_header_t hdr;
+    uint32_t bytes_read = 0, file_size = 0;
+    bool ok = lv_fs_read(&f, &hdr, sizeof(hdr), &bytes_read) == LV_FS_RES_OK && bytes_read == sizeof(hdr);
+    uint32_t payload = ok ? animation_pack_bin_payload_size(&hdr, CANVAS_W, CANVAS_H) : 0;
+    ok = payload != 0 && lv_fs_seek(&f, 0, LV_FS_SEEK_END) == LV_FS_RES_OK && lv_fs_tell(&f, &file_size) == LV_FS_RES_OK &&
+         file_size >= sizeof(hdr) + payload;
+    lv_fs_close(&f);
+    *extra = ok ? file_size - (uint32_t)sizeof(hdr) - payload : 0;
+    return ok;
+}
+
+static int scan_tree(const char *root) {
+    unsigned total = 0, padded = 0, bad = 0;
+    DIR *top = opendir(root);
+    if (!top) {
+        perror(root);
+        return 1;
+    }
+    struct dirent *evo;
+    while ((evo = readdir(top)) != NULL) {
+        if (evo->d_name[0] == '.') continue;
+        char dir[PATH_MAX];
+        snprintf(dir, sizeof(dir), "%s/%s", root, evo->d_name);
+        DIR *d = opendir(dir);
+        if (!d) continue;
+        // Como la comprobación de la SD: cada secuencia va de 1 al mayor número presente.
+        unsigned long last[SCAN_PREFIXES] = { 0 };
+        struct dirent *de;
+        while ((de = readdir(d)) != NULL) {
+            for (size_t p = 0; p < SCAN_PREFIXES; p++) {
+                size_t len = strlen(s_scan_prefixes[p]);
+                if (strncmp(de->d_name, s_scan_prefixes[p], len) != 0) continue;
+                char *end;
+                unsigned long n = strtoul(de->d_name + len, &end, 10);
+                if (n > 0 && n <= UINT16_MAX && !strcasecmp(end, ".bin") && n > last[p]) last[p] = n;
+            }
+        }
+        closedir(d);
+        unsigned dir_total = 0, dir_padded = 0, dir_bad = 0;
+        for (size_t p = 0; p < SCAN_PREFIXES; p++) {
+            for (unsigned long n = 1; n <= last[p]; n++) {
+                char path[PATH_MAX + 64];
+                uint32_t extra = 0;
+                snprintf(path, sizeof(path), "S:%s/%s%lu.bin", dir, s_scan_prefixes[p], n);
+                dir_total++;
+                if (!scan_bin_frame(path, &extra)) {
+                    dir_bad++;
+                    printf("  DEFECTUOSO %s\n", path + 2);
+                } else if (extra) {
+                    dir_padded++;
+                }
+            }
+        }
+        if (dir_total) {
+            printf("%-6s %3u fotogramas, %3u con bytes de relleno, %u defectuosos\n", evo->d_name, dir_total, dir_padded, dir_bad);
+        }
+        total += dir_total;
+        padded += dir_padded;
+        bad += dir_bad;
+    }
+    closedir(top);
+    printf("%s: %u fotogramas, %u con bytes de relleno, %u defectuosos\n", bad || !total ? "FALLO" : "OK", total, padded, bad);
+    return bad || !total ? 1 : 0;
+}
+
+static int build_variant(const variant_t *v) {
+    char cmd[PATH_MAX * 3];
+#if CONFIG_LVGL_PORT_RGB565_BIG_ENDIAN
+    const char *order = " --big-endian";
+#else
+    const char *order = "";
+#endif
+    snprintf(cmd, sizeof(cmd), "python3 '%s' build '%s' %s%s > '%s/build.log' 2>&1", s_tool, s_diymon, v->args, order, s_work);
+    if (system(cmd) != 0) {
+        FAIL("%s: anim_pack.py build falló (ver %s/build.log)", v->name, s_work);
+        return -1;
+    }
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    bool keep = false;
+    bool temp = false;
+    setvbuf(stdout, NULL, _IOLBF, 0); // Mismo orden que los avisos de animation_pack.c en stderr.
+    snprintf(s_tool, sizeof(s_tool), "%s/anim_pack.py", dirname(strdupa(argv[0])));
+    s_work[0] = '\0';
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--work") && i + 1 < argc) {
+            snprintf(s_work, sizeof(s_work), "%s", argv[++i]);
+        } else if (!strcmp(argv[i], "--tool") && i + 1 < argc) {
+            snprintf(s_tool, sizeof(s_tool), "%s", argv[++i]);
+        } else if (!strcmp(argv[i], "--keep")) {
+            keep = true;
+        } else if (!strcmp(argv[i], "--scan") && i + 1 < argc) {
+            return scan_tree(argv[i + 1]);
+        } else {
+            fprintf(stderr, "Uso: %s [--work DIR] [--tool anim_pack.py] [--keep] | --scan DIR_DIYMON\n", argv[0]);
+            return 2;
+        }
+    }
+    if (!s_work[0]) {
+        snprintf(s_work, sizeof(s_work), "/tmp/anim_pack_test.XXXXXX");
+        if (!mkdtemp(s_work)) {
+            perror("mkdtemp");
+            return 1;
+        }
+        temp = true;
+    }
+    if (create_sources()) {
+        fprintf(stderr, "No se pudieron crear los fotogramas de origen en %s\n", s_work);
+        return 1;
+    }
+    printf("Origen sintético en %s (%d evoluciones)\n", s_diymon, EVOLUTIONS);
+
+    for (size_t v = 0; v < sizeof(s_variants) / sizeof(s_variants[0]); v++) {
+        unsigned errors = s_errors, checked = s_checked;
+        printf("%-10s anim_pack.py build %s\n", s_variants[v].name, s_variants[v].args);
+        memset(&s_seen, 0, sizeof(s_seen));
+        if (build_variant(&s_variants[v]) == 0) {
+            for (int e = 0; e < EVOLUTIONS; e++) check_evolution(&s_variants[v], e);
+            check_coverage(&s_variants[v]);
+            if (s_variants[v].flags & VARIANT_CORRUPT) check_rejected(&s_variants[v]);
+        }
+        printf("  %u fotogramas comparados, %u errores\n", s_checked - checked, s_errors - errors);
+    }
+
+    printf("%s: %u fotogramas comparados, %u errores\n", s_errors ? "FALLO" : "OK", s_checked, s_errors);
+    if (temp && !keep && !s_errors) {
+        char cmd[PATH_MAX + 16];
+        snprintf(cmd, sizeof(cmd), "rm -rf '%s'", s_work);
+        if (system(cmd) != 0) fprintf(stderr, "No se pudo borrar %s\n", s_work);
+    }
+    return s_errors ? 1 : 0;
+}
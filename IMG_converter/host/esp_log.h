@@ -0,0 +1,10 @@
+/* Fichero: IMG_converter/host/esp_log.h */
+/* Descripción: Sustituto de host del log de ESP-IDF para compilar módulos del firmware en las pruebas de IMG_converter (anim_pack_test.c). Errores y avisos van a stderr; los mensajes informativos y de depuración se descartan. */
+/* Último cambio: 18/10/2026 - 05:00 */
+#pragma once
+#include <stdio.h>
+
+#define ESP_LOGE(tag, fmt, ...) fprintf(stderr, "E %s: " fmt "\n", tag, ##__VA_ARGS__)
+#define ESP_LOGW(tag, fmt, ...) fprintf(stderr, "W %s: " fmt "\n", tag, ##__VA_ARGS__)
+#define ESP_LOGI(tag, fmt, ...) do { } while (0)
+#define ESP_LOGD(tag, fmt, ...) do { } while (0)
@@ -0,0 +1,4 @@
+/* Fichero: IMG_converter/host/sdkconfig.h */
+/* Descripción: sdkconfig vacío para compilar módulos del firmware en el host. Las opciones que importan se pasan con -D (p. ej. -DCONFIG_LVGL_PORT_RGB565_BIG_ENDIAN=1 para probar los packs big-endian). */
+/* Último cambio: 18/10/2026 - 05:00 */
+#pragma once
@@ -0,0 +1,131 @@
+#!/usr/bin/env python3
+# Fichero: rgb565_swap.py
+# Fecha: 18/10/2026 - 02:30
+# Último cambio: Creado.
+# Descripción: Pasa imágenes RGB565 y RGB565A8 al orden de bytes del panel (big-endian),
+#              el que dibuja LVGL con CONFIG_LVGL_PORT_RGB565_BIG_ENDIAN: así el flush
+#              envía el búfer sin intercambiar los bytes de cada píxel. Solo se tocan
+#              los planos de color; el alfa, los índices y las paletas ARGB8888 de los
+#              formatos indexados (I8, como el fondo) no dependen del orden.
+#              'bin': convierte en sitio los '.bin' de LVGL v9 y los marca en la
+#              cabecera con LV_IMAGE_FLAGS_USER1, que es lo que mira el cargador de
+#              fotogramas (un '.bin' ya marcado no se vuelve a intercambiar).
+#              'c': copia un fichero C de imágenes (los de components/ui/assets/images)
+#              intercambiando los bytes de color de cada array cuyo descriptor sea
+#              RGB565 o RGB565A8. Lo ejecuta el build de components/ui en el modo
+#              big-endian, de modo que los fuentes se guardan en el orden de siempre y
+#              los dos modos del firmware se compilan desde los mismos ficheros.
+#
+# Uso:
+#   python rgb565_swap.py bin <fichero.bin> [...]
+#   python rgb565_swap.py c   <entrada.c> <salida.c>
+
+import argparse
+import re
+import struct
+import sys
+
+LVGL_BIN_MAGIC = 0x19
+LVGL_BIN_HEADER = struct.Struct("<BBHHHHH")   # magic, cf, flags, w, h, stride, reserved
+LVGL_BIN_FLAG_BIG_ENDIAN = 0x0100             # LV_IMAGE_FLAGS_USER1
+
+LV_COLOR_FORMAT_RGB565 = 0x12
+LV_COLOR_FORMAT_RGB565A8 = 0x14
+SWAPPED_CF_NAMES = ("LV_COLOR_FORMAT_RGB565", "LV_COLOR_FORMAT_RGB565A8")
+
+DSC_RE = re.compile(r"lv_(?:img|image)_dsc_t\s+(\w+)\s*=\s*\{(.*?)\};", re.S)
+ARRAY_RE = r"(\b{name}\s*\[\s*\]\s*=\s*\{{)(.*?)(\}};)"
+BYTE_RE = re.compile(r"0[xX][0-9a-fA-F]+|\d+")
+COMMENT_RE = re.compile(r"/\*.*?\*/|//[^\n]*", re.S)
+
+
+def swap_bytes(data, length):
+    # Intercambia los dos bytes de cada color en los primeros 'length' bytes.
+    out = bytearray(data)
+    length -= length % 2
+    out[0:length:2], out[1:length:2] = data[1:length:2], data[0:length:2]
+    return out
+
+
+def convert_bin(path):
+    with open(path, "rb") as f:
+        data = bytearray(f.read())
+    if len(data) < LVGL_BIN_HEADER.size:
+        raise ValueError(f"{path}: fichero demasiado corto")
+    magic, cf, flags, w, h, stride, reserved = LVGL_BIN_HEADER.unpack_from(data)
+    if magic != LVGL_BIN_MAGIC:
+        raise ValueError(f"{path}: no es un .bin de LVGL v9 (magic 0x{magic:02x})")
+    if cf not in (LV_COLOR_FORMAT_RGB565, LV_COLOR_FORMAT_RGB565A8):
+        return "sin color RGB565, se deja igual"
+    if flags & LVGL_BIN_FLAG_BIG_ENDIAN:
+        return "ya estaba en big-endian"
+    color = min(stride * h, len(data) - LVGL_BIN_HEADER.size)
+    pixels = swap_bytes(data[LVGL_BIN_HEADER.size:], color)
+    header = LVGL_BIN_HEADER.pack(magic, cf, flags | LVGL_BIN_FLAG_BIG_ENDIAN, w, h, stride, reserved)
+    with open(path, "wb") as f:
+        f.write(header + pixels)
+    return f"{color // 2} colores intercambiados"
+
+
+def _field(body, name):
+    m = re.search(r"\.header\." + name + r"\s*=\s*([^,}]+)", body)
+    return m.group(1).strip() if m else None
+
+
+def _eval_int(expr):
+    # Los descriptores escriben a veces el stride como expresión ("50 * 2").
+    if expr is None or not re.fullmatch(r"[\d\s\*\+\-\(\)]+", expr):
+        raise ValueError(f"expresión no soportada: {expr!r}")
+    return int(eval(expr, {"__builtins__": {}}))
+
+
+def convert_c(src_path, dst_path):
+    with open(src_path, encoding="utf-8") as f:
+        text = f.read()
+    code = COMMENT_RE.sub(lambda m: " " * len(m.group(0)), text)   # Mismos offsets, sin comentarios.
+    edits = []
+    for dsc in DSC_RE.finditer(code):
+        body = dsc.group(2)
+        if _field(body, "cf") not in SWAPPED_CF_NAMES:
+            continue
+        data = re.search(r"\.data\s*=\s*(?:\(.*?\))?\s*&?\s*(\w+)", body)
+        if not data:
+            raise ValueError(f"{src_path}: el descriptor '{dsc.group(1)}' no apunta a un array")
+        array = re.search(ARRAY_RE.format(name=re.escape(data.group(1))), code, re.S)
+        if not array:
+            raise ValueError(f"{src_path}: no se encuentra el array '{data.group(1)}'")
+        values = bytes(int(v, 0) for v in BYTE_RE.findall(array.group(2)))
+        color = _eval_int(_field(body, "stride")) * _eval_int(_field(body, "h"))
+        swapped = swap_bytes(values, min(color, len(values)))
+        rows = (",".join("0x%02x" % b for b in swapped[i:i + 16]) for i in range(0, len(swapped), 16))
+        lines = "\n    " + ",\n    ".join(rows) + "\n"
+        edits.append((array.start(2), array.end(2), lines, dsc.group(1), min(color, len(values)) // 2))
+    for start, end, lines, _, _ in sorted(edits, reverse=True):
+        text = text[:start] + lines + text[end:]
+    with open(dst_path, "w", encoding="utf-8") as f:
+        f.write(f"/* Generado por IMG_converter/rgb565_swap.py desde '{src_path}': colores RGB565 en big-endian. */\n")
+        f.write(text)
+    return ", ".join(f"{name} ({n} colores)" for _, _, _, name, n in edits) or "sin imágenes RGB565"
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Conversión de imágenes RGB565 al orden de bytes del panel")
+    parser.add_argument("mode", choices=["bin", "c"])
+    parser.add_argument("paths", nargs="+")
+    args = parser.parse_args()
+    try:
+        if args.mode == "bin":
+            for path in args.paths:
+                print(f"{path}: {convert_bin(path)}")
+        else:
+            if len(args.paths) != 2:
+                parser.error("'c' necesita un fichero de entrada y uno de salida")
+            print(f"{args.paths[1]}: {convert_c(args.paths[0], args.paths[1])}")
+    except ValueError as e:
+        print(f"ERROR {e}")
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
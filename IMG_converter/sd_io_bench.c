@@ -0,0 +1,198 @@
+/* Fichero: IMG_converter/sd_io_bench.c */
+/* Descripción: Banco de pruebas de host para la capa de lectura de la SD del driver 'S:' (main/sd_file_io.c). Lee fotogramas consecutivos de una imagen en fichero (un 'ANIM.pak' real o una imagen sintética que se genera si no existe) con el mismo patrón que el cargador de animaciones: cabecera pequeña + carga útil de cada fotograma, con el fichero abierto (pack) o abriéndolo en cada fotograma (.bin sueltos). Compara fopen/fread (el driver anterior) con sd_file_io para varios tamaños de lectura anticipada y con y sin pool, y muestra MB/s y las llamadas al sistema que hizo cada variante. Antes de cada pasada se pide al sistema que descarte la caché de páginas del fichero (posix_fadvise), aunque en el host los números siguen estando dominados por la memoria: sirven para comparar variantes, no como velocidad de la tarjeta.
+   Compilar:  gcc -O2 -I../main -o sd_io_bench sd_io_bench.c ../main/sd_file_io.c -lpthread
+   Uso:       ./sd_io_bench <imagen> [--frame BYTES] [--frames N] [--passes N] */
+/* Último cambio: 17/10/2026 - 22:15 */
+#define _GNU_SOURCE
+#include "sd_file_io.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define HEADER_BYTES    12          // Cabecera LVGL de un .bin / de un fotograma.
+#define DEFAULT_FRAME   103500      // 150x230 RGB565A8.
+#define DEFAULT_FRAMES  64
+
+typedef enum { PATTERN_PACK, PATTERN_REOPEN } pattern_t;
+
+static size_t s_frame = DEFAULT_FRAME;
+static unsigned s_frames = DEFAULT_FRAMES;
+static unsigned s_passes = 3;
+static uint8_t *s_dst;
+
+static double now_s(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void drop_cache(const char *path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return;
+    fdatasync(fd);
+    posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    close(fd);
+}
+
+static int create_image(const char *path) {
+    FILE *f = fopen(path, "wb");
+    if (!f) return -1;
+    uint8_t *buf = malloc(s_frame);
+    if (!buf) {
+        fclose(f);
+        return -1;
+    }
+    uint32_t x = 0x12345678;
+    for (unsigned i = 0; i < s_frames; i++) {
+        for (size_t j = 0; j < s_frame; j++) {
+            x = x * 1664525u + 1013904223u;
+            buf[j] = (uint8_t)(x >> 24);
+        }
+        fwrite(buf, 1, s_frame, f);
+    }
+    free(buf);
+    fclose(f);
+    printf("Imagen sintética creada: %s (%u fotogramas de %zu bytes)\n", path, s_frames, s_frame);
+    return 0;
+}
+
+// --- Variantes ---
+
+static int run_stdio(const char *path, pattern_t pattern) {
+    FILE *f = NULL;
+    for (unsigned i = 0; i < s_frames; i++) {
+        if (pattern == PATTERN_REOPEN || !f) {
+            f = fopen(path, "rb");
+            if (!f) return -1;
+        }
+        if (fseek(f, (long)i * (long)s_frame, SEEK_SET) != 0) return -1;
+        if (fread(s_dst, 1, HEADER_BYTES, f) != HEADER_BYTES) return -1;
+        if (fread(s_dst + HEADER_BYTES, 1, s_frame - HEADER_BYTES, f) != s_frame - HEADER_BYTES) return -1;
+        if (pattern == PATTERN_REOPEN) {
+            fclose(f);
+            f = NULL;
+        }
+    }
+    if (f) fclose(f);
+    return 0;
+}
+
+static int run_sd_file_io(const char *path, pattern_t pattern) {
+    sd_file_t *f = NULL;
+    size_t n;
+    for (unsigned i = 0; i < s_frames; i++) {
+        if (pattern == PATTERN_REOPEN || !f) {
+            f = sd_file_open(path, SD_FILE_MODE_RD);
+            if (!f) return -1;
+        }
+        if (sd_file_seek(f, (int64_t)i * (int64_t)s_frame, SEEK_SET) != 0) return -1;
+        if (sd_file_read(f, s_dst, HEADER_BYTES, &n) != 0 || n != HEADER_BYTES) return -1;
+        if (sd_file_read(f, s_dst + HEADER_BYTES, s_frame - HEADER_BYTES, &n) != 0 || n != s_frame - HEADER_BYTES) return -1;
+        if (pattern == PATTERN_REOPEN) {
+            sd_file_close(f);
+            f = NULL;
+        }
+    }
+    if (f) sd_file_close(f);
+    return 0;
+}
+
+static void bench(const char *path, pattern_t pattern, const char *label, const sd_file_io_cfg_t *cfg) {
+    double best = 0;
+    sd_file_io_stats_t before = {0}, after = {0};
+    if (cfg) {
+        sd_file_io_init(cfg);
+        sd_file_io_get_stats(&before);
+    }
+    for (unsigned p = 0; p < s_passes; p++) {
+        drop_cache(path);
+        double t0 = now_s();
+        int ret = cfg ? run_sd_file_io(path, pattern) : run_stdio(path, pattern);
+        double dt = now_s() - t0;
+        if (ret != 0) {
+            printf("  %-28s ERROR de lectura\n", label);
+            return;
+        }
+        double mbs = (double)s_frame * s_frames / dt / (1024.0 * 1024.0);
+        if (mbs > best) best = mbs;
+    }
+    if (!cfg) {
+        printf("  %-28s %9.1f MB/s\n", label, best);
+        return;
+    }
+    sd_file_io_get_stats(&after);
+    unsigned passes = s_passes;
+    printf("  %-28s %9.1f MB/s   por pasada: open=%u read=%u (directas %u, rellenos %u) lseek=%u\n",
+           label, best,
+           (after.opens - after.pool_hits - before.opens + before.pool_hits) / passes,
+           (after.direct_reads + after.fills - before.direct_reads - before.fills) / passes,
+           (after.direct_reads - before.direct_reads) / passes,
+           (after.fills - before.fills) / passes,
+           (after.seeks - before.seeks) / passes);
+}
+
+static void bench_pattern(const char *path, pattern_t pattern) {
+    static const uint32_t read_ahead_kb[] = { 0, 4, 16, 32 };
+    char label[64];
+
+    bench(path, pattern, "fopen/fread (driver anterior)", NULL);
+    for (size_t i = 0; i < sizeof(read_ahead_kb) / sizeof(read_ahead_kb[0]); i++) {
+        sd_file_io_cfg_t cfg = { .read_ahead_bytes = read_ahead_kb[i] * 1024, .pool_size = 0 };
+        snprintf(label, sizeof(label), "sd_file_io RA=%luK pool=0", (unsigned long)read_ahead_kb[i]);
+        bench(path, pattern, label, &cfg);
+        if (pattern == PATTERN_REOPEN) {
+            cfg.pool_size = 4;
+            snprintf(label, sizeof(label), "sd_file_io RA=%luK pool=4", (unsigned long)read_ahead_kb[i]);
+            bench(path, pattern, label, &cfg);
+        }
+    }
+}
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        fprintf(stderr, "Uso: %s <imagen> [--frame BYTES] [--frames N] [--passes N]\n", argv[0]);
+        return 1;
+    }
+    const char *path = argv[1];
+    for (int i = 2; i + 1 < argc; i += 2) {
+        if (strcmp(argv[i], "--frame") == 0) s_frame = strtoul(argv[i + 1], NULL, 0);
+        else if (strcmp(argv[i], "--frames") == 0) s_frames = strtoul(argv[i + 1], NULL, 0);
+        else if (strcmp(argv[i], "--passes") == 0) s_passes = strtoul(argv[i + 1], NULL, 0);
+    }
+    if (s_frame <= HEADER_BYTES || s_frames == 0 || s_passes == 0) {
+        fprintf(stderr, "Parámetros no válidos.\n");
+        return 1;
+    }
+
+    if (access(path, R_OK) != 0 && create_image(path) != 0) {
+        fprintf(stderr, "No se pudo crear '%s'.\n", path);
+        return 1;
+    }
+    FILE *f = fopen(path, "rb");
+    if (!f) return 1;
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fclose(f);
+    if ((long)(s_frame * s_frames) > size) {
+        s_frames = (unsigned)(size / (long)s_frame);
+        if (s_frames == 0) {
+            fprintf(stderr, "La imagen es más pequeña que un fotograma.\n");
+            return 1;
+        }
+    }
+    s_dst = malloc(s_frame);
+    if (!s_dst) return 1;
+
+    printf("%u fotogramas de %zu bytes, mejor de %u pasadas\n", s_frames, s_frame, s_passes);
+    printf("\nFichero abierto durante toda la secuencia (ANIM.pak):\n");
+    bench_pattern(path, PATTERN_PACK);
+    printf("\nUna apertura por fotograma (.bin sueltos):\n");
+    bench_pattern(path, PATTERN_REOPEN);
+
+    free(s_dst);
+    return 0;
+}
@@ -1,12 +1,14 @@
 /* Fichero: components/bsp/bsp_display.c */
-/* Descripción: Diagnóstico: El control de brillo y apagado del backlight está invertido en la placa de 1.47". Causa Raíz: La circuitería del pin del backlight (BL) en la placa de 1.47" es activa-alta, mientras que en la de 1.9" es activa-baja. La misma fórmula de cálculo del duty cycle del LEDC produce el efecto opuesto. Solución Definitiva: Se ha refactorizado sp_display.c para centralizar la lógica en sp_display_set_brightness. Se utiliza una directiva de preprocesador para aplicar una fórmula de duty cycle invertida (duty = (255 * percentage) / 100) solo para la placa de 1.47". Las funciones 	urn_on y 	urn_off ahora llaman a set_brightness con el porcentaje adecuado (el último guardado o 0), asegurando un comportamiento correcto y mantenible para ambas placas. */
-/* Último cambio: 21/08/2025 - 23:53 */
+/* Descripción: Inicialización de la pantalla (ST7789 en la placa de 1.9", JD9853 en la de 1.47") y control del backlight, cuyo duty se invierte en la placa de 1.47" (activa-alta). Se añade la estrategia del búfer de dibujo de LVGL elegida en Kconfig: parcial de CONFIG_BSP_LCD_BUFFER_LINES líneas o de pantalla completa, con o sin doble búfer. Se decide al iniciar la pantalla, antes de que la WiFi y la UI tomen su memoria: si los búferes dejarían menos de CONFIG_BSP_LCD_RAM_RESERVE_KB libres se quita el doble búfer y, en modo completo, se pasa al parcial. La profundidad de la cola de envíos SPI se calcula con el búfer elegido: un hueco por cada trozo en que esp_lcd divide un flush, para que el flush_cb no se quede esperando a que el bus libere huecos. 'bsp_get_display_buffer_size' devuelve ahora píxeles, que es lo que espera 'lvgl_port_display_cfg_t.buffer_size' (antes devolvía bytes y el búfer real era de 40 líneas, no de 20). */
+/* Último cambio: 18/10/2026 - 03:00 */
 #include "bsp_api.h"
+#include "bsp_priv.h"
 #include "esp_log.h"
 #include "driver/spi_master.h"
 #include "driver/ledc.h"
 #include "esp_lcd_panel_io.h"
 #include "esp_lcd_panel_ops.h"
+#include "esp_heap_caps.h"
 #include "nvs_flash.h"
 #include "nvs.h"
 
@@ -40,10 +42,66 @@ static const char *TAG = "bsp_display";
     #error "No se ha definido una placa soportada en la configuración del proyecto"
 #endif
 
+#define BSP_LCD_LINE_BYTES      (BSP_LCD_H_RES * sizeof(uint16_t))
+#define BSP_LCD_BUFFER_CAPS     (MALLOC_CAP_DMA | MALLOC_CAP_INTERNAL) // Los mismos que pide esp_lvgl_port con 'buff_dma'.
+
 // --- Variables estáticas globales del módulo ---
 static esp_lcd_panel_handle_t g_panel_handle = NULL;
 static esp_lcd_panel_io_handle_t g_io_handle = NULL;
 static int s_last_brightness_percentage = 100;
+static bsp_display_buffer_cfg_t s_buffer_cfg;
+
+// --- Estrategia del búfer de dibujo ---
+static bool buffers_fit(uint32_t lines, bool double_buffer) {
+    size_t bytes = lines * BSP_LCD_LINE_BYTES;
+    size_t total = bytes * (double_buffer ? 2 : 1);
+    return heap_caps_get_largest_free_block(BSP_LCD_BUFFER_CAPS) >= bytes &&
+           heap_caps_get_free_size(BSP_LCD_BUFFER_CAPS) >= total + CONFIG_BSP_LCD_RAM_RESERVE_KB * 1024;
+}
+
+// Se prueba lo configurado y, si no cabe, se reduce: primero el doble búfer y después el modo completo.
+static void choose_buffer_strategy(void) {
+    bsp_display_buffer_cfg_t cfg = {
+#if CONFIG_BSP_LCD_BUFFER_FULL
+        .full_refresh = true,
+        .lines = BSP_LCD_V_RES,
+#else
+        .lines = CONFIG_BSP_LCD_BUFFER_LINES,
+#endif
+#if CONFIG_BSP_LCD_DOUBLE_BUFFER
+        .double_buffer = true,
+#endif
+    };
+    if (cfg.lines > BSP_LCD_V_RES) cfg.lines = BSP_LCD_V_RES;
+    const bool want_double = cfg.double_buffer;
+
+    if (!buffers_fit(cfg.lines, cfg.double_buffer) && cfg.double_buffer) {
+        cfg.double_buffer = false;
+        cfg.degraded = true;
+    }
+    if (!buffers_fit(cfg.lines, cfg.double_buffer) && cfg.full_refresh) {
+        cfg.full_refresh = false;
+        cfg.lines = CONFIG_BSP_LCD_BUFFER_LINES < BSP_LCD_V_RES ? CONFIG_BSP_LCD_BUFFER_LINES : BSP_LCD_V_RES;
+        cfg.double_buffer = want_double && buffers_fit(cfg.lines, true);
+        cfg.degraded = true;
+    }
+    cfg.buffer_px = cfg.lines * BSP_LCD_H_RES;
+
+    // Un hueco de la cola por cada trozo de un flush; con menos, el flush_cb espera al bus antes de volver.
+    size_t chunk = bsp_spi_get_max_transfer_bytes();
+    size_t chunks = (cfg.lines * BSP_LCD_LINE_BYTES + chunk - 1) / chunk;
+    cfg.trans_queue_depth = chunks < 2 ? 2 : chunks;
+
+    if (cfg.degraded) {
+        ESP_LOGW(TAG, "No hay RAM para el búfer configurado (libres %u KB, reserva %d KB): se usa el reducido.",
+                 (unsigned)(heap_caps_get_free_size(BSP_LCD_BUFFER_CAPS) / 1024), CONFIG_BSP_LCD_RAM_RESERVE_KB);
+    }
+    ESP_LOGI(TAG, "Búfer de dibujo: %s, %u líneas (%u KB)%s, cola SPI de %u envíos.",
+             cfg.full_refresh ? "pantalla completa" : "parcial", (unsigned)cfg.lines,
+             (unsigned)(cfg.buffer_px * sizeof(uint16_t) / 1024), cfg.double_buffer ? " x2" : "",
+             (unsigned)cfg.trans_queue_depth);
+    s_buffer_cfg = cfg;
+}
 
 // --- Implementación de funciones ---
 esp_err_t bsp_display_init(void) {
@@ -68,9 +126,10 @@ esp_err_t bsp_display_init(void) {
     }
     bsp_display_set_brightness((int)saved_brightness, true);
 
+    choose_buffer_strategy();
     esp_lcd_panel_io_spi_config_t io_config = {
         .cs_gpio_num = PIN_NUM_LCD_CS, .dc_gpio_num = PIN_NUM_LCD_DC,
-        .spi_mode = 0, .pclk_hz = 40 * 1000 * 1000, .trans_queue_depth = 10,
+        .spi_mode = 0, .pclk_hz = 40 * 1000 * 1000, .trans_queue_depth = s_buffer_cfg.trans_queue_depth,
         .lcd_cmd_bits = 8, .lcd_param_bits = 8
     };
     ESP_ERROR_CHECK(esp_lcd_new_panel_io_spi((esp_lcd_spi_bus_handle_t)BSP_SPI_HOST, &io_config, &g_io_handle));
@@ -148,6 +207,7 @@ esp_lcd_panel_handle_t bsp_get_display_handle(void) { return g_panel_handle; }
 esp_lcd_panel_io_handle_t bsp_get_panel_io_handle(void) { return g_io_handle; }
 int bsp_get_display_hres(void) { return BSP_LCD_H_RES; }
 int bsp_get_display_vres(void) { return BSP_LCD_V_RES; }
-size_t bsp_get_display_buffer_size(void) {
-    return BSP_LCD_H_RES * 20 * sizeof(uint16_t);
+size_t bsp_get_display_buffer_size(void) { return s_buffer_cfg.buffer_px; }
+void bsp_get_display_buffer_cfg(bsp_display_buffer_cfg_t *out) {
+    if (out) *out = s_buffer_cfg;
 }
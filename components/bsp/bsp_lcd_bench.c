@@ -0,0 +1,217 @@
+/* Fichero: components/bsp/bsp_lcd_bench.c */
+/* Descripción: Banco de pruebas del dibujo en pantalla, para elegir en cada placa la estrategia del búfer de dibujo (líneas, doble búfer, refresco completo) que mejor reparte RAM y velocidad. Carga una escena fija hecha solo con LVGL (fondo en degradado, tarjetas semitransparentes con texto y un arco) y la redibuja entera un número fijo de fotogramas con 'lv_refr_now'. Con los eventos del display separa en cada fotograma el render de LVGL, el tiempo de CPU del flush_cb y la espera a que el SPI libere un búfer (LV_EVENT_FLUSH_WAIT_START/FINISH); con doble búfer la espera es la parte del envío que el render no llega a tapar. Se ejecuta en una tarea propia con la pila de la tarea de LVGL y con el cerrojo de LVGL tomado durante toda la medida; al terminar vuelve a cargar la pantalla que había. Se lanza desde el servidor web ('/lcdbench'); el último resultado queda guardado para consultarlo. Solo puede haber una medida en curso. */
+/* Último cambio: 18/10/2026 - 03:00 */
+#include "bsp_api.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
+#include "esp_lvgl_port.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "lvgl.h"
+#include <stdatomic.h>
+#include <string.h>
+
+static const char *TAG = "bsp_lcd_bench";
+
+#define BENCH_WARMUP_FRAMES     2       // El primero carga la escena; no se cuentan.
+#define BENCH_FRAMES            30
+#define BENCH_CARDS             4
+#define BENCH_TASK_STACK        10240   // La de la tarea de LVGL: el render se ejecuta en esta tarea.
+#define BENCH_TASK_PRIORITY     4
+#define BENCH_LOCK_TIMEOUT_MS   2000
+
+typedef struct {
+    bsp_lcd_bench_t *res;
+    SemaphoreHandle_t done;
+} bench_job_t;
+
+// Acumuladores de los eventos del display. Solo se tocan desde la tarea del banco, con el cerrojo de LVGL.
+typedef struct {
+    bool counting;
+    int64_t frame_start_us;
+    int64_t flush_start_us;
+    int64_t wait_start_us;
+    uint64_t frame_us;
+    uint64_t flush_us;
+    uint64_t wait_us;
+    uint32_t frame_max_us;
+    uint32_t frames;
+    uint32_t flushes;
+} bench_acc_t;
+
+static atomic_flag s_busy = ATOMIC_FLAG_INIT;
+static bsp_lcd_bench_t s_last;
+static bool s_has_last = false;
+static bench_acc_t s_acc;
+static lv_obj_t *s_arc;
+static lv_obj_t *s_arc_label;
+
+static void on_display_event(lv_event_t *e) {
+    int64_t now = esp_timer_get_time();
+    switch (lv_event_get_code(e)) {
+    case LV_EVENT_REFR_START:
+        s_acc.frame_start_us = now;
+        break;
+    case LV_EVENT_REFR_READY:
+        if (s_acc.counting) {
+            uint32_t us = (uint32_t)(now - s_acc.frame_start_us);
+            s_acc.frame_us += us;
+            if (us > s_acc.frame_max_us) s_acc.frame_max_us = us;
+            s_acc.frames++;
+        }
+        break;
+    case LV_EVENT_FLUSH_START:
+        s_acc.flush_start_us = now;
+        break;
+    case LV_EVENT_FLUSH_FINISH:
+        if (s_acc.counting) {
+            s_acc.flush_us += (uint64_t)(now - s_acc.flush_start_us);
+            s_acc.flushes++;
+        }
+        break;
+    case LV_EVENT_FLUSH_WAIT_START:
+        s_acc.wait_start_us = now;
+        break;
+    case LV_EVENT_FLUSH_WAIT_FINISH:
+        if (s_acc.counting) s_acc.wait_us += (uint64_t)(now - s_acc.wait_start_us);
+        break;
+    default:
+        break;
+    }
+}
+
+// Escena fija: lo que más cuesta en la UI real (degradados, mezcla alfa, esquinas redondeadas y texto).
+static lv_obj_t *create_scene(void) {
+    lv_obj_t *scr = lv_obj_create(NULL);
+    lv_obj_remove_flag(scr, LV_OBJ_FLAG_SCROLLABLE);
+    lv_obj_set_style_bg_color(scr, lv_color_hex(0x102040), 0);
+    lv_obj_set_style_bg_grad_color(scr, lv_color_hex(0x50A0C0), 0);
+    lv_obj_set_style_bg_grad_dir(scr, LV_GRAD_DIR_VER, 0);
+    lv_obj_set_style_bg_opa(scr, LV_OPA_COVER, 0);
+
+    for (int i = 0; i < BENCH_CARDS; i++) {
+        lv_obj_t *card = lv_obj_create(scr);
+        lv_obj_remove_flag(card, LV_OBJ_FLAG_SCROLLABLE);
+        lv_obj_set_size(card, lv_pct(84), 36);
+        lv_obj_align(card, LV_ALIGN_TOP_MID, 0, 10 + i * 44);
+        lv_obj_set_style_radius(card, 10, 0);
+        lv_obj_set_style_bg_color(card, lv_color_hex(0xFFFFFF), 0);
+        lv_obj_set_style_bg_opa(card, LV_OPA_40, 0);
+        lv_obj_set_style_border_width(card, 2, 0);
+        lv_obj_set_style_border_color(card, lv_color_hex(0xFFD040), 0);
+        lv_obj_t *lbl = lv_label_create(card);
+        lv_label_set_text_fmt(lbl, "DIYMON %d", i + 1);
+        lv_obj_center(lbl);
+    }
+
+    s_arc = lv_arc_create(scr);
+    lv_obj_remove_flag(s_arc, LV_OBJ_FLAG_CLICKABLE);
+    lv_obj_set_size(s_arc, 110, 110);
+    lv_obj_align(s_arc, LV_ALIGN_BOTTOM_MID, 0, -12);
+    s_arc_label = lv_label_create(s_arc);
+    lv_obj_center(s_arc_label);
+    return scr;
+}
+
+static esp_err_t run_frames(bsp_lcd_bench_t *res) {
+    lv_display_t *disp = lv_display_get_default();
+    if (!disp) return ESP_ERR_INVALID_STATE;
+    if (!lvgl_port_lock(BENCH_LOCK_TIMEOUT_MS)) return ESP_ERR_TIMEOUT;
+
+    memset(&s_acc, 0, sizeof(s_acc));
+    lv_obj_t *prev = lv_display_get_screen_active(disp);
+    lv_obj_t *scene = create_scene();
+    lv_display_add_event_cb(disp, on_display_event, LV_EVENT_ALL, NULL);
+    lv_screen_load(scene);
+
+    // Cada fotograma invalida la pantalla entera: el número de flushes lo marca solo el tamaño del búfer.
+    for (int i = 0; i < BENCH_WARMUP_FRAMES + BENCH_FRAMES; i++) {
+        s_acc.counting = i >= BENCH_WARMUP_FRAMES;
+        lv_arc_set_value(s_arc, i * 100 / (BENCH_WARMUP_FRAMES + BENCH_FRAMES - 1));
+        lv_label_set_text_fmt(s_arc_label, "%d", i);
+        lv_obj_invalidate(scene);
+        lv_refr_now(disp);
+    }
+
+    lv_display_remove_event_cb_with_user_data(disp, on_display_event, NULL);
+    res->free_ram_kb = (uint32_t)(heap_caps_get_free_size(MALLOC_CAP_INTERNAL) / 1024);
+    if (prev) {
+        lv_screen_load(prev);
+        lv_obj_invalidate(prev);
+    }
+    lv_obj_delete(scene);
+    s_arc = NULL;
+    s_arc_label = NULL;
+    lvgl_port_unlock();
+
+    if (s_acc.frames == 0) return ESP_FAIL;
+    // Con doble búfer el último envío de un fotograma se solapa con el siguiente: su coste aparece como espera
+    // al principio del fotograma siguiente, así que las medias son las de un refresco continuo.
+    res->frames = s_acc.frames;
+    res->flushes_per_frame = s_acc.flushes / s_acc.frames;
+    res->frame_avg_us = (uint32_t)(s_acc.frame_us / s_acc.frames);
+    res->frame_max_us = s_acc.frame_max_us;
+    res->flush_avg_us = (uint32_t)(s_acc.flush_us / s_acc.frames);
+    res->wait_avg_us = (uint32_t)(s_acc.wait_us / s_acc.frames);
+    uint32_t busy_us = res->flush_avg_us + res->wait_avg_us;
+    res->render_avg_us = res->frame_avg_us > busy_us ? res->frame_avg_us - busy_us : 0;
+    res->fps_x10 = res->frame_avg_us ? 10000000UL / res->frame_avg_us : 0;
+    return ESP_OK;
+}
+
+static void bench_task(void *param) {
+    bench_job_t *job = param;
+    job->res->status = run_frames(job->res);
+    xSemaphoreGive(job->done);
+    vTaskDelete(NULL);
+}
+
+esp_err_t bsp_lcd_run_benchmark(bsp_lcd_bench_t *out) {
+    if (atomic_flag_test_and_set(&s_busy)) {
+        ESP_LOGW(TAG, "Ya hay una medida de la pantalla en curso.");
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    bsp_lcd_bench_t res = { .status = ESP_OK };
+    bsp_get_display_buffer_cfg(&res.buffer);
+    ESP_LOGI(TAG, "Midiendo el dibujo en pantalla (%d fotogramas, búfer %s de %lu líneas%s)...",
+             BENCH_FRAMES, res.buffer.full_refresh ? "completo" : "parcial", (unsigned long)res.buffer.lines,
+             res.buffer.double_buffer ? " x2" : "");
+
+    // El render se hace en una tarea con la pila de la de LVGL: la del llamante (p. ej. el servidor web) no alcanza.
+    bench_job_t job = { .res = &res, .done = xSemaphoreCreateBinary() };
+    if (!job.done) {
+        res.status = ESP_ERR_NO_MEM;
+    } else if (xTaskCreate(bench_task, "lcd_bench_task", BENCH_TASK_STACK, &job, BENCH_TASK_PRIORITY, NULL) != pdPASS) {
+        res.status = ESP_ERR_NO_MEM;
+    } else {
+        xSemaphoreTake(job.done, portMAX_DELAY);
+    }
+    if (job.done) vSemaphoreDelete(job.done);
+
+    if (res.status == ESP_OK) {
+        ESP_LOGI(TAG, "%lu us por fotograma (máx %lu us, %lu.%lu fps) = render %lu us + flush %lu us + espera al SPI %lu us; "
+                 "%lu flushes por fotograma, cola SPI de %lu envíos, %lu KB de RAM libres.",
+                 (unsigned long)res.frame_avg_us, (unsigned long)res.frame_max_us,
+                 (unsigned long)(res.fps_x10 / 10), (unsigned long)(res.fps_x10 % 10),
+                 (unsigned long)res.render_avg_us, (unsigned long)res.flush_avg_us, (unsigned long)res.wait_avg_us,
+                 (unsigned long)res.flushes_per_frame, (unsigned long)res.buffer.trans_queue_depth,
+                 (unsigned long)res.free_ram_kb);
+    } else {
+        ESP_LOGE(TAG, "La medida de la pantalla ha fallado (%s).", esp_err_to_name(res.status));
+    }
+
+    s_last = res;
+    s_has_last = true;
+    if (out) *out = res;
+    atomic_flag_clear(&s_busy);
+    return res.status;
+}
+
+bool bsp_lcd_get_last_benchmark(bsp_lcd_bench_t *out) {
+    if (!s_has_last || !out) return false;
+    *out = s_last;
+    return true;
+}
@@ -0,0 +1,101 @@
+/* Fichero: components/bsp/bsp_lcd_flush.c */
+/* Descripción: Tiempo de CPU del flush de LVGL. Entre los eventos LV_EVENT_FLUSH_START y LV_EVENT_FLUSH_FINISH del display solo se ejecuta el 'flush_cb' de esp_lvgl_port: el intercambio de bytes de cada píxel (con 'swap_bytes') y encolar el envío por SPI. Se cuentan los flushes, los píxeles y el tiempo (total y máximo), de modo que el log y '/metrics' dan los ns por píxel con y sin CONFIG_LVGL_PORT_RGB565_BIG_ENDIAN, el modo en que LVGL dibuja ya en el orden de bytes del panel y el flush no toca los píxeles. Al engancharse se mide además, una vez, lo que cuesta el intercambio por píxel ('lv_draw_sw_rgb565_swap' sobre un búfer de prueba), para comparar los dos modos con una sola compilación. */
+/* Último cambio: 18/10/2026 - 02:30 */
+#include "bsp_api.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "lvgl.h"
+#include <stdlib.h>
+#include <string.h>
+
+static const char *TAG = "bsp_lcd_flush";
+
+#define SWAP_BENCH_PIXELS   4096
+#define SWAP_BENCH_ROUNDS   4
+
+static portMUX_TYPE s_mux = portMUX_INITIALIZER_UNLOCKED;
+static lv_display_t *s_disp;
+static bool s_swap_bytes;
+static int64_t s_flush_start_us;
+static uint32_t s_flush_pixels;
+static bsp_lcd_flush_stats_t s_stats;
+
+// Los dos eventos llegan desde la tarea de LVGL, justo antes y justo después del flush_cb.
+static void on_flush_start(lv_event_t *e) {
+    const lv_area_t *area = lv_event_get_param(e);
+    s_flush_pixels = area ? (uint32_t)lv_area_get_size(area) : 0;
+    s_flush_start_us = esp_timer_get_time();
+}
+
+static void on_flush_finish(lv_event_t *e) {
+    uint32_t us = (uint32_t)(esp_timer_get_time() - s_flush_start_us);
+    taskENTER_CRITICAL(&s_mux);
+    s_stats.flushes++;
+    s_stats.pixels += s_flush_pixels;
+    s_stats.cpu_us += us;
+    if (us > s_stats.max_us) s_stats.max_us = us;
+    taskEXIT_CRITICAL(&s_mux);
+}
+
+// Coste del intercambio de bytes por píxel en ns (la mejor de varias pasadas, sin interrupciones de por medio).
+static uint32_t measure_swap_ns_per_px(void) {
+    uint16_t *buf = calloc(SWAP_BENCH_PIXELS, sizeof(uint16_t));
+    if (!buf) return 0;
+    int64_t best = INT64_MAX;
+    for (int i = 0; i < SWAP_BENCH_ROUNDS; i++) {
+        int64_t t0 = esp_timer_get_time();
+        lv_draw_sw_rgb565_swap(buf, SWAP_BENCH_PIXELS);
+        int64_t us = esp_timer_get_time() - t0;
+        if (us < best) best = us;
+    }
+    free(buf);
+    return (uint32_t)(best * 1000 / SWAP_BENCH_PIXELS);
+}
+
+void bsp_lcd_flush_attach(lv_display_t *disp, bool swap_bytes) {
+    if (!disp || s_disp) return;
+    s_disp = disp;
+    s_swap_bytes = swap_bytes;
+    s_stats.swap_ns_per_px = measure_swap_ns_per_px();
+    // Se registran después de los del árbitro del bus: el START es el último en ejecutarse antes del flush_cb.
+    lv_display_add_event_cb(disp, on_flush_start, LV_EVENT_FLUSH_START, NULL);
+    lv_display_add_event_cb(disp, on_flush_finish, LV_EVENT_FLUSH_FINISH, NULL);
+    ESP_LOGI(TAG, "Orden de bytes RGB565: %s (el intercambio cuesta %lu ns/px).",
+             swap_bytes ? "intercambio en cada flush" : "el del panel, sin intercambio",
+             (unsigned long)s_stats.swap_ns_per_px);
+}
+
+void bsp_lcd_flush_get_stats(bsp_lcd_flush_stats_t *out) {
+    if (!out) return;
+    taskENTER_CRITICAL(&s_mux);
+    *out = s_stats;
+    taskEXIT_CRITICAL(&s_mux);
+    out->swap_bytes = s_swap_bytes;
+}
+
+void bsp_lcd_flush_reset_stats(void) {
+    taskENTER_CRITICAL(&s_mux);
+    uint32_t swap_ns = s_stats.swap_ns_per_px;
+    memset(&s_stats, 0, sizeof(s_stats));
+    s_stats.swap_ns_per_px = swap_ns;
+    taskEXIT_CRITICAL(&s_mux);
+}
+
+void bsp_lcd_flush_log_stats(void) {
+    if (!s_disp) return;
+    bsp_lcd_flush_stats_t st;
+    bsp_lcd_flush_get_stats(&st);
+    if (st.flushes == 0) return;
+    // Sin intercambio, lo que habría costado: el tiempo medido más el intercambio de los mismos píxeles.
+    uint64_t swap_us = st.pixels * st.swap_ns_per_px / 1000;
+    uint64_t other_us = st.swap_bytes ? (st.cpu_us > swap_us ? st.cpu_us - swap_us : 0) : st.cpu_us + swap_us;
+    ESP_LOGI(TAG, "Flush (%s): %lu flushes, %llu Kpx, CPU %llu us (media %lu us, máx %lu us, %lu ns/px) | "
+             "%s: ~%llu us (intercambio %lu ns/px)",
+             st.swap_bytes ? "con intercambio" : "orden del panel",
+             (unsigned long)st.flushes, (unsigned long long)(st.pixels / 1000), (unsigned long long)st.cpu_us,
+             (unsigned long)(st.cpu_us / st.flushes), (unsigned long)st.max_us,
+             (unsigned long)(st.pixels ? st.cpu_us * 1000ULL / st.pixels : 0),
+             st.swap_bytes ? "sin intercambio" : "con intercambio", (unsigned long long)other_us,
+             (unsigned long)st.swap_ns_per_px);
+}
@@ -1,11 +1,14 @@
 /* Fichero: components/bsp/bsp_priv.h */
-/* Último cambio: Creado para declarar los prototipos de las funciones de inicialización internas y específicas de cada placa. */
+/* Último cambio: Declarado el tamaño máximo de transacción del bus SPI, con el que el display dimensiona su cola de envíos. */
 /* Descripción: Cabecera privada del componente BSP. Define la interfaz interna que deben implementar los ficheros de cada placa (ej: WS1.9TS/bsp_display.c). El fichero bsp.c (orquestador) utiliza estos prototipos para llamar a la implementación correcta, que es seleccionada en tiempo de compilación por PlatformIO. Esto desacopla la lógica de orquestación de la implementación de hardware específica. */
-/* Último cambio: 20/08/2025 - 04:57 */
+/* Último cambio: 18/10/2026 - 03:00 */
 #ifndef BSP_PRIV_H
 #define BSP_PRIV_H
 
 #include "esp_err.h"
+#include "sdmmc_cmd.h"
+#include <stddef.h>
+#include <stdint.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -23,6 +26,13 @@ esp_err_t bsp_sdcard_init_internal(void);
 esp_err_t bsp_imu_init_internal(void);
 esp_err_t bsp_battery_init_internal(void);
 
+// --- Tarjeta SD (implementados en bsp_sdcard.c, usados por bsp_sdcard_bench.c) ---
+sdmmc_card_t *bsp_sdcard_get_card(void);
+void bsp_sdcard_get_mount_info(uint32_t *max_files, uint32_t *allocation_unit);
+
+// --- Bus SPI (implementado en bsp_spi.c, usado por bsp_display.c) ---
+size_t bsp_spi_get_max_transfer_bytes(void); // Bytes de cada hueco de la cola de envíos de la pantalla.
+
 #ifdef __cplusplus
 }
 #endif
@@ -1,13 +1,18 @@
 /* Fichero: components/bsp/bsp_sdcard.c */
-/* Último cambio: Unificado el código de los drivers de la tarjeta SD de ambas placas en un único fichero, utilizando directivas de preprocesador. */
-/* Descripción: Este fichero contiene la lógica para la inicialización de la tarjeta SD. El pin Chip Select (CS), que es la única diferencia entre las placas, se selecciona en tiempo de compilación mediante las macros CONFIG_DIYTOGETHER_BOARD_*, definidas por PlatformIO. La lógica de montaje del sistema de ficheros FAT es idéntica y se comparte. */
-/* Último cambio: 20/08/2025 - 05:01 */
+/* Descripción: Montaje de la tarjeta SD en el bus SPI2 compartido con la pantalla. El reloj SPI de montaje sale de 'BSP_SD_SPI_FREQ_KHZ' (antes fijo en el de SDSPI_HOST_DEFAULT). Con 'BSP_SD_AUTOTUNE' se sondea al montar el reloj más alto estable para la tarjeta insertada: se remonta a cada reloj candidato y se comparan tres lecturas directas de los primeros 128 KB con la firma (CRC por bloque) leída al reloj base. El elegido se guarda en NVS con el número de serie de la tarjeta; en los arranques siguientes solo se verifica, y si falla o la tarjeta es otra se vuelve a sondear. Se exponen la tarjeta, la configuración de montaje y el reloj real para el banco de pruebas de la SD. El pin CS de cada placa se sigue eligiendo con CONFIG_DIYTOGETHER_BOARD_*. */
+/* Último cambio: 17/10/2026 - 22:50 */
 #include "bsp_api.h"
 #include "esp_log.h"
 #include "esp_vfs_fat.h"
 #include "sdmmc_cmd.h"
 #include "driver/sdspi_host.h"
 #include "driver/spi_common.h"
+#include "esp_heap_caps.h"
+#include "esp_rom_crc.h"
+#include "nvs.h"
+#include "bsp_priv.h"
+#include <string.h>
+#include <stdlib.h>
 
 static const char *TAG = "bsp_sdcard";
 
@@ -22,29 +27,145 @@ static const char *TAG = "bsp_sdcard";
 
 #define MOUNT_POINT   "/sdcard"
 
+// --- Ajuste automático del reloj SPI ---
+#define SD_NVS_NAMESPACE        "storage"
+#define SD_NVS_KEY_FREQ         "sd_freq_khz"
+#define SD_NVS_KEY_SERIAL       "sd_serial"
+#define PROBE_CHUNK_SECTORS     8       // 4 KB por lectura.
+#define PROBE_CHUNKS            32      // 128 KB desde el sector 0 (MBR, FAT y primeros directorios).
+#define PROBE_PASSES            3       // Lecturas idénticas seguidas para dar un reloj por estable.
+
+// Relojes que se prueban por encima del configurado, de mayor a menor.
+static const uint32_t s_probe_freqs_khz[] = { 40000, 26000 };
+
 // --- Variables estáticas globales del módulo ---
 static sdmmc_card_t *g_card = NULL;
 static sdmmc_host_t g_host = SDSPI_HOST_DEFAULT();
+static sdspi_device_config_t g_slot_config = SDSPI_DEVICE_CONFIG_DEFAULT();
+static const esp_vfs_fat_sdmmc_mount_config_t g_mount_config = {
+    .format_if_mount_failed = false,
+    .max_files = 10,
+    .allocation_unit_size = 16 * 1024
+};
+
+static esp_err_t mount_at(uint32_t freq_khz) {
+    g_host.max_freq_khz = freq_khz;
+    esp_err_t ret = esp_vfs_fat_sdspi_mount(MOUNT_POINT, &g_host, &g_slot_config, &g_mount_config, &g_card);
+    if (ret != ESP_OK) g_card = NULL;
+    return ret;
+}
+
+static void unmount(void) {
+    if (g_card) {
+        esp_vfs_fat_sdcard_unmount(MOUNT_POINT, g_card);
+        g_card = NULL;
+    }
+}
+
+#if CONFIG_BSP_SD_AUTOTUNE
+// Firma de la zona de prueba: un CRC por bloque leído directamente de la tarjeta (sin pasar por FAT).
+static bool read_signature(uint8_t *buf, uint32_t *crcs) {
+    for (int i = 0; i < PROBE_CHUNKS; i++) {
+        if (sdmmc_read_sectors(g_card, buf, (size_t)i * PROBE_CHUNK_SECTORS, PROBE_CHUNK_SECTORS) != ESP_OK) return false;
+        crcs[i] = esp_rom_crc32_le(0, buf, PROBE_CHUNK_SECTORS * 512);
+    }
+    return true;
+}
+
+static bool signature_stable(uint8_t *buf, const uint32_t *ref) {
+    uint32_t crcs[PROBE_CHUNKS];
+    for (int pass = 0; pass < PROBE_PASSES; pass++) {
+        if (!read_signature(buf, crcs) || memcmp(crcs, ref, sizeof(crcs)) != 0) return false;
+    }
+    return true;
+}
+
+// Remonta la tarjeta a 'freq_khz' y comprueba que lee lo mismo que al reloj base.
+// Si no es estable, vuelve a montarla al reloj base.
+static bool try_freq(uint32_t freq_khz, uint8_t *buf, const uint32_t *ref) {
+    unmount();
+    bool ok = mount_at(freq_khz) == ESP_OK && signature_stable(buf, ref);
+    ESP_LOGI(TAG, "Prueba a %lu kHz (real %d kHz): %s", (unsigned long)freq_khz,
+             g_card ? g_card->real_freq_khz : 0, ok ? "estable" : "falla");
+    if (!ok) {
+        unmount();
+        if (mount_at(CONFIG_BSP_SD_SPI_FREQ_KHZ) != ESP_OK) {
+            ESP_LOGE(TAG, "No se pudo volver a montar la tarjeta al reloj base.");
+        }
+    }
+    return ok;
+}
+
+static void save_tuning(uint32_t freq_khz, uint32_t serial) {
+    nvs_handle_t nvs_handle;
+    if (nvs_open(SD_NVS_NAMESPACE, NVS_READWRITE, &nvs_handle) == ESP_OK) {
+        nvs_set_u32(nvs_handle, SD_NVS_KEY_FREQ, freq_khz);
+        nvs_set_u32(nvs_handle, SD_NVS_KEY_SERIAL, serial);
+        nvs_commit(nvs_handle);
+        nvs_close(nvs_handle);
+    }
+}
+
+// Elige el reloj SPI más alto con el que la tarjeta insertada lee de forma fiable. El resultado se
+// guarda en NVS junto al número de serie de la tarjeta: en los siguientes arranques solo se verifica.
+static void sdcard_autotune(void) {
+    const uint32_t base_khz = CONFIG_BSP_SD_SPI_FREQ_KHZ;
+    uint8_t *buf = heap_caps_malloc(PROBE_CHUNK_SECTORS * 512, MALLOC_CAP_DMA);
+    uint32_t ref[PROBE_CHUNKS];
+    if (!buf) return;
+    if (!read_signature(buf, ref)) {
+        ESP_LOGW(TAG, "No se pudo leer la zona de prueba; se mantiene el reloj base.");
+        free(buf);
+        return;
+    }
+
+    uint32_t serial = (uint32_t)g_card->cid.serial;
+    uint32_t saved_khz = 0, saved_serial = 0;
+    nvs_handle_t nvs_handle;
+    if (nvs_open(SD_NVS_NAMESPACE, NVS_READONLY, &nvs_handle) == ESP_OK) {
+        if (nvs_get_u32(nvs_handle, SD_NVS_KEY_FREQ, &saved_khz) != ESP_OK ||
+            nvs_get_u32(nvs_handle, SD_NVS_KEY_SERIAL, &saved_serial) != ESP_OK) {
+            saved_khz = 0;
+        }
+        nvs_close(nvs_handle);
+    }
+
+    if (saved_khz && saved_serial == serial) {
+        if (saved_khz <= base_khz || try_freq(saved_khz, buf, ref)) {
+            ESP_LOGI(TAG, "Reloj SPI guardado para esta tarjeta: %lu kHz.", (unsigned long)(saved_khz > base_khz ? saved_khz : base_khz));
+            free(buf);
+            return;
+        }
+        ESP_LOGW(TAG, "El reloj guardado (%lu kHz) ya no es estable; se vuelve a sondear.", (unsigned long)saved_khz);
+    }
+
+    uint32_t chosen = base_khz;
+    for (size_t i = 0; i < sizeof(s_probe_freqs_khz) / sizeof(s_probe_freqs_khz[0]); i++) {
+        if (s_probe_freqs_khz[i] <= base_khz) break;
+        if (try_freq(s_probe_freqs_khz[i], buf, ref)) {
+            chosen = s_probe_freqs_khz[i];
+            break;
+        }
+    }
+    free(buf);
+    if (!g_card) return;
+    save_tuning(chosen, serial);
+    ESP_LOGI(TAG, "Reloj SPI de la SD ajustado a %lu kHz y guardado en NVS.", (unsigned long)chosen);
+}
+#endif // CONFIG_BSP_SD_AUTOTUNE
 
 // --- Implementación de la función pública ---
 esp_err_t bsp_sdcard_init(void)
 {
-    ESP_LOGI(TAG, "Initializing SD card (CS Pin: %d)...", PIN_NUM_CS);
+    ESP_LOGI(TAG, "Initializing SD card (CS Pin: %d, %d kHz)...", PIN_NUM_CS, CONFIG_BSP_SD_SPI_FREQ_KHZ);
     esp_err_t ret;
 
-    esp_vfs_fat_sdmmc_mount_config_t mount_config = {
-        .format_if_mount_failed = false,
-        .max_files = 10,
-        .allocation_unit_size = 16 * 1024
-    };
-
     g_host.slot = SPI2_HOST;
 
-    sdspi_device_config_t slot_config = SDSPI_DEVICE_CONFIG_DEFAULT();
-    slot_config.gpio_cs = PIN_NUM_CS;
-    slot_config.host_id = SPI2_HOST;
+    g_slot_config.gpio_cs = PIN_NUM_CS;
+    g_slot_config.host_id = SPI2_HOST;
 
-    ret = esp_vfs_fat_sdspi_mount(MOUNT_POINT, &g_host, &slot_config, &mount_config, &g_card);
+    ret = mount_at(CONFIG_BSP_SD_SPI_FREQ_KHZ);
 
     if (ret != ESP_OK) {
         if (ret == ESP_FAIL) {
@@ -54,9 +175,38 @@ esp_err_t bsp_sdcard_init(void)
         }
         return ret;
     }
+
+#if CONFIG_BSP_SD_AUTOTUNE
+    sdcard_autotune();
+    if (!g_card) return ESP_FAIL;
+#endif
     
     sdmmc_card_print_info(stdout, g_card);
     ESP_LOGI(TAG, "SD card initialized successfully!");
     
     return ESP_OK;
 }
+
+sdmmc_card_t *bsp_sdcard_get_card(void) {
+    return g_card;
+}
+
+void bsp_sdcard_get_mount_info(uint32_t *max_files, uint32_t *allocation_unit) {
+    if (max_files) *max_files = g_mount_config.max_files;
+    if (allocation_unit) *allocation_unit = g_mount_config.allocation_unit_size;
+}
+
+uint32_t bsp_sdcard_get_freq_khz(void) {
+    return g_card ? (uint32_t)g_card->real_freq_khz : 0;
+}
+
+void bsp_sdcard_forget_tuning(void) {
+    nvs_handle_t nvs_handle;
+    if (nvs_open(SD_NVS_NAMESPACE, NVS_READWRITE, &nvs_handle) == ESP_OK) {
+        nvs_erase_key(nvs_handle, SD_NVS_KEY_FREQ);
+        nvs_erase_key(nvs_handle, SD_NVS_KEY_SERIAL);
+        nvs_commit(nvs_handle);
+        nvs_close(nvs_handle);
+    }
+    ESP_LOGI(TAG, "Ajuste del reloj SPI de la SD borrado; se volverá a sondear en el próximo arranque.");
+}
@@ -0,0 +1,229 @@
+/* Fichero: components/bsp/bsp_sdcard_bench.c */
+/* Descripción: Banco de pruebas de la tarjeta SD montada en /sdcard. Mide, a través del VFS, la escritura secuencial de un fichero de 1 MB (incluido el fsync), su lectura secuencial, lecturas de 4 KB en posiciones aleatorias y la latencia de abrir, leer 512 bytes y cerrar ficheros pequeños. El fichero de 1 MB se reserva contiguo, como los packs de animación, y se vuelve a leer (secuencial y aleatorio) por sectores con 'sdmmc_read_sectors' para comparar los dos caminos del driver 'S:'. Los ficheros se crean en '/sdcard/.sdbench' y se borran al terminar. Se lanza desde la pantalla de configuración o desde el servidor web ('/sdbench'); el último resultado queda guardado para consultarlo. Solo puede haber una medida en curso. */
+/* Último cambio: 18/10/2026 - 00:30 */
+#include "bsp_api.h"
+#include "bsp_priv.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_random.h"
+#include "esp_heap_caps.h"
+#include "sdmmc_cmd.h"
+#include <stdatomic.h>
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+static const char *TAG = "bsp_sd_bench";
+
+#define BENCH_DIR           "/sdcard/.sdbench"
+#define BENCH_FILE          BENCH_DIR "/seq.bin"
+#define BENCH_FILE_BYTES    (1024 * 1024)
+#define BENCH_CHUNK         (16 * 1024)     // Se reduce a 4 KB si no hay memoria.
+#define BENCH_RAND_BYTES    4096
+#define BENCH_RAND_READS    64
+#define BENCH_SMALL_FILES   16
+#define BENCH_SMALL_BYTES   512
+#define BENCH_SMALL_ROUNDS  3
+
+static atomic_flag s_busy = ATOMIC_FLAG_INIT;
+static bsp_sdcard_bench_t s_last;
+static bool s_has_last = false;
+
+static uint32_t kbps(uint64_t bytes, int64_t us) {
+    return us > 0 ? (uint32_t)(bytes * 1000000ULL / 1024ULL / (uint64_t)us) : 0;
+}
+
+static esp_err_t bench_write(uint8_t *buf, size_t chunk, bsp_sdcard_bench_t *res) {
+    for (size_t i = 0; i < chunk; i++) buf[i] = (uint8_t)(i * 31 + 7);
+    // Reservado contiguo como los 'ANIM.pak' subidos por la web; O_TRUNC liberaría los clústeres reservados.
+    bool reserved = bsp_sdcard_preallocate(BENCH_FILE, BENCH_FILE_BYTES) == ESP_OK;
+    int64_t t0 = esp_timer_get_time();
+    int fd = open(BENCH_FILE, reserved ? O_WRONLY : (O_WRONLY | O_CREAT | O_TRUNC), 0644);
+    if (fd < 0) return ESP_FAIL;
+    for (size_t done = 0; done < BENCH_FILE_BYTES; done += chunk) {
+        if (write(fd, buf, chunk) != (ssize_t)chunk) {
+            close(fd);
+            return ESP_FAIL;
+        }
+    }
+    fsync(fd);
+    close(fd);
+    res->write_kbps = kbps(BENCH_FILE_BYTES, esp_timer_get_time() - t0);
+    return ESP_OK;
+}
+
+static esp_err_t bench_seq_read(uint8_t *buf, size_t chunk, bsp_sdcard_bench_t *res) {
+    int64_t t0 = esp_timer_get_time();
+    int fd = open(BENCH_FILE, O_RDONLY);
+    if (fd < 0) return ESP_FAIL;
+    size_t total = 0;
+    ssize_t r;
+    while ((r = read(fd, buf, chunk)) > 0) total += (size_t)r;
+    close(fd);
+    if (total != BENCH_FILE_BYTES) return ESP_FAIL;
+    res->seq_read_kbps = kbps(total, esp_timer_get_time() - t0);
+    return ESP_OK;
+}
+
+static esp_err_t bench_rand_read(uint8_t *buf, bsp_sdcard_bench_t *res) {
+    int fd = open(BENCH_FILE, O_RDONLY);
+    if (fd < 0) return ESP_FAIL;
+    const uint32_t blocks = BENCH_FILE_BYTES / BENCH_RAND_BYTES;
+    int64_t t0 = esp_timer_get_time();
+    for (int i = 0; i < BENCH_RAND_READS; i++) {
+        off_t off = (off_t)(esp_random() % blocks) * BENCH_RAND_BYTES;
+        if (lseek(fd, off, SEEK_SET) != off || read(fd, buf, BENCH_RAND_BYTES) != BENCH_RAND_BYTES) {
+            close(fd);
+            return ESP_FAIL;
+        }
+    }
+    int64_t us = esp_timer_get_time() - t0;
+    close(fd);
+    res->rand_read_kbps = kbps((uint64_t)BENCH_RAND_READS * BENCH_RAND_BYTES, us);
+    res->rand_read_iops = us > 0 ? (uint32_t)(BENCH_RAND_READS * 1000000LL / us) : 0;
+    return ESP_OK;
+}
+
+// Las mismas lecturas que 'bench_seq_read' y 'bench_rand_read', pero por sectores sobre el fichero contiguo,
+// sin VFS ni FatFs: la diferencia es lo que gana el driver 'S:' con los packs contiguos.
+static esp_err_t bench_sector_read(uint8_t *buf, size_t chunk, bsp_sdcard_bench_t *res) {
+    uint32_t first_sector, size;
+    bsp_sdcard_forget_extent(BENCH_FILE);
+    res->contiguous = bsp_sdcard_get_extent(BENCH_FILE, &first_sector, &size) && size == BENCH_FILE_BYTES;
+    if (!res->contiguous) return ESP_OK;
+
+    const uint32_t chunk_sectors = chunk / 512;
+    int64_t t0 = esp_timer_get_time();
+    for (uint32_t s = 0; s < BENCH_FILE_BYTES / 512; s += chunk_sectors) {
+        if (bsp_sdcard_read_sectors(buf, first_sector + s, chunk_sectors) != ESP_OK) return ESP_FAIL;
+    }
+    res->sector_read_kbps = kbps(BENCH_FILE_BYTES, esp_timer_get_time() - t0);
+
+    const uint32_t blocks = BENCH_FILE_BYTES / BENCH_RAND_BYTES;
+    t0 = esp_timer_get_time();
+    for (int i = 0; i < BENCH_RAND_READS; i++) {
+        uint32_t sector = first_sector + (esp_random() % blocks) * (BENCH_RAND_BYTES / 512);
+        if (bsp_sdcard_read_sectors(buf, sector, BENCH_RAND_BYTES / 512) != ESP_OK) return ESP_FAIL;
+    }
+    res->rand_sector_kbps = kbps((uint64_t)BENCH_RAND_READS * BENCH_RAND_BYTES, esp_timer_get_time() - t0);
+    return ESP_OK;
+}
+
+static void small_path(char *out, size_t size, int index) {
+    snprintf(out, size, BENCH_DIR "/s%02d.bin", index);
+}
+
+static esp_err_t bench_small_files(uint8_t *buf, bsp_sdcard_bench_t *res) {
+    char path[48];
+    for (int i = 0; i < BENCH_SMALL_FILES; i++) {
+        small_path(path, sizeof(path), i);
+        int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0) return ESP_FAIL;
+        write(fd, buf, BENCH_SMALL_BYTES);
+        close(fd);
+    }
+
+    uint64_t total_us = 0;
+    uint32_t max_us = 0;
+    for (int round = 0; round < BENCH_SMALL_ROUNDS; round++) {
+        for (int i = 0; i < BENCH_SMALL_FILES; i++) {
+            small_path(path, sizeof(path), i);
+            int64_t t0 = esp_timer_get_time();
+            int fd = open(path, O_RDONLY);
+            if (fd < 0) return ESP_FAIL;
+            read(fd, buf, BENCH_SMALL_BYTES);
+            close(fd);
+            uint32_t us = (uint32_t)(esp_timer_get_time() - t0);
+            total_us += us;
+            if (us > max_us) max_us = us;
+        }
+    }
+    res->open_avg_us = (uint32_t)(total_us / (BENCH_SMALL_FILES * BENCH_SMALL_ROUNDS));
+    res->open_max_us = max_us;
+    return ESP_OK;
+}
+
+static void cleanup(void) {
+    char path[48];
+    unlink(BENCH_FILE);
+    for (int i = 0; i < BENCH_SMALL_FILES; i++) {
+        small_path(path, sizeof(path), i);
+        unlink(path);
+    }
+    rmdir(BENCH_DIR);
+}
+
+// --- Funciones públicas ---
+
+esp_err_t bsp_sdcard_run_benchmark(bsp_sdcard_bench_t *out) {
+    if (out) {
+        memset(out, 0, sizeof(*out));
+        out->status = ESP_ERR_INVALID_STATE;
+    }
+    sdmmc_card_t *card = bsp_sdcard_get_card();
+    if (!card) return ESP_ERR_INVALID_STATE;
+    if (atomic_flag_test_and_set(&s_busy)) {
+        ESP_LOGW(TAG, "Ya hay una medida de la SD en curso.");
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    bsp_sdcard_bench_t res = {0};
+    strncpy(res.card_name, card->cid.name, sizeof(res.card_name) - 1);
+    res.freq_khz = bsp_sdcard_get_freq_khz();
+    bsp_sdcard_get_mount_info(&res.max_files, &res.allocation_unit);
+    res.file_bytes = BENCH_FILE_BYTES;
+
+    size_t chunk = BENCH_CHUNK;
+    uint8_t *buf = heap_caps_malloc(chunk, MALLOC_CAP_DMA);
+    if (!buf) {
+        chunk = BENCH_RAND_BYTES;
+        buf = heap_caps_malloc(chunk, MALLOC_CAP_DMA);
+    }
+
+    ESP_LOGI(TAG, "Midiendo la tarjeta SD '%s' a %lu kHz (bloques de %u bytes)...",
+             res.card_name, (unsigned long)res.freq_khz, (unsigned)chunk);
+    int64_t t0 = esp_timer_get_time();
+    if (!buf) {
+        res.status = ESP_ERR_NO_MEM;
+    } else {
+        mkdir(BENCH_DIR, 0755);
+        res.status = bench_write(buf, chunk, &res);
+        if (res.status == ESP_OK) res.status = bench_seq_read(buf, chunk, &res);
+        if (res.status == ESP_OK) res.status = bench_rand_read(buf, &res);
+        if (res.status == ESP_OK) res.status = bench_sector_read(buf, chunk, &res);
+        if (res.status == ESP_OK) res.status = bench_small_files(buf, &res);
+        cleanup();
+        heap_caps_free(buf);
+    }
+    res.duration_ms = (uint32_t)((esp_timer_get_time() - t0) / 1000);
+
+    if (res.status == ESP_OK) {
+        ESP_LOGI(TAG, "Escritura %lu KB/s, lectura secuencial %lu KB/s, aleatoria 4 KB %lu KB/s (%lu IOPS), "
+                 "abrir+leer+cerrar %lu us (máx %lu us), %lu ms en total.",
+                 (unsigned long)res.write_kbps, (unsigned long)res.seq_read_kbps,
+                 (unsigned long)res.rand_read_kbps, (unsigned long)res.rand_read_iops,
+                 (unsigned long)res.open_avg_us, (unsigned long)res.open_max_us, (unsigned long)res.duration_ms);
+        if (res.contiguous) {
+            ESP_LOGI(TAG, "Por sectores (sin VFS): secuencial %lu KB/s, aleatoria 4 KB %lu KB/s.",
+                     (unsigned long)res.sector_read_kbps, (unsigned long)res.rand_sector_kbps);
+        } else {
+            ESP_LOGW(TAG, "El fichero de prueba no quedó contiguo; no se mide la lectura por sectores.");
+        }
+    } else {
+        ESP_LOGE(TAG, "La medida de la SD ha fallado (%s).", esp_err_to_name(res.status));
+    }
+
+    s_last = res;
+    s_has_last = true;
+    if (out) *out = res;
+    atomic_flag_clear(&s_busy);
+    return res.status;
+}
+
+bool bsp_sdcard_get_last_benchmark(bsp_sdcard_bench_t *out) {
+    if (!s_has_last || !out) return false;
+    *out = s_last;
+    return true;
+}
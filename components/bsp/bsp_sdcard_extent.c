@@ -0,0 +1,176 @@
+/* Fichero: components/bsp/bsp_sdcard_extent.c */
+/* Descripción: Ficheros contiguos en la tarjeta SD y lectura por sectores. 'bsp_sdcard_preallocate' crea un fichero reservando de una vez todos sus clústeres seguidos (f_expand de FatFs); el servidor web lo usa al recibir un 'ANIM.pak'. Como f_expand solo reserva en un fichero vacío, un pack que ya existe se borra antes, y el aviso distingue ese caso (FR_DENIED por fichero con datos) de la falta de un bloque libre del tamaño pedido. 'bsp_sdcard_get_extent' comprueba que la cadena de clústeres de un fichero es contigua y devuelve su primer sector absoluto en la tarjeta y su tamaño: con eso el driver 'S:' lee los fotogramas con 'sdmmc_read_sectors' sin pasar por el VFS ni por FatFs. El resultado (también el negativo, fichero fragmentado) se guarda en una pequeña caché que se vacía cuando el servidor web modifica la SD. El FIL de la comprobación se reserva en el heap: con sectores de 4 KB no cabe en la pila de las tareas que abren los packs. */
+/* Último cambio: 18/10/2026 - 04:30 */
+#include "bsp_api.h"
+#include "bsp_priv.h"
+#include "esp_log.h"
+#include "esp_vfs_fat.h"
+#include "diskio_sdmmc.h"
+#include "ff.h"
+#include "sdmmc_cmd.h"
+#include "freertos/FreeRTOS.h"
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+static const char *TAG = "bsp_sd_extent";
+
+#define MOUNT_POINT         "/sdcard"
+#define EXTENT_CACHE_SIZE   8
+#define EXTENT_PATH_MAX     96
+#define SECTOR_BYTES        512
+
+typedef struct {
+    char path[EXTENT_PATH_MAX];     // Vacío = entrada libre.
+    bool contiguous;
+    uint32_t first_sector;
+    uint32_t size;
+} extent_entry_t;
+
+static portMUX_TYPE s_mux = portMUX_INITIALIZER_UNLOCKED;
+static extent_entry_t s_cache[EXTENT_CACHE_SIZE];
+static uint8_t s_next_slot;
+
+// "/sdcard/diymon/0/ANIM.pak" -> "0:/diymon/0/ANIM.pak" (unidad lógica de FatFs de la tarjeta).
+static bool to_fatfs_path(const char *path, char *out, size_t size) {
+    sdmmc_card_t *card = bsp_sdcard_get_card();
+    if (!card || strncmp(path, MOUNT_POINT "/", sizeof(MOUNT_POINT)) != 0) return false;
+    BYTE pdrv = ff_diskio_get_pdrv_card(card);
+    if (pdrv == 0xFF) return false;
+    int n = snprintf(out, size, "%u:%s", (unsigned)pdrv, path + sizeof(MOUNT_POINT) - 1);
+    return n > 0 && (size_t)n < size;
+}
+
+static bool cache_find(const char *path, extent_entry_t *out) {
+    bool found = false;
+    taskENTER_CRITICAL(&s_mux);
+    for (int i = 0; i < EXTENT_CACHE_SIZE; i++) {
+        if (s_cache[i].path[0] && strcmp(s_cache[i].path, path) == 0) {
+            *out = s_cache[i];
+            found = true;
+            break;
+        }
+    }
+    taskEXIT_CRITICAL(&s_mux);
+    return found;
+}
+
+static void cache_store(const extent_entry_t *e) {
+    taskENTER_CRITICAL(&s_mux);
+    int slot = -1;
+    for (int i = 0; i < EXTENT_CACHE_SIZE && slot < 0; i++) {
+        if (strcmp(s_cache[i].path, e->path) == 0) slot = i;
+    }
+    if (slot < 0) {
+        slot = s_next_slot;
+        s_next_slot = (s_next_slot + 1) % EXTENT_CACHE_SIZE;
+    }
+    s_cache[slot] = *e;
+    taskEXIT_CRITICAL(&s_mux);
+}
+
+// Mira la cadena de clústeres en la propia FAT. Solo se aceptan volúmenes con sectores de 512 bytes,
+// que son los de la tarjeta: así el sector de FatFs es directamente el bloque de 'sdmmc_read_sectors'.
+static bool probe_extent(const char *path, extent_entry_t *e) {
+    char fpath[EXTENT_PATH_MAX + 8];
+    if (!to_fatfs_path(path, fpath, sizeof(fpath))) return false;
+
+    bool contiguous = false;
+    if (esp_vfs_fat_test_contiguous_file(MOUNT_POINT, path, &contiguous) != ESP_OK || !contiguous) {
+        return false;
+    }
+
+    // Sin FF_FS_TINY cada FIL lleva un búfer de un sector (4 KB con CONFIG_FATFS_SECTOR_4096): en la pila no
+    // cabe en las tareas de 4 KB que abren los packs, así que se reserva en el heap como hace el VFS de IDF.
+    FIL *fil = ff_memalloc(sizeof(FIL));
+    if (!fil) return false;
+    bool ok = false;
+    if (f_open(fil, fpath, FA_READ) == FR_OK) {
+        FATFS *fs = fil->obj.fs;
+        ok = fil->obj.sclust >= 2 && f_size(fil) > 0;
+#if FF_MAX_SS != FF_MIN_SS
+        ok = ok && fs->ssize == SECTOR_BYTES;
+#endif
+        if (ok) {
+            e->first_sector = (uint32_t)(fs->database + (LBA_t)(fil->obj.sclust - 2) * fs->csize);
+            e->size = (uint32_t)f_size(fil);
+        }
+        f_close(fil);
+    }
+    ff_memfree(fil);
+    return ok;
+}
+
+// --- Funciones públicas ---
+
+esp_err_t bsp_sdcard_preallocate(const char *path, uint64_t size) {
+    char fpath[EXTENT_PATH_MAX + 8];
+    if (!path || !to_fatfs_path(path, fpath, sizeof(fpath))) return ESP_ERR_INVALID_STATE;
+    bsp_sdcard_forget_extent(path);
+    // f_expand solo reserva en un fichero vacío: se borra el anterior (el aviso de cambio ya ha salido).
+    if (unlink(path) != 0 && errno != ENOENT) {
+        ESP_LOGW(TAG, "No se pudo borrar '%s' antes de reservarlo (errno %d).", path, errno);
+    }
+
+    FIL *fil = ff_memalloc(sizeof(FIL));
+    if (!fil) return ESP_ERR_NO_MEM;
+    bool had_data = false;
+    FRESULT res = f_open(fil, fpath, FA_WRITE | FA_OPEN_ALWAYS);
+    if (res == FR_OK) {
+        had_data = f_size(fil) != 0;
+        res = f_expand(fil, (FSIZE_t)size, 1);
+        f_close(fil);
+    }
+    ff_memfree(fil);
+    if (res == FR_OK) return ESP_OK;
+
+    // FR_DENIED sale tanto de un fichero con datos como de no encontrar un bloque libre del tamaño pedido.
+    if (res == FR_DENIED && had_data) {
+        ESP_LOGW(TAG, "No se pudo reservar '%s' contiguo: el fichero ya tenía datos (FR_DENIED).", path);
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (res == FR_DENIED) {
+        ESP_LOGW(TAG, "No hay %llu bytes contiguos libres para '%s' (FR_DENIED).", (unsigned long long)size, path);
+        return ESP_ERR_NO_MEM;
+    }
+    ESP_LOGW(TAG, "No se pudo reservar '%s' contiguo (FatFs %d).", path, (int)res);
+    return ESP_FAIL;
+}
+
+bool bsp_sdcard_get_extent(const char *path, uint32_t *first_sector, uint32_t *size) {
+    if (!path || strlen(path) >= EXTENT_PATH_MAX) return false;
+    extent_entry_t e;
+    if (!cache_find(path, &e)) {
+        memset(&e, 0, sizeof(e));
+        strcpy(e.path, path);
+        e.contiguous = probe_extent(path, &e);
+        cache_store(&e);
+    }
+    if (!e.contiguous) return false;
+    if (first_sector) *first_sector = e.first_sector;
+    if (size) *size = e.size;
+    return true;
+}
+
+void bsp_sdcard_forget_extent(const char *path) {
+    taskENTER_CRITICAL(&s_mux);
+    for (int i = 0; i < EXTENT_CACHE_SIZE; i++) {
+        if (!s_cache[i].path[0]) continue;
+        // Sin ruta, o si la ruta es un directorio que contiene la entrada, se olvida.
+        size_t n = path ? strlen(path) : 0;
+        if (!path || (strncmp(s_cache[i].path, path, n) == 0 &&
+                      (s_cache[i].path[n] == '\0' || s_cache[i].path[n] == '/'))) {
+            s_cache[i].path[0] = '\0';
+        }
+    }
+    taskEXIT_CRITICAL(&s_mux);
+}
+
+// El host SDSPI hace cada comando completo (CMD18, bloques y CMD12) dentro de una transacción con el bus
+// tomado, así que estas lecturas se pueden intercalar con las del VFS sin desordenar la tarjeta.
+esp_err_t bsp_sdcard_read_sectors(void *dst, uint32_t sector, uint32_t count) {
+    sdmmc_card_t *card = bsp_sdcard_get_card();
+    if (!card || !dst || count == 0) return ESP_ERR_INVALID_ARG;
+    return sdmmc_read_sectors(card, dst, sector, count);
+}
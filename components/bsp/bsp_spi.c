@@ -1,11 +1,12 @@
 /* Fichero: components/bsp/bsp_spi.c */
-/* Último cambio: Corregidos los pines SPI (SCLK/MOSI) para la placa de 1.47" para resolver el fallo de inicialización de la tarjeta SD. */
-/* Descripción: Diagnóstico de Causa Raíz: El error 'sdmmc_card_init failed (0x107)' (ESP_ERR_TIMEOUT) es causado por una asignación incorrecta de los pines SPI para la placa de 1.47". El log muestra un fallo de comunicación fundamental, y la comparación con el esquemático oficial confirma que los pines SCLK y MOSI estaban intercambiados.
-Solución Definitiva: Se han corregido las macros PIN_NUM_SPI_SCLK y PIN_NUM_SPI_MOSI dentro del bloque de preprocesador para la placa WS1.47TS para que coincidan con el hardware (SCLK=GPIO1, MOSI=GPIO2). Esto establece la conexión física correcta, permitiendo que el controlador SPI se comunique con la tarjeta SD y la inicialice con éxito. */
-/* Último cambio: 20/08/2025 - 05:58 */
+/* Último cambio: Expuesto el tamaño máximo de cada transacción DMA del bus, con el que el display dimensiona la cola de envíos. */
+/* Descripción: Inicialización del bus SPI2, compartido por la pantalla y la tarjeta SD, con los pines de cada placa (en la de 1.47" SCLK=GPIO1 y MOSI=GPIO2, según el esquemático oficial). 'max_transfer_sz' admite los trozos de hasta SPI_LL_DMA_MAX_BIT_LEN / 8 bytes en los que esp_lcd divide cada envío de color; 'bsp_spi_get_max_transfer_bytes' devuelve el menor de los dos, que es lo que ocupa cada hueco de la cola de la pantalla. */
+/* Último cambio: 18/10/2026 - 03:00 */
 #include "bsp_api.h"
 #include "esp_log.h"
+#include "bsp_priv.h"
 #include "driver/spi_master.h"
+#include "hal/spi_ll.h"
 
 static const char *TAG = "bsp_spi";
 
@@ -26,6 +27,7 @@ static const char *TAG = "bsp_spi";
 #endif
 
 #define BSP_SPI_HOST            SPI2_HOST
+#define BSP_SPI_MAX_TRANSFER_SZ (BSP_LCD_H_RES_FOR_SPI * 100 * sizeof(uint16_t))
 
 // --- Variables estáticas globales del módulo ---
 static bool g_spi_bus_initialized = false;
@@ -45,7 +47,7 @@ esp_err_t bsp_spi_init(void) {
         .miso_io_num = PIN_NUM_SPI_MISO, 
         .quadwp_io_num = -1,
         .quadhd_io_num = -1,
-        .max_transfer_sz = BSP_LCD_H_RES_FOR_SPI * 100 * sizeof(uint16_t)
+        .max_transfer_sz = BSP_SPI_MAX_TRANSFER_SZ
     };
     
     esp_err_t ret = spi_bus_initialize(BSP_SPI_HOST, &buscfg, SPI_DMA_CH_AUTO);
@@ -58,3 +60,9 @@ esp_err_t bsp_spi_init(void) {
 
     return ret;
 }
+
+// esp_lcd envía el color en trozos de como mucho SPI_LL_DMA_MAX_BIT_LEN / 8 bytes (32 KB en el C6); el bus limita además a 'max_transfer_sz'.
+size_t bsp_spi_get_max_transfer_bytes(void) {
+    size_t dma_max = SPI_LL_DMA_MAX_BIT_LEN / 8;
+    return BSP_SPI_MAX_TRANSFER_SZ < dma_max ? BSP_SPI_MAX_TRANSFER_SZ : dma_max;
+}
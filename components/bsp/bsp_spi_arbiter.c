@@ -0,0 +1,196 @@
+/* Fichero: components/bsp/bsp_spi_arbiter.c */
+/* Descripción: Arbitraje del bus SPI2 que comparten la pantalla y la tarjeta SD. El driver SPI de ESP-IDF ya serializa las transacciones, pero sin criterio: una lectura de fotograma de ~100 KB ocupa el bus decenas de milisegundos y el envío del búfer de LVGL encolado detrás espera entero, mientras la tarea de LVGL da vueltas en 'wait_for_flushing'. Ahora las lecturas de la SD llegan troceadas (sd_file_io) y antes de cada trozo se consulta al árbitro: si hay un envío a la pantalla pendiente y el trozo no cabe antes de su plazo ('BSP_SPI_FLUSH_DEADLINE_US' desde que LVGL lo pidió), la lectura espera a que termine; si cabe, se intercala. El tiempo de cada trozo se estima con la velocidad medida de la SD. LVGL espera el fin del envío dormida en un semáforo que da la interrupción de fin de transferencia, en lugar de sondear, así que las tareas de menor prioridad (la del precargador) siguen avanzando. Los contadores separan, por cliente, el tiempo con el bus y el tiempo de espera por el otro. */
+/* Último cambio: 17/10/2026 - 23:30 */
+#include "bsp_api.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "esp_lcd_panel_io.h"
+#include "lvgl.h"
+#include "sdkconfig.h"
+#include <string.h>
+
+static const char *TAG = "bsp_spi_arbiter";
+
+#define SD_RATE_INITIAL_BPS     (1024 * 1024)   // Estimación inicial hasta medir la SD (1 MB/s).
+#define SD_MAX_DEFER_US         20000           // Una lectura nunca espera más de esto por la pantalla.
+
+static portMUX_TYPE s_mux = portMUX_INITIALIZER_UNLOCKED;
+static SemaphoreHandle_t s_lcd_done_lvgl;       // Lo espera LVGL (flush_wait_cb).
+static SemaphoreHandle_t s_lcd_done_sd;         // Lo espera una lectura aplazada.
+static lv_display_t *s_disp;
+
+static volatile bool s_lcd_pending;
+static int64_t s_lcd_start_us;
+static int64_t s_lcd_deadline_us;
+static int64_t s_lcd_overlap_us;                // Tiempo del envío en curso con la SD ocupando el bus.
+static bool s_sd_active;
+static int64_t s_sd_begin_us;
+static uint32_t s_sd_rate_bps = SD_RATE_INITIAL_BPS;
+
+static bsp_spi_bus_stats_t s_stats;
+static int64_t s_window_start_us;
+
+// --- Cliente pantalla ---
+
+static void on_flush_start(lv_event_t *e) {
+    const lv_area_t *area = lv_event_get_param(e);
+    int64_t now = esp_timer_get_time();
+    taskENTER_CRITICAL(&s_mux);
+    s_lcd_pending = true;
+    s_lcd_start_us = now;
+    s_lcd_deadline_us = now + CONFIG_BSP_SPI_FLUSH_DEADLINE_US;
+    s_lcd_overlap_us = 0;
+    s_stats.client[BSP_SPI_CLIENT_LCD].transactions++;
+    if (area) s_stats.client[BSP_SPI_CLIENT_LCD].bytes += (uint64_t)lv_area_get_size(area) * 2;
+    taskEXIT_CRITICAL(&s_mux);
+}
+
+// Sustituye al callback de fin de transferencia de esp_lvgl_port: hace lo mismo (lv_display_flush_ready)
+// y además cierra la cuenta del envío y despierta a quien lo esperaba.
+static bool on_color_trans_done(esp_lcd_panel_io_handle_t io, esp_lcd_panel_io_event_data_t *edata, void *user_ctx) {
+    lv_display_flush_ready((lv_display_t *)user_ctx);
+
+    int64_t now = esp_timer_get_time();
+    taskENTER_CRITICAL_ISR(&s_mux);
+    if (s_lcd_pending) {
+        bsp_spi_client_stats_t *lcd = &s_stats.client[BSP_SPI_CLIENT_LCD];
+        int64_t total = now - s_lcd_start_us;
+        int64_t wait = s_lcd_overlap_us < total ? s_lcd_overlap_us : total;
+        lcd->busy_us += (uint64_t)(total - wait);
+        lcd->wait_us += (uint64_t)wait;
+        if ((uint32_t)wait > lcd->max_wait_us) lcd->max_wait_us = (uint32_t)wait;
+        if (now > s_lcd_deadline_us) s_stats.deadline_misses++;
+        s_lcd_pending = false;
+    }
+    taskEXIT_CRITICAL_ISR(&s_mux);
+
+    BaseType_t woken = pdFALSE;
+    xSemaphoreGiveFromISR(s_lcd_done_lvgl, &woken);
+    xSemaphoreGiveFromISR(s_lcd_done_sd, &woken);
+    return woken == pdTRUE;
+}
+
+static void flush_wait_cb(lv_display_t *disp) {
+    // El timeout solo cubre una interrupción perdida; normalmente despierta el semáforo.
+    while (s_lcd_pending) {
+        xSemaphoreTake(s_lcd_done_lvgl, 1);
+    }
+}
+
+// --- Funciones públicas ---
+
+void bsp_spi_arbiter_attach_display(lv_display_t *disp, esp_lcd_panel_io_handle_t io) {
+#if CONFIG_BSP_SPI_ARBITER
+    if (!disp || !io || s_disp) return;
+    s_lcd_done_lvgl = xSemaphoreCreateBinary();
+    s_lcd_done_sd = xSemaphoreCreateBinary();
+    if (!s_lcd_done_lvgl || !s_lcd_done_sd) {
+        ESP_LOGE(TAG, "Sin memoria para el árbitro del bus SPI.");
+        return;
+    }
+    s_disp = disp;
+    s_window_start_us = esp_timer_get_time();
+
+    const esp_lcd_panel_io_callbacks_t cbs = { .on_color_trans_done = on_color_trans_done };
+    esp_lcd_panel_io_register_event_callbacks(io, &cbs, disp);
+    lv_display_add_event_cb(disp, on_flush_start, LV_EVENT_FLUSH_START, NULL);
+    lv_display_set_flush_wait_cb(disp, flush_wait_cb);
+    ESP_LOGI(TAG, "Árbitro del bus SPI activo (plazo de envío a pantalla: %d us).", CONFIG_BSP_SPI_FLUSH_DEADLINE_US);
+#endif
+}
+
+void bsp_spi_arbiter_sd_begin(size_t bytes) {
+    if (!s_disp) return;
+    int64_t t0 = esp_timer_get_time();
+    int64_t now = t0;
+    int64_t est_us = (int64_t)bytes * 1000000LL / s_sd_rate_bps;
+    bool deferred = false;
+
+    // Mientras haya un envío a pantalla pendiente que el trozo retrasaría más allá de su plazo, se espera.
+    while (s_lcd_pending && now - t0 < SD_MAX_DEFER_US) {
+        taskENTER_CRITICAL(&s_mux);
+        bool fits = !s_lcd_pending || now + est_us <= s_lcd_deadline_us;
+        taskEXIT_CRITICAL(&s_mux);
+        if (fits) break;
+        deferred = true;
+        xSemaphoreTake(s_lcd_done_sd, 1);
+        now = esp_timer_get_time();
+    }
+
+    taskENTER_CRITICAL(&s_mux);
+    bsp_spi_client_stats_t *sd = &s_stats.client[BSP_SPI_CLIENT_SD];
+    if (deferred) {
+        s_stats.sd_deferrals++;
+        sd->wait_us += (uint64_t)(now - t0);
+        if ((uint32_t)(now - t0) > sd->max_wait_us) sd->max_wait_us = (uint32_t)(now - t0);
+    }
+    s_sd_active = true;
+    s_sd_begin_us = now;
+    taskEXIT_CRITICAL(&s_mux);
+}
+
+void bsp_spi_arbiter_sd_end(size_t bytes) {
+    if (!s_disp) return;
+    int64_t now = esp_timer_get_time();
+    taskENTER_CRITICAL(&s_mux);
+    if (s_sd_active) {
+        int64_t busy = now - s_sd_begin_us;
+        bsp_spi_client_stats_t *sd = &s_stats.client[BSP_SPI_CLIENT_SD];
+        sd->transactions++;
+        sd->bytes += bytes;
+        sd->busy_us += (uint64_t)busy;
+        // El envío a pantalla pendiente durante este trozo ha esperado por la SD.
+        if (s_lcd_pending) {
+            int64_t from = s_lcd_start_us > s_sd_begin_us ? s_lcd_start_us : s_sd_begin_us;
+            if (now > from) s_lcd_overlap_us += now - from;
+        }
+        // Velocidad de la SD (media móvil) para estimar los trozos siguientes.
+        if (busy > 0 && bytes >= 512) {
+            uint32_t rate = (uint32_t)((uint64_t)bytes * 1000000ULL / (uint64_t)busy);
+            s_sd_rate_bps = (s_sd_rate_bps * 7 + rate) / 8;
+            if (s_sd_rate_bps == 0) s_sd_rate_bps = 1;
+        }
+        s_sd_active = false;
+    }
+    taskEXIT_CRITICAL(&s_mux);
+}
+
+void bsp_spi_arbiter_get_stats(bsp_spi_bus_stats_t *out) {
+    if (!out) return;
+    int64_t now = esp_timer_get_time();
+    taskENTER_CRITICAL(&s_mux);
+    *out = s_stats;
+    out->window_us = s_window_start_us ? (uint64_t)(now - s_window_start_us) : 0;
+    out->sd_rate_bps = s_sd_rate_bps;
+    taskEXIT_CRITICAL(&s_mux);
+}
+
+void bsp_spi_arbiter_reset_stats(void) {
+    taskENTER_CRITICAL(&s_mux);
+    memset(&s_stats, 0, sizeof(s_stats));
+    s_window_start_us = esp_timer_get_time();
+    taskEXIT_CRITICAL(&s_mux);
+}
+
+void bsp_spi_arbiter_log_stats(void) {
+    if (!s_disp) return;
+    bsp_spi_bus_stats_t st;
+    bsp_spi_arbiter_get_stats(&st);
+    const bsp_spi_client_stats_t *lcd = &st.client[BSP_SPI_CLIENT_LCD];
+    const bsp_spi_client_stats_t *sd = &st.client[BSP_SPI_CLIENT_SD];
+    // Ocupación del bus en porcentaje x10 para el log sin coma flotante.
+    uint32_t use = st.window_us ? (uint32_t)((lcd->busy_us + sd->busy_us) * 1000ULL / st.window_us) : 0;
+    ESP_LOGI(TAG, "Bus ocupado %lu.%lu%% | pantalla: %lu envíos, %llu KB, %llu ms con bus, %llu ms esperando (máx %lu us), "
+             "%lu fuera de plazo | SD: %lu trozos, %llu KB, %llu ms con bus, %llu ms esperando (máx %lu us), "
+             "%lu aplazados, %lu KB/s",
+             (unsigned long)(use / 10), (unsigned long)(use % 10),
+             (unsigned long)lcd->transactions, (unsigned long long)(lcd->bytes / 1024),
+             (unsigned long long)(lcd->busy_us / 1000), (unsigned long long)(lcd->wait_us / 1000),
+             (unsigned long)lcd->max_wait_us, (unsigned long)st.deadline_misses,
+             (unsigned long)sd->transactions, (unsigned long long)(sd->bytes / 1024),
+             (unsigned long long)(sd->busy_us / 1000), (unsigned long long)(sd->wait_us / 1000),
+             (unsigned long)sd->max_wait_us, (unsigned long)st.sd_deferrals,
+             (unsigned long)(st.sd_rate_bps / 1024));
+}
@@ -1,6 +1,6 @@
 /* Fichero: components/bsp/include/bsp_api.h */
-/* Descripción: Se ha modificado la firma de 'bsp_display_set_brightness' para aceptar un booleano 'save_to_nvs'. Este cambio es fundamental para la nueva lógica de atenuado, ya que permite al 'state_manager' reducir el brillo temporalmente sin sobrescribir el valor preferido por el usuario en la NVS. */
-/* Último cambio: 21/08/2025 - 19:23 */
+/* Descripción: Se añaden la estrategia del búfer de dibujo elegida al iniciar la pantalla (líneas, doble búfer, refresco completo y profundidad de la cola SPI) y el banco de pruebas del dibujo, que separa en cada fotograma el tiempo de render de LVGL del de espera al envío por SPI. 'bsp_get_display_buffer_size' devuelve ahora píxeles. */
+/* Último cambio: 18/10/2026 - 03:00 */
 #ifndef BSP_API_H
 #define BSP_API_H
 
@@ -10,6 +10,7 @@
 #include "driver/i2c_master.h"
 #include "driver/gpio.h"
 #include "esp_wifi.h"
+#include "lvgl.h"
 #include <stdint.h> // Para uint16_t
 #include <stdbool.h> // Para bool
 
@@ -48,6 +49,111 @@ void bsp_imu_read(float acc[3], float gyro[3]);
 // --- FUNCIONES DE BATERÍA ---
 void bsp_battery_get_voltage(float *voltage, uint16_t *adc_value);
 
+// --- FUNCIONES DE LA TARJETA SD ---
+typedef struct {
+    esp_err_t status;           // ESP_OK si la medida terminó.
+    char card_name[8];
+    uint32_t freq_khz;          // Reloj SPI real de la tarjeta.
+    uint32_t max_files;         // Configuración de montaje.
+    uint32_t allocation_unit;
+    uint32_t file_bytes;        // Tamaño del fichero de prueba secuencial.
+    uint32_t write_kbps;        // Escritura secuencial (incluye el fsync).
+    uint32_t seq_read_kbps;
+    uint32_t rand_read_kbps;    // Lecturas de 4 KB en posiciones aleatorias.
+    uint32_t rand_read_iops;
+    uint32_t open_avg_us;       // Abrir, leer 512 bytes y cerrar un fichero pequeño.
+    uint32_t open_max_us;
+    bool contiguous;            // El fichero de prueba quedó contiguo (si no, no hay medida por sectores).
+    uint32_t sector_read_kbps;  // Lectura secuencial por sectores, sin VFS.
+    uint32_t rand_sector_kbps;  // Lecturas de 4 KB aleatorias por sectores.
+    uint32_t duration_ms;
+} bsp_sdcard_bench_t;
+
+esp_err_t bsp_sdcard_run_benchmark(bsp_sdcard_bench_t *out); // Bloquea unos segundos.
+bool bsp_sdcard_get_last_benchmark(bsp_sdcard_bench_t *out);
+uint32_t bsp_sdcard_get_freq_khz(void);
+void bsp_sdcard_forget_tuning(void); // El reloj se vuelve a sondear en el próximo arranque.
+esp_err_t bsp_sdcard_preallocate(const char *path, uint64_t size); // Crea 'path' (ruta VFS) con sus clústeres contiguos.
+bool bsp_sdcard_get_extent(const char *path, uint32_t *first_sector, uint32_t *size); // false si no es contiguo.
+void bsp_sdcard_forget_extent(const char *path); // NULL olvida todos; un directorio, lo que cuelga de él.
+esp_err_t bsp_sdcard_read_sectors(void *dst, uint32_t sector, uint32_t count);
+
+// --- ÁRBITRO DEL BUS SPI (PANTALLA + SD) ---
+typedef enum {
+    BSP_SPI_CLIENT_LCD = 0,
+    BSP_SPI_CLIENT_SD,
+    BSP_SPI_CLIENT_COUNT
+} bsp_spi_client_t;
+
+typedef struct {
+    uint32_t transactions;      // Envíos a pantalla / trozos de lectura de la SD.
+    uint64_t bytes;
+    uint64_t busy_us;           // Tiempo con el bus.
+    uint64_t wait_us;           // Tiempo esperando a que el otro cliente suelte el bus.
+    uint32_t max_wait_us;
+} bsp_spi_client_stats_t;
+
+typedef struct {
+    bsp_spi_client_stats_t client[BSP_SPI_CLIENT_COUNT];
+    uint64_t window_us;         // Tiempo desde la última puesta a cero.
+    uint32_t sd_deferrals;      // Lecturas de la SD retrasadas para que un envío cumpla su plazo.
+    uint32_t deadline_misses;   // Envíos a pantalla terminados después de su plazo.
+    uint32_t sd_rate_bps;       // Velocidad de lectura de la SD estimada.
+} bsp_spi_bus_stats_t;
+
+void bsp_spi_arbiter_attach_display(lv_display_t *disp, esp_lcd_panel_io_handle_t io); // Con el cerrojo de LVGL tomado.
+void bsp_spi_arbiter_sd_begin(size_t bytes); // Puede esperar a que termine un envío a pantalla.
+void bsp_spi_arbiter_sd_end(size_t bytes);
+void bsp_spi_arbiter_get_stats(bsp_spi_bus_stats_t *out);
+void bsp_spi_arbiter_reset_stats(void);
+void bsp_spi_arbiter_log_stats(void);
+
+// --- TIEMPO DE CPU DEL FLUSH ---
+// Lo que cuesta cada flush de LVGL entre LV_EVENT_FLUSH_START y LV_EVENT_FLUSH_FINISH.
+typedef struct {
+    uint32_t flushes;           // Flushes medidos.
+    uint64_t pixels;            // Píxeles enviados.
+    uint64_t cpu_us;            // Tiempo total del flush_cb.
+    uint32_t max_us;            // Flush más lento.
+    uint32_t swap_ns_per_px;    // Coste medido del intercambio de bytes por píxel.
+    bool swap_bytes;            // El flush intercambia los bytes (si no, LVGL ya dibuja en el orden del panel).
+} bsp_lcd_flush_stats_t;
+
+void bsp_lcd_flush_attach(lv_display_t *disp, bool swap_bytes); // Con el cerrojo de LVGL tomado.
+void bsp_lcd_flush_get_stats(bsp_lcd_flush_stats_t *out);
+void bsp_lcd_flush_reset_stats(void);
+void bsp_lcd_flush_log_stats(void);
+
+// --- BÚFER DE DIBUJO Y BANCO DE PRUEBAS DE LA PANTALLA ---
+// Estrategia elegida en bsp_display_init según Kconfig y la RAM libre.
+typedef struct {
+    uint32_t buffer_px;         // Píxeles de cada búfer (lo que espera 'lvgl_port_display_cfg_t.buffer_size').
+    uint32_t lines;             // Líneas de cada búfer (la pantalla entera con refresco completo).
+    bool double_buffer;
+    bool full_refresh;          // LVGL redibuja la pantalla entera en cada fotograma.
+    uint32_t trans_queue_depth; // Huecos de la cola de envíos SPI de la pantalla.
+    bool degraded;              // No había RAM para lo configurado y se usa una estrategia menor.
+} bsp_display_buffer_cfg_t;
+
+// Resultado del banco de pruebas: una escena fija redibujada entera en cada fotograma.
+typedef struct {
+    esp_err_t status;
+    bsp_display_buffer_cfg_t buffer;
+    uint32_t frames;
+    uint32_t flushes_per_frame;
+    uint32_t frame_avg_us;      // De LV_EVENT_REFR_START a LV_EVENT_REFR_READY.
+    uint32_t frame_max_us;
+    uint32_t render_avg_us;     // Dibujo de LVGL: el fotograma sin el flush ni la espera.
+    uint32_t flush_avg_us;      // CPU del flush_cb (intercambio de bytes y encolar el envío).
+    uint32_t wait_avg_us;       // Esperando a que el SPI libere un búfer.
+    uint32_t fps_x10;
+    uint32_t free_ram_kb;       // RAM interna libre con los búferes reservados.
+} bsp_lcd_bench_t;
+
+void bsp_get_display_buffer_cfg(bsp_display_buffer_cfg_t *out);
+esp_err_t bsp_lcd_run_benchmark(bsp_lcd_bench_t *out); // Ocupa la pantalla un par de segundos. No desde la tarea de LVGL.
+bool bsp_lcd_get_last_benchmark(bsp_lcd_bench_t *out);
+
 // --- GETTERS DE HANDLES Y CONFIGURACIÓN ---
 i2c_master_bus_handle_t bsp_get_i2c_bus_handle(void);
 esp_lcd_panel_io_handle_t bsp_get_panel_io_handle(void);
@@ -55,6 +161,6 @@ esp_lcd_panel_handle_t bsp_get_display_handle(void);
 esp_lcd_touch_handle_t bsp_get_touch_handle(void);
 int bsp_get_display_hres(void);
 int bsp_get_display_vres(void);
-size_t bsp_get_display_buffer_size(void);
+size_t bsp_get_display_buffer_size(void); // En píxeles.
 
 #endif // BSP_API_H
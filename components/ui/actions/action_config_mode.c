@@ -1,7 +1,6 @@
 /* Fichero: components/ui/actions/action_config_mode.c */
-/* Descripción: Diagnóstico de Causa Raíz: El 'Load access fault' es un error de tipo 'use-after-free' que ocurre por ejecutar una destrucción compleja de la UI de forma síncrona dentro de un callback de evento de LVGL. La llamada a lv_obj_del() marca la pantalla y sus hijos para ser borrados, pero el proceso de limpieza real se completa más tarde en el ciclo principal de LVGL. Al ejecutar la destrucción de forma síncrona, se crea una condición de carrera en la que el manejador de LVGL intenta acceder a objetos que ya han sido invalidados en el mismo ciclo de eventos, causando el crash.
-Solución Definitiva: Toda la lógica de transición al modo de configuración se ha encapsulado en una única función (	ransition_to_config_mode_cb) que es invocada de forma asíncrona a través de un temporizador de un solo uso. La función ction_config_mode_start ahora solo se encarga de programar este temporizador. Esto garantiza que el ciclo de eventos actual de LVGL finalice de forma limpia. La transición (destrucción de la UI antigua y creación de la nueva) se ejecuta en un ciclo posterior, eliminando la condición de carrera y asegurando la estabilidad del estado de LVGL. */
-/* Último cambio: 20/08/2025 - 07:56 */
+/* Descripción: Pantalla y tarea del modo configuración. Se añade el botón 'TEST SD', que lanza el banco de pruebas de la tarjeta SD del BSP en una tarea aparte (tarda unos segundos y no debe bloquear la tarea de LVGL) y muestra en la pantalla el reloj SPI, las velocidades de escritura y lectura y la latencia de apertura de ficheros. El mismo resultado se consulta desde el portal web en '/sdbench'. La transición al modo configuración se sigue ejecutando de forma asíncrona con un temporizador de un solo uso, para que el ciclo de eventos de LVGL en curso termine antes de destruir la pantalla principal. */
+/* Último cambio: 17/10/2026 - 22:50 */
 #include "actions/action_config_mode.h"
 #include "esp_log.h"
 #include "freertos/FreeRTOS.h"
@@ -24,6 +23,8 @@ static bool s_is_config_mode_active = false;
 static lv_obj_t *s_config_screen = NULL;
 static TaskHandle_t s_wifi_task_handle = NULL;
 static httpd_handle_t s_server_handle = NULL;
+static lv_obj_t *s_bench_label = NULL;
+static lv_obj_t *s_bench_button = NULL;
 
 // --- Funciones de ayuda privadas del módulo ---
 
@@ -90,6 +91,37 @@ static void restart_button_event_cb(lv_event_t *e) {
     }
 }
 
+static void sd_bench_task(void *param) {
+    bsp_sdcard_bench_t res;
+    bsp_sdcard_run_benchmark(&res);
+
+    lvgl_port_lock(0);
+    if (s_is_config_mode_active && s_bench_label) {
+        if (res.status == ESP_OK) {
+            lv_label_set_text_fmt(s_bench_label, "SD %lu kHz\nEscr %lu KB/s  Lect %lu KB/s\nAleat %lu KB/s  Abrir %lu us",
+                                  (unsigned long)res.freq_khz, (unsigned long)res.write_kbps,
+                                  (unsigned long)res.seq_read_kbps, (unsigned long)res.rand_read_kbps,
+                                  (unsigned long)res.open_avg_us);
+        } else {
+            lv_label_set_text_fmt(s_bench_label, "Test SD fallido (%s)", esp_err_to_name(res.status));
+        }
+        lv_obj_clear_state(s_bench_button, LV_STATE_DISABLED);
+    }
+    lvgl_port_unlock();
+    vTaskDelete(NULL);
+}
+
+static void sd_bench_button_event_cb(lv_event_t *e) {
+    if (lv_event_get_code(e) != LV_EVENT_CLICKED) return;
+    ESP_LOGI(TAG, "Botón 'TEST SD' presionado. Midiendo la tarjeta SD...");
+    lv_obj_add_state(s_bench_button, LV_STATE_DISABLED);
+    lv_label_set_text(s_bench_label, "Midiendo SD...");
+    if (xTaskCreate(sd_bench_task, "sd_bench_task", 4096, NULL, 3, NULL) != pdPASS) {
+        lv_label_set_text(s_bench_label, "Sin memoria para el test");
+        lv_obj_clear_state(s_bench_button, LV_STATE_DISABLED);
+    }
+}
+
 static void transition_to_config_mode_cb(lv_timer_t *timer) {
     ESP_LOGI(TAG, "Ejecutando transición al modo configuración...");
 
@@ -127,6 +159,22 @@ static void transition_to_config_mode_cb(lv_timer_t *timer) {
     lv_obj_center(lbl);
 
     button_feedback_add(restart_button);
+
+    s_bench_button = lv_btn_create(s_config_screen);
+    lv_obj_align(s_bench_button, LV_ALIGN_BOTTOM_MID, 0, -75);
+    lv_obj_add_event_cb(s_bench_button, sd_bench_button_event_cb, LV_EVENT_CLICKED, NULL);
+    lbl = lv_label_create(s_bench_button);
+    lv_label_set_text(lbl, "TEST SD");
+    lv_obj_center(lbl);
+    button_feedback_add(s_bench_button);
+
+    s_bench_label = lv_label_create(s_config_screen);
+    lv_obj_set_style_text_color(s_bench_label, lv_color_white(), 0);
+    lv_obj_set_style_text_align(s_bench_label, LV_TEXT_ALIGN_CENTER, 0);
+    lv_obj_set_width(s_bench_label, lv_pct(95));
+    lv_obj_align(s_bench_label, LV_ALIGN_CENTER, 0, 55);
+    lv_label_set_text(s_bench_label, "");
+
     lv_screen_load(s_config_screen);
     lvgl_port_unlock();
 
@@ -1,7 +1,7 @@
-/* Fecha: 17/08/2025 - 09:45  */
+/* Fecha: 17/10/2026 - 21:40  */
 /* Fichero: components/ui/actions/action_evolution.c */
-/* Último cambio: Actualizada la ruta de inclusión de 'telemetry_manager.h' para reflejar la refactorización a ui/telemetry/. */
-/* Descripción: Módulo que maneja los cambios de estado del Diymon. Se ha actualizado la ruta de inclusión para apuntar al nuevo directorio 'telemetry', manteniendo la consistencia con la refactorización de la lógica de sensores. */
+/* Último cambio: El cambio de animación de reposo se hace con precarga en segundo plano. */
+/* Descripción: Módulo que maneja los cambios de estado del Diymon. Tras un cambio de evolución, la animación de reposo ya no se detiene, oculta y recarga dentro de la tarea de LVGL: 'ui_idle_animation_switch_evolution' mantiene visible el personaje anterior mientras se precarga el primer fotograma del nuevo y hace el cambio cuando está listo. */
 
 #include "actions/action_evolution.h"
 #include "diymon_evolution.h"
@@ -17,23 +17,12 @@ static const char *TAG = "ACTION_EVOLUTION";
  * @brief Función interna para actualizar la UI después de un cambio de evolución.
  */
 static void update_ui_after_evolution_change(void) {
-    // Detiene la animación de reposo actual para poder recargarla con el nuevo personaje.
-    ui_idle_animation_stop();
-    // Oculta temporalmente el objeto de la animación para evitar que se vea el último fotograma del personaje anterior.
-    if (g_animation_img_obj) {
-        lv_obj_add_flag(g_animation_img_obj, LV_OBJ_FLAG_HIDDEN);
-    }
-
     // Fuerza la actualización inmediata de la telemetría para que muestre el nuevo código EVO.
     telemetry_manager_update_values(100); // Se asume 100% de batería, ya que no se recalcula aquí. La tarea principal lo corregirá.
-    
-    // Inicia la nueva animación de reposo, que cargará los assets del nuevo código de evolución.
-    ui_idle_animation_start(g_main_screen_obj);
-    
-    // Vuelve a hacer visible el objeto de la animación.
-    if (g_animation_img_obj) {
-        lv_obj_clear_flag(g_animation_img_obj, LV_OBJ_FLAG_HIDDEN);
-    }
+
+    // Precarga en segundo plano la animación de reposo del nuevo código de evolución; el personaje
+    // anterior sigue visible hasta que el primer fotograma del nuevo está listo.
+    ui_idle_animation_switch_evolution(g_main_screen_obj);
 }
 
 /**
@@ -0,0 +1,159 @@
+/* Fichero: components/ui/animation_clock.c */
+/* Descripción: Reloj de animación. Los players programaban el siguiente fotograma con un periodo fijo del lv_timer (500 ms en las acciones, 1500 ms en reposo) contado desde que terminaba la carga anterior, así que cada lectura lenta de la SD retrasaba todo el resto de la animación. Ahora cada fotograma tiene una hora de salida fija (la del anterior más su duración) y el temporizador se reprograma para despertar justo a esa hora. Si al llegar el turno ya pasó también el del fotograma siguiente, se saltan los vencidos: la animación conserva su duración total a costa de mostrar menos fotogramas. El último fotograma de una acción se muestra siempre (es la pose final). Los contadores comparan los FPS conseguidos con los programados y miden el retraso de cada fotograma respecto a su hora. */
+/* Último cambio: 17/10/2026 - 20:25 */
+#include "animation_clock.h"
+#include "animation_loader.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "lvgl.h"
+#include <string.h>
+
+static const char *TAG = "ANIM_CLOCK";
+
+// Un fotograma cuenta como tardío si sale más de un refresco de pantalla después de su hora.
+#define CLOCK_LATE_US   ((int64_t)LV_DEF_REFR_PERIOD * 1000)
+
+static int64_t frame_us(const animation_clock_t *clk, int32_t index) {
+    uint16_t ms = (index >= 0 && index < ANIM_CLOCK_MAX_FRAMES) ? clk->durations_ms[index] : 0;
+    return (int64_t)(ms ? ms : clk->default_ms) * 1000;
+}
+
+static int32_t following(const animation_clock_t *clk, int32_t index) {
+    int32_t next = index + 1;
+    if (clk->loop && next >= clk->frame_count) next = 0;
+    return next;
+}
+
+void animation_clock_init(animation_clock_t *clk, const char *name, uint16_t default_ms) {
+    if (!clk) return;
+    memset(clk, 0, sizeof(*clk));
+    clk->name = name ? name : "";
+    clk->default_ms = default_ms ? default_ms : 1;
+    clk->current = -1;
+    clk->target = -1;
+}
+
+void animation_clock_start(animation_clock_t *clk, const char *base_path, const char *prefix,
+                           uint16_t frame_count, bool loop) {
+    if (!clk) return;
+    if (clk->running) animation_clock_stop(clk);
+
+    memset(clk->durations_ms, 0, sizeof(clk->durations_ms));
+    animation_loader_get_frame_durations(base_path, prefix, clk->durations_ms, ANIM_CLOCK_MAX_FRAMES);
+    clk->frame_count = frame_count;
+    clk->loop = loop;
+    clk->current = -1;
+    clk->target = -1;
+    clk->next_due_us = esp_timer_get_time();
+    clk->window_start_us = clk->next_due_us;
+    clk->running = true;
+}
+
+void animation_clock_stop(animation_clock_t *clk) {
+    if (!clk || !clk->running) return;
+    clk->stats.active_us += (uint64_t)(esp_timer_get_time() - clk->window_start_us);
+    clk->target = -1;
+    clk->running = false;
+}
+
+void animation_clock_resume(animation_clock_t *clk) {
+    if (!clk || clk->running) return;
+    clk->next_due_us = esp_timer_get_time();
+    clk->window_start_us = clk->next_due_us;
+    clk->target = -1;
+    clk->running = true;
+}
+
+int32_t animation_clock_poll(animation_clock_t *clk, uint32_t *wait_ms) {
+    if (wait_ms) *wait_ms = 0;
+    if (!clk || !clk->running || clk->frame_count == 0) return ANIM_CLOCK_END;
+    if (clk->target >= 0) return clk->target; // Ya elegido, pendiente de lectura.
+
+    int64_t now = esp_timer_get_time();
+    int32_t next = following(clk, clk->current);
+    if (next >= clk->frame_count) {
+        // Acción: termina cuando el último fotograma ha cumplido su duración.
+        if (now < clk->next_due_us) {
+            if (wait_ms) *wait_ms = (uint32_t)((clk->next_due_us - now + 999) / 1000);
+            return ANIM_CLOCK_WAIT;
+        }
+        return ANIM_CLOCK_END;
+    }
+    if (now < clk->next_due_us) {
+        if (wait_ms) *wait_ms = (uint32_t)((clk->next_due_us - now + 999) / 1000);
+        return ANIM_CLOCK_WAIT;
+    }
+
+    // Se saltan los fotogramas cuyo turno completo ya pasó. En un bucle, como mucho una vuelta:
+    // más retraso que eso solo puede venir de un bloqueo largo y se recoloca el reloj en 'now'.
+    int64_t due = clk->next_due_us;
+    for (uint16_t n = 0; n < clk->frame_count; n++) {
+        int64_t next_due = due + frame_us(clk, next);
+        if (now < next_due) break;
+        if (!clk->loop && next + 1 >= clk->frame_count) break; // La pose final se muestra siempre.
+        clk->stats.skipped++;
+        clk->stats.scheduled_us += (uint64_t)frame_us(clk, next);
+        next = following(clk, next);
+        due = next_due;
+        if (n + 1 == clk->frame_count) due = now;
+    }
+
+    clk->target = next;
+    clk->target_due_us = due;
+    return next;
+}
+
+void animation_clock_presented(animation_clock_t *clk) {
+    if (!clk || clk->target < 0) return;
+    int64_t late = esp_timer_get_time() - clk->target_due_us;
+    if (late < 0) late = 0;
+
+    clk->stats.presented++;
+    clk->stats.scheduled_us += (uint64_t)frame_us(clk, clk->target);
+    clk->stats.last_late_us = (uint32_t)late;
+    clk->stats.total_late_us += (uint64_t)late;
+    if (late > clk->stats.max_late_us) clk->stats.max_late_us = (uint32_t)late;
+    if (late > CLOCK_LATE_US) clk->stats.late++;
+
+    clk->current = clk->target;
+    clk->next_due_us = clk->target_due_us + frame_us(clk, clk->target);
+    clk->target = -1;
+}
+
+void animation_clock_dropped(animation_clock_t *clk) {
+    if (!clk || clk->target < 0) return;
+    clk->stats.skipped++;
+    clk->stats.scheduled_us += (uint64_t)frame_us(clk, clk->target);
+    clk->current = clk->target;
+    clk->next_due_us = clk->target_due_us + frame_us(clk, clk->target);
+    clk->target = -1;
+}
+
+uint32_t animation_clock_wait_ms(const animation_clock_t *clk) {
+    if (!clk || !clk->running) return 0;
+    int64_t wait = clk->next_due_us - esp_timer_get_time();
+    return wait > 0 ? (uint32_t)((wait + 999) / 1000) : 0;
+}
+
+void animation_clock_get_stats(const animation_clock_t *clk, animation_clock_stats_t *out) {
+    if (!clk || !out) return;
+    *out = clk->stats;
+    if (clk->running) out->active_us += (uint64_t)(esp_timer_get_time() - clk->window_start_us);
+}
+
+void animation_clock_log_stats(const animation_clock_t *clk) {
+    if (!clk) return;
+    animation_clock_stats_t st;
+    animation_clock_get_stats(clk, &st);
+    uint32_t due = st.presented + st.skipped;
+    // FPS x100 para el log sin coma flotante.
+    uint32_t fps = st.active_us ? (uint32_t)((uint64_t)st.presented * 100000000ULL / st.active_us) : 0;
+    uint32_t target_fps = st.scheduled_us ? (uint32_t)((uint64_t)due * 100000000ULL / st.scheduled_us) : 0;
+    uint32_t avg_late = st.presented ? (uint32_t)(st.total_late_us / st.presented) : 0;
+    ESP_LOGI(TAG, "[%s] FPS=%lu.%02lu (objetivo %lu.%02lu) mostrados=%lu saltados=%lu tardíos=%lu "
+             "retraso(último/medio/máx)=%lu/%lu/%lu us",
+             clk->name, (unsigned long)(fps / 100), (unsigned long)(fps % 100),
+             (unsigned long)(target_fps / 100), (unsigned long)(target_fps % 100),
+             (unsigned long)st.presented, (unsigned long)st.skipped, (unsigned long)st.late,
+             (unsigned long)st.last_late_us, (unsigned long)avg_late, (unsigned long)st.max_late_us);
+}
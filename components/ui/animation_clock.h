@@ -0,0 +1,110 @@
+/* Fichero: components/ui/animation_clock.h */
+/* Descripción: Interfaz del reloj de animación compartido por los players de acción y de reposo. Cada fotograma tiene una hora de salida en tiempo real (esp_timer), calculada sumando las duraciones de los anteriores desde el inicio de la secuencia, en lugar de esperar un periodo fijo del lv_timer después de cada carga. Si el player va retrasado (lectura lenta de la SD), se saltan los fotogramas cuyo turno ya terminó en vez de ralentizar la animación. Las duraciones salen de la tabla del pack ('duration_ms'); sin ellas se usa la cadencia por defecto del player. */
+/* Último cambio: 17/10/2026 - 20:25 */
+#ifndef ANIMATION_CLOCK_H
+#define ANIMATION_CLOCK_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define ANIM_CLOCK_MAX_FRAMES   64      // Duraciones propias por secuencia; las siguientes usan la cadencia por defecto.
+
+#define ANIM_CLOCK_WAIT         (-1)    // Aún no toca el siguiente fotograma.
+#define ANIM_CLOCK_END          (-2)    // Secuencia sin bucle terminada.
+
+typedef struct {
+    uint32_t presented;         // Fotogramas mostrados.
+    uint32_t skipped;           // Fotogramas saltados por ir retrasado (o fallidos).
+    uint32_t late;              // Fotogramas mostrados más de un refresco de pantalla tarde.
+    uint32_t last_late_us;      // Retraso del último fotograma respecto a su hora.
+    uint32_t max_late_us;
+    uint64_t total_late_us;     // Para el retraso medio.
+    uint64_t scheduled_us;      // Suma de las duraciones de los fotogramas vencidos (mostrados + saltados).
+    uint64_t active_us;         // Tiempo de reproducción (sin pausas).
+} animation_clock_stats_t;
+
+typedef struct {
+    const char *name;           // Para el log (ej: "accion", "reposo").
+    uint16_t default_ms;        // Cadencia de los fotogramas sin duración propia.
+    uint16_t frame_count;
+    bool loop;
+    bool running;
+    uint16_t durations_ms[ANIM_CLOCK_MAX_FRAMES];
+    int32_t current;            // Último fotograma mostrado (-1 al empezar).
+    int64_t next_due_us;        // Hora de salida del fotograma siguiente a 'current'.
+    int32_t target;             // Fotograma elegido pendiente de mostrar (-1 si no hay).
+    int64_t target_due_us;
+    int64_t window_start_us;    // Inicio del tramo de reproducción en curso.
+    animation_clock_stats_t stats;
+} animation_clock_t;
+
+/**
+ * @brief Prepara un reloj y pone a cero sus contadores.
+ * @param name Nombre para el log (cadena estática).
+ * @param default_ms Duración de los fotogramas sin 'duration_ms' en el pack.
+ */
+void animation_clock_init(animation_clock_t *clk, const char *name, uint16_t default_ms);
+
+/**
+ * @brief Empieza una secuencia: el fotograma 0 sale ya y los siguientes a su hora.
+ *        Lee las duraciones de la secuencia del pack de 'base_path' (si lo hay).
+ * @param loop true para los bucles de reposo; false para las acciones (terminan tras el último).
+ */
+void animation_clock_start(animation_clock_t *clk, const char *base_path, const char *prefix,
+                           uint16_t frame_count, bool loop);
+
+/**
+ * @brief Detiene el reloj (pausa o fin) y acumula el tiempo de reproducción.
+ */
+void animation_clock_stop(animation_clock_t *clk);
+
+/**
+ * @brief Reanuda tras una pausa: el fotograma siguiente a 'current' sale ya, sin contar
+ *        como retraso el tiempo que estuvo parado.
+ */
+void animation_clock_resume(animation_clock_t *clk);
+
+/**
+ * @brief Decide qué fotograma toca mostrar ahora. Si el anterior ya se pasó de su turno,
+ *        salta los fotogramas vencidos (salvo el último de una secuencia sin bucle).
+ *        Un fotograma elegido se mantiene hasta 'presented' o 'dropped', aunque tarde en leerse.
+ * @param wait_ms Salida: milisegundos hasta el próximo turno (con ANIM_CLOCK_WAIT).
+ * @return Índice del fotograma, ANIM_CLOCK_WAIT o ANIM_CLOCK_END.
+ */
+int32_t animation_clock_poll(animation_clock_t *clk, uint32_t *wait_ms);
+
+/**
+ * @brief El fotograma elegido ya está en pantalla: registra su retraso y programa el siguiente
+ *        a partir de su hora de salida (no de la hora real de presentación).
+ */
+void animation_clock_presented(animation_clock_t *clk);
+
+/**
+ * @brief El fotograma elegido no pudo cargarse: cuenta como saltado y se sigue con el siguiente.
+ */
+void animation_clock_dropped(animation_clock_t *clk);
+
+/**
+ * @brief Milisegundos hasta el turno del fotograma siguiente (0 si ya tocaba).
+ */
+uint32_t animation_clock_wait_ms(const animation_clock_t *clk);
+
+/**
+ * @brief Copia los contadores (incluye el tramo en curso en 'active_us').
+ */
+void animation_clock_get_stats(const animation_clock_t *clk, animation_clock_stats_t *out);
+
+/**
+ * @brief Escribe en el log los FPS conseguidos frente a los programados y el retraso por fotograma.
+ */
+void animation_clock_log_stats(const animation_clock_t *clk);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // ANIMATION_CLOCK_H
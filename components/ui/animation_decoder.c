@@ -0,0 +1,265 @@
+/* Fichero: components/ui/animation_decoder.c */
+/* Descripción: Decodificador de imágenes de LVGL para los fotogramas de animación ('.anim' virtuales). El cargador leía cada fotograma entero (103 KB en RGB565A8) en un búfer compartido, más otro igual para el doble búfer del precargador, aunque LVGL solo dibuja bandas de 20 filas (el búfer de dibujo del BSP). Este decodificador implementa get_area: por cada banda que LVGL va a dibujar lee de la SD solo esas filas (plano de color y plano alfa, una lectura contigua por plano) en una banda de ANIM_DECODER_BAND_ROWS filas y la entrega como un lv_draw_buf_t RGB565A8. Los fotogramas RAW del pack (RGB565A8 o I8) y los '.bin' sueltos se leen así; los comprimidos y los delta no permiten leer filas sueltas y se decodifican completos, con el cargador de siempre, en un búfer de fotograma que solo se reserva si aparece alguno. Sin caché de imágenes de LVGL (LV_CACHE_DEF_SIZE = 0), info/open/close se llaman en cada dibujado, así que son baratos: analizan la ruta y consultan la tabla del pack ya abierto. Con el pack en la copia de la flash las filas se copian desde la imagen mapeada, y la decodificación completa usa el fotograma mapeado si el cargador lo devuelve sin copia. */
+/* Último cambio: 17/10/2026 - 23:55 */
+#include "animation_decoder.h"
+#include "animation_loader.h"
+#include "animation_pack.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "lvgl.h"
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char *TAG = "ANIM_DECODER";
+
+typedef struct {
+    char dir[96];
+    char prefix[16];
+    uint16_t frame_index;
+    animation_frame_info_t info;
+} decoder_session_t;
+
+static lv_image_decoder_t *s_decoder = NULL;
+
+// Banda compartida: LVGL dibuja las imágenes de una en una en su propia tarea.
+static lv_draw_buf_t s_band;
+static uint8_t *s_band_data = NULL;
+static uint32_t s_band_size = 0;
+static uint16_t s_band_width = 0;
+
+// Búfer completo para los fotogramas sin acceso por filas (reserva diferida).
+static animation_t s_full;
+static lv_draw_buf_t s_full_buf;
+static uint16_t s_canvas_w = 0;
+static uint16_t s_canvas_h = 0;
+
+static animation_decoder_stats_t s_stats;
+static char s_stats_src[96];        // Fotograma al que se suman los tiempos en curso.
+static uint32_t s_stats_frame_us = 0;
+
+// --- Rutas virtuales ---
+
+// "<dir>/<prefijo><n>.anim" -> directorio, prefijo e índice (n - 1).
+static bool parse_src(const char *src, decoder_session_t *s) {
+    const char *slash = strrchr(src, '/');
+    const char *dot = strrchr(src, '.');
+    if (!slash || !dot || dot < slash || strcmp(dot + 1, ANIM_DECODER_SRC_EXT) != 0) return false;
+
+    const char *digits = dot;
+    while (digits > slash + 1 && isdigit((unsigned char)digits[-1])) digits--;
+    size_t dir_len = (size_t)(slash - src);
+    size_t prefix_len = (size_t)(digits - (slash + 1));
+    if (digits == dot || prefix_len == 0 || prefix_len >= sizeof(s->prefix) || dir_len >= sizeof(s->dir)) return false;
+
+    int number = atoi(digits);
+    if (number < 1 || number > UINT16_MAX) return false;
+    memcpy(s->dir, src, dir_len);
+    s->dir[dir_len] = '\0';
+    memcpy(s->prefix, slash + 1, prefix_len);
+    s->prefix[prefix_len] = '\0';
+    s->frame_index = (uint16_t)(number - 1);
+    return true;
+}
+
+void animation_decoder_build_src(char *buf, size_t size, const char *base_path, const char *prefix, uint16_t frame_index) {
+    if (!buf || size == 0) return;
+    snprintf(buf, size, "%s/%s%d.%s", base_path ? base_path : "", prefix ? prefix : "", frame_index + 1, ANIM_DECODER_SRC_EXT);
+}
+
+// --- Contadores ---
+
+static void stats_begin_frame(const char *src) {
+    if (strncmp(s_stats_src, src, sizeof(s_stats_src)) == 0) return;
+    if (s_stats_src[0] != '\0') {
+        s_stats.frames++;
+        s_stats.last_frame_us = s_stats_frame_us;
+        if (s_stats_frame_us > s_stats.max_frame_us) s_stats.max_frame_us = s_stats_frame_us;
+    }
+    strncpy(s_stats_src, src, sizeof(s_stats_src) - 1);
+    s_stats_src[sizeof(s_stats_src) - 1] = '\0';
+    s_stats_frame_us = 0;
+}
+
+// --- Decodificación completa (fotogramas comprimidos o delta) ---
+
+static bool decode_full_frame(decoder_session_t *s, lv_image_decoder_dsc_t *dsc) {
+    if (!s_full.img_dsc.data) {
+        size_t size = (size_t)s_canvas_w * s_canvas_h * 3;
+        s_full.img_dsc.data = malloc(size + ANIM_PACK_DECODE_MARGIN);
+        if (!s_full.img_dsc.data) {
+            ESP_LOGE(TAG, "Sin memoria para decodificar completo un fotograma sin acceso por filas (%u bytes).", (unsigned int)size);
+            return false;
+        }
+        s_full.img_dsc.data_size = size;
+        s_full.width = s_canvas_w;
+        s_full.height = s_canvas_h;
+        s_stats.full_buffer_bytes = size + ANIM_PACK_DECODE_MARGIN;
+        ESP_LOGW(TAG, "'%s/%s' tiene fotogramas comprimidos o delta: se reserva un búfer completo de %u bytes. "
+                 "Genera el pack con '--encoding raw' y sin '--delta' para este modo.", s->dir, s->prefix, (unsigned int)size);
+    }
+
+    // El cargador recuerda qué fotograma tiene el búfer: las bandas siguientes del mismo no leen nada.
+    s_full.base_path = s->dir;
+    int64_t t0 = esp_timer_get_time();
+    bool ok = animation_loader_load_frame(&s_full, s->frame_index, s->prefix);
+    s_full.base_path = NULL;
+    if (!ok) return false;
+    s_stats_frame_us += (uint32_t)(esp_timer_get_time() - t0);
+
+    // Con el pack en flash el cargador puede devolver el fotograma sin copiarlo al búfer.
+    const lv_img_dsc_t *img = s_full.flash_dsc.data ? &s_full.flash_dsc : &s_full.img_dsc;
+    const lv_image_header_t *hdr = &img->header;
+    if (lv_draw_buf_init(&s_full_buf, hdr->w, hdr->h, LV_COLOR_FORMAT_RGB565A8, hdr->stride,
+                         (void *)img->data, img->data_size) != LV_RESULT_OK) {
+        return false;
+    }
+    dsc->decoded = &s_full_buf;
+    s_stats.full_decodes++;
+    return true;
+}
+
+// --- Callbacks de LVGL ---
+
+static lv_result_t decoder_info(lv_image_decoder_t *decoder, const void *src, lv_image_header_t *header) {
+    LV_UNUSED(decoder);
+    if (lv_image_src_get_type(src) != LV_IMAGE_SRC_FILE) return LV_RESULT_INVALID;
+    if (strcmp(lv_fs_get_ext(src), ANIM_DECODER_SRC_EXT) != 0) return LV_RESULT_INVALID;
+
+    decoder_session_t s;
+    if (!parse_src(src, &s) || !animation_loader_get_frame_info(s.dir, s.prefix, s.frame_index, &s.info)) {
+        return LV_RESULT_INVALID;
+    }
+    *header = s.info.header;
+    return LV_RESULT_OK;
+}
+
+static lv_result_t decoder_open(lv_image_decoder_t *decoder, lv_image_decoder_dsc_t *dsc) {
+    LV_UNUSED(decoder);
+    decoder_session_t *s = lv_malloc(sizeof(decoder_session_t));
+    if (!s) return LV_RESULT_INVALID;
+    if (!parse_src(dsc->src, s) || !animation_loader_get_frame_info(s->dir, s->prefix, s->frame_index, &s->info)) {
+        lv_free(s);
+        return LV_RESULT_INVALID;
+    }
+    dsc->user_data = s;
+    dsc->header = s->info.header;
+    stats_begin_frame(dsc->src);
+
+    // Con acceso por filas 'decoded' se queda en NULL y LVGL pide las bandas con get_area.
+    if (!s->info.row_access && !decode_full_frame(s, dsc)) {
+        lv_free(s);
+        dsc->user_data = NULL;
+        return LV_RESULT_INVALID;
+    }
+    return LV_RESULT_OK;
+}
+
+static lv_result_t decoder_get_area(lv_image_decoder_t *decoder, lv_image_decoder_dsc_t *dsc,
+                                    const lv_area_t *full_area, lv_area_t *decoded_area) {
+    LV_UNUSED(decoder);
+    decoder_session_t *s = dsc->user_data;
+    if (!s || !s->info.row_access) return LV_RESULT_INVALID;
+
+    // Bandas de arriba abajo; siempre filas completas del fotograma (LVGL recorta en x).
+    int32_t y1 = decoded_area->y1 == LV_COORD_MIN ? full_area->y1 : decoded_area->y2 + 1;
+    if (y1 < 0 || y1 > full_area->y2) return LV_RESULT_INVALID;
+    int32_t rows = LV_MIN(full_area->y2 - y1 + 1, ANIM_DECODER_BAND_ROWS);
+    uint16_t w = s->info.header.w;
+    if (w > s_band_width) {
+        ESP_LOGE(TAG, "Fotograma de %d px de ancho mayor que la banda (%d px).", w, s_band_width);
+        return LV_RESULT_INVALID;
+    }
+
+    int64_t t0 = esp_timer_get_time();
+    if (!animation_loader_read_rows(s->dir, s->prefix, s->frame_index, (uint16_t)y1, (uint16_t)rows, s_band_data, s_band_size)) {
+        return LV_RESULT_INVALID;
+    }
+    uint32_t band_us = (uint32_t)(esp_timer_get_time() - t0);
+    if (lv_draw_buf_init(&s_band, w, rows, LV_COLOR_FORMAT_RGB565A8, (uint32_t)w * 2, s_band_data, s_band_size) != LV_RESULT_OK) {
+        return LV_RESULT_INVALID;
+    }
+
+    dsc->decoded = &s_band;
+    decoded_area->x1 = 0;
+    decoded_area->x2 = w - 1;
+    decoded_area->y1 = y1;
+    decoded_area->y2 = y1 + rows - 1;
+
+    s_stats.bands++;
+    s_stats.bytes_read += (uint32_t)w * rows * 3;
+    s_stats_frame_us += band_us;
+    if (band_us > s_stats.max_band_us) s_stats.max_band_us = band_us;
+    return LV_RESULT_OK;
+}
+
+static void decoder_close(lv_image_decoder_t *decoder, lv_image_decoder_dsc_t *dsc) {
+    LV_UNUSED(decoder);
+    // La banda y el búfer completo son del módulo; solo se libera la sesión.
+    lv_free(dsc->user_data);
+    dsc->user_data = NULL;
+}
+
+// --- Funciones públicas ---
+
+bool animation_decoder_init(uint16_t canvas_w, uint16_t canvas_h) {
+    if (s_decoder) return true;
+
+    s_band_size = (uint32_t)canvas_w * ANIM_DECODER_BAND_ROWS * 3;
+    s_band_data = malloc(s_band_size);
+    s_decoder = s_band_data ? lv_image_decoder_create() : NULL;
+    if (!s_decoder) {
+        ESP_LOGE(TAG, "No se pudo reservar la banda de %lu bytes ni registrar el decodificador.", (unsigned long)s_band_size);
+        free(s_band_data);
+        s_band_data = NULL;
+        return false;
+    }
+    lv_image_decoder_set_info_cb(s_decoder, decoder_info);
+    lv_image_decoder_set_open_cb(s_decoder, decoder_open);
+    lv_image_decoder_set_get_area_cb(s_decoder, decoder_get_area);
+    lv_image_decoder_set_close_cb(s_decoder, decoder_close);
+
+    s_band_width = canvas_w;
+    s_canvas_w = canvas_w;
+    s_canvas_h = canvas_h;
+    memset(&s_stats, 0, sizeof(s_stats));
+    s_stats.band_buffer_bytes = s_band_size;
+    s_stats_src[0] = '\0';
+
+    uint32_t frame_bytes = (uint32_t)canvas_w * canvas_h * 3 + ANIM_PACK_DECODE_MARGIN;
+    ESP_LOGI(TAG, "Decodificador por bandas registrado: banda de %lu bytes (%d filas) en lugar de %lu bytes "
+             "por búfer de fotograma (x2 con el doble búfer del precargador).",
+             (unsigned long)s_band_size, ANIM_DECODER_BAND_ROWS, (unsigned long)frame_bytes);
+    return true;
+}
+
+void animation_decoder_deinit(void) {
+    if (s_decoder) {
+        lv_image_decoder_delete(s_decoder);
+        s_decoder = NULL;
+    }
+    free(s_band_data);
+    s_band_data = NULL;
+    s_band_size = 0;
+    s_band_width = 0;
+    if (s_full.img_dsc.data) {
+        animation_loader_forget_buffer(s_full.img_dsc.data);
+        free((void *)s_full.img_dsc.data);
+    }
+    memset(&s_full, 0, sizeof(s_full));
+}
+
+void animation_decoder_get_stats(animation_decoder_stats_t *out) {
+    if (out) *out = s_stats;
+}
+
+void animation_decoder_log_stats(void) {
+    animation_decoder_stats_t st;
+    animation_decoder_get_stats(&st);
+    ESP_LOGI(TAG, "[bandas] fotogramas=%lu bandas=%lu leídos=%lu bytes completos=%lu fotograma(último/máx)=%lu/%lu us "
+             "banda máx=%lu us RAM banda=%lu bytes búfer completo=%lu bytes",
+             (unsigned long)st.frames, (unsigned long)st.bands, (unsigned long)st.bytes_read, (unsigned long)st.full_decodes,
+             (unsigned long)st.last_frame_us, (unsigned long)st.max_frame_us, (unsigned long)st.max_band_us,
+             (unsigned long)st.band_buffer_bytes, (unsigned long)st.full_buffer_bytes);
+}
@@ -0,0 +1,63 @@
+/* Fichero: components/ui/animation_decoder.h */
+/* Descripción: Interfaz del decodificador de imágenes de LVGL para los fotogramas de animación de la SD. Con CONFIG_DIYMON_ANIM_STREAM_DECODER los players no tienen búfer de fotograma: el objeto imagen recibe una ruta virtual '<dir>/<prefijo><n>.anim' y el decodificador entrega a LVGL, mediante get_area, solo las filas de la zona que se está dibujando (bandas del alto del búfer de dibujo). */
+/* Último cambio: 17/10/2026 - 19:40 */
+#ifndef ANIMATION_DECODER_H
+#define ANIMATION_DECODER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define ANIM_DECODER_SRC_EXT    "anim"  // Extensión de las rutas virtuales (no existen en la SD).
+#define ANIM_DECODER_BAND_ROWS  20      // Filas por banda: el alto del búfer de dibujo del BSP.
+
+typedef struct {
+    uint32_t frames;            // Fotogramas distintos dibujados.
+    uint32_t bands;             // Bandas leídas por filas.
+    uint32_t bytes_read;        // Bytes de píxeles leídos de la SD por bandas.
+    uint32_t full_decodes;      // Fotogramas comprimidos o delta decodificados completos (sin acceso por filas).
+    uint32_t last_frame_us;     // Tiempo de decodificación acumulado del último fotograma completo en pantalla.
+    uint32_t max_frame_us;
+    uint32_t max_band_us;       // Peor banda.
+    uint32_t band_buffer_bytes; // RAM de la banda (frente a w * h * 3 del búfer de fotograma).
+    uint32_t full_buffer_bytes; // RAM reservada para los fotogramas sin acceso por filas (0 si no hubo).
+} animation_decoder_stats_t;
+
+/**
+ * @brief Registra el decodificador en LVGL. Debe llamarse desde la tarea de LVGL.
+ * @param canvas_w Lienzo de la animación: ancho máximo de los fotogramas, para reservar la banda.
+ * @param canvas_h Alto del lienzo (búfer completo, solo si aparece un fotograma sin acceso por filas).
+ * @return true si se registró y se reservó la banda.
+ */
+bool animation_decoder_init(uint16_t canvas_w, uint16_t canvas_h);
+
+/**
+ * @brief Elimina el decodificador y libera sus búferes.
+ */
+void animation_decoder_deinit(void);
+
+/**
+ * @brief Construye la ruta virtual del fotograma 'frame_index' (0..N-1) de una secuencia.
+ * @param base_path Directorio de evolución (ej: "S:/diymon/0").
+ */
+void animation_decoder_build_src(char *buf, size_t size, const char *base_path, const char *prefix, uint16_t frame_index);
+
+/**
+ * @brief Copia los contadores del decodificador.
+ */
+void animation_decoder_get_stats(animation_decoder_stats_t *out);
+
+/**
+ * @brief Escribe en el log los contadores, la RAM usada y los tiempos por fotograma.
+ */
+void animation_decoder_log_stats(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // ANIMATION_DECODER_H
@@ -0,0 +1,457 @@
+/* Fichero: components/ui/animation_flash.c */
+/* Descripción: Copia del pack de animaciones de la evolución actual en la partición de datos 'assets' (ver partitions.csv). La partición se mapea entera una sola vez al arrancar; su primer sector lleva una cabecera con la ruta del directorio copiado, el tamaño y CRC32 de la imagen y una firma de las tablas del pack de origen, y la imagen empieza en el sector siguiente. La imagen es un 'ANIM.pak' aplanado: mismas tablas, sin almacén compartido (los payloads que el pack tomaba de 'STORE.pak' se copian una sola vez) y con los offsets rehechos para que cada payload quede alineado como en la SD. Así el cargador la abre con 'animation_pack_open_mapped' y los fotogramas RAW se muestran apuntando el descriptor de LVGL a la flash, sin copia a RAM. La copia la hace una tarea de baja prioridad: espera unos segundos tras la petición, compara la firma con el pack de la SD y, si hace falta, retira la copia antigua (el cargador vuelve a la SD y se espera a que la pantalla deje de mostrar fotogramas de la flash), borra y escribe sector a sector con pausas para que LVGL siga dibujando, comprueba el CRC leyendo la flash y escribe la cabecera la última, de modo que un corte a medias deja la partición sin copia, nunca con una copia corrupta. Los cambios que hace el servidor web en el directorio copiado (o en el almacén) marcan la copia como obsoleta y programan otra. */
+/* Último cambio: 17/10/2026 - 23:55 */
+#include "animation_flash.h"
+#include "animation_loader.h"
+#include "animation_pack.h"
+#include "ui_action_animations.h"
+#include "web_server.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_partition.h"
+#include "esp_rom_crc.h"
+#include "esp_lvgl_port.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "sdkconfig.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char *TAG = "ANIM_FLASH";
+
+#define FLASH_MAGIC             0x414C4644u // "DFLA"
+#define FLASH_VERSION           1
+#define FLASH_SECTOR            4096
+#define FLASH_IMAGE_OFFSET      FLASH_SECTOR    // Sector 0: cabecera. Imagen del pack a continuación.
+#define FLASH_CHUNK             4096            // Búfer de copia SD -> flash.
+
+#define SYNC_TASK_STACK_SIZE    4096
+#define SYNC_TASK_PRIORITY      2               // Por debajo del precargador (3) y de LVGL (4).
+#define SYNC_DELAY_MS           3000            // Espera tras la última petición o cambio en la SD.
+#define SYNC_ERASE_PAUSE_MS     20              // Pausa tras cada sector borrado (la caché de flash se detiene).
+#define RELEASE_POLL_MS         100
+#define RELEASE_CLEAN_POLLS     5               // La pantalla debe estar libre de la flash durante 500 ms.
+#define RELEASE_TIMEOUT_MS      5000
+
+typedef struct __attribute__((packed)) {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t reserved;
+    uint32_t image_size;        // Bytes de la imagen del pack desde FLASH_IMAGE_OFFSET.
+    uint32_t image_crc;         // CRC32 de la imagen.
+    uint32_t source_sig;        // CRC32 de las tablas del pack de la SD del que se copió.
+    char dir_path[64];          // Directorio de evolución copiado (ej: "S:/diymon/0").
+    uint32_t header_crc;        // CRC32 de los campos anteriores.
+} flash_header_t;
+
+typedef enum {
+    FLASH_EMPTY,                // Sin copia válida.
+    FLASH_VALID,                // La copia se puede leer.
+    FLASH_STALE,                // Legible, pero la SD cambió: el cargador no la usa.
+    FLASH_SYNCING,              // Se está reescribiendo: nadie debe leer la imagen.
+} flash_state_t;
+
+static const esp_partition_t *s_part;
+static const uint8_t *s_map;
+static esp_partition_mmap_handle_t s_map_handle;
+static flash_header_t s_hdr;
+static volatile flash_state_t s_state = FLASH_EMPTY;
+static SemaphoreHandle_t s_lock;
+static TaskHandle_t s_task;
+static char s_want_dir[64];
+static bool s_force;
+static animation_flash_stats_t s_stats;
+
+// --- Partición ---
+
+static uint32_t header_crc(const flash_header_t *h) {
+    return esp_rom_crc32_le(0, (const uint8_t *)h, offsetof(flash_header_t, header_crc));
+}
+
+static bool map_partition(void) {
+    const void *ptr = NULL;
+    if (esp_partition_mmap(s_part, 0, s_part->size, ESP_PARTITION_MMAP_DATA, &ptr, &s_map_handle) != ESP_OK) {
+        ESP_LOGE(TAG, "No se pudo mapear la partición '%s'.", ANIM_FLASH_PARTITION_LABEL);
+        s_map = NULL;
+        return false;
+    }
+    s_map = ptr;
+    return true;
+}
+
+static void unmap_partition(void) {
+    if (!s_map) return;
+    esp_partition_munmap(s_map_handle);
+    s_map = NULL;
+}
+
+// Comprueba la cabecera mapeada, el CRC de la imagen y sus tablas. Deja la cabecera en 's_hdr'.
+static bool check_image(void) {
+    flash_header_t h;
+    memcpy(&h, s_map, sizeof(h));
+    if (h.magic != FLASH_MAGIC || h.version != FLASH_VERSION || h.header_crc != header_crc(&h) ||
+        h.image_size == 0 || h.image_size > s_part->size - FLASH_IMAGE_OFFSET) {
+        return false;
+    }
+    h.dir_path[sizeof(h.dir_path) - 1] = '\0';
+    if (esp_rom_crc32_le(0, s_map + FLASH_IMAGE_OFFSET, h.image_size) != h.image_crc) {
+        ESP_LOGW(TAG, "La copia de '%s' en flash está corrupta (CRC).", h.dir_path);
+        return false;
+    }
+    animation_pack_t *pack = animation_pack_open_mapped(h.dir_path, s_map + FLASH_IMAGE_OFFSET, h.image_size);
+    if (!pack) return false;
+    animation_pack_close(pack);
+    s_hdr = h;
+    return true;
+}
+
+static void set_state(flash_state_t state) {
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    s_state = state;
+    s_stats.image_bytes = state == FLASH_EMPTY ? 0 : s_hdr.image_size;
+    xSemaphoreGive(s_lock);
+}
+
+// --- Copia desde la SD ---
+
+// Firma del pack de origen: sus tablas (incluidos offsets, tamaños y el id del almacén).
+static uint32_t pack_signature(const animation_pack_t *pack) {
+    const animation_pack_header_t *hdr = &pack->header;
+    uint32_t crc = esp_rom_crc32_le(0, (const uint8_t *)hdr, sizeof(*hdr));
+    crc = esp_rom_crc32_le(crc, (const uint8_t *)pack->seqs, (size_t)hdr->seq_count * sizeof(animation_pack_seq_t));
+    crc = esp_rom_crc32_le(crc, (const uint8_t *)pack->frames, (size_t)hdr->frame_count * sizeof(animation_pack_frame_t));
+    return esp_rom_crc32_le(crc, (const uint8_t *)pack->palettes,
+                            (size_t)hdr->palette_count * ANIM_PACK_PALETTE_SIZE * sizeof(uint16_t));
+}
+
+// Tabla de fotogramas de la imagen: payloads repetidos (mismo offset en el origen) se guardan una vez.
+// Devuelve el tamaño de la imagen.
+static uint32_t plan_image(const animation_pack_t *pack, animation_pack_frame_t *frames) {
+    const animation_pack_header_t *hdr = &pack->header;
+    uint32_t align = hdr->payload_align >= 4 ? hdr->payload_align : 4;
+    uint32_t tables = sizeof(*hdr) + (uint32_t)hdr->seq_count * sizeof(animation_pack_seq_t) +
+                      (uint32_t)hdr->frame_count * sizeof(animation_pack_frame_t) +
+                      (uint32_t)hdr->palette_count * ANIM_PACK_PALETTE_SIZE * sizeof(uint16_t);
+    uint32_t cursor = (tables + align - 1) / align * align;
+    uint32_t end = tables;
+
+    for (uint16_t i = 0; i < hdr->frame_count; i++) {
+        frames[i] = pack->frames[i];
+        uint16_t j = 0;
+        while (j < i && pack->frames[j].offset != pack->frames[i].offset) j++;
+        if (j < i) {
+            frames[i].offset = frames[j].offset;
+            continue;
+        }
+        frames[i].offset = cursor;
+        end = cursor + frames[i].size;
+        cursor = (end + align - 1) / align * align;
+    }
+    return end;
+}
+
+typedef struct {
+    uint32_t erased_end;        // Offset de la partición hasta el que ya está borrada.
+} flash_writer_t;
+
+// Borra sector a sector hasta 'end', con una pausa tras cada uno.
+static esp_err_t writer_erase_to(flash_writer_t *w, uint32_t end) {
+    while (w->erased_end < end) {
+        esp_err_t err = esp_partition_erase_range(s_part, w->erased_end, FLASH_SECTOR);
+        if (err != ESP_OK) return err;
+        w->erased_end += FLASH_SECTOR;
+        vTaskDelay(pdMS_TO_TICKS(SYNC_ERASE_PAUSE_MS));
+    }
+    return ESP_OK;
+}
+
+static esp_err_t writer_write(flash_writer_t *w, uint32_t offset, const void *data, uint32_t len) {
+    if (len == 0) return ESP_OK;
+    esp_err_t err = writer_erase_to(w, offset + len);
+    return err == ESP_OK ? esp_partition_write(s_part, offset, data, len) : err;
+}
+
+static bool write_image(animation_pack_t *src, const animation_pack_frame_t *frames, uint32_t image_size, uint8_t *chunk) {
+    flash_writer_t w = { .erased_end = FLASH_IMAGE_OFFSET };
+    animation_pack_header_t hdr = src->header;
+    hdr.flags &= ~ANIM_PACK_HDR_FLAG_STORE;
+    hdr.store_id = 0;
+
+    uint32_t off = FLASH_IMAGE_OFFSET;
+    uint32_t seq_bytes = (uint32_t)hdr.seq_count * sizeof(animation_pack_seq_t);
+    uint32_t frame_bytes = (uint32_t)hdr.frame_count * sizeof(animation_pack_frame_t);
+    uint32_t palette_bytes = (uint32_t)hdr.palette_count * ANIM_PACK_PALETTE_SIZE * sizeof(uint16_t);
+    if (writer_write(&w, off, &hdr, sizeof(hdr)) != ESP_OK ||
+        writer_write(&w, off + sizeof(hdr), src->seqs, seq_bytes) != ESP_OK ||
+        writer_write(&w, off + sizeof(hdr) + seq_bytes, frames, frame_bytes) != ESP_OK ||
+        writer_write(&w, off + sizeof(hdr) + seq_bytes + frame_bytes, src->palettes, palette_bytes) != ESP_OK) {
+        return false;
+    }
+
+    for (uint16_t i = 0; i < hdr.frame_count; i++) {
+        uint16_t j = 0;
+        while (j < i && src->frames[j].offset != src->frames[i].offset) j++;
+        if (j < i) continue; // Payload ya copiado.
+
+        if (lv_fs_seek(&src->file, src->frames[i].offset, LV_FS_SEEK_SET) != LV_FS_RES_OK) return false;
+        for (uint32_t done = 0; done < frames[i].size;) {
+            uint32_t n = frames[i].size - done < FLASH_CHUNK ? frames[i].size - done : FLASH_CHUNK;
+            uint32_t bytes_read = 0;
+            if (lv_fs_read(&src->file, chunk, n, &bytes_read) != LV_FS_RES_OK || bytes_read != n ||
+                writer_write(&w, FLASH_IMAGE_OFFSET + frames[i].offset + done, chunk, n) != ESP_OK) {
+                ESP_LOGW(TAG, "Fallo al copiar el fotograma %u a la flash.", i);
+                return false;
+            }
+            done += n;
+        }
+    }
+    // El relleno entre payloads queda borrado (0xFF) y forma parte del CRC.
+    return writer_erase_to(&w, FLASH_IMAGE_OFFSET + image_size) == ESP_OK;
+}
+
+// CRC de la imagen leyendo la flash (no la caché del mapeo antiguo).
+static bool image_crc_from_flash(uint32_t image_size, uint8_t *chunk, uint32_t *out_crc) {
+    uint32_t crc = 0;
+    for (uint32_t done = 0; done < image_size;) {
+        uint32_t n = image_size - done < FLASH_CHUNK ? image_size - done : FLASH_CHUNK;
+        if (esp_partition_read(s_part, FLASH_IMAGE_OFFSET + done, chunk, n) != ESP_OK) return false;
+        crc = esp_rom_crc32_le(crc, chunk, n);
+        done += n;
+    }
+    *out_crc = crc;
+    return true;
+}
+
+static bool flash_frame_on_screen(void) {
+    bool shown = false;
+    if (lvgl_port_lock(RELEASE_POLL_MS)) {
+        const lv_image_dsc_t *src = g_animation_img_obj ? lv_image_get_src(g_animation_img_obj) : NULL;
+        shown = src && lv_image_src_get_type(src) == LV_IMAGE_SRC_VARIABLE && s_map &&
+                (const uint8_t *)src->data >= s_map && (const uint8_t *)src->data < s_map + s_part->size;
+        lvgl_port_unlock();
+    } else {
+        shown = true; // Sin el cerrojo no se puede saber: se vuelve a mirar.
+    }
+    return shown;
+}
+
+// Retira la copia antigua: el cargador deja de usarla y la pantalla deja de mostrarla.
+static bool release_image(void) {
+    flash_state_t prev = s_state;
+    set_state(FLASH_SYNCING);
+    animation_loader_close_pack(); // Espera a que termine cualquier lectura de la imagen.
+
+    int clean = 0;
+    for (int waited = 0; waited < RELEASE_TIMEOUT_MS && clean < RELEASE_CLEAN_POLLS; waited += RELEASE_POLL_MS) {
+        clean = flash_frame_on_screen() ? 0 : clean + 1;
+        vTaskDelay(pdMS_TO_TICKS(RELEASE_POLL_MS));
+    }
+    if (clean < RELEASE_CLEAN_POLLS) {
+        ESP_LOGW(TAG, "La pantalla sigue mostrando un fotograma de la flash. Se reintentará la copia.");
+        set_state(prev);
+        return false;
+    }
+    return true;
+}
+
+static void sync_dir(const char *dir_path, bool force) {
+    animation_pack_t *src = animation_pack_open(dir_path);
+    if (!src) {
+        // Sin SD o sin pack (fotogramas '.bin' sueltos): se conserva la copia que haya.
+        ESP_LOGI(TAG, "'%s' no tiene pack en la SD; la copia en flash no cambia.", dir_path);
+        return;
+    }
+
+    uint32_t sig = pack_signature(src);
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    bool current = s_state == FLASH_VALID && strcmp(s_hdr.dir_path, dir_path) == 0 && s_hdr.source_sig == sig;
+    xSemaphoreGive(s_lock);
+    if (current && !force) {
+        s_stats.skipped++;
+        animation_pack_close(src);
+        return;
+    }
+
+    size_t frame_bytes = (size_t)src->header.frame_count * sizeof(animation_pack_frame_t);
+    animation_pack_frame_t *frames = malloc(frame_bytes ? frame_bytes : 1);
+    uint8_t *chunk = malloc(FLASH_CHUNK);
+    uint32_t image_size = frames ? plan_image(src, frames) : 0;
+    bool ok = false;
+    int64_t t0 = esp_timer_get_time();
+
+    if (!frames || !chunk) {
+        ESP_LOGE(TAG, "Sin memoria para copiar el pack de '%s'.", dir_path);
+    } else if (image_size > s_part->size - FLASH_IMAGE_OFFSET) {
+        ESP_LOGW(TAG, "El pack de '%s' ocupa %lu KB aplanado y la partición admite %lu KB: no se copia.",
+                 dir_path, (unsigned long)(image_size / 1024), (unsigned long)((s_part->size - FLASH_IMAGE_OFFSET) / 1024));
+    } else if (!release_image()) {
+        xTaskNotifyGive(s_task); // Se reintenta tras la espera habitual.
+        free(frames);
+        free(chunk);
+        animation_pack_close(src);
+        return;
+    } else {
+        ESP_LOGI(TAG, "Copiando el pack de '%s' a la flash (%lu KB)...", dir_path, (unsigned long)(image_size / 1024));
+        unmap_partition();
+        flash_header_t h = { .magic = FLASH_MAGIC, .version = FLASH_VERSION, .image_size = image_size, .source_sig = sig };
+        strncpy(h.dir_path, dir_path, sizeof(h.dir_path) - 1);
+
+        // La cabecera se borra primero y se escribe la última.
+        uint32_t crc = 0;
+        ok = esp_partition_erase_range(s_part, 0, FLASH_SECTOR) == ESP_OK &&
+             write_image(src, frames, image_size, chunk) &&
+             image_crc_from_flash(image_size, chunk, &crc);
+        if (ok) {
+            h.image_crc = crc;
+            h.header_crc = header_crc(&h);
+            ok = esp_partition_write(s_part, 0, &h, sizeof(h)) == ESP_OK;
+        }
+        ok = map_partition() && ok && check_image();
+        set_state(ok ? FLASH_VALID : FLASH_EMPTY);
+        animation_loader_close_pack(); // El cargador vuelve a abrir el pack, ahora desde la flash.
+    }
+
+    if (ok) {
+        s_stats.syncs++;
+        s_stats.last_sync_ms = (uint32_t)((esp_timer_get_time() - t0) / 1000);
+        ESP_LOGI(TAG, "Pack de '%s' copiado a la flash en %lu ms.", dir_path, (unsigned long)s_stats.last_sync_ms);
+    } else {
+        s_stats.failures++;
+    }
+    free(frames);
+    free(chunk);
+    animation_pack_close(src);
+}
+
+static void sync_task_main(void *arg) {
+    while (true) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        // Cada petición o cambio nuevo reinicia la espera.
+        while (ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(SYNC_DELAY_MS)) > 0) {
+        }
+
+        char dir[sizeof(s_want_dir)];
+        xSemaphoreTake(s_lock, portMAX_DELAY);
+        memcpy(dir, s_want_dir, sizeof(dir));
+        bool force = s_force;
+        s_force = false;
+        xSemaphoreGive(s_lock);
+        if (dir[0]) sync_dir(dir, force);
+    }
+}
+
+// Se ejecuta en la tarea del servidor web con la ruta VFS del fichero modificado.
+static void on_web_fs_change(const char *vfs_path) {
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    // "S:/diymon/0" -> "/diymon/0": basta con buscarlo dentro de la ruta VFS ("/sdcard/diymon/0/...").
+    const char *dir = strchr(s_hdr.dir_path, ':');
+    dir = dir ? dir + 1 : s_hdr.dir_path;
+    size_t len = strlen(dir);
+    const char *hit = len ? strstr(vfs_path, dir) : NULL;
+    bool affected = (hit && (hit[len] == '\0' || hit[len] == '/')) || strstr(vfs_path, "/" ANIM_STORE_FILENAME);
+    bool notify = false;
+    if (affected && s_state == FLASH_VALID) {
+        s_state = FLASH_STALE;
+        s_force = true;
+        if (!s_want_dir[0]) memcpy(s_want_dir, s_hdr.dir_path, sizeof(s_want_dir));
+        notify = true;
+    }
+    xSemaphoreGive(s_lock);
+    if (notify) {
+        ESP_LOGI(TAG, "Cambio en '%s': la copia en flash se rehará.", vfs_path);
+        xTaskNotifyGive(s_task);
+    }
+}
+
+// --- Funciones públicas ---
+
+void animation_flash_init(void) {
+#if CONFIG_DIYMON_ANIM_FLASH_ASSETS
+    if (s_part) return;
+    s_part = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ANIM_FLASH_PARTITION_SUBTYPE, ANIM_FLASH_PARTITION_LABEL);
+    if (!s_part) {
+        ESP_LOGW(TAG, "No hay partición '%s': las animaciones solo se leerán de la SD.", ANIM_FLASH_PARTITION_LABEL);
+        return;
+    }
+    s_lock = xSemaphoreCreateMutex();
+    if (!s_lock || !map_partition() ||
+        xTaskCreate(sync_task_main, "anim_flash", SYNC_TASK_STACK_SIZE, NULL, SYNC_TASK_PRIORITY, &s_task) != pdPASS) {
+        ESP_LOGE(TAG, "No se pudo preparar la partición '%s'.", ANIM_FLASH_PARTITION_LABEL);
+        unmap_partition();
+        s_part = NULL;
+        return;
+    }
+    s_stats.partition_bytes = s_part->size;
+
+    int64_t t0 = esp_timer_get_time();
+    if (check_image()) {
+        set_state(FLASH_VALID);
+        ESP_LOGI(TAG, "Copia en flash de '%s' válida (%lu KB, comprobada en %lu ms).", s_hdr.dir_path,
+                 (unsigned long)(s_hdr.image_size / 1024), (unsigned long)((esp_timer_get_time() - t0) / 1000));
+    } else {
+        ESP_LOGI(TAG, "La partición '%s' (%lu KB) no tiene copia válida.", ANIM_FLASH_PARTITION_LABEL,
+                 (unsigned long)(s_part->size / 1024));
+    }
+    web_server_add_fs_change_cb(on_web_fs_change);
+#endif
+}
+
+bool animation_flash_has_image(const char *dir_path) {
+    if (!s_part || !dir_path) return false;
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    bool ok = s_state == FLASH_VALID && strcmp(s_hdr.dir_path, dir_path) == 0;
+    xSemaphoreGive(s_lock);
+    return ok;
+}
+
+bool animation_flash_lookup(const char *dir_path, const uint8_t **data, uint32_t *size) {
+    if (!s_part || !dir_path || !data || !size) return false;
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    bool ok = s_state == FLASH_VALID && s_map && strcmp(s_hdr.dir_path, dir_path) == 0;
+    if (ok) {
+        *data = s_map + FLASH_IMAGE_OFFSET;
+        *size = s_hdr.image_size;
+    }
+    xSemaphoreGive(s_lock);
+    return ok;
+}
+
+bool animation_flash_owns(const void *ptr) {
+    const uint8_t *p = ptr;
+    return s_part && s_map && (s_state == FLASH_VALID || s_state == FLASH_STALE) &&
+           p >= s_map && p < s_map + s_part->size;
+}
+
+void animation_flash_request_sync(const char *dir_path) {
+    if (!s_part || !dir_path) return;
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    bool current = s_state == FLASH_VALID && strcmp(s_hdr.dir_path, dir_path) == 0;
+    bool pending = strcmp(s_want_dir, dir_path) == 0;
+    strncpy(s_want_dir, dir_path, sizeof(s_want_dir) - 1);
+    s_want_dir[sizeof(s_want_dir) - 1] = '\0';
+    xSemaphoreGive(s_lock);
+    // La copia de este directorio ya está (o ya se pidió): la firma se comprueba una vez por petición nueva.
+    if (current && pending) return;
+    xTaskNotifyGive(s_task);
+}
+
+void animation_flash_get_stats(animation_flash_stats_t *out) {
+    if (!out) return;
+    memset(out, 0, sizeof(*out));
+    if (!s_part) return;
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    *out = s_stats;
+    xSemaphoreGive(s_lock);
+}
+
+void animation_flash_log_stats(void) {
+    if (!s_part) return;
+    animation_flash_stats_t st;
+    animation_flash_get_stats(&st);
+    ESP_LOGI(TAG, "[flash] copia='%s' %lu/%lu KB copias=%lu al_día=%lu fallidas=%lu última=%lu ms",
+             st.image_bytes ? s_hdr.dir_path : "-", (unsigned long)(st.image_bytes / 1024),
+             (unsigned long)(st.partition_bytes / 1024), (unsigned long)st.syncs, (unsigned long)st.skipped,
+             (unsigned long)st.failures, (unsigned long)st.last_sync_ms);
+}
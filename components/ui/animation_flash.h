@@ -0,0 +1,61 @@
+/* Fichero: components/ui/animation_flash.h */
+/* Descripción: Interfaz de la copia en flash de las animaciones. La partición de datos 'assets' guarda el 'ANIM.pak' de la evolución actual, aplanado en un pack autocontenido (sin almacén compartido), y se mapea en memoria: el cargador abre ese pack con 'animation_pack_open_mapped' y apunta los descriptores de los fotogramas RAW directamente a la flash. Una tarea de baja prioridad mantiene la copia al día: la rehace cuando cambia la evolución o cuando el servidor web modifica el pack en la SD. Si la SD falla, la copia que haya sigue sirviendo las animaciones de su evolución. */
+/* Último cambio: 17/10/2026 - 23:55 */
+#ifndef ANIMATION_FLASH_H
+#define ANIMATION_FLASH_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define ANIM_FLASH_PARTITION_LABEL  "assets"
+#define ANIM_FLASH_PARTITION_SUBTYPE 0x40   // Subtipo de datos propio (partitions.csv).
+
+typedef struct {
+    uint32_t syncs;             // Copias completadas.
+    uint32_t skipped;           // Peticiones con la copia ya al día.
+    uint32_t failures;          // Copias abortadas o que no cabían.
+    uint32_t last_sync_ms;      // Duración de la última copia.
+    uint32_t image_bytes;       // Tamaño de la copia vigente (0 si no hay).
+    uint32_t partition_bytes;
+} animation_flash_stats_t;
+
+/**
+ * @brief Busca y mapea la partición 'assets' y valida la copia que contenga (CRC).
+ *        Debe llamarse antes de cargar fotogramas; sin partición el resto de funciones no hacen nada.
+ */
+void animation_flash_init(void);
+
+/**
+ * @brief Indica si hay una copia válida del pack de 'dir_path' (ej: "S:/diymon/0").
+ */
+bool animation_flash_has_image(const char *dir_path);
+
+/**
+ * @brief Devuelve la imagen mapeada del pack de 'dir_path' si la copia es válida y está al día.
+ *        La usa el cargador con su cerrojo tomado; el puntero vale hasta que cierre el pack.
+ */
+bool animation_flash_lookup(const char *dir_path, const uint8_t **data, uint32_t *size);
+
+/**
+ * @brief Indica si 'ptr' apunta dentro de la copia mapeada y esta sigue siendo legible.
+ */
+bool animation_flash_owns(const void *ptr);
+
+/**
+ * @brief Pide que la copia pase a ser la del pack de 'dir_path'. No bloquea: la tarea de copia
+ *        espera unos segundos (precarga de la evolución nueva, subidas en curso) antes de empezar.
+ */
+void animation_flash_request_sync(const char *dir_path);
+
+void animation_flash_get_stats(animation_flash_stats_t *out);
+void animation_flash_log_stats(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // ANIMATION_FLASH_H
@@ -0,0 +1,633 @@
+/* Fichero: components/ui/animation_integrity.c */
+/* Descripción: Comprobación en segundo plano de las animaciones de la SD. La única verificación del arranque era abrir '/sdcard/diymon', y un fotograma truncado o con una cabecera ajena solo se descubría al reproducirlo (o ni eso: el cargador mostraba lo que hubiera leído). Unos segundos después del arranque, una tarea de prioridad 1 recorre los directorios de evolución, la evolución actual primero. Si el directorio tiene un 'ANIM.pak' válido se lee el payload almacenado de cada fotograma de sus secuencias (las tablas ya las valida 'animation_pack_open'); si no, se valida cada '<prefijo><n>.bin': cabecera LVGL RGB565A8 del tamaño del lienzo y stride coherente, con la misma regla que el cargador ('animation_pack_bin_payload_size'), y un fichero de al menos 12 + w*h*3 bytes (los '.bin' exportados pueden llevar bytes de relleno al final, que se ignoran); los píxeles se leen enteros y solo ellos entran en la CRC. De cada fotograma se anota si es defectuoso y el CRC32 de lo leído; los huecos de la numeración cuentan como fotogramas defectuosos. El resultado se guarda en 'ANIM.chk' junto con una firma barata del directorio (las tablas del pack, o nombre, tamaño y fecha de cada '.bin'): en los arranques siguientes, si la firma coincide, el índice se carga sin releer los payloads, salvo con CONFIG_DIYMON_ANIM_INTEGRITY_REVERIFY, que los relee y marca los que ya no dan el mismo CRC (la tarjeta se ha corrompido). Las lecturas se hacen en bloques de 4 KB con una pausa cada 64 KB para no acaparar el bus SPI. En RAM solo quedan los recuentos y, si hace falta, un mapa de bits de fotogramas defectuosos por directorio. La firma de un pack incluye además si se usan sus secuencias premezcladas, porque los CRC anotados son los de las secuencias en uso. Los cambios que hace el servidor web invalidan el directorio afectado (o todos, si cambia el almacén compartido) y lo vuelven a recorrer tras unos segundos de calma. */
+/* Último cambio: 18/10/2026 - 05:15 */
+#include "animation_integrity.h"
+#include "animation_pack.h"
+#include "ui_action_animations.h"
+#include "helpers.h"
+#include "web_server.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_rom_crc.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "sdkconfig.h"
+#include "lvgl.h"
+#include <dirent.h>
+#include <stddef.h>
+#include <sys/stat.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+static const char *TAG = "ANIM_INTEGRITY";
+
+#define ROOT_VFS_PATH           "/sdcard/diymon"
+#define ROOT_LVGL_PATH          "S:/diymon"
+#define CHK_MAGIC               0x4B484344u // "DCHK"
+#define CHK_VERSION             1
+#define MAX_DIRS                16
+#define DIR_PATH_MAX            32
+#define BITMAP_BYTES            (ANIM_INTEGRITY_MAX_FRAMES / 8)
+#define LVGL_BIN_HEADER_SIZE    12
+#define SCAN_CHUNK              4096
+
+#define SCAN_TASK_STACK_SIZE    4096
+#define SCAN_TASK_PRIORITY      1               // Por debajo de la copia en flash (2), del precargador (3) y de LVGL (4).
+#define SCAN_START_DELAY_MS     8000            // Deja terminar la precarga y la copia en flash del arranque.
+#define SCAN_DELAY_MS           3000            // Espera tras el último cambio hecho por el servidor web.
+#define SCAN_PAUSE_EVERY        (64 * 1024)     // Bytes leídos entre pausas...
+#define SCAN_PAUSE_MS           10              // ...para que el precargador y la pantalla usen el bus.
+
+// Prefijos de acción comprobados (los mismos que indexa el manifiesto).
+static const char *const k_prefixes[] = { "ANIM_IDLE_", "ANIM_EAT_", "ANIM_GYM_", "ANIM_ATK_" };
+#define PREFIX_COUNT (sizeof(k_prefixes) / sizeof(k_prefixes[0]))
+#define MAX_ENTRIES  (PREFIX_COUNT * ANIM_INTEGRITY_MAX_FRAMES)
+
+typedef struct __attribute__((packed)) {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t entry_count;
+    uint32_t source_sig;        // Firma de lo validado: tablas del pack o nombre, tamaño y fecha de cada '.bin'.
+    uint16_t counts[PREFIX_COUNT];
+    uint32_t crc;               // CRC32 de los campos anteriores y de las entradas.
+} chk_header_t;
+
+typedef struct __attribute__((packed)) {
+    uint8_t prefix;             // Índice en k_prefixes.
+    uint8_t bad;
+    uint16_t frame;
+    uint32_t crc;               // CRC32 del payload leído (0 si no se pudo leer).
+} chk_entry_t;
+
+typedef struct {
+    char dir_path[DIR_PATH_MAX]; // "S:/diymon/111"; vacío = entrada libre.
+    uint16_t counts[PREFIX_COUNT];
+    uint16_t bad_count;
+    uint8_t *bad;               // PREFIX_COUNT * BITMAP_BYTES; solo si hay algún fotograma marcado.
+    uint32_t epoch;             // Cambia con cada aviso del servidor web.
+    bool valid;                 // Recorrido y sin cambios desde entonces.
+    bool dirty;                 // Pendiente de recorrer.
+} integrity_dir_t;
+
+// Resultado de recorrer un directorio, antes de publicarlo.
+typedef struct {
+    uint32_t sig;
+    uint16_t counts[PREFIX_COUNT];
+    chk_entry_t *entries;       // MAX_ENTRIES, en orden de prefijo y fotograma.
+    uint16_t entry_count;
+} scan_result_t;
+
+typedef struct {
+    uint8_t *chunk;
+    uint32_t bytes;
+    uint32_t since_pause;
+    uint32_t frames;
+    uint32_t mismatches;
+} scan_ctx_t;
+
+static SemaphoreHandle_t s_lock;
+static TaskHandle_t s_task;
+static integrity_dir_t s_dirs[MAX_DIRS];
+static animation_integrity_stats_t s_stats;
+
+// --- Tabla de directorios (con el cerrojo tomado) ---
+
+static int prefix_slot(const char *prefix) {
+    for (int i = 0; i < PREFIX_COUNT; i++) {
+        if (strcmp(k_prefixes[i], prefix) == 0) return i;
+    }
+    return -1;
+}
+
+static integrity_dir_t* find_dir_locked(const char *dir_path) {
+    for (int i = 0; i < MAX_DIRS; i++) {
+        if (s_dirs[i].dir_path[0] && strcmp(s_dirs[i].dir_path, dir_path) == 0) return &s_dirs[i];
+    }
+    return NULL;
+}
+
+static integrity_dir_t* add_dir_locked(const char *dir_path) {
+    integrity_dir_t *d = find_dir_locked(dir_path);
+    if (d || strlen(dir_path) >= DIR_PATH_MAX) return d;
+    for (int i = 0; i < MAX_DIRS; i++) {
+        if (!s_dirs[i].dir_path[0]) {
+            strcpy(s_dirs[i].dir_path, dir_path);
+            return &s_dirs[i];
+        }
+    }
+    return NULL;
+}
+
+static bool is_bad_locked(const integrity_dir_t *d, int slot, uint16_t frame) {
+    return d && d->bad && frame < ANIM_INTEGRITY_MAX_FRAMES &&
+           (d->bad[slot * BITMAP_BYTES + frame / 8] & (1u << (frame % 8)));
+}
+
+// Devuelve true si el fotograma no estaba marcado.
+static bool mark_bad_locked(integrity_dir_t *d, int slot, uint16_t frame) {
+    if (frame >= ANIM_INTEGRITY_MAX_FRAMES || is_bad_locked(d, slot, frame)) return false;
+    if (!d->bad) {
+        d->bad = calloc(PREFIX_COUNT, BITMAP_BYTES);
+        if (!d->bad) return false;
+    }
+    d->bad[slot * BITMAP_BYTES + frame / 8] |= 1u << (frame % 8);
+    d->bad_count++;
+    return true;
+}
+
+static void clear_bad_locked(integrity_dir_t *d) {
+    free(d->bad);
+    d->bad = NULL;
+    d->bad_count = 0;
+}
+
+static void invalidate_locked(integrity_dir_t *d) {
+    d->valid = false;
+    d->dirty = true;
+    d->epoch++;
+    clear_bad_locked(d); // El fichero defectuoso puede haberse sustituido.
+}
+
+// --- Lectura de payloads ---
+
+static bool crc_range(lv_fs_file_t *f, uint32_t offset, uint32_t size, scan_ctx_t *ctx, uint32_t *out_crc) {
+    if (lv_fs_seek(f, offset, LV_FS_SEEK_SET) != LV_FS_RES_OK) return false;
+    uint32_t crc = 0;
+    for (uint32_t done = 0; done < size;) {
+        uint32_t n = size - done < SCAN_CHUNK ? size - done : SCAN_CHUNK;
+        uint32_t bytes_read = 0;
+        if (lv_fs_read(f, ctx->chunk, n, &bytes_read) != LV_FS_RES_OK || bytes_read != n) return false;
+        crc = esp_rom_crc32_le(crc, ctx->chunk, n);
+        done += n;
+        ctx->bytes += n;
+        ctx->since_pause += n;
+        if (ctx->since_pause >= SCAN_PAUSE_EVERY) {
+            ctx->since_pause = 0;
+            vTaskDelay(pdMS_TO_TICKS(SCAN_PAUSE_MS));
+        }
+    }
+    *out_crc = crc;
+    return true;
+}
+
+static void add_entry(scan_result_t *res, int slot, uint16_t frame, bool bad, uint32_t crc) {
+    if (res->entry_count >= MAX_ENTRIES) return;
+    res->entries[res->entry_count++] = (chk_entry_t){ .prefix = slot, .bad = bad, .frame = frame, .crc = crc };
+}
+
+// --- Packs ---
+
+// Firma del pack: sus tablas (incluidos offsets, tamaños y el id del almacén) y qué secuencias se usan
+// (las premezcladas o las RGB565A8): los CRC guardados son los de los payloads de esas secuencias.
+static uint32_t pack_signature(const animation_pack_t *pack) {
+    const animation_pack_header_t *hdr = &pack->header;
+    uint8_t preblended = animation_pack_uses_preblended(pack);
+    uint32_t crc = esp_rom_crc32_le(0, (const uint8_t *)hdr, sizeof(*hdr));
+    crc = esp_rom_crc32_le(crc, (const uint8_t *)pack->seqs, (size_t)hdr->seq_count * sizeof(animation_pack_seq_t));
+    crc = esp_rom_crc32_le(crc, &preblended, sizeof(preblended));
+    return esp_rom_crc32_le(crc, (const uint8_t *)pack->frames, (size_t)hdr->frame_count * sizeof(animation_pack_frame_t));
+}
+
+static void pack_counts(const animation_pack_t *pack, scan_result_t *res) {
+    for (int slot = 0; slot < PREFIX_COUNT; slot++) {
+        const animation_pack_seq_t *seq = animation_pack_find_seq(pack, k_prefixes[slot]);
+        res->counts[slot] = seq ? seq->frame_count : 0;
+    }
+}
+
+static void check_pack_frames(animation_pack_t *pack, scan_ctx_t *ctx, scan_result_t *res) {
+    for (int slot = 0; slot < PREFIX_COUNT; slot++) {
+        const animation_pack_seq_t *seq = animation_pack_find_seq(pack, k_prefixes[slot]);
+        uint16_t n = res->counts[slot] < ANIM_INTEGRITY_MAX_FRAMES ? res->counts[slot] : ANIM_INTEGRITY_MAX_FRAMES;
+        for (uint16_t f = 0; f < n; f++) {
+            const animation_pack_frame_t *frame = animation_pack_get_frame(pack, seq, f);
+            uint32_t crc = 0;
+            bool ok = frame && crc_range(&pack->file, frame->offset, frame->size, ctx, &crc);
+            if (!ok) ESP_LOGW(TAG, "Fotograma %u de '%s' ilegible en el pack de '%s'.", f + 1, k_prefixes[slot], pack->dir_path);
+            add_entry(res, slot, f, !ok, crc);
+            ctx->frames++;
+        }
+    }
+}
+
+// --- Fotogramas '.bin' sueltos ---
+
+// Recuento (el número más alto de cada prefijo), fotogramas presentes y firma del directorio.
+static bool list_loose_frames(const char *dir_path, scan_result_t *res, uint8_t *present) {
+    char vfs_dir[DIR_PATH_MAX + 8];
+    snprintf(vfs_dir, sizeof(vfs_dir), "/sdcard%s", dir_path + 2); // "S:/diymon/0" -> "/sdcard/diymon/0"
+    DIR *dir = opendir(vfs_dir);
+    if (!dir) return false;
+
+    char path[DIR_PATH_MAX + 8 + sizeof(((struct dirent *)0)->d_name)];
+    struct stat st;
+    struct dirent *de;
+    uint32_t sig = 0;
+    while ((de = readdir(dir)) != NULL) {
+        int slot = -1;
+        for (int i = 0; i < PREFIX_COUNT && slot < 0; i++) {
+            if (strncmp(de->d_name, k_prefixes[i], strlen(k_prefixes[i])) == 0) slot = i;
+        }
+        if (slot < 0) continue;
+        char *end = NULL;
+        unsigned long n = strtoul(de->d_name + strlen(k_prefixes[slot]), &end, 10);
+        if (n == 0 || n > UINT16_MAX || strcasecmp(end, ".bin") != 0) continue;
+
+        snprintf(path, sizeof(path), "%s/%s", vfs_dir, de->d_name);
+        if (stat(path, &st) != 0) continue;
+        uint32_t meta[2] = { (uint32_t)st.st_size, (uint32_t)st.st_mtime };
+        sig = esp_rom_crc32_le(sig, (const uint8_t *)de->d_name, strlen(de->d_name));
+        sig = esp_rom_crc32_le(sig, (const uint8_t *)meta, sizeof(meta));
+        if (n > res->counts[slot]) res->counts[slot] = (uint16_t)n;
+        if (n <= ANIM_INTEGRITY_MAX_FRAMES) present[slot * BITMAP_BYTES + (n - 1) / 8] |= 1u << ((n - 1) % 8);
+    }
+    closedir(dir);
+    res->sig = sig;
+    return true;
+}
+
+// Misma regla que el cargador (animation_pack_bin_payload_size): cabecera RGB565A8 del lienzo y fichero sin
+// truncar. Los bytes sobrantes al final se ignoran y la CRC cubre solo los píxeles.
+static bool check_bin_frame(const char *path, scan_ctx_t *ctx, uint32_t *crc) {
+    lv_fs_file_t f;
+    if (lv_fs_open(&f, path, LV_FS_MODE_RD) != LV_FS_RES_OK) return false;
+
+    lv_image_header_t hdr;
+    uint32_t bytes_read = 0, file_size = 0;
+    bool ok = lv_fs_read(&f, &hdr, LVGL_BIN_HEADER_SIZE, &bytes_read) == LV_FS_RES_OK && bytes_read == LVGL_BIN_HEADER_SIZE;
+    uint32_t payload = ok ? animation_pack_bin_payload_size(&hdr, ANIM_CANVAS_W, ANIM_CANVAS_H) : 0;
+    ok = payload != 0 && lv_fs_seek(&f, 0, LV_FS_SEEK_END) == LV_FS_RES_OK && lv_fs_tell(&f, &file_size) == LV_FS_RES_OK &&
+         file_size >= LVGL_BIN_HEADER_SIZE + payload;
+    ok = ok && crc_range(&f, LVGL_BIN_HEADER_SIZE, payload, ctx, crc);
+    lv_fs_close(&f);
+    return ok;
+}
+
+static void check_loose_frames(const char *dir_path, const uint8_t *present, scan_ctx_t *ctx, scan_result_t *res) {
+    char path[DIR_PATH_MAX + 32];
+    for (int slot = 0; slot < PREFIX_COUNT; slot++) {
+        uint16_t n = res->counts[slot] < ANIM_INTEGRITY_MAX_FRAMES ? res->counts[slot] : ANIM_INTEGRITY_MAX_FRAMES;
+        for (uint16_t f = 0; f < n; f++) {
+            snprintf(path, sizeof(path), "%s/%s%u.bin", dir_path, k_prefixes[slot], f + 1);
+            uint32_t crc = 0;
+            bool exists = present[slot * BITMAP_BYTES + f / 8] & (1u << (f % 8));
+            bool ok = exists && check_bin_frame(path, ctx, &crc);
+            if (!ok) ESP_LOGW(TAG, "Fotograma defectuoso: '%s'%s.", path, exists ? "" : " (no existe)");
+            add_entry(res, slot, f, !ok, crc);
+            ctx->frames++;
+        }
+    }
+}
+
+// --- Índice persistido ---
+
+static uint32_t index_crc(const chk_header_t *hdr, const chk_entry_t *entries) {
+    uint32_t crc = esp_rom_crc32_le(0, (const uint8_t *)hdr, offsetof(chk_header_t, crc));
+    return esp_rom_crc32_le(crc, (const uint8_t *)entries, (size_t)hdr->entry_count * sizeof(chk_entry_t));
+}
+
+static bool load_index(const char *dir_path, scan_result_t *out) {
+    char path[DIR_PATH_MAX + 16];
+    snprintf(path, sizeof(path), "%s/%s", dir_path, ANIM_INTEGRITY_FILENAME);
+    lv_fs_file_t f;
+    if (lv_fs_open(&f, path, LV_FS_MODE_RD) != LV_FS_RES_OK) return false;
+
+    chk_header_t hdr;
+    uint32_t bytes_read = 0;
+    bool ok = lv_fs_read(&f, &hdr, sizeof(hdr), &bytes_read) == LV_FS_RES_OK && bytes_read == sizeof(hdr) &&
+              hdr.magic == CHK_MAGIC && hdr.version == CHK_VERSION && hdr.entry_count <= MAX_ENTRIES;
+    uint32_t entry_bytes = ok ? (uint32_t)hdr.entry_count * sizeof(chk_entry_t) : 0;
+    ok = ok && lv_fs_read(&f, out->entries, entry_bytes, &bytes_read) == LV_FS_RES_OK && bytes_read == entry_bytes &&
+         index_crc(&hdr, out->entries) == hdr.crc;
+    lv_fs_close(&f);
+    if (!ok) {
+        ESP_LOGW(TAG, "Índice '%s' inválido. Se rehará.", path);
+        return false;
+    }
+    out->sig = hdr.source_sig;
+    memcpy(out->counts, hdr.counts, sizeof(out->counts));
+    out->entry_count = hdr.entry_count;
+    return true;
+}
+
+static void save_index(const char *dir_path, const scan_result_t *res) {
+    char path[DIR_PATH_MAX + 16];
+    snprintf(path, sizeof(path), "%s/%s", dir_path, ANIM_INTEGRITY_FILENAME);
+    chk_header_t hdr = { .magic = CHK_MAGIC, .version = CHK_VERSION, .entry_count = res->entry_count,
+                         .source_sig = res->sig };
+    memcpy(hdr.counts, res->counts, sizeof(hdr.counts));
+    hdr.crc = index_crc(&hdr, res->entries);
+
+    lv_fs_file_t f;
+    if (lv_fs_open(&f, path, LV_FS_MODE_WR) != LV_FS_RES_OK) {
+        ESP_LOGW(TAG, "No se pudo escribir el índice '%s'.", path);
+        return;
+    }
+    uint32_t entry_bytes = (uint32_t)res->entry_count * sizeof(chk_entry_t), w1 = 0, w2 = 0;
+    bool ok = lv_fs_write(&f, &hdr, sizeof(hdr), &w1) == LV_FS_RES_OK && w1 == sizeof(hdr) &&
+              lv_fs_write(&f, res->entries, entry_bytes, &w2) == LV_FS_RES_OK && w2 == entry_bytes;
+    lv_fs_close(&f);
+    if (!ok) ESP_LOGW(TAG, "Índice '%s' incompleto; se rehará en el próximo arranque.", path);
+}
+
+// Marca como defectuosos los fotogramas cuyo CRC ya no es el del índice anterior.
+static void compare_crcs(const char *dir_path, const scan_result_t *prev, scan_result_t *res, scan_ctx_t *ctx) {
+    for (uint16_t i = 0; i < res->entry_count && i < prev->entry_count; i++) {
+        chk_entry_t *e = &res->entries[i];
+        const chk_entry_t *p = &prev->entries[i];
+        if (e->prefix != p->prefix || e->frame != p->frame || e->bad || p->bad || e->crc == p->crc) continue;
+        ESP_LOGW(TAG, "El fotograma %u de '%s' en '%s' ha cambiado sin modificarse el directorio (CRC %08lx, antes %08lx).",
+                 e->frame + 1, k_prefixes[e->prefix], dir_path, (unsigned long)e->crc, (unsigned long)p->crc);
+        e->bad = true;
+        ctx->mismatches++;
+    }
+}
+
+// --- Recorrido ---
+
+// Publica el resultado si el directorio no ha cambiado mientras se recorría.
+static void publish(const char *dir_path, uint32_t epoch, const scan_result_t *res, const scan_ctx_t *ctx, bool from_index) {
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    integrity_dir_t *d = find_dir_locked(dir_path);
+    if (d && d->epoch == epoch) {
+        memcpy(d->counts, res->counts, sizeof(d->counts));
+        clear_bad_locked(d);
+        for (uint16_t i = 0; i < res->entry_count; i++) {
+            if (res->entries[i].bad) mark_bad_locked(d, res->entries[i].prefix, res->entries[i].frame);
+        }
+        d->valid = true;
+    }
+    if (from_index) s_stats.dirs_from_index++;
+    else s_stats.dirs_scanned++;
+    s_stats.frames_checked += ctx->frames;
+    s_stats.bytes_read += ctx->bytes;
+    s_stats.crc_mismatches += ctx->mismatches;
+    xSemaphoreGive(s_lock);
+}
+
+static void scan_dir(const char *dir_path, uint32_t epoch, uint8_t *chunk) {
+    scan_result_t prev = { .entries = malloc(MAX_ENTRIES * sizeof(chk_entry_t)) };
+    scan_result_t res = { .entries = malloc(MAX_ENTRIES * sizeof(chk_entry_t)) };
+    uint8_t *present = calloc(PREFIX_COUNT, BITMAP_BYTES);
+    scan_ctx_t ctx = { .chunk = chunk };
+    if (!prev.entries || !res.entries || !present) {
+        ESP_LOGE(TAG, "Sin memoria para comprobar '%s'.", dir_path);
+        goto out;
+    }
+
+    // Las tablas del pack y el listado del directorio dan la firma sin leer ningún payload.
+    animation_pack_t *pack = animation_pack_open(dir_path);
+    if (pack) {
+        res.sig = pack_signature(pack);
+        pack_counts(pack, &res);
+    } else if (!list_loose_frames(dir_path, &res, present)) {
+        ESP_LOGW(TAG, "No se pudo abrir '%s'.", dir_path);
+        goto out;
+    }
+
+    bool indexed = load_index(dir_path, &prev) && prev.sig == res.sig &&
+                   memcmp(prev.counts, res.counts, sizeof(res.counts)) == 0;
+#if !CONFIG_DIYMON_ANIM_INTEGRITY_REVERIFY
+    if (indexed) {
+        if (pack) animation_pack_close(pack);
+        publish(dir_path, epoch, &prev, &ctx, true);
+        goto out;
+    }
+#endif
+    if (pack) {
+        check_pack_frames(pack, &ctx, &res);
+        animation_pack_close(pack);
+    } else {
+        check_loose_frames(dir_path, present, &ctx, &res);
+    }
+    if (indexed) compare_crcs(dir_path, &prev, &res, &ctx);
+    if (!indexed || ctx.mismatches) save_index(dir_path, &res);
+    publish(dir_path, epoch, &res, &ctx, false);
+
+out:
+    free(prev.entries);
+    free(res.entries);
+    free(present);
+}
+
+// Da de alta los directorios de evolución de la SD y los marca para recorrerlos.
+static uint32_t discover_dirs(void) {
+    DIR *dir = opendir(ROOT_VFS_PATH);
+    if (!dir) {
+        ESP_LOGW(TAG, "No se pudo abrir '%s'. No se comprobarán las animaciones.", ROOT_VFS_PATH);
+        return 0;
+    }
+    char dir_path[DIR_PATH_MAX + 256];
+    uint32_t found = 0;
+    struct dirent *de;
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    while ((de = readdir(dir)) != NULL) {
+        if (de->d_type != DT_DIR || de->d_name[0] == '.') continue;
+        snprintf(dir_path, sizeof(dir_path), "%s/%s", ROOT_LVGL_PATH, de->d_name);
+        integrity_dir_t *d = add_dir_locked(dir_path);
+        if (!d) {
+            ESP_LOGW(TAG, "'%s' no cabe en la tabla (%d directorios); no se comprobará.", dir_path, MAX_DIRS);
+            continue;
+        }
+        invalidate_locked(d);
+        found++;
+    }
+    xSemaphoreGive(s_lock);
+    closedir(dir);
+    return found;
+}
+
+// Toma el siguiente directorio pendiente, el de la evolución actual antes que ninguno.
+static bool take_pending(char *dir_path, uint32_t *epoch) {
+    char current[64];
+    ui_helpers_build_asset_path(current, sizeof(current), "");
+    size_t len = strlen(current);
+    if (len > 0 && current[len - 1] == '/') current[len - 1] = '\0';
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    integrity_dir_t *pick = find_dir_locked(current);
+    if (!pick || !pick->dirty) {
+        pick = NULL;
+        for (int i = 0; i < MAX_DIRS && !pick; i++) {
+            if (s_dirs[i].dir_path[0] && s_dirs[i].dirty) pick = &s_dirs[i];
+        }
+    }
+    if (pick) {
+        pick->dirty = false;
+        strcpy(dir_path, pick->dir_path);
+        *epoch = pick->epoch;
+    }
+    xSemaphoreGive(s_lock);
+    return pick != NULL;
+}
+
+static void scan_pending(void) {
+    uint8_t *chunk = malloc(SCAN_CHUNK);
+    if (!chunk) {
+        ESP_LOGE(TAG, "Sin memoria para el búfer de lectura.");
+        return;
+    }
+    animation_integrity_stats_t before;
+    animation_integrity_get_stats(&before);
+    int64_t t0 = esp_timer_get_time();
+    char dir_path[DIR_PATH_MAX];
+    uint32_t epoch, dirs = 0;
+    while (take_pending(dir_path, &epoch)) {
+        scan_dir(dir_path, epoch, chunk);
+        dirs++;
+    }
+    free(chunk);
+
+    animation_integrity_stats_t after;
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    s_stats.last_scan_ms = (uint32_t)((esp_timer_get_time() - t0) / 1000);
+    xSemaphoreGive(s_lock);
+    animation_integrity_get_stats(&after);
+    ESP_LOGI(TAG, "%lu directorios comprobados en %lu ms (%lu desde su índice): %lu fotogramas leídos (%lu KB), %lu defectuosos.",
+             (unsigned long)dirs, (unsigned long)after.last_scan_ms,
+             (unsigned long)(after.dirs_from_index - before.dirs_from_index),
+             (unsigned long)(after.frames_checked - before.frames_checked),
+             (unsigned long)((after.bytes_read - before.bytes_read) / 1024), (unsigned long)after.bad_frames);
+}
+
+static void scan_task_main(void *arg) {
+    vTaskDelay(pdMS_TO_TICKS(SCAN_START_DELAY_MS));
+    if (discover_dirs() > 0) scan_pending();
+
+    while (true) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        // Cada cambio nuevo reinicia la espera.
+        while (ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(SCAN_DELAY_MS)) > 0) {
+        }
+        scan_pending();
+    }
+}
+
+// Se ejecuta en la tarea del servidor web con la ruta VFS del fichero modificado.
+static void on_web_fs_change(const char *vfs_path) {
+    const char *root = strstr(vfs_path, "/diymon/");
+    if (!root) return;
+    const char *name = root + strlen("/diymon/");
+    const char *slash = strchr(name, '/');
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    if (slash) {
+        char dir_path[DIR_PATH_MAX];
+        int n = snprintf(dir_path, sizeof(dir_path), "%s/%.*s", ROOT_LVGL_PATH, (int)(slash - name), name);
+        integrity_dir_t *d = n > 0 && n < (int)sizeof(dir_path) ? add_dir_locked(dir_path) : NULL;
+        if (d) invalidate_locked(d);
+    } else if (strchr(name, '.')) {
+        // Fichero en la raíz (el almacén 'STORE.pak'): puede afectar a todos los packs.
+        for (int i = 0; i < MAX_DIRS; i++) {
+            if (s_dirs[i].dir_path[0]) invalidate_locked(&s_dirs[i]);
+        }
+    } else {
+        // Directorio de evolución nuevo.
+        char dir_path[DIR_PATH_MAX];
+        int n = snprintf(dir_path, sizeof(dir_path), "%s/%s", ROOT_LVGL_PATH, name);
+        integrity_dir_t *d = n > 0 && n < (int)sizeof(dir_path) ? add_dir_locked(dir_path) : NULL;
+        if (d) invalidate_locked(d);
+    }
+    xSemaphoreGive(s_lock);
+    xTaskNotifyGive(s_task);
+}
+
+// --- Funciones públicas ---
+
+void animation_integrity_start(void) {
+#if CONFIG_DIYMON_ANIM_INTEGRITY_SCAN
+    if (s_lock) return;
+    s_lock = xSemaphoreCreateMutex();
+    if (!s_lock || xTaskCreate(scan_task_main, "anim_check", SCAN_TASK_STACK_SIZE, NULL, SCAN_TASK_PRIORITY, &s_task) != pdPASS) {
+        ESP_LOGE(TAG, "No se pudo crear la tarea de comprobación de animaciones.");
+        if (s_lock) vSemaphoreDelete(s_lock);
+        s_lock = NULL;
+        return;
+    }
+    web_server_add_fs_change_cb(on_web_fs_change);
+    ESP_LOGI(TAG, "Comprobación de animaciones programada en %d s.", SCAN_START_DELAY_MS / 1000);
+#endif
+}
+
+bool animation_integrity_is_bad(const char *dir_path, const char *prefix, uint16_t frame_index) {
+    if (!s_lock || !dir_path || !prefix) return false;
+    int slot = prefix_slot(prefix);
+    if (slot < 0) return false;
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    bool bad = is_bad_locked(find_dir_locked(dir_path), slot, frame_index);
+    xSemaphoreGive(s_lock);
+    return bad;
+}
+
+uint16_t animation_integrity_next_good(const char *dir_path, const char *prefix, uint16_t from, uint16_t count, bool wrap) {
+    if (!s_lock || !dir_path || !prefix || count == 0) return from;
+    int slot = prefix_slot(prefix);
+    if (slot < 0) return from;
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    const integrity_dir_t *d = find_dir_locked(dir_path);
+    uint16_t next = from;
+    if (d && d->bad) {
+        uint16_t steps = wrap ? count : (from < count ? count - from : 0);
+        uint16_t f = from;
+        for (uint16_t i = 0; i < steps; i++) {
+            if (wrap && f >= count) f = 0;
+            if (!is_bad_locked(d, slot, f)) {
+                next = f;
+                break;
+            }
+            f++;
+        }
+    }
+    xSemaphoreGive(s_lock);
+    return next;
+}
+
+void animation_integrity_report_bad(const char *dir_path, const char *prefix, uint16_t frame_index) {
+    if (!s_lock || !dir_path || !prefix) return;
+    int slot = prefix_slot(prefix);
+    if (slot < 0) return;
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    integrity_dir_t *d = add_dir_locked(dir_path);
+    bool marked = d && mark_bad_locked(d, slot, frame_index);
+    if (marked) s_stats.reported++;
+    xSemaphoreGive(s_lock);
+    if (marked) {
+        ESP_LOGW(TAG, "Fotograma %u de '%s' en '%s' marcado como defectuoso; se saltará.", frame_index + 1, prefix, dir_path);
+    }
+}
+
+bool animation_integrity_get_frame_count(const char *dir_path, const char *prefix, uint16_t *count) {
+    if (!s_lock || !dir_path || !prefix || !count) return false;
+    int slot = prefix_slot(prefix);
+    if (slot < 0) return false;
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    const integrity_dir_t *d = find_dir_locked(dir_path);
+    bool ok = d && d->valid;
+    if (ok) *count = d->counts[slot];
+    xSemaphoreGive(s_lock);
+    return ok;
+}
+
+void animation_integrity_get_stats(animation_integrity_stats_t *out) {
+    if (!out) return;
+    memset(out, 0, sizeof(*out));
+    if (!s_lock) return;
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    *out = s_stats;
+    out->bad_frames = 0;
+    for (int i = 0; i < MAX_DIRS; i++) out->bad_frames += s_dirs[i].bad_count;
+    xSemaphoreGive(s_lock);
+}
+
+void animation_integrity_log_stats(void) {
+    if (!s_lock) return;
+    animation_integrity_stats_t st;
+    animation_integrity_get_stats(&st);
+    ESP_LOGI(TAG, "[integridad] recorridos=%lu desde_índice=%lu fotogramas=%lu (%lu KB) defectuosos=%lu crc_cambiado=%lu marcados_al_leer=%lu último=%lu ms",
+             (unsigned long)st.dirs_scanned, (unsigned long)st.dirs_from_index, (unsigned long)st.frames_checked,
+             (unsigned long)(st.bytes_read / 1024), (unsigned long)st.bad_frames, (unsigned long)st.crc_mismatches,
+             (unsigned long)st.reported, (unsigned long)st.last_scan_ms);
+}
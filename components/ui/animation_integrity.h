@@ -0,0 +1,67 @@
+/* Fichero: components/ui/animation_integrity.h */
+/* Descripción: Interfaz de la comprobación en segundo plano de las animaciones de la SD. Tras el arranque, una tarea de baja prioridad recorre todos los directorios de evolución, valida cada fotograma (cabecera, dimensiones, formato y tamaño de los '.bin' sueltos; lectura completa del payload en los packs) y guarda por directorio un índice 'ANIM.chk' con el número de fotogramas de cada acción, los defectuosos y el CRC32 de cada uno. Los players consultan los fotogramas marcados para saltarlos sin tocar la SD, y el manifiesto de animaciones usa el índice como fuente rápida de recuentos. */
+/* Último cambio: 18/10/2026 - 01:30 */
+#ifndef ANIMATION_INTEGRITY_H
+#define ANIMATION_INTEGRITY_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define ANIM_INTEGRITY_FILENAME     "ANIM.chk"
+#define ANIM_INTEGRITY_MAX_FRAMES   256     // Por secuencia; los fotogramas por encima no se marcan.
+
+typedef struct {
+    uint32_t dirs_scanned;      // Directorios validados leyendo sus fotogramas.
+    uint32_t dirs_from_index;   // Directorios con 'ANIM.chk' al día (sin releer los payloads).
+    uint32_t frames_checked;    // Fotogramas leídos y validados.
+    uint32_t bad_frames;        // Fotogramas marcados como defectuosos ahora mismo.
+    uint32_t crc_mismatches;    // Fotogramas cuyo CRC ya no coincide con el del índice (re-verificación).
+    uint32_t reported;          // Fotogramas marcados por el cargador al fallar su lectura.
+    uint32_t bytes_read;
+    uint32_t last_scan_ms;      // Duración del último recorrido completo.
+} animation_integrity_stats_t;
+
+/**
+ * @brief Arranca la tarea de comprobación. El primer recorrido empieza unos segundos después,
+ *        con la evolución actual en primer lugar. Sin CONFIG_DIYMON_ANIM_INTEGRITY_SCAN no hace nada
+ *        y ningún fotograma se marca.
+ */
+void animation_integrity_start(void);
+
+/**
+ * @brief Indica si el fotograma 'frame_index' (0..N-1) de una secuencia está marcado como defectuoso.
+ *        No toca la SD: es una consulta al índice en RAM.
+ * @param dir_path Ruta LVGL del directorio de evolución (ej: "S:/diymon/0"), sin barra final.
+ */
+bool animation_integrity_is_bad(const char *dir_path, const char *prefix, uint16_t frame_index);
+
+/**
+ * @brief Devuelve el primer fotograma a partir de 'from' (incluido) que no está marcado.
+ *        Con 'wrap', al llegar a 'count' se sigue desde el 0. Si todos están marcados devuelve 'from'.
+ */
+uint16_t animation_integrity_next_good(const char *dir_path, const char *prefix, uint16_t from, uint16_t count, bool wrap);
+
+/**
+ * @brief Marca un fotograma cuya lectura ha fallado de forma reproducible (cabecera inválida, fichero
+ *        truncado). Sigue marcado hasta que el servidor web cambie el directorio.
+ */
+void animation_integrity_report_bad(const char *dir_path, const char *prefix, uint16_t frame_index);
+
+/**
+ * @brief Número de fotogramas de una secuencia según el último recorrido del directorio.
+ * @return false si el directorio aún no se ha recorrido o ha cambiado desde entonces.
+ */
+bool animation_integrity_get_frame_count(const char *dir_path, const char *prefix, uint16_t *count);
+
+void animation_integrity_get_stats(animation_integrity_stats_t *out);
+void animation_integrity_log_stats(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // ANIMATION_INTEGRITY_H
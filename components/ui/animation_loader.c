@@ -1,17 +1,509 @@
 /* Fichero: components/ui/animation_loader.c */
-/* Descripción: Diagnóstico de Causa Raíz: La función nimation_loader_count_frames contaba cualquier fichero que coincidiera con el prefijo de la animación (ej: 'ANIM_IDLE_'), incluyendo ficheros fuente como '.png' que se habían dejado en la tarjeta SD. Esto inflaba el conteo de fotogramas y causaba intentos de cargar ficheros con el formato incorrecto. Solución Definitiva: Se ha añadido una comprobación explícita de la extensión del fichero. La función ahora solo cuenta los ficheros que, además de coincidir con el prefijo, terminan en '.bin'. Esto asegura un conteo preciso de los fotogramas de animación válidos y resuelve los errores de carga. */
-/* Último cambio: 21/08/2025 - 18:11 */
+/* Descripción: Fotogramas premezclados. 'animation_loader_set_background_signature' es el interruptor de la UI: con la firma del fondo en pantalla, el pack entrega sus secuencias premezcladas (RGB565 opaco) cuando se generaron contra ese fondo, y el descriptor del fotograma pasa a LV_COLOR_FORMAT_RGB565 sin más cambios en el cargador (sus claves son las de otras entradas de la tabla, así que no se confunden con las RGB565A8 en búferes ni caché). 'preblended_frames' cuenta los fotogramas servidos así. Orden de bytes de los '.bin' sueltos. La cabecera LVGL de un fotograma suelto marca con ANIM_BIN_FLAG_BIG_ENDIAN (LV_IMAGE_FLAGS_USER1) que su plano de color está en el orden del panel ('RGB565A8.bin.ps1 -BigEndian'). Si no coincide con el de los búferes de LVGL (CONFIG_LVGL_PORT_RGB565_BIG_ENDIAN), el plano de color se intercambia al cargarlo, antes de guardarlo en la caché, y en cada banda leída por filas: los fotogramas viejos se siguen viendo bien, pagando el intercambio que el modo nativo ahorra en el flush. Los packs en el orden contrario los rechaza animation_pack.c. Fotogramas defectuosos. 'animation_loader_load_frame' consulta primero el índice de la comprobación de la SD (animation_integrity.c) y descarta sin leer nada los fotogramas marcados. Un '.bin' suelto ya no se da por bueno con lo que se haya podido leer: su cabecera debe ser RGB565A8 del tamaño del player y el fichero debe llenar el búfer (misma regla que la comprobación de la SD, 'animation_pack_bin_payload_size'; los bytes sobrantes al final se ignoran); si no, se informa a la comprobación para que los players lo salten desde entonces. Packs en flash. El pack de un directorio se abre primero desde la copia mapeada de la partición de assets (animation_flash.c) y, si no la hay o no está al día, desde la SD. Con el pack en flash, un fotograma RAW completo no se copia: 'flash_dsc' apunta al payload mapeado, en cualquiera de los dos modos (con búfer de fotograma o decodificador por bandas). Los demás fotogramas se decodifican desde la imagen mapeada sin pasar por la caché de RAM, que ya no aporta nada. 'animation_loader_close_pack' es también lo que usa la copia en flash para retirar la imagen antes de reescribirla: el cerrojo del cargador garantiza que nadie la está leyendo. */
+/* Último cambio: 18/10/2026 - 05:15 */
 #include "animation_loader.h"
+#include "animation_pack.h"
+#include "animation_manifest.h"
+#include "animation_decoder.h"
+#include "animation_flash.h"
+#include "animation_integrity.h"
 #include "esp_log.h"
+#include "esp_heap_caps.h"
+#include "sdkconfig.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
 static const char *TAG = "ANIM_LOADER";
 #define LVGL_BIN_HEADER_SIZE 12
+// '.bin' con el plano de color RGB565 en el orden del panel (big-endian).
+#define ANIM_BIN_FLAG_BIG_ENDIAN LV_IMAGE_FLAGS_USER1
+
+// --- Pack del directorio en uso ---
+// Solo se mantiene abierto el pack de un directorio. 's_pack_dir' recuerda también
+// los directorios sin pack para no reintentar la apertura en cada fotograma.
+// Si el servidor web modifica la SD (generación distinta) el pack se vuelve a abrir.
+static animation_pack_t *s_pack = NULL;
+static char s_pack_dir[128] = "";
+static uint32_t s_pack_generation = 0;
+static uint16_t s_pack_serial = 0;      // Cambia con cada apertura del pack; forma parte de las claves.
+static uint32_t s_store_id = 0;         // Almacén al que pertenecen las claves STORE_KEY_FLAG vigentes.
+
+// Claves de los fotogramas del almacén: no dependen del pack que los referencia.
+// Las claves locales nunca llegan a este bit (serial de 15 bits).
+#define STORE_KEY_FLAG          0x80000000u
+
+// --- Contenido de los búferes de fotograma ---
+// Como mucho hay dos búferes (compartido y trasero del precargador); se deja margen.
+#define LOADER_MAX_BUFFERS 4
+
+typedef struct {
+    const void *buf;
+    uint32_t key;
+} buffer_key_t;
+
+static buffer_key_t s_buffer_keys[LOADER_MAX_BUFFERS];
+
+// Claves virtuales de los '.bin' sueltos: por encima de cualquier índice global del pack.
+#define FILE_KEY_BASE           0x8000
+#define FILE_KEY_PREFIXES       8
+#define FILE_KEY_MAX_FRAMES     0x0800
+static char s_file_prefixes[FILE_KEY_PREFIXES][16];
+
+// --- Caché de fotogramas en RAM ---
+#define CACHE_MAX_ENTRIES       16
+#define CACHE_RAM_HEADROOM      (48 * 1024)   // Igual que el precargador: RAM para WiFi y el servidor web.
+#define CACHE_BUDGET            ((uint32_t)CONFIG_DIYMON_ANIM_FRAME_CACHE_KB * 1024)
+
+typedef struct {
+    uint32_t key;               // Clave del fotograma (0 = libre).
+    uint32_t size;
+    uint32_t last_use;
+    uint8_t *data;              // Bytes tal como se leyeron de la SD.
+} cache_entry_t;
+
+static cache_entry_t s_cache[CACHE_MAX_ENTRIES];
+static uint32_t s_cache_bytes = 0;
+static uint32_t s_cache_clock = 0;
+static animation_cache_stats_t s_cache_stats;
+
+// --- '.bin' suelto abierto para las lecturas por filas ---
+static lv_fs_file_t s_row_file;
+static bool s_row_file_open = false;
+static char s_row_path[128];
+static uint32_t s_row_generation = 0;
+static lv_image_header_t s_row_header;
+
+// Serializa el acceso al pack y al índice entre la tarea de LVGL y la de precarga.
+static SemaphoreHandle_t s_loader_lock = NULL;
+
+#define LOADER_LOCK()   do { if (s_loader_lock) xSemaphoreTakeRecursive(s_loader_lock, portMAX_DELAY); } while (0)
+#define LOADER_UNLOCK() do { if (s_loader_lock) xSemaphoreGiveRecursive(s_loader_lock); } while (0)
+
+// --- Caché (todas las funciones requieren el cerrojo del cargador) ---
+
+static void cache_drop(cache_entry_t *e) {
+    s_cache_bytes -= e->size;
+    free(e->data);
+    memset(e, 0, sizeof(*e));
+}
+
+static void cache_flush_locked(void) {
+    for (int i = 0; i < CACHE_MAX_ENTRIES; i++) {
+        if (s_cache[i].key) cache_drop(&s_cache[i]);
+    }
+}
+
+static bool cache_evict_lru(void) {
+    cache_entry_t *lru = NULL;
+    for (int i = 0; i < CACHE_MAX_ENTRIES; i++) {
+        if (s_cache[i].key && (!lru || s_cache[i].last_use < lru->last_use)) lru = &s_cache[i];
+    }
+    if (!lru) return false;
+    cache_drop(lru);
+    s_cache_stats.evictions++;
+    return true;
+}
+
+static const cache_entry_t* cache_lookup(uint32_t key) {
+    for (int i = 0; i < CACHE_MAX_ENTRIES; i++) {
+        if (s_cache[i].key == key) {
+            s_cache[i].last_use = ++s_cache_clock;
+            s_cache_stats.hits++;
+            return &s_cache[i];
+        }
+    }
+    s_cache_stats.misses++;
+    return NULL;
+}
+
+// Reserva una entrada vacía de 'size' bytes para un fotograma de una secuencia que ocupa
+// 'seq_bytes' en total. Devuelve NULL si la secuencia no cabe en el presupuesto o no hay RAM.
+// Conserva solo las entradas del almacén (válidas para cualquier pack que lo use).
+static void cache_keep_store_locked(void) {
+    for (int i = 0; i < CACHE_MAX_ENTRIES; i++) {
+        if (!s_cache[i].key) continue;
+        if (s_cache[i].key & STORE_KEY_FLAG) {
+            s_cache_stats.carried++;
+        } else {
+            cache_drop(&s_cache[i]);
+        }
+    }
+}
+
+static cache_entry_t* cache_reserve(uint32_t key, uint32_t size, uint32_t seq_bytes) {
+    if (key == 0 || seq_bytes > CACHE_BUDGET || size > seq_bytes) {
+        s_cache_stats.bypassed++;
+        return NULL;
+    }
+
+    cache_entry_t *slot = NULL;
+    while (true) {
+        slot = NULL;
+        for (int i = 0; i < CACHE_MAX_ENTRIES && !slot; i++) {
+            if (!s_cache[i].key) slot = &s_cache[i];
+        }
+        bool fits = slot && s_cache_bytes + size <= CACHE_BUDGET &&
+                    heap_caps_get_free_size(MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT) >= size + CACHE_RAM_HEADROOM;
+        if (fits) break;
+        if (!cache_evict_lru()) {
+            s_cache_stats.bypassed++;
+            return NULL;
+        }
+    }
+
+    slot->data = malloc(size);
+    if (!slot->data) {
+        s_cache_stats.bypassed++;
+        return NULL;
+    }
+    slot->key = key;
+    slot->size = size;
+    slot->last_use = ++s_cache_clock;
+    s_cache_bytes += size;
+    return slot;
+}
+
+static void forget_store_buffer_keys(void) {
+    for (int i = 0; i < LOADER_MAX_BUFFERS; i++) {
+        if (s_buffer_keys[i].key & STORE_KEY_FLAG) s_buffer_keys[i].key = 0;
+    }
+}
+
+// La copia en flash del pack si es la de este directorio y está al día; si no, el de la SD.
+static animation_pack_t* open_pack(const char *dir_path) {
+    const uint8_t *data;
+    uint32_t size;
+    if (animation_flash_lookup(dir_path, &data, &size)) {
+        animation_pack_t *pack = animation_pack_open_mapped(dir_path, data, size);
+        if (pack) return pack;
+    }
+    return animation_pack_open(dir_path);
+}
+
+animation_pack_t* animation_loader_get_pack(const char *dir_path) {
+    if (!dir_path) return NULL;
+    LOADER_LOCK();
+    uint32_t generation = animation_manifest_get_generation();
+    if (strcmp(s_pack_dir, dir_path) != 0 || s_pack_generation != generation) {
+        bool same_sd = s_pack_generation == generation;
+        animation_pack_close(s_pack);
+        s_pack = open_pack(dir_path);
+        s_pack_serial++;
+        strncpy(s_pack_dir, dir_path, sizeof(s_pack_dir) - 1);
+        s_pack_dir[sizeof(s_pack_dir) - 1] = '\0';
+        s_pack_generation = generation;
+        memset(s_file_prefixes, 0, sizeof(s_file_prefixes));
+
+        // Las claves locales del pack anterior ya no pueden coincidir: se libera su RAM.
+        // Las del almacén siguen siendo válidas si la SD no ha cambiado y el almacén es el mismo.
+        uint32_t store_id = animation_pack_uses_store(s_pack) ? s_pack->header.store_id : 0;
+        if (same_sd && (store_id == 0 || store_id == s_store_id)) {
+            cache_keep_store_locked();
+        } else {
+            cache_flush_locked();
+            forget_store_buffer_keys();
+        }
+        if (store_id) s_store_id = store_id;
+    }
+    animation_pack_t *pack = s_pack;
+    LOADER_UNLOCK();
+    return pack;
+}
+
+static uint32_t frame_key(uint32_t global_index) {
+    // El +1 reserva la clave 0 para "contenido desconocido".
+    return ((uint32_t)(s_pack_serial & 0x7FFF) << 16 | global_index) + 1;
+}
+
+// Clave del fotograma 'global_index' del pack: su posición en el almacén si lo usa.
+static uint32_t pack_frame_key(const animation_pack_t *pack, uint32_t global_index) {
+    if (!animation_pack_uses_store(pack)) return frame_key(global_index);
+    return STORE_KEY_FLAG | (pack->frames[global_index].offset / pack->header.payload_align);
+}
+
+static uint32_t file_frame_key(const char *prefix, uint16_t frame_index) {
+    if (frame_index >= FILE_KEY_MAX_FRAMES) return 0;
+    for (int i = 0; i < FILE_KEY_PREFIXES; i++) {
+        if (s_file_prefixes[i][0] == '\0') {
+            strncpy(s_file_prefixes[i], prefix, sizeof(s_file_prefixes[i]) - 1);
+        }
+        if (strncmp(s_file_prefixes[i], prefix, sizeof(s_file_prefixes[i]) - 1) == 0) {
+            return frame_key(FILE_KEY_BASE + i * FILE_KEY_MAX_FRAMES + frame_index);
+        }
+    }
+    return 0; // Demasiados prefijos distintos: sin clave, no se reutiliza.
+}
+
+static buffer_key_t* find_buffer_slot(const void *buf, bool create) {
+    buffer_key_t *free_slot = NULL;
+    for (int i = 0; i < LOADER_MAX_BUFFERS; i++) {
+        if (s_buffer_keys[i].buf == buf) return &s_buffer_keys[i];
+        if (!free_slot && !s_buffer_keys[i].buf) free_slot = &s_buffer_keys[i];
+    }
+    if (create && free_slot) free_slot->buf = buf;
+    return create ? free_slot : NULL;
+}
+
+static void set_buffer_key(const void *buf, uint32_t key) {
+    buffer_key_t *slot = find_buffer_slot(buf, true);
+    if (slot) slot->key = key;
+}
+
+static const uint8_t* find_buffer_with_key(uint32_t key, const void *exclude) {
+    for (int i = 0; i < LOADER_MAX_BUFFERS; i++) {
+        if (s_buffer_keys[i].buf && s_buffer_keys[i].buf != exclude && s_buffer_keys[i].key == key) {
+            return s_buffer_keys[i].buf;
+        }
+    }
+    return NULL;
+}
+
+static void set_frame_header(animation_t *anim, const animation_pack_frame_t *frame) {
+    anim->img_dsc.header.w = frame->w;
+    anim->img_dsc.header.h = frame->h;
+    anim->img_dsc.header.stride = frame->stride;
+    // Los fotogramas I8 ya están expandidos a RGB565A8.
+    anim->img_dsc.header.cf = frame->cf == LV_COLOR_FORMAT_I8 ? LV_COLOR_FORMAT_RGB565A8 : frame->cf;
+    anim->frame_x = frame->x;
+    anim->frame_y = frame->y;
+}
+
+// Payload almacenado de un fotograma desde la caché; si no está y la secuencia cabe,
+// se lee de la SD a una entrada nueva. NULL = leer en streaming desde la SD.
+// Con el pack en flash el payload ya está en memoria: no se usa la caché.
+static const uint8_t* cached_payload(animation_pack_t *pack, const animation_pack_frame_t *frame,
+                                     uint32_t key, uint32_t seq_bytes) {
+    if (pack->mapped) return animation_pack_get_mapped_payload(pack, frame);
+    const cache_entry_t *hit = cache_lookup(key);
+    if (hit) return hit->data;
+
+    cache_entry_t *e = cache_reserve(key, frame->size, seq_bytes);
+    if (!e) return NULL;
+    if (!animation_pack_read_stored(pack, frame, e->data)) {
+        cache_drop(e);
+        return NULL;
+    }
+    return e->data;
+}
+
+// Decodifica un único fotograma del pack sobre el búfer del player. Un delta se aplica
+// sobre el contenido actual, que el llamador garantiza que es el fotograma anterior.
+static bool decode_pack_frame(animation_t *anim, animation_pack_t *pack, const animation_pack_frame_t *frame,
+                              uint32_t key, uint32_t seq_bytes, const uint16_t *palette, uint32_t capacity) {
+    uint8_t *dst = (uint8_t *)anim->img_dsc.data;
+    const uint8_t *stored;
+    bool ok;
+
+    if (!(frame->encoding & ANIM_PACK_FLAG_DELTA)) {
+        stored = cached_payload(pack, frame, key, seq_bytes);
+        ok = stored ? animation_pack_decode_frame(frame, palette, stored, dst, capacity)
+                    : animation_pack_read_frame(pack, frame, palette, dst, capacity);
+        anim->dirty.count = 0;
+    } else {
+        uint32_t scratch_size = frame->raw_size + ANIM_PACK_DECODE_MARGIN;
+        uint8_t *scratch = malloc(scratch_size);
+        if (!scratch && s_cache_bytes > 0) {
+            cache_flush_locked(); // La RAM del búfer temporal tiene prioridad sobre la caché.
+            scratch = malloc(scratch_size);
+        }
+        if (!scratch) {
+            ESP_LOGE(TAG, "Sin memoria para el delta de %lu bytes.", (unsigned long)frame->raw_size);
+            return false;
+        }
+        // Después de reservar el búfer temporal: vaciar la caché invalidaría 'stored'.
+        stored = cached_payload(pack, frame, key, seq_bytes);
+        ok = (stored ? animation_pack_decode_frame(frame, palette, stored, scratch, scratch_size)
+                     : animation_pack_read_frame(pack, frame, palette, scratch, scratch_size)) &&
+             animation_pack_apply_delta(frame, palette, scratch, dst, anim->img_dsc.data_size,
+                                        anim->dirty.areas, ANIM_DIRTY_MAX_AREAS, &anim->dirty.count);
+        free(scratch);
+    }
+    if (!ok) return false;
+
+    // Un delta tiene el mismo recorte que su fotograma anterior (validado al abrir el pack).
+    set_frame_header(anim, frame);
+    return true;
+}
+
+// El fotograma 'key' ya está en el búfer destino o en otro búfer de fotograma:
+// se reutiliza sin leer la SD. Devuelve false si no está en ninguno.
+static bool reuse_buffered_frame(animation_t *anim, uint32_t key) {
+    uint8_t *dst = (uint8_t *)anim->img_dsc.data;
+    if (key == 0) return false;
+    if (animation_loader_get_buffer_key(dst) != key) {
+        const uint8_t *src = find_buffer_with_key(key, dst);
+        if (!src) return false;
+        memcpy(dst, src, anim->img_dsc.data_size);
+        set_buffer_key(dst, key);
+    }
+    anim->dirty.base_key = 0;
+    anim->dirty.count = 0;
+    s_cache_stats.reused++;
+    return true;
+}
+
+static bool load_frame_from_pack(animation_t *anim, animation_pack_t *pack, uint16_t frame_index, const char *prefix) {
+    const animation_pack_seq_t *seq = animation_pack_find_seq(pack, prefix);
+    const animation_pack_frame_t *frame = animation_pack_get_frame(pack, seq, frame_index);
+    if (!frame) {
+        ESP_LOGW(TAG, "El pack de '%s' no contiene el fotograma %d de '%s'.", pack->dir_path, frame_index + 1, prefix);
+        return false;
+    }
+
+    uint8_t *dst = (uint8_t *)anim->img_dsc.data;
+    // Todos los búferes de fotograma se reservan con la holgura de descompresión.
+    uint32_t capacity = anim->img_dsc.data_size + ANIM_PACK_DECODE_MARGIN;
+
+    if (reuse_buffered_frame(anim, pack_frame_key(pack, seq->first_frame + frame_index))) {
+        set_frame_header(anim, frame);
+        return true;
+    }
+
+    // Punto de partida: retroceder por los deltas hasta encontrar un búfer con el
+    // fotograma anterior o, en el peor caso, el fotograma clave de la secuencia.
+    uint16_t start = frame_index;
+    while (pack->frames[seq->first_frame + start].encoding & ANIM_PACK_FLAG_DELTA) {
+        uint32_t base_key = pack_frame_key(pack, seq->first_frame + start - 1);
+        if (animation_loader_get_buffer_key(dst) == base_key) break;
+        const uint8_t *src = find_buffer_with_key(base_key, dst);
+        if (src) {
+            memcpy(dst, src, anim->img_dsc.data_size);
+            set_buffer_key(dst, base_key);
+            break;
+        }
+        start--; // El primer fotograma de la secuencia es clave (validado al abrir el pack).
+    }
+
+    const uint16_t *palette = animation_pack_get_palette(pack, seq);
+    // Los fotogramas repetidos (mismo payload en el almacén) comparten entrada en la caché.
+    uint32_t seq_bytes = 0;
+    for (uint16_t i = 0; i < seq->frame_count; i++) {
+        const animation_pack_frame_t *fr = &pack->frames[seq->first_frame + i];
+        bool repeated = false;
+        for (uint16_t j = 0; j < i && !repeated; j++) {
+            repeated = pack->frames[seq->first_frame + j].offset == fr->offset;
+        }
+        if (!repeated) seq_bytes += fr->size;
+    }
+
+    set_buffer_key(dst, 0); // Contenido indeterminado hasta terminar.
+    for (uint16_t i = start; i <= frame_index; i++) {
+        const animation_pack_frame_t *fr = &pack->frames[seq->first_frame + i];
+        if (!decode_pack_frame(anim, pack, fr, pack_frame_key(pack, seq->first_frame + i), seq_bytes, palette, capacity)) {
+            return false;
+        }
+    }
+    set_buffer_key(dst, pack_frame_key(pack, seq->first_frame + frame_index));
+
+    // Las zonas sucias solo sirven si el delta se aplicó directamente sobre el fotograma anterior.
+    if (start == frame_index && (frame->encoding & ANIM_PACK_FLAG_DELTA)) {
+        anim->dirty.base_key = pack_frame_key(pack, seq->first_frame + frame_index - 1);
+    } else {
+        anim->dirty.base_key = 0;
+        anim->dirty.count = 0;
+    }
+    return true;
+}
+
+// Fotograma RAW completo de un pack en flash: el descriptor apunta a su payload mapeado.
+static bool map_flash_frame(animation_t *anim, animation_pack_t *pack, uint16_t frame_index, const char *prefix) {
+    const animation_pack_seq_t *seq = animation_pack_find_seq(pack, prefix);
+    const animation_pack_frame_t *frame = animation_pack_get_frame(pack, seq, frame_index);
+    if (!animation_pack_frame_is_direct(frame)) return false;
+
+    lv_img_dsc_t *dsc = &anim->flash_dsc;
+    memset(dsc, 0, sizeof(*dsc));
+    dsc->header.magic = LV_IMAGE_HEADER_MAGIC;
+    dsc->header.w = frame->w;
+    dsc->header.h = frame->h;
+    dsc->header.stride = frame->stride;
+    dsc->header.cf = frame->cf;
+    dsc->data = animation_pack_get_mapped_payload(pack, frame);
+    dsc->data_size = frame->raw_size;
+    anim->frame_x = frame->x;
+    anim->frame_y = frame->y;
+    anim->dirty.base_key = 0;
+    anim->dirty.count = 0;
+    s_cache_stats.flash_frames++;
+    return true;
+}
+
+// El '.bin' está en el orden contrario al de los búferes de LVGL.
+static bool bin_needs_swap(const lv_image_header_t *header) {
+    return ((header->flags & ANIM_BIN_FLAG_BIG_ENDIAN) != 0) != (ANIM_PACK_NATIVE_HDR_FLAGS != 0);
+}
+
+static bool load_frame_from_file(animation_t *anim, uint16_t frame_index, const char *prefix) {
+    uint8_t *dst = (uint8_t *)anim->img_dsc.data;
+    uint32_t key = file_frame_key(prefix, frame_index);
+
+    anim->frame_x = 0;
+    anim->frame_y = 0;
+    anim->img_dsc.header.w = anim->width;
+    anim->img_dsc.header.h = anim->height;
+    anim->img_dsc.header.stride = anim->width * 2;
+    anim->img_dsc.header.cf = LV_COLOR_FORMAT_RGB565A8;
+    if (reuse_buffered_frame(anim, key)) return true;
+
+    anim->dirty.base_key = 0;
+    anim->dirty.count = 0;
+    const cache_entry_t *hit = key ? cache_lookup(key) : NULL;
+    if (hit) {
+        memcpy(dst, hit->data, hit->size < anim->img_dsc.data_size ? hit->size : anim->img_dsc.data_size);
+        set_buffer_key(dst, key);
+        return true;
+    }
+
+    char full_path[128];
+    snprintf(full_path, sizeof(full_path), "%s/%s%d.bin", anim->base_path, prefix, frame_index + 1);
+
+    lv_fs_file_t f;
+    lv_fs_res_t res = lv_fs_open(&f, full_path, LV_FS_MODE_RD);
+    if (res != LV_FS_RES_OK) {
+        ESP_LOGW(TAG, "Fallo al abrir frame (LVGL): %s", full_path);
+        return false;
+    }
+
+    // El búfer es del tamaño del lienzo: la cabecera debe describir exactamente eso y el fichero no puede
+    // acabar antes. Un fotograma que no cumple se marca para que los players lo salten sin volver a leerlo.
+    set_buffer_key(dst, 0);
+    lv_image_header_t header;
+    uint32_t header_read = 0, bytes_read = 0;
+    lv_fs_res_t hres = lv_fs_read(&f, &header, LVGL_BIN_HEADER_SIZE, &header_read);
+    bool header_ok = hres == LV_FS_RES_OK && header_read == LVGL_BIN_HEADER_SIZE &&
+                     animation_pack_bin_payload_size(&header, anim->width, anim->height) != 0;
+    res = header_ok ? lv_fs_read(&f, (void *)anim->img_dsc.data, anim->img_dsc.data_size, &bytes_read) : hres;
+    lv_fs_close(&f);
+    if (!header_ok || bytes_read != anim->img_dsc.data_size) {
+        ESP_LOGW(TAG, "Fotograma inválido o truncado: %s (%lu de %lu bytes).", full_path,
+                 (unsigned long)bytes_read, (unsigned long)anim->img_dsc.data_size);
+        // Un error de E/S puede ser pasajero; una cabecera ajena o un fichero corto, no.
+        if (res == LV_FS_RES_OK) animation_integrity_report_bad(anim->base_path, prefix, frame_index);
+        return false;
+    }
+    if (bin_needs_swap(&header)) {
+        lv_draw_sw_rgb565_swap(dst, (uint32_t)header.stride * header.h / 2);
+        s_cache_stats.swapped_frames++;
+    }
+    set_buffer_key(dst, key);
+
+    // Se guarda una copia si el bucle completo cabe en la caché.
+    if (key) {
+        uint32_t seq_bytes = (uint32_t)animation_manifest_get_frame_count(anim->base_path, prefix) * bytes_read;
+        cache_entry_t *e = cache_reserve(key, bytes_read, seq_bytes);
+        if (e) memcpy(e->data, dst, bytes_read);
+    }
+    return true;
+}
 
 animation_t animation_loader_init(const char *path, uint16_t width, uint16_t height, uint16_t num_frames) {
     animation_t anim = { 0 };
+    if (!s_loader_lock) {
+        s_loader_lock = xSemaphoreCreateRecursiveMutex();
+    }
     anim.base_path = path ? strdup(path) : NULL;
     anim.frame_count = num_frames;
     anim.width = width;
@@ -20,12 +512,17 @@ animation_t animation_loader_init(const char *path, uint16_t width, uint16_t hei
     uint32_t rgb_stride = width * 2; 
     size_t buffer_size = (size_t)width * height * 3;
 
-    anim.img_dsc.data = (uint8_t *)malloc(buffer_size);
+#if CONFIG_DIYMON_ANIM_STREAM_DECODER
+    // LVGL decodifica cada fotograma por bandas al dibujarlo: el player no necesita búfer.
+    buffer_size = 0;
+#else
+    anim.img_dsc.data = (uint8_t *)malloc(buffer_size + ANIM_PACK_DECODE_MARGIN);
     if (!anim.img_dsc.data) { 
         ESP_LOGE(TAG, "Fallo al reservar buffer de animación de tamaño %u!", (unsigned int)buffer_size);
         animation_loader_free(&anim); 
         return anim; 
     }
+#endif
     
     anim.img_dsc.header.w = width;
     anim.img_dsc.header.h = height;
@@ -37,24 +534,66 @@ animation_t animation_loader_init(const char *path, uint16_t width, uint16_t hei
     return anim;
 }
 
-bool animation_loader_load_frame(animation_t *anim, uint16_t frame_index, const char *prefix) {
-    if (!anim || !anim->base_path || !anim->img_dsc.data) return false;
-    char full_path[128];
-    snprintf(full_path, sizeof(full_path), "%s/%s%d.bin", anim->base_path, prefix, frame_index + 1);
+#if CONFIG_DIYMON_ANIM_STREAM_DECODER
+// Sin búfer de fotograma: se resuelven la geometría y la ruta virtual del fotograma; sus
+// píxeles los lee el decodificador por bandas cuando LVGL lo dibuja.
+static bool select_streamed_frame(animation_t *anim, uint16_t frame_index, const char *prefix) {
+    animation_frame_info_t info;
+    if (!animation_loader_get_frame_info(anim->base_path, prefix, frame_index, &info)) {
+        ESP_LOGW(TAG, "No se encontró el fotograma %d de '%s' en '%s'.", frame_index + 1, prefix, anim->base_path);
+        return false;
+    }
+    anim->img_dsc.header = info.header;
+    anim->frame_x = info.x;
+    anim->frame_y = info.y;
+    anim->dirty.base_key = 0;
+    anim->dirty.count = 0;
+    animation_decoder_build_src(anim->frame_src, sizeof(anim->frame_src), anim->base_path, prefix, frame_index);
+    return true;
+}
+#endif
 
-    lv_fs_file_t f;
-    lv_fs_res_t res = lv_fs_open(&f, full_path, LV_FS_MODE_RD);
-    if (res != LV_FS_RES_OK) {
-        ESP_LOGW(TAG, "Fallo al abrir frame (LVGL): %s", full_path);
+bool animation_loader_load_frame(animation_t *anim, uint16_t frame_index, const char *prefix) {
+    if (!anim || !anim->base_path || !animation_loader_is_ready(anim)) return false;
+    // Fotograma marcado por la comprobación de la SD: se descarta sin esperar a una lectura que fallará.
+    if (animation_integrity_is_bad(anim->base_path, prefix, frame_index)) {
+        LOADER_LOCK();
+        s_cache_stats.bad_skipped++;
+        LOADER_UNLOCK();
         return false;
     }
-    
-    lv_fs_seek(&f, LVGL_BIN_HEADER_SIZE, LV_FS_SEEK_SET);
-    uint32_t bytes_read = 0;
-    lv_fs_read(&f, (void *)anim->img_dsc.data, anim->img_dsc.data_size, &bytes_read);
-    lv_fs_close(&f);
 
-    return true;
+    LOADER_LOCK();
+    animation_pack_t *pack = animation_loader_get_pack(anim->base_path);
+    if (pack && pack->mapped && map_flash_frame(anim, pack, frame_index, prefix)) {
+        if (anim->flash_dsc.header.cf == LV_COLOR_FORMAT_RGB565) s_cache_stats.preblended_frames++;
+        LOADER_UNLOCK();
+        return true;
+    }
+    bool ok;
+#if CONFIG_DIYMON_ANIM_STREAM_DECODER
+    if (!anim->img_dsc.data) {
+        ok = select_streamed_frame(anim, frame_index, prefix);
+    } else
+#endif
+    if (pack) {
+        ok = load_frame_from_pack(anim, pack, frame_index, prefix);
+    } else {
+        ok = load_frame_from_file(anim, frame_index, prefix);
+    }
+    // El fotograma de la flash sigue en pantalla hasta que el nuevo esté listo.
+    if (ok) anim->flash_dsc.data = NULL;
+    if (ok && anim->img_dsc.data && anim->img_dsc.header.cf == LV_COLOR_FORMAT_RGB565) s_cache_stats.preblended_frames++;
+    LOADER_UNLOCK();
+    return ok;
+}
+
+void animation_loader_set_background_signature(uint32_t signature) {
+    LOADER_LOCK();
+    animation_pack_set_background_signature(signature);
+    LOADER_UNLOCK();
+    ESP_LOGI(TAG, "Fotogramas premezclados %s (firma del fondo %08lx).", signature ? "permitidos" : "desactivados",
+             (unsigned long)signature);
 }
 
 void animation_loader_free(animation_t *anim) {
@@ -64,50 +603,205 @@ void animation_loader_free(animation_t *anim) {
         anim->base_path = NULL;
     }
     if (anim->img_dsc.data) {
+        animation_loader_forget_buffer(anim->img_dsc.data);
         free((void*)anim->img_dsc.data);
         anim->img_dsc.data = NULL;
     }
+    anim->flash_dsc.data = NULL;
     anim->frame_count = 0;
 }
 
+void animation_loader_close_pack(void) {
+    LOADER_LOCK();
+    animation_pack_close(s_pack);
+    s_pack = NULL;
+    s_pack_dir[0] = '\0';
+    if (s_row_file_open) {
+        lv_fs_close(&s_row_file);
+        s_row_file_open = false;
+    }
+    LOADER_UNLOCK();
+}
+
+bool animation_loader_is_ready(const animation_t *anim) {
+    if (!anim) return false;
+#if CONFIG_DIYMON_ANIM_STREAM_DECODER
+    if (anim->width > 0 && anim->height > 0) return true;
+#endif
+    return anim->img_dsc.data != NULL;
+}
+
+// Requiere el cerrojo. Mantiene abierto el último '.bin' leído por filas y valida su cabecera.
+static bool open_row_file(const char *base_path, const char *prefix, uint16_t frame_index) {
+    char path[128];
+    snprintf(path, sizeof(path), "%s/%s%d.bin", base_path, prefix, frame_index + 1);
+    uint32_t generation = animation_manifest_get_generation();
+    if (s_row_file_open && s_row_generation == generation && strcmp(s_row_path, path) == 0) return true;
+
+    if (s_row_file_open) {
+        lv_fs_close(&s_row_file);
+        s_row_file_open = false;
+    }
+    if (lv_fs_open(&s_row_file, path, LV_FS_MODE_RD) != LV_FS_RES_OK) {
+        ESP_LOGW(TAG, "Fallo al abrir frame (LVGL): %s", path);
+        return false;
+    }
+    uint32_t bytes_read = 0;
+    lv_fs_res_t res = lv_fs_read(&s_row_file, &s_row_header, LVGL_BIN_HEADER_SIZE, &bytes_read);
+    if (res != LV_FS_RES_OK || bytes_read != LVGL_BIN_HEADER_SIZE ||
+        !animation_pack_bin_payload_size(&s_row_header, s_row_header.w, s_row_header.h)) {
+        ESP_LOGW(TAG, "'%s' no es un fotograma RGB565A8 válido.", path);
+        lv_fs_close(&s_row_file);
+        if (res == LV_FS_RES_OK) animation_integrity_report_bad(base_path, prefix, frame_index);
+        return false;
+    }
+    strncpy(s_row_path, path, sizeof(s_row_path) - 1);
+    s_row_path[sizeof(s_row_path) - 1] = '\0';
+    s_row_generation = generation;
+    s_row_file_open = true;
+    return true;
+}
+
+bool animation_loader_get_frame_info(const char *base_path, const char *prefix, uint16_t frame_index,
+                                     animation_frame_info_t *out) {
+    if (!base_path || !prefix || !out) return false;
+    memset(out, 0, sizeof(*out));
+
+    LOADER_LOCK();
+    bool ok = false;
+    animation_pack_t *pack = animation_loader_get_pack(base_path);
+    if (pack) {
+        const animation_pack_frame_t *frame = animation_pack_get_frame(pack, animation_pack_find_seq(pack, prefix), frame_index);
+        if (frame) {
+            out->header.magic = LV_IMAGE_HEADER_MAGIC;
+            out->header.cf = LV_COLOR_FORMAT_RGB565A8; // Los I8 se entregan ya expandidos.
+            out->header.w = frame->w;
+            out->header.h = frame->h;
+            out->header.stride = frame->stride;
+            out->x = frame->x;
+            out->y = frame->y;
+            out->row_access = animation_pack_frame_has_row_access(frame);
+            ok = true;
+        }
+    } else if (open_row_file(base_path, prefix, frame_index)) {
+        out->header = s_row_header;
+        out->row_access = true;
+        ok = true;
+    }
+    LOADER_UNLOCK();
+    return ok;
+}
+
+bool animation_loader_read_rows(const char *base_path, const char *prefix, uint16_t frame_index,
+                                uint16_t y, uint16_t rows, uint8_t *dst, uint32_t dst_size) {
+    if (!base_path || !prefix || !dst || rows == 0) return false;
+
+    LOADER_LOCK();
+    bool ok = false;
+    animation_pack_t *pack = animation_loader_get_pack(base_path);
+    if (pack) {
+        const animation_pack_seq_t *seq = animation_pack_find_seq(pack, prefix);
+        const animation_pack_frame_t *frame = animation_pack_get_frame(pack, seq, frame_index);
+        ok = frame && animation_pack_read_rows(pack, frame, animation_pack_get_palette(pack, seq), y, rows, dst, dst_size);
+    } else if (open_row_file(base_path, prefix, frame_index)) {
+        // '.bin': cabecera, plano de color (stride * h) y plano alfa (w * h).
+        uint32_t w = s_row_header.w, h = s_row_header.h, stride = s_row_header.stride;
+        uint32_t color_off = LVGL_BIN_HEADER_SIZE + (uint32_t)y * stride;
+        uint32_t alpha_off = LVGL_BIN_HEADER_SIZE + h * stride + (uint32_t)y * w;
+        uint32_t color_len = rows * stride, alpha_len = rows * w, r1 = 0, r2 = 0;
+        ok = (uint32_t)y + rows <= h && dst_size >= color_len + alpha_len &&
+             lv_fs_seek(&s_row_file, color_off, LV_FS_SEEK_SET) == LV_FS_RES_OK &&
+             lv_fs_read(&s_row_file, dst, color_len, &r1) == LV_FS_RES_OK && r1 == color_len &&
+             lv_fs_seek(&s_row_file, alpha_off, LV_FS_SEEK_SET) == LV_FS_RES_OK &&
+             lv_fs_read(&s_row_file, dst + color_len, alpha_len, &r2) == LV_FS_RES_OK && r2 == alpha_len;
+        if (ok && bin_needs_swap(&s_row_header)) lv_draw_sw_rgb565_swap(dst, color_len / 2);
+    }
+    LOADER_UNLOCK();
+    return ok;
+}
+
+uint32_t animation_loader_get_buffer_key(const void *buf) {
+    LOADER_LOCK();
+    buffer_key_t *slot = find_buffer_slot(buf, false);
+    uint32_t key = slot ? slot->key : 0;
+    LOADER_UNLOCK();
+    return key;
+}
+
+void animation_loader_forget_buffer(const void *buf) {
+    LOADER_LOCK();
+    buffer_key_t *slot = find_buffer_slot(buf, false);
+    if (slot) {
+        slot->buf = NULL;
+        slot->key = 0;
+    }
+    LOADER_UNLOCK();
+}
+
 uint16_t animation_loader_count_frames(const char *path, const char *prefix) {
     if (!path || !prefix) {
         return 0;
     }
+    LOADER_LOCK();
+    uint16_t count = animation_manifest_get_frame_count(path, prefix);
+    LOADER_UNLOCK();
+    return count;
+}
 
-    uint16_t count = 0;
-    ESP_LOGD(TAG, "Abriendo directorio de animación (LVGL): '%s' para contar frames con prefijo '%s'", path, prefix);
-    
-    lv_fs_dir_t d;
-    lv_fs_res_t res = lv_fs_dir_open(&d, path);
+uint16_t animation_loader_get_frame_durations(const char *path, const char *prefix, uint16_t *durations_ms,
+                                              uint16_t max_frames) {
+    if (!path || !prefix || !durations_ms || max_frames == 0) return 0;
 
-    if(res != LV_FS_RES_OK) {
-        ESP_LOGE(TAG, "No se pudo abrir el directorio (LVGL): %s. Código de error: %d", path, res);
-        return 0;
+    LOADER_LOCK();
+    uint16_t count = 0;
+    animation_pack_t *pack = animation_loader_get_pack(path);
+    const animation_pack_seq_t *seq = pack ? animation_pack_find_seq(pack, prefix) : NULL;
+    if (seq) {
+        count = seq->frame_count < max_frames ? seq->frame_count : max_frames;
+        for (uint16_t i = 0; i < count; i++) {
+            durations_ms[i] = animation_pack_get_frame(pack, seq, i)->duration_ms;
+        }
     }
+    LOADER_UNLOCK();
+    return count;
+}
 
-    char fn[256];
-    size_t prefix_len = strlen(prefix);
 
-    while(lv_fs_dir_read(&d, fn, sizeof(fn)) == LV_FS_RES_OK && fn[0] != '\0') {
-        // Ignorar directorios y ficheros que no sean de animación.
-        if (fn[0] == '/' || strcmp(fn, ".") == 0 || strcmp(fn, "..") == 0) {
-            continue;
-        }
+void animation_loader_cache_flush(void) {
+    LOADER_LOCK();
+    cache_flush_locked();
+    LOADER_UNLOCK();
+}
 
-        size_t fn_len = strlen(fn);
-        const char *extension = ".bin";
-        size_t ext_len = strlen(extension);
+uint32_t animation_loader_cache_reclaim(uint32_t bytes) {
+    LOADER_LOCK();
+    uint32_t before = s_cache_bytes;
+    while (before - s_cache_bytes < bytes && cache_evict_lru()) {
+    }
+    uint32_t freed = before - s_cache_bytes;
+    LOADER_UNLOCK();
+    return freed;
+}
 
-        // [CORRECCIÓN] Comprobar prefijo Y extensión del fichero.
-        if (strncmp(fn, prefix, prefix_len) == 0 && 
-            fn_len > ext_len && 
-            strcmp(fn + fn_len - ext_len, extension) == 0) {
-            count++;
-        }
+void animation_loader_cache_get_stats(animation_cache_stats_t *out) {
+    if (!out) return;
+    LOADER_LOCK();
+    *out = s_cache_stats;
+    out->bytes = s_cache_bytes;
+    out->budget = CACHE_BUDGET;
+    out->entries = 0;
+    for (int i = 0; i < CACHE_MAX_ENTRIES; i++) {
+        if (s_cache[i].key) out->entries++;
     }
+    LOADER_UNLOCK();
+}
 
-    lv_fs_dir_close(&d);
-    ESP_LOGD(TAG, "Cierre de directorio. Total de fotogramas con prefijo '%s': %d", prefix, count);
-    return count;
+void animation_loader_cache_log_stats(void) {
+    animation_cache_stats_t st;
+    animation_loader_cache_get_stats(&st);
+    ESP_LOGI(TAG, "[caché] aciertos=%lu fallos=%lu reutilizados=%lu sin_admitir=%lu desalojos=%lu compartidas=%lu desde_flash=%lu defectuosos=%lu intercambiados=%lu premezclados=%lu ocupación=%lu/%lu bytes (%u entradas)",
+             (unsigned long)st.hits, (unsigned long)st.misses, (unsigned long)st.reused, (unsigned long)st.bypassed,
+             (unsigned long)st.evictions, (unsigned long)st.carried, (unsigned long)st.flash_frames, (unsigned long)st.bad_skipped,
+             (unsigned long)st.swapped_frames, (unsigned long)st.preblended_frames,
+             (unsigned long)st.bytes, (unsigned long)st.budget, st.entries);
 }
@@ -1,15 +1,47 @@
 /*
  * Fichero: ./components/diymon_ui/animation_loader.h
- * Fecha: 11/08/2025 - 12:00
- * Último cambio: Sin cambios en esta iteración.
- * Descripción: Define la interfaz para el cargador de animaciones. Se añade una
- *              función que permite contar el número de fotogramas de una animación
- *              en un directorio específico, basado en un prefijo de fichero.
+ * Fecha: 18/10/2026 - 04:00
+ * Último cambio: 'animation_loader_set_background_signature' activa los fotogramas premezclados del pack; contador 'preblended_frames'.
+ * Descripción: Define la interfaz para el cargador de animaciones. Tras cargar un
+ *              fotograma delta, 'dirty' indica qué zonas cambiaron respecto al
+ *              fotograma anterior para invalidar solo esas áreas. El cargador
+ *              recuerda qué fotograma contiene cada búfer (clave de fotograma) para
+ *              aplicar los deltas sobre el búfer adecuado. Con fotogramas recortados,
+ *              'img_dsc' describe solo el recorte y 'frame_x'/'frame_y' su posición
+ *              dentro del lienzo 'width' x 'height'. Los fotogramas leídos de la SD
+ *              se guardan en una caché LRU limitada por CONFIG_DIYMON_ANIM_FRAME_CACHE_KB
+ *              para que los bucles cortos se reproduzcan desde RAM. Los fotogramas del
+ *              almacén compartido ('STORE.pak') se identifican por su posición en él, así
+ *              que sus entradas sobreviven al cambio de evolución.
+ *              Con CONFIG_DIYMON_ANIM_STREAM_DECODER los players no tienen búfer:
+ *              cargar un fotograma solo resuelve su geometría y su ruta virtual
+ *              ('frame_src'), y LVGL lo decodifica por bandas al dibujarlo.
+ *              'animation_loader_get_frame_durations' da la duración de cada fotograma
+ *              de una secuencia (0 = sin duración propia en el pack).
+ *              Si el pack se abrió desde la copia mapeada en flash (animation_flash.h),
+ *              los fotogramas RAW no se copian: 'flash_dsc' describe el fotograma con
+ *              'data' apuntando a la flash y es lo que debe mostrarse mientras
+ *              'flash_dsc.data' no sea NULL. El resto de fotogramas se decodifican
+ *              desde la flash al búfer del player como siempre.
+ *              Los fotogramas marcados como defectuosos por la comprobación de la SD
+ *              (animation_integrity.h) fallan al instante, sin leer la tarjeta.
+ *              Con la firma del fondo fijada por la UI, los packs generados contra ese
+ *              fondo entregan fotogramas RGB565 opacos (premezclados) en lugar de
+ *              RGB565A8; 'img_dsc' / 'flash_dsc' llevan entonces LV_COLOR_FORMAT_RGB565.
  */
 #ifndef ANIMATION_LOADER_H
 #define ANIMATION_LOADER_H
 
 #include "lvgl.h"
+#include "animation_pack.h"
+
+#define ANIM_DIRTY_MAX_AREAS 8
+
+typedef struct {
+    uint32_t base_key;          // Fotograma respecto al que cambian las zonas (0 = fotograma completo).
+    uint8_t count;              // Zonas válidas; 0 = invalidar el fotograma completo.
+    lv_area_t areas[ANIM_DIRTY_MAX_AREAS]; // En coordenadas del fotograma.
+} animation_dirty_t;
 
 typedef struct {
     char *base_path;
@@ -17,11 +49,82 @@ typedef struct {
     uint16_t width;
     uint16_t height;
     lv_img_dsc_t img_dsc;
+    int16_t frame_x;            // Posición del fotograma cargado dentro del lienzo.
+    int16_t frame_y;
+    animation_dirty_t dirty;    // Zonas modificadas por la última carga.
+    char frame_src[96];         // Sin búfer de fotograma: ruta virtual '.anim' del fotograma cargado.
+    lv_img_dsc_t flash_dsc;     // Fotograma cargado sin copia desde la flash (data = NULL si no).
 } animation_t;
 
+typedef struct {
+    lv_image_header_t header;   // Dimensiones del fotograma ya decodificado (RGB565A8).
+    int16_t x;                  // Posición del recorte dentro del lienzo.
+    int16_t y;
+    bool row_access;            // Sus filas pueden leerse sueltas (animation_loader_read_rows).
+} animation_frame_info_t;
+
+typedef struct {
+    uint32_t hits;              // Fotogramas decodificados desde la caché.
+    uint32_t misses;            // Fotogramas que no estaban en la caché (leídos de la SD).
+    uint32_t reused;            // Fotogramas que ya estaban en un búfer de fotograma (sin caché ni SD).
+    uint32_t bypassed;          // Lecturas no guardadas: secuencia mayor que el presupuesto o sin RAM.
+    uint32_t evictions;         // Entradas desalojadas para hacer sitio.
+    uint32_t carried;           // Entradas del almacén conservadas al cambiar de evolución.
+    uint32_t flash_frames;      // Fotogramas mostrados directamente desde la flash (sin copia).
+    uint32_t bad_skipped;       // Cargas descartadas sin leer: fotograma marcado como defectuoso (animation_integrity.h).
+    uint32_t swapped_frames;    // '.bin' sueltos en el orden de bytes contrario al de LVGL, intercambiados al cargarlos.
+    uint32_t preblended_frames; // Fotogramas RGB565 opacos de las secuencias premezcladas del pack.
+    uint32_t bytes;             // Ocupación actual.
+    uint32_t budget;            // CONFIG_DIYMON_ANIM_FRAME_CACHE_KB en bytes.
+    uint16_t entries;
+} animation_cache_stats_t;
+
 animation_t animation_loader_init(const char *path, uint16_t width, uint16_t height, uint16_t num_frames);
 bool animation_loader_load_frame(animation_t *anim, uint16_t frame_index, const char *prefix);
 void animation_loader_free(animation_t *anim);
 uint16_t animation_loader_count_frames(const char *path, const char *prefix);
+void animation_loader_close_pack(void);
+animation_pack_t* animation_loader_get_pack(const char *dir_path);
+uint32_t animation_loader_get_buffer_key(const void *buf);
+void animation_loader_forget_buffer(const void *buf);
+
+/**
+ * @brief Firma del fondo bajo el lienzo (ui_helpers_get_background_signature); los packs premezclados
+ *        contra ese fondo entregan sus fotogramas RGB565 opacos. 0 vuelve a los fotogramas RGB565A8.
+ */
+void animation_loader_set_background_signature(uint32_t signature);
+
+/**
+ * @brief Copia la duración en milisegundos de los fotogramas de una secuencia del pack
+ *        (0 = cadencia por defecto del player). Sin pack no hay duraciones.
+ * @return Número de duraciones escritas en 'durations_ms' (como mucho 'max_frames').
+ */
+uint16_t animation_loader_get_frame_durations(const char *path, const char *prefix, uint16_t *durations_ms,
+                                              uint16_t max_frames);
+
+/**
+ * @brief Indica si el player puede mostrar fotogramas: tiene búfer de fotograma o, con
+ *        CONFIG_DIYMON_ANIM_STREAM_DECODER, los decodifica LVGL por bandas al dibujarlos.
+ */
+bool animation_loader_is_ready(const animation_t *anim);
+
+/**
+ * @brief Geometría del fotograma 'frame_index' (0..N-1) de una secuencia, sin leer sus píxeles
+ *        (salvo la cabecera de un '.bin' suelto).
+ */
+bool animation_loader_get_frame_info(const char *base_path, const char *prefix, uint16_t frame_index,
+                                     animation_frame_info_t *out);
+
+/**
+ * @brief Lee las filas [y, y + rows) de un fotograma con acceso por filas como una banda RGB565A8
+ *        (rows * stride bytes de color y rows * w de alfa). 'dst_size' >= rows * w * 3.
+ */
+bool animation_loader_read_rows(const char *base_path, const char *prefix, uint16_t frame_index,
+                                uint16_t y, uint16_t rows, uint8_t *dst, uint32_t dst_size);
+
+void animation_loader_cache_flush(void);
+uint32_t animation_loader_cache_reclaim(uint32_t bytes);
+void animation_loader_cache_get_stats(animation_cache_stats_t *out);
+void animation_loader_cache_log_stats(void);
 
 #endif // ANIMATION_LOADER_H
\ No newline at end of file
@@ -0,0 +1,253 @@
+/* Fichero: components/ui/animation_manifest.c */
+/* Descripción: Índice de fotogramas por directorio de evolución. Antes, cada inicio de animación (acción o reposo) enumeraba el directorio completo con lv_fs_dir_read comparando prefijo y extensión de decenas de entradas (incluidos los '.xcf' y '.png' de origen). Ahora el índice de un directorio se construye una única vez: desde la tabla de secuencias del 'ANIM.pak' si existe, desde los recuentos de la comprobación de la SD (animation_integrity.c, índice 'ANIM.chk') si el directorio ya se recorrió y no ha cambiado, desde el manifiesto persistido 'ANIM.idx' (opcional, CONFIG_DIYMON_ANIM_MANIFEST_PERSIST) o con un único recorrido que cuenta todos los prefijos de acción a la vez. El servidor web notifica cada subida/borrado; la notificación incrementa un contador de generación que invalida los índices en memoria y borra el 'ANIM.idx' del directorio afectado. El aviso se registra con 'web_server_add_fs_change_cb', que el servidor web comparte con el pool de ficheros del driver 'S:'. */
+/* Último cambio: 18/10/2026 - 01:30 */
+#include "animation_manifest.h"
+#include "animation_loader.h"
+#include "animation_pack.h"
+#include "animation_integrity.h"
+#include "web_server.h"
+#include "esp_log.h"
+#include "sdkconfig.h"
+#include "lvgl.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+static const char *TAG = "ANIM_MANIFEST";
+
+#define MANIFEST_CACHE_SLOTS    4
+#define MANIFEST_FILE_MAGIC     "DIDX1"
+
+// Prefijos de acción indexados (los mismos que usan las animaciones de la UI).
+static const char *const k_prefixes[] = { "ANIM_IDLE_", "ANIM_EAT_", "ANIM_GYM_", "ANIM_ATK_" };
+#define MANIFEST_PREFIX_COUNT (sizeof(k_prefixes) / sizeof(k_prefixes[0]))
+
+typedef struct {
+    char dir_path[64];
+    uint16_t counts[MANIFEST_PREFIX_COUNT];
+    uint32_t generation;
+    uint32_t last_use;
+    bool valid;
+} manifest_entry_t;
+
+static manifest_entry_t s_entries[MANIFEST_CACHE_SLOTS];
+static uint32_t s_use_clock = 0;
+
+// Se incrementa desde la tarea del servidor web; se lee desde la tarea de LVGL.
+static volatile uint32_t s_generation = 0;
+
+// --- Construcción del índice ---
+
+static int prefix_slot(const char *prefix) {
+    for (int i = 0; i < MANIFEST_PREFIX_COUNT; i++) {
+        if (strcmp(k_prefixes[i], prefix) == 0) return i;
+    }
+    return -1;
+}
+
+static bool build_from_pack(manifest_entry_t *entry) {
+    animation_pack_t *pack = animation_loader_get_pack(entry->dir_path);
+    if (!pack) return false;
+
+    for (int i = 0; i < MANIFEST_PREFIX_COUNT; i++) {
+        const animation_pack_seq_t *seq = animation_pack_find_seq(pack, k_prefixes[i]);
+        entry->counts[i] = seq ? seq->frame_count : 0;
+    }
+    return true;
+}
+
+// Recuentos del último recorrido de la comprobación de la SD, si el directorio no ha cambiado desde entonces.
+static bool build_from_integrity(manifest_entry_t *entry) {
+    for (int i = 0; i < MANIFEST_PREFIX_COUNT; i++) {
+        if (!animation_integrity_get_frame_count(entry->dir_path, k_prefixes[i], &entry->counts[i])) return false;
+    }
+    return true;
+}
+
+static bool build_from_dir_scan(manifest_entry_t *entry) {
+    lv_fs_dir_t d;
+    lv_fs_res_t res = lv_fs_dir_open(&d, entry->dir_path);
+    if (res != LV_FS_RES_OK) {
+        ESP_LOGE(TAG, "No se pudo abrir el directorio (LVGL): %s. Código de error: %d", entry->dir_path, res);
+        return false;
+    }
+
+    const char *extension = ".bin";
+    const size_t ext_len = strlen(extension);
+    char fn[256];
+
+    // Un único recorrido cuenta los fotogramas de todas las acciones.
+    while (lv_fs_dir_read(&d, fn, sizeof(fn)) == LV_FS_RES_OK && fn[0] != '\0') {
+        if (fn[0] == '/') continue; // Directorios.
+
+        size_t fn_len = strlen(fn);
+        if (fn_len <= ext_len || strcmp(fn + fn_len - ext_len, extension) != 0) continue;
+
+        for (int i = 0; i < MANIFEST_PREFIX_COUNT; i++) {
+            if (strncmp(fn, k_prefixes[i], strlen(k_prefixes[i])) == 0) {
+                entry->counts[i]++;
+                break;
+            }
+        }
+    }
+    lv_fs_dir_close(&d);
+    return true;
+}
+
+#if CONFIG_DIYMON_ANIM_MANIFEST_PERSIST
+static bool load_persisted(manifest_entry_t *entry) {
+    char path[96];
+    snprintf(path, sizeof(path), "%s/%s", entry->dir_path, ANIM_MANIFEST_FILENAME);
+
+    lv_fs_file_t f;
+    if (lv_fs_open(&f, path, LV_FS_MODE_RD) != LV_FS_RES_OK) return false;
+
+    char buf[160];
+    uint32_t bytes_read = 0;
+    lv_fs_read(&f, buf, sizeof(buf) - 1, &bytes_read);
+    lv_fs_close(&f);
+    buf[bytes_read] = '\0';
+
+    if (strncmp(buf, MANIFEST_FILE_MAGIC "\n", strlen(MANIFEST_FILE_MAGIC) + 1) != 0) {
+        ESP_LOGW(TAG, "Manifiesto '%s' con formato desconocido. Se reconstruirá.", path);
+        return false;
+    }
+
+    char *line = strchr(buf, '\n') + 1;
+    while (line && *line) {
+        char prefix[16];
+        unsigned count;
+        if (sscanf(line, "%15s %u", prefix, &count) == 2) {
+            int slot = prefix_slot(prefix);
+            if (slot >= 0) entry->counts[slot] = (uint16_t)count;
+        }
+        line = strchr(line, '\n');
+        if (line) line++;
+    }
+    return true;
+}
+
+static void save_persisted(const manifest_entry_t *entry) {
+    char path[96];
+    snprintf(path, sizeof(path), "%s/%s", entry->dir_path, ANIM_MANIFEST_FILENAME);
+
+    char buf[160];
+    int len = snprintf(buf, sizeof(buf), "%s\n", MANIFEST_FILE_MAGIC);
+    for (int i = 0; i < MANIFEST_PREFIX_COUNT && len < sizeof(buf); i++) {
+        len += snprintf(buf + len, sizeof(buf) - len, "%s %u\n", k_prefixes[i], entry->counts[i]);
+    }
+
+    lv_fs_file_t f;
+    if (lv_fs_open(&f, path, LV_FS_MODE_WR) != LV_FS_RES_OK) {
+        ESP_LOGW(TAG, "No se pudo escribir el manifiesto '%s'.", path);
+        return;
+    }
+    uint32_t bytes_written = 0;
+    lv_fs_write(&f, buf, len, &bytes_written);
+    lv_fs_close(&f);
+}
+#endif
+
+static manifest_entry_t* get_entry(const char *dir_path) {
+    uint32_t generation = s_generation;
+    manifest_entry_t *entry = NULL;
+
+    for (int i = 0; i < MANIFEST_CACHE_SLOTS; i++) {
+        manifest_entry_t *e = &s_entries[i];
+        if (e->valid && e->generation != generation) {
+            e->valid = false; // Índice obsoleto tras un cambio en la SD.
+        }
+        if (e->valid && strcmp(e->dir_path, dir_path) == 0) {
+            e->last_use = ++s_use_clock;
+            return e;
+        }
+        // Candidata a reemplazo: una entrada libre o, si no hay, la menos usada.
+        if (!entry || (entry->valid && (!e->valid || e->last_use < entry->last_use))) {
+            entry = e;
+        }
+    }
+
+    // Fallo de caché: construir el índice en la entrada elegida.
+    memset(entry, 0, sizeof(*entry));
+    strncpy(entry->dir_path, dir_path, sizeof(entry->dir_path) - 1);
+
+    const char *source = "pack";
+    bool ok = build_from_pack(entry);
+    if (!ok) {
+        source = "ANIM.chk";
+        ok = build_from_integrity(entry);
+    }
+#if CONFIG_DIYMON_ANIM_MANIFEST_PERSIST
+    if (!ok) {
+        source = "ANIM.idx";
+        ok = load_persisted(entry);
+    }
+#endif
+    if (!ok) {
+        source = "recorrido del directorio";
+        ok = build_from_dir_scan(entry);
+#if CONFIG_DIYMON_ANIM_MANIFEST_PERSIST
+        if (ok) save_persisted(entry);
+#endif
+    }
+    if (!ok) {
+        return NULL;
+    }
+
+    entry->generation = generation;
+    entry->last_use = ++s_use_clock;
+    entry->valid = true;
+    ESP_LOGI(TAG, "Índice de '%s' construido desde %s: IDLE=%u EAT=%u GYM=%u ATK=%u",
+             dir_path, source, entry->counts[0], entry->counts[1], entry->counts[2], entry->counts[3]);
+    return entry;
+}
+
+// --- Invalidación desde el servidor web ---
+
+// Se ejecuta en la tarea del servidor web con la ruta VFS del fichero modificado.
+static void on_web_fs_change(const char *vfs_path) {
+    s_generation++;
+
+#if CONFIG_DIYMON_ANIM_MANIFEST_PERSIST
+    char idx_path[160];
+    strncpy(idx_path, vfs_path, sizeof(idx_path) - 1);
+    idx_path[sizeof(idx_path) - 1] = '\0';
+    char *slash = strrchr(idx_path, '/');
+    if (slash && strstr(idx_path, "/diymon/")) {
+        snprintf(slash + 1, sizeof(idx_path) - (slash + 1 - idx_path), "%s", ANIM_MANIFEST_FILENAME);
+        unlink(idx_path);
+    }
+#endif
+    ESP_LOGD(TAG, "Cambio en '%s': índices de animación invalidados.", vfs_path);
+}
+
+// --- Funciones públicas ---
+
+void animation_manifest_init(void) {
+    web_server_add_fs_change_cb(on_web_fs_change);
+}
+
+void animation_manifest_preload(const char *dir_path) {
+    if (dir_path) get_entry(dir_path);
+}
+
+uint16_t animation_manifest_get_frame_count(const char *dir_path, const char *prefix) {
+    if (!dir_path || !prefix) return 0;
+
+    int slot = prefix_slot(prefix);
+    if (slot < 0) {
+        ESP_LOGW(TAG, "Prefijo '%s' no indexado.", prefix);
+        return 0;
+    }
+    manifest_entry_t *entry = get_entry(dir_path);
+    return entry ? entry->counts[slot] : 0;
+}
+
+void animation_manifest_invalidate_all(void) {
+    s_generation++;
+}
+
+uint32_t animation_manifest_get_generation(void) {
+    return s_generation;
+}
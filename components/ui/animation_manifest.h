@@ -0,0 +1,49 @@
+/* Fichero: components/ui/animation_manifest.h */
+/* Descripción: Interfaz del índice de fotogramas por directorio de evolución. El índice se construye una sola vez por directorio (desde la tabla del 'ANIM.pak', desde el índice 'ANIM.chk' de la comprobación de la SD, desde el manifiesto persistido 'ANIM.idx' o con un único recorrido del directorio) y responde al número de fotogramas de cada prefijo de acción sin enumerar la SD en el camino crítico. Se invalida cuando el servidor web sube o borra ficheros. */
+/* Último cambio: 18/10/2026 - 01:30 */
+#ifndef ANIMATION_MANIFEST_H
+#define ANIMATION_MANIFEST_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define ANIM_MANIFEST_FILENAME  "ANIM.idx"
+
+/**
+ * @brief Registra la invalidación del índice ante cambios de ficheros hechos por el servidor web.
+ */
+void animation_manifest_init(void);
+
+/**
+ * @brief Construye (si hace falta) el índice de un directorio, p.ej. en el arranque.
+ * @param dir_path Ruta LVGL del directorio de evolución (ej: "S:/diymon/0"), sin barra final.
+ */
+void animation_manifest_preload(const char *dir_path);
+
+/**
+ * @brief Devuelve el número de fotogramas de una secuencia usando el índice en caché.
+ *        Los fotogramas de la secuencia son '<dir_path>/<prefix><1..N>.bin' o las
+ *        entradas de la secuencia homónima del pack.
+ */
+uint16_t animation_manifest_get_frame_count(const char *dir_path, const char *prefix);
+
+/**
+ * @brief Descarta todos los índices en memoria.
+ */
+void animation_manifest_invalidate_all(void);
+
+/**
+ * @brief Contador que se incrementa con cada cambio de ficheros en la SD.
+ *        Permite a otros módulos (p.ej. el pack abierto) detectar que deben recargarse.
+ */
+uint32_t animation_manifest_get_generation(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // ANIMATION_MANIFEST_H
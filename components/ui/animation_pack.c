@@ -0,0 +1,726 @@
+/* Fichero: components/ui/animation_pack.c */
+/* Descripción: 'animation_pack_bin_payload_size' valida la cabecera de un '.bin' suelto del lienzo para el cargador y para la comprobación de la SD, de modo que los dos aceptan los mismos ficheros (también los que traen bytes sobrantes al final). Un fotograma RGB565A8 completo debe traer su plano alfa (stride*h + w*h bytes) y en RGB565 y RGB565A8 el stride no puede ser menor que w*2: si no, el cargador leería bytes del fotograma siguiente. Secuencias premezcladas. Una secuencia marcada con ANIM_PACK_SEQ_FLAG_PREBLENDED solo puede tener fotogramas RGB565 sin paleta y exige una firma de fondo en la cabecera. 'animation_pack_find_seq' la elige en lugar de la RGB565A8 del mismo prefijo cuando la firma del pack coincide con la del fondo en pantalla, fijada por la UI con 'animation_pack_set_background_signature'; si no coincide (otro fondo u otra posición del lienzo) o la UI no la ha fijado, se usa la normal, así que un pack premezclado funciona con cualquier fondo. Orden de bytes. La cabecera del pack declara con ANIM_PACK_HDR_FLAG_BIG_ENDIAN si sus colores RGB565 están en el orden del panel; un pack en el orden contrario al del firmware se rechaza al abrirlo (desde la SD o desde la imagen en flash) con un aviso para regenerarlo, en lugar de mostrarse con los colores cambiados. Los fotogramas se siguen copiando o apuntando tal cual: el orden ya es el de los búferes de LVGL. Packs en memoria. 'animation_pack_open_mapped' abre la imagen de un pack autocontenido (la copia de la partición de assets, mapeada en flash) con la misma validación de tablas que uno de la SD. En ese caso las lecturas de payloads, de payloads almacenados y de rangos de filas copian desde la imagen en lugar de pasar por lv_fs, y los fotogramas comprimidos se descomprimen directamente desde ella. Un fotograma RAW completo y sin paleta ('animation_pack_frame_is_direct') ya es la imagen LVGL: el cargador apunta su descriptor al payload mapeado sin copiarlo. */
+/* Último cambio: 18/10/2026 - 05:15 */
+#include "animation_pack.h"
+#include "esp_log.h"
+#if LV_USE_LZ4_INTERNAL
+#include "src/libs/lz4/lz4.h"
+#elif LV_USE_LZ4_EXTERNAL
+#include <lz4.h>
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char *TAG = "ANIM_PACK";
+
+// Firma del fondo bajo el lienzo de animación (0 = no usar secuencias premezcladas).
+static volatile uint32_t s_bg_signature = 0;
+
+// Lee exactamente 'len' bytes desde la posición actual del fichero.
+static bool read_exact(lv_fs_file_t *f, void *dst, uint32_t len) {
+    uint32_t bytes_read = 0;
+    lv_fs_res_t res = lv_fs_read(f, dst, len, &bytes_read);
+    return res == LV_FS_RES_OK && bytes_read == len;
+}
+
+// --- Descompresión RLE en streaming ---
+// Formato de lv_rle: byte de control; con el bit 7 activo le siguen (ctrl & 0x7F) bloques
+// literales, si no, un bloque que se repite 'ctrl' veces.
+
+typedef enum {
+    RLE_CTRL,
+    RLE_LITERAL,
+    RLE_REPEAT,
+} rle_state_t;
+
+typedef struct {
+    uint8_t *out;
+    uint32_t out_len;
+    uint32_t out_cap;
+    rle_state_t state;
+    uint32_t pending;           // Bytes literales que faltan o repeticiones del bloque.
+    uint8_t blk[4];
+    uint8_t blk_fill;
+    uint8_t blk_size;
+} rle_stream_t;
+
+// Procesa un bloque de entrada. Devuelve false si la salida desborda.
+static bool rle_stream_feed(rle_stream_t *st, const uint8_t *in, uint32_t len) {
+    const uint8_t *end = in + len;
+    while (in < end) {
+        switch (st->state) {
+            case RLE_CTRL: {
+                uint8_t ctrl = *in++;
+                if (ctrl & 0x80) {
+                    st->pending = (uint32_t)st->blk_size * (ctrl & 0x7F);
+                    st->state = RLE_LITERAL;
+                } else {
+                    st->pending = ctrl;
+                    st->blk_fill = 0;
+                    st->state = RLE_REPEAT;
+                }
+                break;
+            }
+            case RLE_LITERAL: {
+                uint32_t n = (uint32_t)(end - in);
+                if (n > st->pending) n = st->pending;
+                if (st->out_len + n > st->out_cap) return false;
+                memcpy(st->out + st->out_len, in, n);
+                st->out_len += n;
+                st->pending -= n;
+                in += n;
+                if (st->pending == 0) st->state = RLE_CTRL;
+                break;
+            }
+            case RLE_REPEAT: {
+                st->blk[st->blk_fill++] = *in++;
+                if (st->blk_fill < st->blk_size) break;
+
+                uint32_t bytes = st->pending * st->blk_size;
+                if (st->out_len + bytes > st->out_cap) return false;
+                uint8_t *o = st->out + st->out_len;
+                if (st->blk_size == 2 && st->blk[0] == st->blk[1]) {
+                    memset(o, st->blk[0], bytes); // Caso típico: píxeles transparentes a cero.
+                } else {
+                    for (uint32_t i = 0; i < st->pending; i++, o += st->blk_size) {
+                        memcpy(o, st->blk, st->blk_size);
+                    }
+                }
+                st->out_len += bytes;
+                st->state = RLE_CTRL;
+                break;
+            }
+        }
+    }
+    return true;
+}
+
+static uint8_t rle_block_size(const animation_pack_frame_t *frame) {
+    if (frame->encoding & ANIM_PACK_FLAG_DELTA) return 1;
+    // Igual que el decodificador de LVGL: RGB565A8 se comprime en bloques de 2 bytes.
+    if (frame->cf == LV_COLOR_FORMAT_RGB565A8) return 2;
+    uint8_t blk = (lv_color_format_get_bpp(frame->cf) + 7) >> 3;
+    return (blk == 0 || blk > 4) ? 1 : blk;
+}
+
+// Búfer de lectura del streaming. El cargador serializa las lecturas, así que basta uno.
+static uint8_t s_stream_chunk[ANIM_PACK_STREAM_CHUNK];
+
+static bool read_frame_rle(animation_pack_t *pack, const animation_pack_frame_t *frame, uint8_t *dst) {
+    rle_stream_t st = {
+        .out = dst,
+        .out_cap = frame->raw_size,
+        .state = RLE_CTRL,
+        .blk_size = rle_block_size(frame),
+    };
+
+    uint32_t remaining = frame->size;
+    while (remaining > 0) {
+        uint32_t n = remaining < sizeof(s_stream_chunk) ? remaining : sizeof(s_stream_chunk);
+        if (!read_exact(&pack->file, s_stream_chunk, n)) {
+            ESP_LOGW(TAG, "Lectura incompleta del fotograma RLE en offset %lu.", (unsigned long)frame->offset);
+            return false;
+        }
+        if (!rle_stream_feed(&st, s_stream_chunk, n)) {
+            ESP_LOGE(TAG, "RLE corrupto en offset %lu: desborda %lu bytes.", (unsigned long)frame->offset, (unsigned long)frame->raw_size);
+            return false;
+        }
+        remaining -= n;
+    }
+
+    if (st.out_len != frame->raw_size || st.state != RLE_CTRL) {
+        ESP_LOGE(TAG, "RLE incompleto en offset %lu: %lu de %lu bytes.",
+                 (unsigned long)frame->offset, (unsigned long)st.out_len, (unsigned long)frame->raw_size);
+        return false;
+    }
+    return true;
+}
+
+static bool read_frame_lz4(animation_pack_t *pack, const animation_pack_frame_t *frame, uint8_t *dst, uint32_t dst_size) {
+#if LV_USE_LZ4
+    // Descompresión in situ: el bloque comprimido se coloca al final del búfer y la
+    // salida avanza desde el principio sin alcanzarlo gracias al margen.
+    uint32_t margin = (frame->size >> 8) + 32;
+    if ((uint64_t)frame->raw_size + margin > dst_size || frame->size > dst_size) {
+        ESP_LOGE(TAG, "Búfer de %lu bytes insuficiente para descomprimir LZ4 in situ (%lu + %lu).",
+                 (unsigned long)dst_size, (unsigned long)frame->raw_size, (unsigned long)margin);
+        return false;
+    }
+    uint8_t *src = dst + dst_size - frame->size;
+    if (!read_exact(&pack->file, src, frame->size)) {
+        ESP_LOGW(TAG, "Lectura incompleta del fotograma LZ4 en offset %lu.", (unsigned long)frame->offset);
+        return false;
+    }
+    int len = LZ4_decompress_safe((const char *)src, (char *)dst, (int)frame->size, (int)frame->raw_size);
+    if (len < 0 || (uint32_t)len != frame->raw_size) {
+        ESP_LOGE(TAG, "LZ4 corrupto en offset %lu (resultado %d).", (unsigned long)frame->offset, len);
+        return false;
+    }
+    return true;
+#else
+    ESP_LOGE(TAG, "Fotograma LZ4 en el pack pero CONFIG_LV_USE_LZ4 está desactivado.");
+    return false;
+#endif
+}
+
+// Decodifica un payload completo que ya está en memoria ('src' no solapa con 'dst').
+static bool decode_payload(const animation_pack_frame_t *frame, const uint8_t *src, uint8_t *dst, uint32_t dst_size) {
+    if (frame->raw_size > dst_size) {
+        ESP_LOGE(TAG, "Fotograma de %lu bytes no cabe en el búfer de %lu bytes.",
+                 (unsigned long)frame->raw_size, (unsigned long)dst_size);
+        return false;
+    }
+
+    switch (frame->encoding & ANIM_PACK_ENC_MASK) {
+        case ANIM_PACK_ENC_RLE: {
+            rle_stream_t st = {
+                .out = dst,
+                .out_cap = frame->raw_size,
+                .state = RLE_CTRL,
+                .blk_size = rle_block_size(frame),
+            };
+            if (!rle_stream_feed(&st, src, frame->size) || st.out_len != frame->raw_size || st.state != RLE_CTRL) {
+                ESP_LOGE(TAG, "RLE corrupto en offset %lu.", (unsigned long)frame->offset);
+                return false;
+            }
+            return true;
+        }
+        case ANIM_PACK_ENC_LZ4: {
+#if LV_USE_LZ4
+            int len = LZ4_decompress_safe((const char *)src, (char *)dst, (int)frame->size, (int)frame->raw_size);
+            if (len < 0 || (uint32_t)len != frame->raw_size) {
+                ESP_LOGE(TAG, "LZ4 corrupto en offset %lu (resultado %d).", (unsigned long)frame->offset, len);
+                return false;
+            }
+            return true;
+#else
+            ESP_LOGE(TAG, "Fotograma LZ4 en el pack pero CONFIG_LV_USE_LZ4 está desactivado.");
+            return false;
+#endif
+        }
+        default:
+            memcpy(dst, src, frame->size);
+            return true;
+    }
+}
+
+// Sustituye el fichero del pack por el almacén compartido y devuelve su tamaño en 'file_size'.
+static bool open_store(animation_pack_t *pack, const char *dir_path, uint32_t *file_size) {
+    char store_path[128];
+    const char *slash = strrchr(dir_path, '/');
+    int parent_len = slash ? (int)(slash - dir_path) : 0;
+    snprintf(store_path, sizeof(store_path), "%.*s/%s", parent_len, dir_path, ANIM_STORE_FILENAME);
+
+    lv_fs_close(&pack->file);
+    memset(&pack->file, 0, sizeof(pack->file));
+    if (lv_fs_open(&pack->file, store_path, LV_FS_MODE_RD) != LV_FS_RES_OK) {
+        ESP_LOGE(TAG, "El pack de '%s' necesita el almacén '%s', que no existe.", dir_path, store_path);
+        memset(&pack->file, 0, sizeof(pack->file));
+        return false;
+    }
+
+    animation_store_header_t store;
+    if (!read_exact(&pack->file, &store, sizeof(store)) || store.magic != ANIM_STORE_MAGIC || store.version != ANIM_STORE_VERSION) {
+        ESP_LOGE(TAG, "Cabecera de almacén inválida en '%s'.", store_path);
+        return false;
+    }
+    if (store.store_id != pack->header.store_id || store.payload_align != pack->header.payload_align) {
+        ESP_LOGE(TAG, "El pack de '%s' se generó para el almacén %08lx y '%s' es el %08lx. Regenera los packs.",
+                 dir_path, (unsigned long)pack->header.store_id, store_path, (unsigned long)store.store_id);
+        return false;
+    }
+
+    lv_fs_seek(&pack->file, 0, LV_FS_SEEK_END);
+    lv_fs_tell(&pack->file, file_size);
+    ESP_LOGD(TAG, "Almacén '%s': %lu payloads, %lu bytes.", store_path, (unsigned long)store.payload_count, (unsigned long)*file_size);
+    return true;
+}
+
+static bool validate_tables(const animation_pack_t *pack, uint32_t file_size) {
+    const animation_pack_header_t *hdr = &pack->header;
+
+    for (uint16_t i = 0; i < hdr->seq_count; i++) {
+        const animation_pack_seq_t *seq = &pack->seqs[i];
+        if ((uint32_t)seq->first_frame + seq->frame_count > hdr->frame_count) {
+            ESP_LOGE(TAG, "Secuencia %d fuera de la tabla de fotogramas.", i);
+            return false;
+        }
+        if (seq->palette != ANIM_PACK_NO_PALETTE && seq->palette >= hdr->palette_count) {
+            ESP_LOGE(TAG, "Secuencia %d con paleta %d inexistente.", i, seq->palette);
+            return false;
+        }
+        if ((seq->flags & ~ANIM_PACK_SEQ_FLAG_PREBLENDED) ||
+            ((seq->flags & ANIM_PACK_SEQ_FLAG_PREBLENDED) && (hdr->bg_signature == 0 || seq->palette != ANIM_PACK_NO_PALETTE))) {
+            ESP_LOGE(TAG, "Secuencia %d con opciones 0x%04x inválidas.", i, seq->flags);
+            return false;
+        }
+    }
+
+    for (uint16_t i = 0; i < hdr->frame_count; i++) {
+        const animation_pack_frame_t *fr = &pack->frames[i];
+        if (fr->size == 0 || fr->offset > file_size || fr->size > file_size - fr->offset) {
+            ESP_LOGE(TAG, "Fotograma %d fuera de los límites del fichero de payloads (offset %lu, tamaño %lu).",
+                     i, (unsigned long)fr->offset, (unsigned long)fr->size);
+            return false;
+        }
+        uint8_t enc = fr->encoding & ANIM_PACK_ENC_MASK;
+        bool delta = fr->encoding & ANIM_PACK_FLAG_DELTA;
+        bool rgb565 = fr->cf == LV_COLOR_FORMAT_RGB565 || fr->cf == LV_COLOR_FORMAT_RGB565A8;
+        if (rgb565 && fr->stride < fr->w * 2) {
+            ESP_LOGE(TAG, "Fotograma %d con stride %d menor que su ancho (%d px).", i, fr->stride, fr->w);
+            return false;
+        }
+        // Un fotograma completo trae el plano de color y, en RGB565A8, el alfa (w*h) detrás: el cargador y el
+        // descriptor mapeado en flash leen ese alfa, así que un payload más corto invadiría el siguiente.
+        uint32_t min_raw = (uint32_t)fr->stride * fr->h + (fr->cf == LV_COLOR_FORMAT_RGB565A8 ? (uint32_t)fr->w * fr->h : 0);
+        if ((!delta && fr->raw_size < min_raw) || (enc == ANIM_PACK_ENC_RAW && fr->size != fr->raw_size)) {
+            ESP_LOGE(TAG, "Fotograma %d truncado: %lu bytes para %dx%d.", i, (unsigned long)fr->raw_size, fr->w, fr->h);
+            return false;
+        }
+        if (enc > ANIM_PACK_ENC_LZ4 || (fr->encoding & ~(ANIM_PACK_ENC_MASK | ANIM_PACK_FLAG_DELTA))) {
+            ESP_LOGE(TAG, "Fotograma %d con codificación 0x%02x desconocida.", i, fr->encoding);
+            return false;
+        }
+        if (fr->cf == LV_COLOR_FORMAT_I8 && (fr->stride != fr->w * 2 || (!delta && fr->raw_size < (uint32_t)fr->w * fr->h * 2))) {
+            ESP_LOGE(TAG, "Fotograma indexado %d con geometría inválida (%dx%d, stride %d).", i, fr->w, fr->h, fr->stride);
+            return false;
+        }
+        if (fr->w == 0 || fr->h == 0 || (uint32_t)fr->x + fr->w > hdr->canvas_w || (uint32_t)fr->y + fr->h > hdr->canvas_h) {
+            ESP_LOGE(TAG, "Recorte del fotograma %d (%d,%d %dx%d) fuera del lienzo %dx%d.",
+                     i, fr->x, fr->y, fr->w, fr->h, hdr->canvas_w, hdr->canvas_h);
+            return false;
+        }
+    }
+
+    for (uint16_t i = 0; i < hdr->seq_count; i++) {
+        const animation_pack_seq_t *seq = &pack->seqs[i];
+        if (seq->frame_count > 0 && (pack->frames[seq->first_frame].encoding & ANIM_PACK_FLAG_DELTA)) {
+            ESP_LOGE(TAG, "La secuencia %d no empieza por un fotograma clave.", i);
+            return false;
+        }
+        for (uint16_t f = 0; f < seq->frame_count; f++) {
+            const animation_pack_frame_t *fr = &pack->frames[seq->first_frame + f];
+            if (fr->cf == LV_COLOR_FORMAT_I8 && seq->palette == ANIM_PACK_NO_PALETTE) {
+                ESP_LOGE(TAG, "Fotograma indexado %d en la secuencia %d sin paleta.", f, i);
+                return false;
+            }
+            if ((seq->flags & ANIM_PACK_SEQ_FLAG_PREBLENDED) && (fr->cf != LV_COLOR_FORMAT_RGB565 || fr->stride != fr->w * 2)) {
+                ESP_LOGE(TAG, "Fotograma %d de la secuencia premezclada %d no es RGB565.", f, i);
+                return false;
+            }
+            if (f == 0) continue;
+            const animation_pack_frame_t *prev = fr - 1;
+            if ((fr->encoding & ANIM_PACK_FLAG_DELTA) &&
+                (fr->x != prev->x || fr->y != prev->y || fr->w != prev->w || fr->h != prev->h || fr->stride != prev->stride ||
+                 fr->cf != prev->cf)) {
+                ESP_LOGE(TAG, "Delta %d de la secuencia %d con un recorte distinto al del fotograma anterior.", f, i);
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// Los colores del pack se entregan a LVGL sin convertir: su orden de bytes debe ser el del firmware.
+static bool byte_order_ok(const animation_pack_header_t *hdr, const char *path) {
+    if ((hdr->flags & ANIM_PACK_HDR_FLAG_BIG_ENDIAN) == ANIM_PACK_NATIVE_HDR_FLAGS) return true;
+    ESP_LOGE(TAG, "Pack '%s' con RGB565 %s y firmware en %s: hay que regenerarlo%s.", path,
+             (hdr->flags & ANIM_PACK_HDR_FLAG_BIG_ENDIAN) ? "big-endian" : "little-endian",
+             ANIM_PACK_NATIVE_HDR_FLAGS ? "big-endian" : "little-endian",
+             ANIM_PACK_NATIVE_HDR_FLAGS ? " con 'anim_pack.py --big-endian'" : " sin '--big-endian'");
+    return false;
+}
+
+animation_pack_t* animation_pack_open(const char *dir_path) {
+    if (!dir_path) return NULL;
+
+    char full_path[128];
+    snprintf(full_path, sizeof(full_path), "%s/%s", dir_path, ANIM_PACK_FILENAME);
+
+    animation_pack_t *pack = calloc(1, sizeof(animation_pack_t));
+    if (!pack) return NULL;
+
+    if (lv_fs_open(&pack->file, full_path, LV_FS_MODE_RD) != LV_FS_RES_OK) {
+        ESP_LOGD(TAG, "No hay pack en '%s'.", dir_path);
+        free(pack);
+        return NULL;
+    }
+
+    uint32_t file_size = 0;
+    lv_fs_seek(&pack->file, 0, LV_FS_SEEK_END);
+    lv_fs_tell(&pack->file, &file_size);
+    lv_fs_seek(&pack->file, 0, LV_FS_SEEK_SET);
+
+    animation_pack_header_t *hdr = &pack->header;
+    if (!read_exact(&pack->file, hdr, sizeof(*hdr)) || hdr->magic != ANIM_PACK_MAGIC) {
+        ESP_LOGE(TAG, "Cabecera de pack inválida en '%s'.", full_path);
+        goto fail;
+    }
+    if (hdr->version != ANIM_PACK_VERSION) {
+        ESP_LOGE(TAG, "Versión de pack %d no soportada en '%s' (esperada %d).", hdr->version, full_path, ANIM_PACK_VERSION);
+        goto fail;
+    }
+    if (hdr->flags & ~(ANIM_PACK_HDR_FLAG_STORE | ANIM_PACK_HDR_FLAG_BIG_ENDIAN)) {
+        ESP_LOGE(TAG, "Pack '%s' con opciones 0x%04x desconocidas.", full_path, hdr->flags);
+        goto fail;
+    }
+    if (!byte_order_ok(hdr, full_path)) {
+        goto fail;
+    }
+
+    size_t seq_bytes = (size_t)hdr->seq_count * sizeof(animation_pack_seq_t);
+    size_t frame_bytes = (size_t)hdr->frame_count * sizeof(animation_pack_frame_t);
+    size_t palette_bytes = (size_t)hdr->palette_count * ANIM_PACK_PALETTE_SIZE * sizeof(uint16_t);
+    pack->seqs = malloc(seq_bytes ? seq_bytes : 1);
+    pack->frames = malloc(frame_bytes ? frame_bytes : 1);
+    pack->palettes = malloc(palette_bytes ? palette_bytes : 1);
+    if (!pack->seqs || !pack->frames || !pack->palettes) {
+        ESP_LOGE(TAG, "Sin memoria para las tablas del pack (%u fotogramas).", hdr->frame_count);
+        goto fail;
+    }
+
+    if (!read_exact(&pack->file, pack->seqs, seq_bytes) || !read_exact(&pack->file, pack->frames, frame_bytes) ||
+        !read_exact(&pack->file, pack->palettes, palette_bytes)) {
+        ESP_LOGE(TAG, "Tablas de pack truncadas en '%s'.", full_path);
+        goto fail;
+    }
+    if ((hdr->flags & ANIM_PACK_HDR_FLAG_STORE) && !open_store(pack, dir_path, &file_size)) {
+        goto fail;
+    }
+    if (!validate_tables(pack, file_size)) {
+        goto fail;
+    }
+
+    pack->dir_path = strdup(dir_path);
+    ESP_LOGI(TAG, "Pack abierto: '%s' (%d secuencias, %d fotogramas, %lu bytes%s%s).",
+             full_path, hdr->seq_count, hdr->frame_count, (unsigned long)file_size,
+             (hdr->flags & ANIM_PACK_HDR_FLAG_STORE) ? " en el almacén" : "",
+             !hdr->bg_signature ? "" : animation_pack_uses_preblended(pack) ? ", premezclado" : ", premezclado para otro fondo");
+    return pack;
+
+fail:
+    animation_pack_close(pack);
+    return NULL;
+}
+
+animation_pack_t* animation_pack_open_mapped(const char *dir_path, const uint8_t *data, uint32_t size) {
+    if (!dir_path || !data || size < sizeof(animation_pack_header_t)) return NULL;
+
+    animation_pack_t *pack = calloc(1, sizeof(animation_pack_t));
+    if (!pack) return NULL;
+    pack->mapped = data;
+    pack->mapped_size = size;
+
+    animation_pack_header_t *hdr = &pack->header;
+    memcpy(hdr, data, sizeof(*hdr));
+    if (hdr->magic != ANIM_PACK_MAGIC || hdr->version != ANIM_PACK_VERSION ||
+        (hdr->flags & ~ANIM_PACK_HDR_FLAG_BIG_ENDIAN) != 0) {
+        ESP_LOGE(TAG, "Imagen de pack inválida para '%s' (versión %d, opciones 0x%04x).", dir_path, hdr->version, hdr->flags);
+        goto fail;
+    }
+    if (!byte_order_ok(hdr, dir_path)) {
+        goto fail;
+    }
+
+    size_t seq_bytes = (size_t)hdr->seq_count * sizeof(animation_pack_seq_t);
+    size_t frame_bytes = (size_t)hdr->frame_count * sizeof(animation_pack_frame_t);
+    size_t palette_bytes = (size_t)hdr->palette_count * ANIM_PACK_PALETTE_SIZE * sizeof(uint16_t);
+    if (sizeof(*hdr) + seq_bytes + frame_bytes + palette_bytes > size) {
+        ESP_LOGE(TAG, "Tablas de la imagen de pack de '%s' truncadas.", dir_path);
+        goto fail;
+    }
+    // Las tablas se copian a RAM como en un pack de la SD; los payloads se quedan en la imagen.
+    pack->seqs = malloc(seq_bytes ? seq_bytes : 1);
+    pack->frames = malloc(frame_bytes ? frame_bytes : 1);
+    pack->palettes = malloc(palette_bytes ? palette_bytes : 1);
+    if (!pack->seqs || !pack->frames || !pack->palettes) {
+        ESP_LOGE(TAG, "Sin memoria para las tablas del pack (%u fotogramas).", hdr->frame_count);
+        goto fail;
+    }
+    const uint8_t *p = data + sizeof(*hdr);
+    memcpy(pack->seqs, p, seq_bytes);
+    memcpy(pack->frames, p + seq_bytes, frame_bytes);
+    memcpy(pack->palettes, p + seq_bytes + frame_bytes, palette_bytes);
+    if (!validate_tables(pack, size)) {
+        goto fail;
+    }
+
+    pack->dir_path = strdup(dir_path);
+    ESP_LOGI(TAG, "Pack de '%s' abierto desde memoria (%d secuencias, %d fotogramas, %lu bytes%s).",
+             dir_path, hdr->seq_count, hdr->frame_count, (unsigned long)size,
+             !hdr->bg_signature ? "" : animation_pack_uses_preblended(pack) ? ", premezclado" : ", premezclado para otro fondo");
+    return pack;
+
+fail:
+    animation_pack_close(pack);
+    return NULL;
+}
+
+void animation_pack_close(animation_pack_t *pack) {
+    if (!pack) return;
+    if (pack->file.drv) {
+        lv_fs_close(&pack->file);
+    }
+    free(pack->seqs);
+    free(pack->frames);
+    free(pack->palettes);
+    free(pack->dir_path);
+    free(pack);
+}
+
+bool animation_pack_uses_store(const animation_pack_t *pack) {
+    return pack && (pack->header.flags & ANIM_PACK_HDR_FLAG_STORE);
+}
+
+void animation_pack_set_background_signature(uint32_t signature) {
+    s_bg_signature = signature;
+}
+
+bool animation_pack_uses_preblended(const animation_pack_t *pack) {
+    return pack && pack->header.bg_signature != 0 && pack->header.bg_signature == s_bg_signature;
+}
+
+const animation_pack_seq_t* animation_pack_find_seq(const animation_pack_t *pack, const char *prefix) {
+    if (!pack || !prefix) return NULL;
+    // La premezclada va detrás de la normal; sin ella (o con otro fondo) se usa la normal.
+    bool preblended = animation_pack_uses_preblended(pack);
+    const animation_pack_seq_t *found = NULL;
+    for (uint16_t i = 0; i < pack->header.seq_count; i++) {
+        const animation_pack_seq_t *seq = &pack->seqs[i];
+        if (strncmp(seq->prefix, prefix, ANIM_PACK_PREFIX_LEN) != 0) continue;
+        bool seq_preblended = (seq->flags & ANIM_PACK_SEQ_FLAG_PREBLENDED) != 0;
+        if (seq_preblended == preblended) return seq;
+        if (!seq_preblended) found = seq;
+    }
+    return found;
+}
+
+const animation_pack_frame_t* animation_pack_get_frame(const animation_pack_t *pack, const animation_pack_seq_t *seq, uint16_t index) {
+    if (!pack || !seq || index >= seq->frame_count) return NULL;
+    return &pack->frames[seq->first_frame + index];
+}
+
+const uint16_t* animation_pack_get_palette(const animation_pack_t *pack, const animation_pack_seq_t *seq) {
+    if (!pack || !seq || seq->palette == ANIM_PACK_NO_PALETTE || seq->palette >= pack->header.palette_count) return NULL;
+    return &pack->palettes[(size_t)seq->palette * ANIM_PACK_PALETTE_SIZE];
+}
+
+// Expande in situ 'px' índices que empiezan en dst + px al plano de color RGB565 en dst.
+// El píxel i se escribe en [2i, 2i + 1] y su índice está en px + i >= 2i + 1: nunca se pisa
+// un índice que quede por leer.
+static void expand_indexed(uint8_t *dst, uint32_t px, const uint16_t *palette) {
+    const uint8_t *idx = dst + px;
+    for (uint32_t i = 0; i < px; i++) {
+        uint16_t c = palette[idx[i]];
+        dst[2 * i] = (uint8_t)c;
+        dst[2 * i + 1] = (uint8_t)(c >> 8);
+    }
+}
+
+static bool read_payload(animation_pack_t *pack, const animation_pack_frame_t *frame, uint8_t *dst, uint32_t dst_size) {
+    if (pack->mapped) {
+        return decode_payload(frame, pack->mapped + frame->offset, dst, dst_size);
+    }
+    if (frame->raw_size > dst_size) {
+        ESP_LOGE(TAG, "Fotograma de %lu bytes no cabe en el búfer de %lu bytes.",
+                 (unsigned long)frame->raw_size, (unsigned long)dst_size);
+        return false;
+    }
+    if (lv_fs_seek(&pack->file, frame->offset, LV_FS_SEEK_SET) != LV_FS_RES_OK) {
+        return false;
+    }
+
+    switch (frame->encoding & ANIM_PACK_ENC_MASK) {
+        case ANIM_PACK_ENC_RLE:
+            return read_frame_rle(pack, frame, dst); // Capacidad ya comprobada arriba.
+        case ANIM_PACK_ENC_LZ4:
+            return read_frame_lz4(pack, frame, dst, dst_size);
+        default:
+            break;
+    }
+
+    if (!read_exact(&pack->file, dst, frame->size)) {
+        ESP_LOGW(TAG, "Lectura incompleta del fotograma en offset %lu.", (unsigned long)frame->offset);
+        return false;
+    }
+    return true;
+}
+
+bool animation_pack_read_frame(animation_pack_t *pack, const animation_pack_frame_t *frame, const uint16_t *palette,
+                               uint8_t *dst, uint32_t dst_size) {
+    if (!pack || !frame || !dst) return false;
+    if (frame->cf != LV_COLOR_FORMAT_I8 || (frame->encoding & ANIM_PACK_FLAG_DELTA)) {
+        return read_payload(pack, frame, dst, dst_size);
+    }
+
+    // Índices + alfa se colocan a partir de dst + w*h: el alfa queda ya tras el plano de color.
+    uint32_t px = (uint32_t)frame->w * frame->h;
+    if (!palette || dst_size < px * 3) {
+        ESP_LOGE(TAG, "Fotograma indexado sin paleta o búfer de %lu bytes insuficiente.", (unsigned long)dst_size);
+        return false;
+    }
+    if (!read_payload(pack, frame, dst + px, dst_size - px)) return false;
+    expand_indexed(dst, px, palette);
+    return true;
+}
+
+const uint8_t* animation_pack_get_mapped_payload(const animation_pack_t *pack, const animation_pack_frame_t *frame) {
+    if (!pack || !pack->mapped || !frame) return NULL;
+    return pack->mapped + frame->offset; // Dentro de la imagen (validado al abrir el pack).
+}
+
+bool animation_pack_frame_is_direct(const animation_pack_frame_t *frame) {
+    return frame && frame->encoding == ANIM_PACK_ENC_RAW && frame->cf != LV_COLOR_FORMAT_I8 && (frame->offset & 3) == 0;
+}
+
+bool animation_pack_read_stored(animation_pack_t *pack, const animation_pack_frame_t *frame, uint8_t *dst) {
+    if (!pack || !frame || !dst) return false;
+    if (pack->mapped) {
+        memcpy(dst, pack->mapped + frame->offset, frame->size);
+        return true;
+    }
+    if (lv_fs_seek(&pack->file, frame->offset, LV_FS_SEEK_SET) != LV_FS_RES_OK || !read_exact(&pack->file, dst, frame->size)) {
+        ESP_LOGW(TAG, "Lectura incompleta del fotograma en offset %lu.", (unsigned long)frame->offset);
+        return false;
+    }
+    return true;
+}
+
+bool animation_pack_decode_frame(const animation_pack_frame_t *frame, const uint16_t *palette, const uint8_t *stored,
+                                 uint8_t *dst, uint32_t dst_size) {
+    if (!frame || !stored || !dst) return false;
+    if (frame->cf != LV_COLOR_FORMAT_I8 || (frame->encoding & ANIM_PACK_FLAG_DELTA)) {
+        return decode_payload(frame, stored, dst, dst_size);
+    }
+
+    // Misma disposición que al leer de la SD: índices + alfa a partir de dst + w*h.
+    uint32_t px = (uint32_t)frame->w * frame->h;
+    if (!palette || dst_size < px * 3) {
+        ESP_LOGE(TAG, "Fotograma indexado sin paleta o búfer de %lu bytes insuficiente.", (unsigned long)dst_size);
+        return false;
+    }
+    if (!decode_payload(frame, stored, dst + px, dst_size - px)) return false;
+    expand_indexed(dst, px, palette);
+    return true;
+}
+
+bool animation_pack_apply_delta(const animation_pack_frame_t *frame, const uint16_t *palette, const uint8_t *delta,
+                                uint8_t *dst, uint32_t dst_size,
+                                lv_area_t *areas, uint8_t max_areas, uint8_t *area_count) {
+    if (area_count) *area_count = 0;
+    if (!frame || !delta || !dst || frame->raw_size < sizeof(animation_pack_delta_header_t)) return false;
+
+    const animation_pack_delta_header_t *hdr = (const animation_pack_delta_header_t *)delta;
+    const uint8_t *end = delta + frame->raw_size;
+    const uint8_t *p = delta + sizeof(*hdr) + (size_t)hdr->rect_count * sizeof(animation_pack_delta_rect_t);
+    if (p > end) {
+        ESP_LOGE(TAG, "Delta con tabla de rectángulos truncada.");
+        return false;
+    }
+
+    // Geometría de los planos: color con 'stride' y, en RGB565A8, alfa de 1 byte por píxel tras el color.
+    // En I8 el destino es RGB565A8 y el delta trae 1 byte (índice) por píxel de color.
+    bool indexed = frame->cf == LV_COLOR_FORMAT_I8;
+    if (indexed && !palette) return false;
+    bool has_alpha_plane = indexed || frame->cf == LV_COLOR_FORMAT_RGB565A8;
+    uint32_t px_bytes = has_alpha_plane ? 2 : (lv_color_format_get_bpp(frame->cf) + 7) >> 3;
+    uint32_t src_px_bytes = indexed ? 1 : px_bytes;
+    uint32_t color_plane = (uint32_t)frame->stride * frame->h;
+    uint32_t alpha_stride = frame->w;
+    if (color_plane + (has_alpha_plane ? alpha_stride * frame->h : 0) > dst_size) return false;
+
+    const animation_pack_delta_rect_t *rects = (const animation_pack_delta_rect_t *)(delta + sizeof(*hdr));
+    for (uint16_t i = 0; i < hdr->rect_count; i++) {
+        animation_pack_delta_rect_t r;
+        memcpy(&r, &rects[i], sizeof(r));
+        if (r.w == 0 || r.h == 0 || (uint32_t)r.x + r.w > frame->w || (uint32_t)r.y + r.h > frame->h) {
+            ESP_LOGE(TAG, "Rectángulo %d del delta fuera del fotograma.", i);
+            return false;
+        }
+
+        uint32_t row_bytes = r.w * src_px_bytes;
+        uint32_t rect_bytes = row_bytes * r.h + (has_alpha_plane ? (uint32_t)r.w * r.h : 0);
+        if ((uint32_t)(end - p) < rect_bytes) {
+            ESP_LOGE(TAG, "Píxeles del delta truncados en el rectángulo %d.", i);
+            return false;
+        }
+
+        for (uint16_t y = 0; y < r.h; y++, p += row_bytes) {
+            uint8_t *row = dst + (uint32_t)(r.y + y) * frame->stride + r.x * px_bytes;
+            if (indexed) {
+                for (uint16_t x = 0; x < r.w; x++) {
+                    uint16_t c = palette[p[x]];
+                    row[2 * x] = (uint8_t)c;
+                    row[2 * x + 1] = (uint8_t)(c >> 8);
+                }
+            } else {
+                memcpy(row, p, row_bytes);
+            }
+        }
+        if (has_alpha_plane) {
+            for (uint16_t y = 0; y < r.h; y++, p += r.w) {
+                memcpy(dst + color_plane + (uint32_t)(r.y + y) * alpha_stride + r.x, p, r.w);
+            }
+        }
+
+        if (areas && area_count && max_areas > 0) {
+            lv_area_t a = { r.x, r.y, r.x + r.w - 1, r.y + r.h - 1 };
+            if (*area_count < max_areas) {
+                areas[(*area_count)++] = a;
+            } else {
+                lv_area_t *last = &areas[max_areas - 1];
+                _lv_area_join(last, last, &a);
+            }
+        }
+    }
+    return true;
+}
+
+uint32_t animation_pack_bin_payload_size(const lv_image_header_t *header, uint16_t w, uint16_t h) {
+    if (!header || header->magic != LV_IMAGE_HEADER_MAGIC || header->cf != LV_COLOR_FORMAT_RGB565A8 ||
+        header->w != w || header->h != h || header->stride != w * 2) {
+        return 0;
+    }
+    return (uint32_t)header->stride * header->h + (uint32_t)header->w * header->h;
+}
+
+bool animation_pack_frame_has_row_access(const animation_pack_frame_t *frame) {
+    return frame && frame->encoding == ANIM_PACK_ENC_RAW &&
+           (frame->cf == LV_COLOR_FORMAT_RGB565A8 || frame->cf == LV_COLOR_FORMAT_I8) && frame->stride == frame->w * 2;
+}
+
+bool animation_pack_read_rows(animation_pack_t *pack, const animation_pack_frame_t *frame, const uint16_t *palette,
+                              uint16_t y, uint16_t rows, uint8_t *dst, uint32_t dst_size) {
+    if (!pack || !animation_pack_frame_has_row_access(frame) || !dst || rows == 0 || (uint32_t)y + rows > frame->h) {
+        return false;
+    }
+    uint32_t band_px = (uint32_t)frame->w * rows;
+    if (dst_size < band_px * 3 || (frame->cf == LV_COLOR_FORMAT_I8 && !palette)) {
+        ESP_LOGE(TAG, "Banda de %d filas sin paleta o búfer de %lu bytes insuficiente.", rows, (unsigned long)dst_size);
+        return false;
+    }
+
+    // RGB565A8: color (stride * h) y alfa (w * h). I8: índices (w * h) y alfa (w * h).
+    bool indexed = frame->cf == LV_COLOR_FORMAT_I8;
+    uint32_t color_bpp = indexed ? 1 : 2;
+    uint32_t color_plane = (uint32_t)frame->w * frame->h * color_bpp;
+    uint32_t color_off = frame->offset + (uint32_t)y * frame->w * color_bpp;
+    uint32_t alpha_off = frame->offset + color_plane + (uint32_t)y * frame->w;
+    // Los índices se leen en la segunda mitad del plano de color de la banda y se expanden hacia delante.
+    uint8_t *color_dst = indexed ? dst + band_px : dst;
+
+    if (pack->mapped) {
+        memcpy(color_dst, pack->mapped + color_off, band_px * color_bpp);
+        memcpy(dst + band_px * 2, pack->mapped + alpha_off, band_px);
+    } else if (lv_fs_seek(&pack->file, color_off, LV_FS_SEEK_SET) != LV_FS_RES_OK ||
+               !read_exact(&pack->file, color_dst, band_px * color_bpp) ||
+               lv_fs_seek(&pack->file, alpha_off, LV_FS_SEEK_SET) != LV_FS_RES_OK ||
+               !read_exact(&pack->file, dst + band_px * 2, band_px)) {
+        ESP_LOGW(TAG, "Lectura incompleta de las filas %d-%d del fotograma en offset %lu.",
+                 y, y + rows - 1, (unsigned long)frame->offset);
+        return false;
+    }
+    if (indexed) expand_indexed(dst, band_px, palette);
+    return true;
+}
@@ -0,0 +1,263 @@
+/* Fichero: components/ui/animation_pack.h */
+/* Descripción: 'animation_pack_bin_payload_size' es la regla única para los '.bin' sueltos del lienzo (cabecera y tamaño mínimo, con bytes sobrantes al final permitidos) que aplican el cargador y la comprobación de la SD. Versión 7 del formato 'ANIM.pak': el pack puede llevar, además de las secuencias RGB565A8, una versión premezclada de cada una ('anim_pack.py --preblend'): fotogramas RGB565 opacos (2 bytes/píxel, sin alfa) ya mezclados con el recorte del fondo sobre el que se dibujan. Esas secuencias van marcadas con ANIM_PACK_SEQ_FLAG_PREBLENDED detrás de la normal del mismo prefijo, y la cabecera guarda la firma del fondo usado ('bg_signature'). 'animation_pack_find_seq' solo las devuelve si esa firma coincide con la del fondo que la UI tiene en pantalla ('animation_pack_set_background_signature'); con otro fondo, o sin firma, se usan las RGB565A8. Desde la versión 6, cada entrada de la tabla de fotogramas lleva su duración en milisegundos ('duration_ms', 0 = la cadencia por defecto del player), tomada del fichero opcional 'ANIM.timing' del directorio de evolución al generar el pack. El reloj de animación (animation_clock.c) la usa para programar cada fotograma. Con ANIM_PACK_HDR_FLAG_STORE el pack solo contiene sus tablas y los offsets de los fotogramas apuntan a 'S:/diymon/STORE.pak', donde cada payload distinto se guarda una sola vez. Con ANIM_PACK_HDR_FLAG_BIG_ENDIAN los colores RGB565 (planos de color y paletas) están en el orden de bytes del panel, el que dibuja LVGL con CONFIG_LVGL_PORT_RGB565_BIG_ENDIAN ('anim_pack.py --big-endian'); solo se abren los packs cuyo orden coincide con el del firmware (ANIM_PACK_NATIVE_HDR_FLAGS). Los fotogramas RAW pueden leerse por rangos de filas ('animation_pack_read_rows') para el decodificador por bandas. Un pack también puede abrirse sobre una imagen en memoria ('animation_pack_open_mapped', la copia de la partición de assets mapeada en flash): las lecturas pasan a ser accesos a memoria y 'animation_pack_get_mapped_payload' da el puntero al payload para usarlo sin copia. */
+/* Último cambio: 18/10/2026 - 05:15 */
+#ifndef ANIMATION_PACK_H
+#define ANIMATION_PACK_H
+
+#include "lvgl.h"
+#include "sdkconfig.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// --- Formato en disco (little-endian, generado por IMG_converter/anim_pack.py) ---
+// Los campos de las tablas son siempre little-endian; solo los colores RGB565 siguen ANIM_PACK_HDR_FLAG_BIG_ENDIAN.
+#define ANIM_PACK_FILENAME      "ANIM.pak"
+#define ANIM_PACK_MAGIC         0x4B415044u // "DPAK"
+#define ANIM_PACK_VERSION       7
+#define ANIM_PACK_PREFIX_LEN    12
+#define ANIM_PACK_PALETTE_SIZE  256     // Colores RGB565 por paleta.
+#define ANIM_PACK_NO_PALETTE    0xFFFF  // Secuencia sin fotogramas indexados.
+
+#define ANIM_PACK_HDR_FLAG_STORE 0x0001 // Los payloads están en el almacén compartido, no en el pack.
+#define ANIM_PACK_HDR_FLAG_BIG_ENDIAN 0x0002 // Colores RGB565 en el orden de bytes del panel (big-endian).
+
+#define ANIM_PACK_SEQ_FLAG_PREBLENDED 0x0001 // Fotogramas RGB565 opacos, premezclados con el fondo de 'bg_signature'.
+
+// Orden de bytes que espera el firmware: el de los búferes de LVGL.
+#if CONFIG_LVGL_PORT_RGB565_BIG_ENDIAN
+#define ANIM_PACK_NATIVE_HDR_FLAGS ANIM_PACK_HDR_FLAG_BIG_ENDIAN
+#else
+#define ANIM_PACK_NATIVE_HDR_FLAGS 0
+#endif
+
+// Almacén compartido: en el directorio padre de las evoluciones (ej: "S:/diymon/STORE.pak").
+#define ANIM_STORE_FILENAME     "STORE.pak"
+#define ANIM_STORE_MAGIC        0x4F545344u // "DSTO"
+#define ANIM_STORE_VERSION      1
+
+// Holgura que necesita el búfer destino por encima del tamaño del fotograma para
+// descomprimir LZ4 in situ: (comprimido >> 8) + 32, con comprimido < tamaño del fotograma.
+#define ANIM_PACK_DECODE_MARGIN 512
+// Tamaño de cada lectura al descomprimir RLE en streaming (múltiplo del sector).
+#define ANIM_PACK_STREAM_CHUNK  4096
+
+typedef struct __attribute__((packed)) {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t seq_count;
+    uint16_t frame_count;
+    uint16_t payload_align;     // Alineación de cada payload (512 = sector de la SD).
+    uint16_t canvas_w;          // Lienzo común de la animación; los fotogramas recortados se
+    uint16_t canvas_h;          // colocan dentro de él en su posición (x, y).
+    uint16_t palette_count;     // Paletas almacenadas tras la tabla de fotogramas.
+    uint16_t flags;             // ANIM_PACK_HDR_FLAG_*.
+    uint32_t store_id;          // Identificador del almacén referenciado (0 sin almacén).
+    uint32_t bg_signature;      // Firma del fondo de las secuencias premezcladas (0 si no hay).
+} animation_pack_header_t;
+
+typedef struct __attribute__((packed)) {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t payload_align;     // Debe coincidir con la de los packs que lo referencian.
+    uint32_t store_id;          // Cambia con cada generación del almacén.
+    uint32_t payload_count;     // Payloads distintos guardados (informativo).
+} animation_store_header_t;
+
+typedef struct __attribute__((packed)) {
+    char prefix[ANIM_PACK_PREFIX_LEN]; // Prefijo de la secuencia, ej: "ANIM_IDLE_".
+    uint16_t first_frame;              // Índice de su primer fotograma en la tabla global.
+    uint16_t frame_count;
+    uint16_t palette;                  // Índice de su paleta o ANIM_PACK_NO_PALETTE.
+    uint16_t flags;                    // ANIM_PACK_SEQ_FLAG_*.
+} animation_pack_seq_t;
+
+typedef struct __attribute__((packed)) {
+    uint32_t offset;            // Offset absoluto del payload en el pack o, con almacén, en 'STORE.pak'.
+    uint32_t size;              // Bytes almacenados del payload.
+    uint32_t raw_size;          // Bytes del payload una vez descomprimido.
+    uint16_t x;                 // Posición del recorte dentro del lienzo.
+    uint16_t y;
+    uint16_t w;                 // Dimensiones del recorte (las de la imagen LVGL).
+    uint16_t h;
+    uint16_t stride;            // Stride del plano de color ya decodificado.
+    uint8_t cf;                 // lv_color_format_t del payload (I8: índices + alfa, se expande a RGB565A8; RGB565: premezclado).
+    uint8_t encoding;           // Ver animation_pack_encoding_t.
+    uint16_t duration_ms;       // Tiempo en pantalla; 0 = cadencia por defecto del player.
+} animation_pack_frame_t;
+
+typedef enum {
+    ANIM_PACK_ENC_RAW = 0,      // Píxeles LVGL sin cabecera, listos para el lv_img_dsc_t.
+    ANIM_PACK_ENC_RLE = 1,      // RLE de LVGL (lv_rle) con bloque de 2 bytes en RGB565A8 (1 byte en deltas).
+    ANIM_PACK_ENC_LZ4 = 2,      // Bloque LZ4 sin cabecera (requiere CONFIG_LV_USE_LZ4).
+} animation_pack_encoding_t;
+
+#define ANIM_PACK_ENC_MASK      0x0F
+#define ANIM_PACK_FLAG_DELTA    0x80    // El payload es un delta respecto al fotograma anterior.
+
+// Payload de un fotograma delta (una vez descomprimido): cabecera, tabla de rectángulos y,
+// por cada rectángulo, sus filas del plano de color seguidas de sus filas del plano alfa (RGB565A8).
+// En fotogramas I8 las filas de color son índices de 1 byte de la paleta de la secuencia.
+typedef struct __attribute__((packed)) {
+    uint16_t rect_count;
+    uint16_t reserved;
+} animation_pack_delta_header_t;
+
+typedef struct __attribute__((packed)) {
+    uint16_t x;
+    uint16_t y;
+    uint16_t w;
+    uint16_t h;
+} animation_pack_delta_rect_t;
+
+// --- Pack abierto en memoria ---
+typedef struct {
+    char *dir_path;
+    lv_fs_file_t file;                  // Fichero de los payloads: el propio pack o el almacén compartido.
+    animation_pack_header_t header;
+    animation_pack_seq_t *seqs;
+    animation_pack_frame_t *frames;
+    uint16_t *palettes;                 // palette_count * ANIM_PACK_PALETTE_SIZE colores RGB565.
+    const uint8_t *mapped;              // Imagen del pack en memoria (NULL si se lee de 'file').
+    uint32_t mapped_size;
+} animation_pack_t;
+
+/**
+ * @brief Abre el pack de un directorio de evolución y carga sus tablas en RAM.
+ *        Si el pack referencia el almacén compartido, se abre también y se valida su 'store_id'.
+ * @param dir_path Ruta LVGL del directorio (ej: "S:/diymon/0"), sin barra final.
+ * @return El pack abierto, o NULL si no existe o su cabecera no es válida.
+ */
+animation_pack_t* animation_pack_open(const char *dir_path);
+
+/**
+ * @brief Abre un pack autocontenido (sin almacén) que ya está en memoria, p.ej. mapeado desde flash.
+ *        Los offsets de los fotogramas son relativos a 'data'. 'data' debe seguir siendo válido
+ *        hasta cerrar el pack.
+ * @param dir_path Directorio de evolución al que corresponde (solo para identificarlo).
+ */
+animation_pack_t* animation_pack_open_mapped(const char *dir_path, const uint8_t *data, uint32_t size);
+
+/**
+ * @brief Cierra el fichero del pack y libera sus tablas.
+ */
+void animation_pack_close(animation_pack_t *pack);
+
+/**
+ * @brief Indica si los payloads del pack están en el almacén compartido. En ese caso dos
+ *        fotogramas con el mismo offset tienen el mismo contenido, aunque sean de packs distintos.
+ */
+bool animation_pack_uses_store(const animation_pack_t *pack);
+
+/**
+ * @brief Busca una secuencia por su prefijo de animación. Si el pack usa sus secuencias
+ *        premezcladas (animation_pack_uses_preblended) devuelve la premezclada cuando existe.
+ * @return La secuencia, o NULL si el pack no la contiene.
+ */
+const animation_pack_seq_t* animation_pack_find_seq(const animation_pack_t *pack, const char *prefix);
+
+/**
+ * @brief Fija la firma del fondo que hay bajo el lienzo de animación (ui_helpers_get_background_signature).
+ *        Las secuencias premezcladas solo se usan en los packs generados contra ese mismo fondo; 0 las desactiva.
+ */
+void animation_pack_set_background_signature(uint32_t signature);
+
+/**
+ * @brief Indica si 'animation_pack_find_seq' entrega las secuencias premezcladas del pack.
+ */
+bool animation_pack_uses_preblended(const animation_pack_t *pack);
+
+/**
+ * @brief Obtiene la entrada de la tabla para el fotograma 'index' de una secuencia.
+ */
+const animation_pack_frame_t* animation_pack_get_frame(const animation_pack_t *pack, const animation_pack_seq_t *seq, uint16_t index);
+
+/**
+ * @brief Devuelve la paleta RGB565 de una secuencia, o NULL si no tiene fotogramas indexados.
+ */
+const uint16_t* animation_pack_get_palette(const animation_pack_t *pack, const animation_pack_seq_t *seq);
+
+/**
+ * @brief Lee el payload de un fotograma y lo descomprime sobre 'dst' si hace falta.
+ *        RAW: un único seek + read. RLE: lecturas secuenciales por bloques.
+ *        LZ4: lectura al final de 'dst' y descompresión in situ.
+ *        Un fotograma completo I8 se lee detrás del plano de color y se expande con 'palette'
+ *        a RGB565A8 (w*h*3 bytes); los deltas se devuelven tal cual.
+ * @param palette Paleta de la secuencia (solo fotogramas I8).
+ * @param dst Búfer destino.
+ * @param dst_size Capacidad del búfer destino; debe ser >= frame->raw_size (+ ANIM_PACK_DECODE_MARGIN en LZ4).
+ * @return true si se obtuvo el payload completo.
+ */
+bool animation_pack_read_frame(animation_pack_t *pack, const animation_pack_frame_t *frame, const uint16_t *palette,
+                               uint8_t *dst, uint32_t dst_size);
+
+/**
+ * @brief Puntero al payload almacenado de un fotograma de un pack en memoria, o NULL si el pack se lee de fichero.
+ */
+const uint8_t* animation_pack_get_mapped_payload(const animation_pack_t *pack, const animation_pack_frame_t *frame);
+
+/**
+ * @brief Indica si el payload almacenado ya es la imagen LVGL del fotograma: RAW completo, sin paleta
+ *        y alineado a 4 bytes. Con un pack en memoria, el descriptor puede apuntar a él sin copiarlo.
+ */
+bool animation_pack_frame_is_direct(const animation_pack_frame_t *frame);
+
+/**
+ * @brief Lee los frame->size bytes almacenados del payload, sin descomprimir.
+ */
+bool animation_pack_read_stored(animation_pack_t *pack, const animation_pack_frame_t *frame, uint8_t *dst);
+
+/**
+ * @brief Igual que animation_pack_read_frame, pero con el payload almacenado ya en memoria.
+ * @param stored Payload leído con animation_pack_read_stored (no debe solapar con 'dst').
+ */
+bool animation_pack_decode_frame(const animation_pack_frame_t *frame, const uint16_t *palette, const uint8_t *stored,
+                                 uint8_t *dst, uint32_t dst_size);
+
+/**
+ * @brief Regla común para un fotograma suelto ('.bin' de LVGL v9) del lienzo 'w' x 'h', la misma en el
+ *        cargador y en la comprobación de la SD: cabecera RGB565A8 de ese tamaño con stride w*2. El fichero
+ *        debe traer al menos la cabecera más los bytes devueltos; lo que sobre detrás se ignora (los '.bin'
+ *        exportados pueden llevar bytes de relleno al final).
+ * @return Bytes de píxeles (plano de color + alfa), o 0 si la cabecera no vale.
+ */
+uint32_t animation_pack_bin_payload_size(const lv_image_header_t *header, uint16_t w, uint16_t h);
+
+/**
+ * @brief Indica si las filas del fotograma pueden leerse sueltas con animation_pack_read_rows
+ *        (payload RAW completo, RGB565A8 o I8). Los comprimidos y los deltas solo se leen enteros.
+ */
+bool animation_pack_frame_has_row_access(const animation_pack_frame_t *frame);
+
+/**
+ * @brief Lee las filas [y, y + rows) de un fotograma con acceso por filas como una banda RGB565A8:
+ *        rows * stride bytes de color seguidos de rows * w bytes de alfa. Dos lecturas por banda.
+ * @param palette Paleta de la secuencia (solo fotogramas I8).
+ * @param dst_size Debe ser >= rows * w * 3.
+ */
+bool animation_pack_read_rows(animation_pack_t *pack, const animation_pack_frame_t *frame, const uint16_t *palette,
+                              uint16_t y, uint16_t rows, uint8_t *dst, uint32_t dst_size);
+
+/**
+ * @brief Aplica un delta ya descomprimido sobre un búfer que contiene el fotograma anterior.
+ * @param frame Entrada del fotograma delta (dimensiones y formato de color).
+ * @param palette Paleta de la secuencia (solo fotogramas I8).
+ * @param delta Payload del delta (frame->raw_size bytes).
+ * @param dst Búfer con el fotograma anterior; se actualiza in situ.
+ * @param areas Salida: rectángulos modificados, en coordenadas del fotograma (puede ser NULL).
+ * @param max_areas Capacidad de 'areas'. Si hay más rectángulos se fusionan en el último.
+ * @param area_count Salida: número de rectángulos escritos en 'areas'.
+ * @return true si el delta es válido y se aplicó completo.
+ */
+bool animation_pack_apply_delta(const animation_pack_frame_t *frame, const uint16_t *palette, const uint8_t *delta,
+                                uint8_t *dst, uint32_t dst_size,
+                                lv_area_t *areas, uint8_t max_areas, uint8_t *area_count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // ANIMATION_PACK_H
@@ -0,0 +1,357 @@
+/* Fichero: components/ui/animation_prefetch.c */
+/* Descripción: Precargador de fotogramas con doble búfer. Los temporizadores de animación leían ~100 KB de la SD dentro de la tarea de LVGL en cada tick, bloqueando el táctil y las animaciones de los paneles. Ahora una tarea de baja prioridad lee el siguiente fotograma en el búfer trasero; al llegar su turno, 'animation_prefetch_present' solo intercambia los punteros de los búferes frontal y trasero y actualiza el descriptor del player. Si el fotograma aún no está listo se devuelve PENDING y el player reintenta en el siguiente tick sin bloquear. Cuando no hay RAM interna suficiente para el segundo búfer se mantiene la carga síncrona anterior. La tarea usa lv_fs directamente: el driver 'S:' no tiene caché (cache_size = 0), por lo que lv_fs_open/read/seek no reservan memoria de LVGL y pueden llamarse fuera de su tarea. El búfer trasero se reserva con la misma holgura de descompresión (ANIM_PACK_DECODE_MARGIN) que el compartido, porque ambos se alternan como destino de los fotogramas comprimidos. Con fotogramas delta, la tarea comprueba al terminar que el fotograma base del delta es el que está en el búfer frontal (en pantalla); solo entonces se entregan al player las zonas modificadas y, si no, se marca el fotograma completo como sucio. Junto con la cabecera del recorte se entrega su posición dentro del lienzo, y 'animation_prefetch_attach' copia también las dimensiones del lienzo a cada player. Con el decodificador por bandas el player no tiene búfer: se registran las dimensiones del lienzo y se queda en modo síncrono, que solo resuelve la geometría y la ruta de cada fotograma. 'animation_prefetch_warmup' prepara un cambio de evolución: la tarea resuelve primero el índice de fotogramas del directorio nuevo (y con él abre su pack) y después lee su primer fotograma en el búfer trasero, todo fuera de la tarea de LVGL. Con el pack en la copia de la flash, un fotograma que el cargador sirve sin copia ('flash_dsc') no ocupa el búfer trasero: al presentarlo no se intercambian los búferes, el player muestra el descriptor de la flash y se comprueba antes que la copia no se haya retirado mientras tanto. Un fotograma marcado como defectuoso por la comprobación de la SD (animation_integrity.c) se da por fallido al instante, sin sustituir la petición pendiente: los players ya piden por adelantado el siguiente fotograma sano. */
+/* Último cambio: 18/10/2026 - 01:30 */
+#include "animation_prefetch.h"
+#include "animation_flash.h"
+#include "animation_integrity.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include <stdlib.h>
+#include <string.h>
+
+static const char *TAG = "ANIM_PREFETCH";
+
+// --- Constantes de configuración de la tarea ---
+#define PREFETCH_TASK_STACK_SIZE    4096
+#define PREFETCH_TASK_PRIORITY      3             // Por debajo de la tarea de LVGL (4).
+#define PREFETCH_RAM_HEADROOM       (48 * 1024)   // RAM interna que se deja libre para WiFi y el servidor web.
+
+typedef enum {
+    REQ_NONE,
+    REQ_PENDING,
+    REQ_LOADING,
+    REQ_READY,
+    REQ_FAILED,
+} prefetch_req_state_t;
+
+typedef struct {
+    char base_path[96];
+    char prefix[16];
+    uint16_t frame_index;
+    prefetch_req_state_t state;
+    bool waited;                // El player ya preguntó por este fotograma antes de estar listo.
+    bool warmup;                // Resolver antes el índice de fotogramas del directorio (cambio de evolución).
+} prefetch_req_t;
+
+// --- Variables estáticas privadas del módulo ---
+static SemaphoreHandle_t s_lock = NULL;
+static SemaphoreHandle_t s_task_exit = NULL;
+static TaskHandle_t s_task = NULL;
+static volatile bool s_stop = false;
+static bool s_double_buffered = false;
+
+static lv_img_dsc_t s_front;                // Lo que está en pantalla.
+static uint8_t *s_back = NULL;              // Destino de la siguiente lectura.
+static lv_image_header_t s_back_header;     // Cabecera del fotograma leído en el búfer trasero.
+static animation_dirty_t s_back_dirty;      // Zonas que cambian respecto al búfer frontal.
+static lv_point_t s_back_pos;               // Posición del recorte trasero dentro del lienzo.
+static lv_point_t s_front_pos;
+static lv_img_dsc_t s_back_flash;           // Fotograma leído sin copia desde la flash (data = NULL si está en 's_back').
+static lv_img_dsc_t s_front_flash;          // Ídem para el que está en pantalla.
+static uint16_t s_canvas_w;
+static uint16_t s_canvas_h;
+static prefetch_req_t s_req;
+static animation_prefetch_stats_t s_stats;
+
+// --- Tarea de precarga ---
+
+static bool req_matches(const char *base_path, const char *prefix, uint16_t frame_index) {
+    return s_req.state != REQ_NONE && s_req.frame_index == frame_index &&
+           base_path && strcmp(s_req.base_path, base_path) == 0 &&
+           strcmp(s_req.prefix, prefix) == 0;
+}
+
+// Requiere 's_lock'. Sustituye la petición anterior salvo que sea el mismo fotograma.
+static void request_locked(const char *base_path, const char *prefix, uint16_t frame_index) {
+    if (req_matches(base_path, prefix, frame_index) && s_req.state != REQ_FAILED) return;
+
+    strncpy(s_req.base_path, base_path, sizeof(s_req.base_path) - 1);
+    s_req.base_path[sizeof(s_req.base_path) - 1] = '\0';
+    strncpy(s_req.prefix, prefix, sizeof(s_req.prefix) - 1);
+    s_req.prefix[sizeof(s_req.prefix) - 1] = '\0';
+    s_req.frame_index = frame_index;
+    s_req.state = REQ_PENDING;
+    s_req.waited = false;
+    s_req.warmup = false;
+    xTaskNotifyGive(s_task);
+}
+
+static void prefetch_task_main(void *pvParameters) {
+    ESP_LOGI(TAG, "Tarea de precarga iniciada.");
+
+    while (!s_stop) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        while (!s_stop) {
+            xSemaphoreTake(s_lock, portMAX_DELAY);
+            if (s_req.state != REQ_PENDING) {
+                xSemaphoreGive(s_lock);
+                break;
+            }
+            prefetch_req_t job = s_req;
+            s_req.state = REQ_LOADING;
+
+            animation_t target = { 0 };
+            target.base_path = job.base_path;
+            target.width = s_canvas_w;
+            target.height = s_canvas_h;
+            target.img_dsc = s_front; // Plantilla de cabecera y capacidad.
+            target.img_dsc.data = s_back;
+            const void *front_data = s_front.data; // No cambia mientras haya una lectura en curso.
+            xSemaphoreGive(s_lock);
+
+            int64_t t0 = esp_timer_get_time();
+            if (job.warmup) {
+                // El player contará los fotogramas al hacer el cambio: que encuentre el índice ya hecho.
+                animation_loader_count_frames(job.base_path, job.prefix);
+            }
+            bool ok = animation_loader_load_frame(&target, job.frame_index, job.prefix);
+            uint32_t load_us = (uint32_t)(esp_timer_get_time() - t0);
+            if (target.dirty.base_key == 0 || target.dirty.base_key != animation_loader_get_buffer_key(front_data)) {
+                target.dirty.count = 0;
+            }
+
+            xSemaphoreTake(s_lock, portMAX_DELAY);
+            s_stats.last_load_us = load_us;
+            if (load_us > s_stats.max_load_us) s_stats.max_load_us = load_us;
+            if (!ok) s_stats.failed++;
+
+            // Si llegó otra petición durante la lectura, se descarta este resultado.
+            if (s_req.state == REQ_LOADING) {
+                s_req.state = ok ? REQ_READY : REQ_FAILED;
+                s_back_header = target.img_dsc.header;
+                s_back_dirty = target.dirty;
+                s_back_pos.x = target.frame_x;
+                s_back_pos.y = target.frame_y;
+                s_back_flash = target.flash_dsc;
+            }
+            xSemaphoreGive(s_lock);
+        }
+    }
+
+    xSemaphoreGive(s_task_exit);
+    vTaskDelete(NULL);
+}
+
+// --- Funciones públicas ---
+
+bool animation_prefetch_init(animation_t *shared) {
+    if (!shared) return false;
+
+    s_front = shared->img_dsc;
+    s_front_pos.x = 0;
+    s_front_pos.y = 0;
+    memset(&s_front_flash, 0, sizeof(s_front_flash));
+    memset(&s_back_flash, 0, sizeof(s_back_flash));
+    s_canvas_w = shared->width;
+    s_canvas_h = shared->height;
+    memset(&s_req, 0, sizeof(s_req));
+    memset(&s_stats, 0, sizeof(s_stats));
+    s_double_buffered = false;
+    if (!shared->img_dsc.data) {
+        // Decodificación por bandas: no hay búfer que duplicar, cada tick solo resuelve la ruta del fotograma.
+        ESP_LOGI(TAG, "Player sin búfer de fotograma (decodificador por bandas). Modo síncrono.");
+        return false;
+    }
+
+    size_t size = shared->img_dsc.data_size + ANIM_PACK_DECODE_MARGIN;
+    uint32_t caps = MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT;
+    if (heap_caps_get_largest_free_block(caps) < size || heap_caps_get_free_size(caps) < size + PREFETCH_RAM_HEADROOM) {
+        ESP_LOGW(TAG, "RAM interna insuficiente para un segundo búfer de %u bytes. Modo síncrono.", (unsigned int)size);
+        return false;
+    }
+
+    s_back = heap_caps_malloc(size, caps);
+    s_lock = xSemaphoreCreateMutex();
+    s_task_exit = xSemaphoreCreateBinary();
+    if (!s_back || !s_lock || !s_task_exit) {
+        ESP_LOGW(TAG, "No se pudo reservar el doble búfer. Modo síncrono.");
+        animation_prefetch_deinit(shared);
+        return false;
+    }
+
+    s_stop = false;
+    if (xTaskCreate(prefetch_task_main, "anim_prefetch", PREFETCH_TASK_STACK_SIZE, NULL,
+                    PREFETCH_TASK_PRIORITY, &s_task) != pdPASS) {
+        ESP_LOGW(TAG, "No se pudo crear la tarea de precarga. Modo síncrono.");
+        s_task = NULL;
+        animation_prefetch_deinit(shared);
+        return false;
+    }
+
+    s_double_buffered = true;
+    ESP_LOGI(TAG, "Doble búfer activo (2 x %u bytes).", (unsigned int)size);
+    return true;
+}
+
+void animation_prefetch_deinit(animation_t *shared) {
+    if (s_task) {
+        s_stop = true;
+        xTaskNotifyGive(s_task);
+        xSemaphoreTake(s_task_exit, portMAX_DELAY);
+        s_task = NULL;
+    }
+
+    // El player compartido recupera la propiedad del búfer frontal; el trasero se libera aquí.
+    if (shared && s_double_buffered) {
+        shared->img_dsc.data = s_front.data;
+    }
+    animation_loader_forget_buffer(s_back);
+    free(s_back);
+    s_back = NULL;
+
+    if (s_lock) {
+        vSemaphoreDelete(s_lock);
+        s_lock = NULL;
+    }
+    if (s_task_exit) {
+        vSemaphoreDelete(s_task_exit);
+        s_task_exit = NULL;
+    }
+    s_double_buffered = false;
+    memset(&s_req, 0, sizeof(s_req));
+}
+
+bool animation_prefetch_is_double_buffered(void) {
+    return s_double_buffered;
+}
+
+void animation_prefetch_attach(animation_t *anim) {
+    if (!anim) return;
+    if (s_double_buffered) xSemaphoreTake(s_lock, portMAX_DELAY);
+    anim->img_dsc = s_front;
+    anim->frame_x = s_front_pos.x;
+    anim->frame_y = s_front_pos.y;
+    anim->flash_dsc = s_front_flash;
+    anim->width = s_canvas_w;
+    anim->height = s_canvas_h;
+    anim->dirty.count = 0; // Al engancharse se muestra el fotograma completo.
+    if (s_double_buffered) xSemaphoreGive(s_lock);
+}
+
+void animation_prefetch_request(const char *base_path, const char *prefix, uint16_t frame_index) {
+    if (!s_double_buffered || !base_path || !prefix) return;
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    request_locked(base_path, prefix, frame_index);
+    xSemaphoreGive(s_lock);
+}
+
+bool animation_prefetch_warmup(const char *base_path, const char *prefix) {
+    if (!s_double_buffered || !base_path || !prefix) return false;
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    request_locked(base_path, prefix, 0);
+    s_req.warmup = true;
+    xSemaphoreGive(s_lock);
+    return true;
+}
+
+animation_prefetch_result_t animation_prefetch_present(animation_t *anim, const char *prefix, uint16_t frame_index) {
+    if (!anim || !prefix) return ANIM_PREFETCH_FAILED;
+    // Fotograma marcado como defectuoso: falla sin leer y sin desplazar la petición en curso, que
+    // normalmente ya es el fotograma sano que viene después.
+    if (animation_integrity_is_bad(anim->base_path, prefix, frame_index)) return ANIM_PREFETCH_FAILED;
+
+    if (!s_double_buffered) {
+        // Modo síncrono: lectura directa sobre el búfer compartido, como antes.
+        uint32_t shown_key = animation_loader_get_buffer_key(anim->img_dsc.data);
+        int64_t t0 = esp_timer_get_time();
+        bool ok = animation_loader_load_frame(anim, frame_index, prefix);
+        if (anim->dirty.base_key == 0 || anim->dirty.base_key != shown_key) {
+            anim->dirty.count = 0;
+        }
+        s_stats.last_load_us = (uint32_t)(esp_timer_get_time() - t0);
+        if (s_stats.last_load_us > s_stats.max_load_us) s_stats.max_load_us = s_stats.last_load_us;
+        if (!ok) {
+            s_stats.failed++;
+            return ANIM_PREFETCH_FAILED;
+        }
+        s_front = anim->img_dsc;
+        s_front_flash = anim->flash_dsc;
+        s_front_pos.x = anim->frame_x;
+        s_front_pos.y = anim->frame_y;
+        s_stats.presented++;
+        s_stats.missed++;
+        return ANIM_PREFETCH_PRESENTED;
+    }
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    if (!req_matches(anim->base_path, prefix, frame_index)) {
+        // No se pidió por adelantado: se pide ahora y el player reintentará.
+        s_stats.missed++;
+        if (anim->base_path) {
+            request_locked(anim->base_path, prefix, frame_index);
+            s_req.waited = true;
+        }
+        xSemaphoreGive(s_lock);
+        return anim->base_path ? ANIM_PREFETCH_PENDING : ANIM_PREFETCH_FAILED;
+    }
+
+    animation_prefetch_result_t result;
+    switch (s_req.state) {
+        case REQ_READY: {
+            if (s_back_flash.data && !animation_flash_owns(s_back_flash.data)) {
+                // La copia en flash se retiró después de la lectura: el player lo pedirá de nuevo.
+                s_req.state = REQ_NONE;
+                result = ANIM_PREFETCH_FAILED;
+                break;
+            }
+            if (s_back_flash.data) {
+                // Sin copia: el búfer frontal no cambia y el player muestra el descriptor de la flash.
+                s_back_dirty.count = 0;
+            } else {
+                uint8_t *old_front = (uint8_t *)s_front.data;
+                s_front.data = s_back;
+                s_front.header = s_back_header;
+                s_back = old_front;
+            }
+            s_front_flash = s_back_flash;
+            s_front_pos = s_back_pos;
+            if (!s_req.waited) s_stats.prefetched++;
+            s_stats.presented++;
+            s_req.state = REQ_NONE;
+            anim->img_dsc = s_front;
+            anim->flash_dsc = s_front_flash;
+            anim->dirty = s_back_dirty;
+            anim->frame_x = s_front_pos.x;
+            anim->frame_y = s_front_pos.y;
+            result = ANIM_PREFETCH_PRESENTED;
+            break;
+        }
+        case REQ_FAILED:
+            s_req.state = REQ_NONE;
+            result = ANIM_PREFETCH_FAILED;
+            break;
+        default:
+            if (!s_req.waited) {
+                s_stats.late++;
+                s_req.waited = true;
+            }
+            result = ANIM_PREFETCH_PENDING;
+            break;
+    }
+    xSemaphoreGive(s_lock);
+    return result;
+}
+
+void animation_prefetch_get_stats(animation_prefetch_stats_t *out) {
+    if (!out) return;
+    if (s_double_buffered) xSemaphoreTake(s_lock, portMAX_DELAY);
+    *out = s_stats;
+    if (s_double_buffered) xSemaphoreGive(s_lock);
+}
+
+void animation_prefetch_log_stats(void) {
+    animation_prefetch_stats_t st;
+    animation_prefetch_get_stats(&st);
+    ESP_LOGI(TAG, "[%s] mostrados=%lu precargados=%lu tarde=%lu perdidos=%lu fallidos=%lu lectura(última/máx)=%lu/%lu us",
+             s_double_buffered ? "doble búfer" : "síncrono",
+             (unsigned long)st.presented, (unsigned long)st.prefetched, (unsigned long)st.late,
+             (unsigned long)st.missed, (unsigned long)st.failed,
+             (unsigned long)st.last_load_us, (unsigned long)st.max_load_us);
+}
@@ -0,0 +1,88 @@
+/* Fichero: components/ui/animation_prefetch.h */
+/* Descripción: Interfaz del precargador de fotogramas en segundo plano. Una tarea dedicada lee el fotograma N+1 en un segundo búfer mientras el fotograma N está en pantalla; los temporizadores de LVGL solo intercambian el puntero 'data' del lv_img_dsc_t, sin leer de la SD dentro de la tarea de LVGL. Si no hay RAM interna para el segundo búfer se usa la carga síncrona sobre el búfer compartido. 'animation_prefetch_warmup' adelanta en segundo plano el primer fotograma de otro directorio de evolución. */
+/* Último cambio: 17/10/2026 - 21:40 */
+#ifndef ANIMATION_PREFETCH_H
+#define ANIMATION_PREFETCH_H
+
+#include "animation_loader.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+    ANIM_PREFETCH_PRESENTED,    // El fotograma está en el búfer frontal y el descriptor actualizado.
+    ANIM_PREFETCH_PENDING,      // Aún se está leyendo: mantener el fotograma actual y reintentar.
+    ANIM_PREFETCH_FAILED,       // La lectura falló.
+} animation_prefetch_result_t;
+
+typedef struct {
+    uint32_t presented;         // Fotogramas mostrados.
+    uint32_t prefetched;        // Fotogramas que ya estaban listos al llegar su turno.
+    uint32_t late;              // Turnos en los que el fotograma seguía leyéndose (se reintenta).
+    uint32_t missed;            // Fotogramas que no se habían pedido por adelantado.
+    uint32_t failed;            // Lecturas fallidas.
+    uint32_t last_load_us;      // Duración de la última lectura.
+    uint32_t max_load_us;       // Peor lectura observada.
+} animation_prefetch_stats_t;
+
+/**
+ * @brief Reserva el segundo búfer e inicia la tarea de precarga.
+ * @param shared Player que posee el búfer compartido (será el búfer frontal inicial).
+ * @return true si hay doble búfer; false si se trabaja en modo síncrono (sin RAM suficiente).
+ */
+bool animation_prefetch_init(animation_t *shared);
+
+/**
+ * @brief Detiene la tarea y libera el segundo búfer. 'shared' recupera la propiedad del búfer frontal.
+ */
+void animation_prefetch_deinit(animation_t *shared);
+
+/**
+ * @brief Indica si la precarga con doble búfer está activa.
+ */
+bool animation_prefetch_is_double_buffered(void);
+
+/**
+ * @brief Apunta el descriptor de 'anim' al búfer frontal (lo que está en pantalla).
+ *        Debe llamarse al iniciar o reanudar un player antes de asignarlo al objeto imagen.
+ */
+void animation_prefetch_attach(animation_t *anim);
+
+/**
+ * @brief Pide la lectura asíncrona de un fotograma en el búfer trasero.
+ *        Si había otra petición sin empezar, se sustituye.
+ */
+void animation_prefetch_request(const char *base_path, const char *prefix, uint16_t frame_index);
+
+/**
+ * @brief Pide el fotograma 0 de una secuencia de otro directorio resolviendo antes, en la tarea
+ *        de precarga, su índice de fotogramas. El player lo recoge con animation_prefetch_present.
+ * @return false en modo síncrono (no hay tarea): el llamante debe cargar directamente.
+ */
+bool animation_prefetch_warmup(const char *base_path, const char *prefix);
+
+/**
+ * @brief Muestra el fotograma pedido si ya está listo (no bloquea en modo doble búfer).
+ *        Si no se había pedido, se pide y se devuelve ANIM_PREFETCH_PENDING.
+ *        En modo síncrono se carga directamente sobre el búfer de 'anim'.
+ */
+animation_prefetch_result_t animation_prefetch_present(animation_t *anim, const char *prefix, uint16_t frame_index);
+
+/**
+ * @brief Copia los contadores de precarga.
+ */
+void animation_prefetch_get_stats(animation_prefetch_stats_t *out);
+
+/**
+ * @brief Escribe los contadores de precarga en el log.
+ */
+void animation_prefetch_log_stats(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // ANIMATION_PREFETCH_H
@@ -1,10 +1,10 @@
 /* Fichero: components/ui/core/ui.c */
-/* Descripción: Diagnóstico de Causa Raíz: El 'Load access fault' ocurre porque la función delete_screen_main se llamaba a sí misma de forma recursiva. El flujo era: 1.  action_config_mode_start llama a delete_screen_main. 2. delete_screen_main llama a lv_obj_del(g_main_screen_obj). 3. lv_obj_del dispara el evento LV_EVENT_DELETE. 4. Un callback incorrectamente registrado para este evento era la propia función delete_screen_main, provocando una segunda llamada concurrente que intentaba liberar recursos ya en proceso de liberación, causando el crash.
-Solución Definitiva: Se ha eliminado la línea que registraba el callback recursivo. La limpieza de la pantalla principal ahora se inicia de forma única y explícita desde el orquestador de acciones, y el callback de limpieza correcto ('main_screen_cleanup_cb' en 'screens.c') se ejecuta una sola vez, garantizando que los recursos se liberen de forma segura. */
-/* Último cambio: 20/08/2025 - 07:32 */
+/* Descripción: Se inicializa el índice de fotogramas de animación ('animation_manifest_init') antes de crear las pantallas. Así el registro de invalidación con el servidor web queda activo y el índice del directorio de evolución se construye una sola vez al arrancar la animación de reposo, sin enumerar la SD en cada acción. */
+/* Último cambio: 17/10/2026 - 10:05 */
 #include "ui.h"
 #include "screens.h"
 #include "ui_action_animations.h"
+#include "animation_manifest.h"
 #include "esp_log.h"
 
 extern lv_obj_t *g_main_screen_obj; 
@@ -17,6 +17,7 @@ void ui_preinit(void) {
 }
 
 void ui_init(void) {
+    animation_manifest_init();
     create_screens();
     
     // [CORRECCIÓN] Se elimina el callback recursivo que causaba el crash.
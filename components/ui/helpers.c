@@ -1,9 +1,13 @@
 /* Fichero: components/ui/helpers.c */
-/* Descripción: Diagnóstico de Causa Raíz: La construcción de rutas de animación era inconsistente. La función de ayuda 'ui_helpers_build_asset_path' añadía una barra inclinada ('/') final, y la función de carga de fotogramas ('animation_loader_load_frame') añadía otra, resultando en una ruta malformada con una doble barra (ej: '.../2//ANIM_IDLE_2.bin'). Esto causaba que el sistema de ficheros de LVGL no encontrara los fotogramas de la animación. Solución Definitiva: Se ha modificado 'ui_helpers_build_asset_path' para que no añada la barra inclinada final. Ahora, esta función devuelve una ruta de directorio limpia, y es responsabilidad de la función que carga el fotograma específico añadir el separador, garantizando que todas las rutas se construyan de forma correcta y consistente. */
-/* Último cambio: 21/08/2025 - 17:57 */
+/* Descripción: Diagnóstico de Causa Raíz: La construcción de rutas de animación era inconsistente. La función de ayuda 'ui_helpers_build_asset_path' añadía una barra inclinada ('/') final, y la función de carga de fotogramas ('animation_loader_load_frame') añadía otra, resultando en una ruta malformada con una doble barra (ej: '.../2//ANIM_IDLE_2.bin'). Esto causaba que el sistema de ficheros de LVGL no encontrara los fotogramas de la animación. Solución Definitiva: Se ha modificado 'ui_helpers_build_asset_path' para que no añada la barra inclinada final. Ahora, esta función devuelve una ruta de directorio limpia, y es responsabilidad de la función que carga el fotograma específico añadir el separador, garantizando que todas las rutas se construyan de forma correcta y consistente. Caché del fondo (CONFIG_DIYMON_BG_COMPOSITOR): la zona del fondo (bg_0, indexado I8) que queda bajo el lienzo de animación se convierte una sola vez a RGB565 opaco, con una tabla de la paleta ya mezclada sobre negro y en el orden de bytes del panel. Cada fotograma RGB565A8 se compone en esa copia solo sobre su recorte y el del anterior, o solo sobre sus zonas modificadas si el recorte no cambia: alfa 255 copia el píxel, alfa 0 deja el del fondo y el resto se mezcla una vez. El objeto imagen muestra la composición en el origen del lienzo y responde a LV_EVENT_COVER_CHECK como opaco, así LVGL empieza a dibujar en él y no pinta el fondo indexado debajo: la mezcla de dos capas por refresco queda en una copia. Si no hay RAM para la copia o el fotograma no es RGB565A8, los fotogramas se dibujan sobre el fondo como antes. Fotogramas premezclados: 'ui_helpers_get_background_signature' da la firma (CRC32) del fondo bajo el lienzo (posición y tamaño del lienzo, paleta e índices del recorte), la misma que calcula 'anim_pack.py --preblend'; con ella el cargador elige las secuencias RGB565 opacas de los packs generados contra este fondo. Un fondo distinto da otra firma y se vuelve a las RGB565A8. La caché del fondo copia esos fotogramas fila a fila, sin alfa, y 'ui_helpers_cover_when_opaque' hace que el objeto imagen tape lo que tiene debajo mientras muestra una imagen RGB565, sea la composición o un fotograma premezclado. */
+/* Último cambio: 18/10/2026 - 04:00 */
 #include "helpers.h"
 #include "diymon_evolution.h"
 #include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
+#include "esp_rom_crc.h"
+#include "sdkconfig.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -49,3 +53,261 @@ void ui_helpers_free_background_buffer(void) {
 // Implementaciones placeholder para que compile
 void ui_helpers_create_diymon_gif(lv_obj_t* parent) {}
 void ui_helpers_free_gif_buffer(void) {}
+
+#define BG_PALETTE_SIZE         256
+
+// --- FONDO BAJO LAS ANIMACIONES ---
+
+// Un RGB565 no tiene transparencias: LVGL puede empezar a dibujar en el objeto y saltarse lo que hay debajo.
+static void opaque_image_cover_cb(lv_event_t *e) {
+    lv_obj_t *obj = lv_event_get_target(e);
+    const void *src = lv_image_get_src(obj);
+    if (!src || lv_image_src_get_type(src) != LV_IMAGE_SRC_VARIABLE) return;
+    if (((const lv_image_dsc_t *)src)->header.cf != LV_COLOR_FORMAT_RGB565) return;
+    lv_cover_check_info_t *info = lv_event_get_param(e);
+    if (info->res == LV_COVER_RES_MASKED) return;
+    lv_area_t coords;
+    lv_obj_get_coords(obj, &coords);
+    if (_lv_area_is_in(info->area, &coords, 0)) info->res = LV_COVER_RES_COVER;
+}
+
+void ui_helpers_cover_when_opaque(lv_obj_t* img_obj) {
+    if (img_obj) lv_obj_add_event_cb(img_obj, opaque_image_cover_cb, LV_EVENT_COVER_CHECK, NULL);
+}
+
+uint32_t ui_helpers_get_background_signature(const lv_area_t* canvas) {
+    if (!canvas || bg_0.header.cf != LV_COLOR_FORMAT_I8 || canvas->x1 < 0 || canvas->y1 < 0 ||
+        canvas->x2 >= (int32_t)bg_0.header.w || canvas->y2 >= (int32_t)bg_0.header.h) {
+        return 0;
+    }
+    // Misma secuencia que 'background_signature' de anim_pack.py: rectángulo, paleta e índices del recorte.
+    uint16_t rect[4] = { (uint16_t)canvas->x1, (uint16_t)canvas->y1,
+                         (uint16_t)lv_area_get_width(canvas), (uint16_t)lv_area_get_height(canvas) };
+    uint32_t crc = esp_rom_crc32_le(0, (const uint8_t *)rect, sizeof(rect));
+    crc = esp_rom_crc32_le(crc, bg_0.data, BG_PALETTE_SIZE * sizeof(lv_color32_t));
+    const uint8_t *idx = bg_0.data + BG_PALETTE_SIZE * sizeof(lv_color32_t) + canvas->y1 * bg_0.header.stride + canvas->x1;
+    for (int32_t y = 0; y < rect[3]; y++) {
+        crc = esp_rom_crc32_le(crc, idx + y * bg_0.header.stride, rect[2]);
+    }
+    return crc ? crc : 1; // 0 significa "sin fondo conocido".
+}
+
+// --- CACHÉ DEL FONDO PARA LAS ANIMACIONES ---
+#if CONFIG_DIYMON_BG_COMPOSITOR
+
+#define BG_CACHE_MIN_FREE_RAM   (48 * 1024)  // La misma reserva que la caché de fotogramas.
+
+typedef struct {
+    lv_obj_t *obj;              // Objeto imagen que muestra la composición.
+    lv_area_t canvas;           // Zona del lienzo en coordenadas del padre.
+    lv_img_dsc_t dsc;           // Composición: RGB565 opaco del tamaño del lienzo.
+    uint16_t *pixels;
+    uint16_t lut[BG_PALETTE_SIZE]; // Paleta del fondo ya mezclada sobre negro.
+    const uint8_t *bg_index;    // Índices del fondo en la esquina del lienzo.
+    uint32_t bg_stride;
+    lv_area_t sprite;           // Recorte del último fotograma compuesto, en coordenadas del lienzo.
+    const void *sprite_data;    // Datos del último fotograma compuesto.
+    uint32_t frames;
+    uint32_t partial_frames;    // Compuestos solo sobre sus zonas modificadas.
+    uint64_t pixels_done;
+    uint64_t us;
+} bg_cache_t;
+
+static bg_cache_t *s_bg_cache = NULL;
+
+static inline uint16_t rgb565_swap(uint16_t c) {
+    return (uint16_t)((c << 8) | (c >> 8));
+}
+
+// La composición está en el orden de bytes de los búferes de LVGL; la mezcla trabaja en el natural.
+static inline uint16_t rgb565_mix(uint16_t fg, uint16_t bg, uint8_t alpha) {
+#if CONFIG_LVGL_PORT_RGB565_BIG_ENDIAN
+    return rgb565_swap(lv_color_16_16_mix(rgb565_swap(fg), rgb565_swap(bg), alpha));
+#else
+    return lv_color_16_16_mix(fg, bg, alpha);
+#endif
+}
+
+// Recompone la zona 'r' (coordenadas del lienzo): fondo y, donde se solapa con 'fr', el fotograma encima.
+// Un fotograma RGB565 (premezclado) ya es opaco: se copia sin mirar alfa.
+static void compose_area(const lv_area_t *r, const lv_img_dsc_t *frame, const lv_area_t *fr) {
+    bg_cache_t *c = s_bg_cache;
+    int32_t canvas_w = c->dsc.header.w;
+    const uint16_t *fcolor = frame ? (const uint16_t *)frame->data : NULL;
+    const uint8_t *falpha = frame && frame->header.cf == LV_COLOR_FORMAT_RGB565A8 ?
+                            frame->data + frame->header.stride * frame->header.h : NULL;
+    uint32_t fstride = frame ? frame->header.stride / 2 : 0;
+
+    for (int32_t y = r->y1; y <= r->y2; y++) {
+        uint16_t *dst = c->pixels + y * canvas_w;
+        const uint8_t *idx = c->bg_index + y * c->bg_stride;
+        int32_t sx1 = r->x2 + 1, sx2 = r->x2;
+        if (frame && y >= fr->y1 && y <= fr->y2) {
+            sx1 = LV_MAX(r->x1, fr->x1);
+            sx2 = LV_MIN(r->x2, fr->x2);
+        }
+        int32_t x = r->x1;
+        for (; x < sx1 && x <= r->x2; x++) dst[x] = c->lut[idx[x]];
+        if (sx1 <= sx2 && !falpha) {
+            memcpy(dst + sx1, fcolor + (y - fr->y1) * fstride + (sx1 - fr->x1), (size_t)(sx2 - sx1 + 1) * sizeof(uint16_t));
+            x = sx2 + 1;
+        } else if (sx1 <= sx2) {
+            const uint16_t *src = fcolor + (y - fr->y1) * fstride + (sx1 - fr->x1);
+            const uint8_t *a = falpha + (y - fr->y1) * fstride + (sx1 - fr->x1);
+            for (; x <= sx2; x++, src++, a++) {
+                if (*a == LV_OPA_COVER) dst[x] = *src;
+                else if (*a == LV_OPA_TRANSP) dst[x] = c->lut[idx[x]];
+                else dst[x] = rgb565_mix(*src, c->lut[idx[x]], *a);
+            }
+        }
+        for (; x <= r->x2; x++) dst[x] = c->lut[idx[x]];
+    }
+    c->pixels_done += (uint64_t)lv_area_get_size(r);
+}
+
+// Invalida una zona del lienzo en pantalla.
+static void invalidate_canvas_area(const lv_area_t *r) {
+    lv_area_t coords;
+    lv_obj_get_coords(s_bg_cache->obj, &coords);
+    lv_area_t area = *r;
+    lv_area_move(&area, coords.x1, coords.y1);
+    lv_obj_invalidate_area(s_bg_cache->obj, &area);
+}
+
+bool ui_helpers_bg_cache_create(lv_obj_t* img_obj, const lv_area_t* canvas) {
+    if (s_bg_cache || !img_obj || !canvas) return s_bg_cache != NULL;
+    if (bg_0.header.cf != LV_COLOR_FORMAT_I8 || canvas->x1 < 0 || canvas->y1 < 0 ||
+        canvas->x2 >= (int32_t)bg_0.header.w || canvas->y2 >= (int32_t)bg_0.header.h) {
+        ESP_LOGW(TAG_HELPERS, "El lienzo no cabe en el fondo indexado: los fotogramas se dibujan sobre el fondo.");
+        return false;
+    }
+
+    int32_t w = lv_area_get_width(canvas);
+    int32_t h = lv_area_get_height(canvas);
+    size_t bytes = (size_t)w * h * sizeof(uint16_t);
+    if (heap_caps_get_free_size(MALLOC_CAP_INTERNAL) < bytes + sizeof(bg_cache_t) + BG_CACHE_MIN_FREE_RAM) {
+        ESP_LOGW(TAG_HELPERS, "Sin RAM para la caché del fondo (%u bytes): los fotogramas se dibujan sobre el fondo.", (unsigned)bytes);
+        return false;
+    }
+    bg_cache_t *c = heap_caps_calloc(1, sizeof(bg_cache_t), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    uint16_t *pixels = heap_caps_malloc(bytes, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    if (!c || !pixels) {
+        heap_caps_free(c);
+        heap_caps_free(pixels);
+        ESP_LOGW(TAG_HELPERS, "No se pudo reservar la caché del fondo: los fotogramas se dibujan sobre el fondo.");
+        return false;
+    }
+
+    // I8: paleta de 256 colores ARGB8888 y después un índice por píxel.
+    const lv_color32_t *palette = (const lv_color32_t *)bg_0.data;
+    for (int i = 0; i < BG_PALETTE_SIZE; i++) {
+        lv_color_t col = lv_color_mix(lv_color_make(palette[i].red, palette[i].green, palette[i].blue),
+                                      lv_color_black(), palette[i].alpha);
+        uint16_t v = lv_color_to_u16(col);
+#if CONFIG_LVGL_PORT_RGB565_BIG_ENDIAN
+        v = rgb565_swap(v);
+#endif
+        c->lut[i] = v;
+    }
+    c->obj = img_obj;
+    c->canvas = *canvas;
+    c->pixels = pixels;
+    c->bg_stride = bg_0.header.stride;
+    c->bg_index = bg_0.data + BG_PALETTE_SIZE * sizeof(lv_color32_t) + canvas->y1 * c->bg_stride + canvas->x1;
+    c->dsc.header.magic = LV_IMAGE_HEADER_MAGIC;
+    c->dsc.header.cf = LV_COLOR_FORMAT_RGB565;
+    c->dsc.header.w = w;
+    c->dsc.header.h = h;
+    c->dsc.header.stride = w * sizeof(uint16_t);
+    c->dsc.data_size = bytes;
+    c->dsc.data = (const uint8_t *)pixels;
+    lv_area_set(&c->sprite, 0, 0, -1, -1);
+    s_bg_cache = c;
+
+    lv_area_t all;
+    lv_area_set(&all, 0, 0, w - 1, h - 1);
+    compose_area(&all, NULL, NULL);
+    c->pixels_done = 0;
+    ESP_LOGI(TAG_HELPERS, "Caché del fondo de %ldx%ld (%u bytes) lista para componer las animaciones.",
+             (long)w, (long)h, (unsigned)bytes);
+    return true;
+}
+
+void ui_helpers_bg_cache_destroy(void) {
+    bg_cache_t *c = s_bg_cache;
+    if (!c) return;
+    if (lv_obj_is_valid(c->obj) && lv_image_get_src(c->obj) == &c->dsc) {
+        lv_image_set_src(c->obj, NULL);
+    }
+    s_bg_cache = NULL;
+    heap_caps_free(c->pixels);
+    heap_caps_free(c);
+    ESP_LOGI(TAG_HELPERS, "Caché del fondo liberada.");
+}
+
+bool ui_helpers_bg_cache_show(const lv_img_dsc_t* frame, int32_t x, int32_t y, const lv_area_t* dirty, uint8_t dirty_count) {
+    bg_cache_t *c = s_bg_cache;
+    if (!c || !frame || !frame->data ||
+        (frame->header.cf != LV_COLOR_FORMAT_RGB565A8 && frame->header.cf != LV_COLOR_FORMAT_RGB565)) {
+        return false;
+    }
+
+    lv_area_t sprite;
+    lv_area_set(&sprite, x, y, x + frame->header.w - 1, y + frame->header.h - 1);
+    lv_area_t bounds;
+    lv_area_set(&bounds, 0, 0, c->dsc.header.w - 1, c->dsc.header.h - 1);
+    if (!_lv_area_is_in(&sprite, &bounds, 0)) return false;
+
+    int64_t t0 = esp_timer_get_time();
+    bool showing = lv_image_get_src(c->obj) == &c->dsc;
+    bool same = showing && frame->data == c->sprite_data && sprite.x1 == c->sprite.x1 && sprite.y1 == c->sprite.y1 &&
+                sprite.x2 == c->sprite.x2 && sprite.y2 == c->sprite.y2;
+
+    if (same && dirty_count > 0) {
+        // Mismo recorte sobre el mismo búfer: solo cambian sus zonas modificadas.
+        for (uint8_t i = 0; i < dirty_count; i++) {
+            lv_area_t area = dirty[i];
+            lv_area_move(&area, sprite.x1, sprite.y1);
+            if (!_lv_area_intersect(&area, &area, &sprite)) continue;
+            compose_area(&area, frame, &sprite);
+            invalidate_canvas_area(&area);
+        }
+        c->partial_frames++;
+    } else {
+        // El recorte anterior vuelve a ser fondo salvo lo que tape el nuevo.
+        lv_area_t old = c->sprite;
+        bool had_old = old.x2 >= old.x1 && !_lv_area_is_in(&old, &sprite, 0);
+        compose_area(&sprite, frame, &sprite);
+        if (had_old) compose_area(&old, frame, &sprite);
+        if (!showing) {
+            // set_src invalida el objeto entero (estaba mostrando un fotograma sin componer).
+            lv_obj_set_pos(c->obj, c->canvas.x1, c->canvas.y1);
+            lv_image_set_src(c->obj, &c->dsc);
+        } else {
+            invalidate_canvas_area(&sprite);
+            if (had_old) invalidate_canvas_area(&old);
+        }
+    }
+    c->sprite = sprite;
+    c->sprite_data = frame->data;
+    c->frames++;
+    c->us += (uint64_t)(esp_timer_get_time() - t0);
+    return true;
+}
+
+void ui_helpers_bg_cache_log_stats(void) {
+    bg_cache_t *c = s_bg_cache;
+    if (!c || c->frames == 0) return;
+    ESP_LOGI(TAG_HELPERS, "Composición sobre el fondo: %lu fotogramas (%lu solo por zonas), %llu Kpx, %llu us (media %lu us).",
+             (unsigned long)c->frames, (unsigned long)c->partial_frames, (unsigned long long)(c->pixels_done / 1000),
+             (unsigned long long)c->us, (unsigned long)(c->us / c->frames));
+}
+
+#else
+
+bool ui_helpers_bg_cache_create(lv_obj_t* img_obj, const lv_area_t* canvas) { return false; }
+void ui_helpers_bg_cache_destroy(void) {}
+bool ui_helpers_bg_cache_show(const lv_img_dsc_t* frame, int32_t x, int32_t y, const lv_area_t* dirty, uint8_t dirty_count) { return false; }
+void ui_helpers_bg_cache_log_stats(void) {}
+
+#endif // CONFIG_DIYMON_BG_COMPOSITOR
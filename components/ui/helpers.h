@@ -1,7 +1,7 @@
-/* Fecha: 17/08/2025 - 10:18  */
+/* Fecha: 18/10/2026 - 04:00  */
 /* Fichero: components/ui/helpers.h */
-/* Último cambio: Renombrado de 'diymon_ui_helpers.h' para simplificar y estandarizar. */
-/* Descripción: Funciones de ayuda para la interfaz de usuario. Proporciona utilidades para construir rutas de assets y cargar elementos visuales como el fondo de pantalla. */
+/* Último cambio: Firma del fondo bajo el lienzo para los fotogramas premezclados y objeto imagen opaco con imágenes RGB565. */
+/* Descripción: Funciones de ayuda para la interfaz de usuario. Proporciona utilidades para construir rutas de assets y cargar elementos visuales como el fondo de pantalla. 'ui_helpers_bg_cache_*' guardan una copia opaca del fondo bajo el lienzo de animación y componen sobre ella cada fotograma RGB565A8, de modo que LVGL dibuja el lienzo como una sola copia sin pintar el fondo debajo. 'ui_helpers_get_background_signature' identifica el fondo bajo el lienzo para elegir los fotogramas premezclados con él. */
 #ifndef HELPERS_H
 #define HELPERS_H
 
@@ -13,4 +13,20 @@ void ui_helpers_free_background_buffer(void);
 void ui_helpers_create_diymon_gif(lv_obj_t* parent);
 void ui_helpers_free_gif_buffer(void);
 
+// --- FONDO BAJO LAS ANIMACIONES ---
+// Firma del fondo bajo 'canvas' (la de 'anim_pack.py --preblend'); 0 si el fondo no es el indexado o no lo cubre.
+uint32_t ui_helpers_get_background_signature(const lv_area_t* canvas);
+// Mientras 'img_obj' muestre una imagen RGB565 (opaca), LVGL no dibuja lo que queda debajo.
+void ui_helpers_cover_when_opaque(lv_obj_t* img_obj);
+
+// --- CACHÉ DEL FONDO PARA LAS ANIMACIONES ---
+// 'canvas' es la zona del lienzo en coordenadas del padre del fondo; 'img_obj' es el objeto que mostrará la composición.
+bool ui_helpers_bg_cache_create(lv_obj_t* img_obj, const lv_area_t* canvas);
+void ui_helpers_bg_cache_destroy(void);
+// Compone 'frame' (RGB565A8, o RGB565 premezclado) en (x, y) del lienzo y lo muestra. 'dirty' (en coordenadas del fotograma) limita el
+// trabajo a las zonas que cambiaron respecto al fotograma anterior del mismo recorte; con 'dirty_count' = 0 se
+// recompone el recorte entero. Devuelve false si no hay caché o el fotograma no se puede componer.
+bool ui_helpers_bg_cache_show(const lv_img_dsc_t* frame, int32_t x, int32_t y, const lv_area_t* dirty, uint8_t dirty_count);
+void ui_helpers_bg_cache_log_stats(void);
+
 #endif // HELPERS_H
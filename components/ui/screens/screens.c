@@ -1,6 +1,6 @@
 /* Fichero: components/ui/screens/screens.c */
-/* Descripción: Diagnóstico de Causa Raíz: La pantalla de 1.47" tiene una resolución física ligeramente mayor que su resolución lógica de 172px, lo que provoca que se muestren píxeles no inicializados (ruido visual) en los bordes laterales. Solución Definitiva: Se ha modificado la creación de la pantalla principal ('g_main_screen_obj') para que tenga un fondo negro sólido y opaco, sin bordes ni padding. Al establecer explícitamente el color de fondo de todo el objeto de la pantalla, se asegura que LVGL limpie todo el framebuffer a negro en cada ciclo de renderizado, eliminando eficazmente el ruido visual y creando bordes negros limpios en los laterales. */
-/* Último cambio: 21/08/2025 - 19:09 */
+/* Descripción: Diagnóstico de Causa Raíz: La pantalla de 1.47" tiene una resolución física ligeramente mayor que su resolución lógica de 172px, lo que provoca que se muestren píxeles no inicializados (ruido visual) en los bordes laterales. Solución Definitiva: Se ha modificado la creación de la pantalla principal ('g_main_screen_obj') para que tenga un fondo negro sólido y opaco, sin bordes ni padding. Al establecer explícitamente el color de fondo de todo el objeto de la pantalla, se asegura que LVGL limpie todo el framebuffer a negro en cada ciclo de renderizado, eliminando eficazmente el ruido visual y creando bordes negros limpios en los laterales. Tras crear el fondo y el objeto de animación se crea la caché del fondo bajo el lienzo (CONFIG_DIYMON_BG_COMPOSITOR), sobre la que se componen los fotogramas; se libera al limpiar la pantalla, antes que el búfer de animación. Con CONFIG_DIYMON_ANIM_PREBLENDED se pasa al cargador la firma del fondo bajo el lienzo, de modo que los packs premezclados contra este fondo se muestran como RGB565 opaco; al limpiar la pantalla la firma vuelve a 0. */
+/* Último cambio: 18/10/2026 - 04:00 */
 #include "screens.h"
 #include "ui_idle_animation.h"
 #include "ui_actions_panel.h"
@@ -11,6 +11,8 @@
 #include "bsp_api.h"
 #include "screen_manager.h"
 #include "ui_asset_loader.h"
+#include "animation_loader.h"
+#include "sdkconfig.h"
 
 static const char *TAG = "SCREENS";
 
@@ -41,6 +43,14 @@ static void cleanup_main_screen_resources(void) {
     telemetry_manager_destroy();
     ESP_LOGI(TAG, "[CLEANUP] <- Gestor de telemetría destruido.");
 
+#if CONFIG_DIYMON_ANIM_PREBLENDED
+    animation_loader_set_background_signature(0);
+#endif
+
+    ESP_LOGI(TAG, "[CLEANUP] -> Liberando caché del fondo...");
+    ui_helpers_bg_cache_destroy();
+    ESP_LOGI(TAG, "[CLEANUP] <- Caché del fondo liberada.");
+
     ESP_LOGI(TAG, "[CLEANUP] -> Liberando buffer de animación compartido...");
     ui_action_animations_destroy();
     ESP_LOGI(TAG, "[CLEANUP] <- Buffer de animación liberado.");
@@ -69,6 +79,14 @@ void create_screen_main(void) {
 
     ui_helpers_load_background(g_main_screen_obj);
     ui_action_animations_create(g_main_screen_obj);
+    lv_area_t canvas;
+    if (ui_action_animations_get_canvas_area(&canvas)) {
+        ui_helpers_bg_cache_create(g_animation_img_obj, &canvas);
+#if CONFIG_DIYMON_ANIM_PREBLENDED
+        // Antes de arrancar el reposo: sus primeros fotogramas ya salen de las secuencias premezcladas.
+        animation_loader_set_background_signature(ui_helpers_get_background_signature(&canvas));
+#endif
+    }
     g_idle_animation_obj = ui_idle_animation_start(g_main_screen_obj);
     ui_actions_panel_create(g_main_screen_obj);
     telemetry_manager_create(g_main_screen_obj);
@@ -1,13 +1,20 @@
-/* Fecha: 17/08/2025 - 10:25  */
+/* Fecha: 18/10/2026 - 04:00  */
 /* Fichero: components/ui/ui_action_animations.c */
-/* Último cambio: Actualizada la inclusión de 'diymon_ui_helpers.h' a 'helpers.h' para corregir el error de compilación. */
-/* Descripción: Se ha corregido la directiva de inclusión para que apunte al fichero de cabecera renombrado 'helpers.h'. Esto resuelve el error 'No such file or directory' que impedía la compilación. */
+/* Último cambio: El objeto imagen tapa el fondo mientras muestra una imagen RGB565 (fotogramas premezclados o la composición). */
+/* Descripción: Los fotogramas recortados del pack solo contienen la zona visible del personaje. El lienzo de 150x230 se sigue colocando abajo y centrado (30 px sobre el borde); al crear el objeto se calcula el origen de ese lienzo y 'ui_action_animations_show_frame' sitúa el objeto imagen en origen + (frame_x, frame_y) antes de mostrar cada fotograma, de forma que LVGL solo mezcla los píxeles del recorte. Con CONFIG_DIYMON_ANIM_STREAM_DECODER no se reserva el búfer compartido: se registra el decodificador por bandas y el objeto imagen recibe la ruta virtual '.anim' de cada fotograma en lugar del descriptor en RAM. Cada acción se reproduce contra el reloj de animación: FRAME_INTERVAL_MS es solo la duración por defecto de los fotogramas sin 'duration_ms' en el pack, el temporizador se reprograma para despertar a la hora de salida del siguiente fotograma y, si una lectura lenta retrasa la animación, se saltan los fotogramas vencidos. Los toques que llegan durante una acción ya no se descartan: entran en una cola acotada (ACTION_QUEUE_LEN) y un toque repetido de la misma acción que ya espera al final de la cola se fusiona con ella. Al encolar se resuelven el directorio y el número de fotogramas; cuando la acción en curso muestra su último fotograma se pide al precargador el primer fotograma de la siguiente, que empieza en cuanto termina la actual sin pasar por la animación de reposo. Al terminar una acción se registran los contadores del reloj (FPS conseguidos frente a programados, retraso por fotograma), del precargador, de la caché del cargador, en ese modo del decodificador, el uso del bus SPI por la pantalla y la SD (tiempo con el bus y esperando, lecturas aplazadas) y el tiempo de CPU del flush. Si el fotograma viene de la copia del pack en flash ('flash_dsc'), el objeto imagen apunta directamente a ella. Un fotograma que no se puede cargar sigue terminando la acción, salvo que la comprobación de la SD (animation_integrity.c) lo tenga marcado como defectuoso: entonces se descarta como un fotograma vencido y la acción continúa. Las dimensiones del lienzo (ANIM_CANVAS_W/H) están en la interfaz del módulo. Si la pantalla creó la caché del fondo ('ui_helpers_bg_cache_create' sobre la zona que da 'ui_action_animations_get_canvas_area'), 'ui_action_animations_show_frame' le pasa primero el fotograma de RAM o de flash con sus zonas modificadas; solo si no lo puede componer se usa el camino de siempre. Al terminar una acción se registra también el coste de la composición. Los fotogramas premezclados (RGB565 opaco, elegidos por el cargador cuando el pack se generó contra el fondo en pantalla) siguen el mismo camino: la caché del fondo los copia sin mezclar y, sin ella, el objeto imagen los muestra en su recorte y, como es opaco, LVGL no dibuja el fondo debajo ('ui_helpers_cover_when_opaque'). */
 
 #include "ui_action_animations.h"
 #include "animation_loader.h"
+#include "animation_prefetch.h"
+#include "animation_decoder.h"
+#include "animation_clock.h"
+#include "animation_flash.h"
+#include "animation_integrity.h"
+#include "bsp_api.h"
 #include "helpers.h" // Corregido desde diymon_ui_helpers.h
 #include "ui_idle_animation.h"
 #include "esp_log.h"
+#include "sdkconfig.h"
 #include <stdio.h>
 #include <string.h>
 
@@ -19,105 +26,235 @@ static animation_t g_animation_player; // Player global que contiene el búfer c
 
 static lv_timer_t *s_anim_timer;
 static bool s_is_action_in_progress = false;
-static int s_current_frame_index;
+static animation_clock_t s_action_clock;
+static lv_point_t s_canvas_origin; // Esquina superior izquierda del lienzo dentro del padre.
 
-#define FRAME_INTERVAL_MS 500
+#define ANIM_CANVAS_BOTTOM_MARGIN 30
+#define FRAME_INTERVAL_MS 500   // Duración de los fotogramas sin 'duration_ms' en el pack.
+#define PREFETCH_POLL_MS  10   // Reintento mientras el fotograma siguiente se termina de leer.
+#define ACTION_QUEUE_LEN  4    // Acciones pendientes como máximo; las que no caben se descartan.
+
+// Acción ya resuelta: directorio de la evolución y número de fotogramas.
+typedef struct {
+    diymon_action_id_t action_id;
+    uint16_t frame_count;
+    char base_path[96];
+} queued_action_t;
+
+static queued_action_t s_queue[ACTION_QUEUE_LEN];
+static uint8_t s_queue_head = 0;
+static uint8_t s_queue_count = 0;
+static struct {
+    uint32_t queued;            // Toques encolados durante otra acción.
+    uint32_t coalesced;         // Toques repetidos fusionados con el último encolado.
+    uint32_t dropped;           // Toques descartados con la cola llena.
+    uint32_t chained;           // Acciones encadenadas sin pasar por reposo.
+} s_queue_stats;
 
 // --- Declaraciones de Funciones Internas ---
 static void animation_timer_cb(lv_timer_t *timer);
 static void animation_finished(void);
 static const char* get_anim_prefix(diymon_action_id_t action_id);
+static bool resolve_action(diymon_action_id_t action_id, queued_action_t *out);
+static void start_action(const queued_action_t *action);
 
 // --- Implementación de Funciones Públicas ---
 
 void ui_action_animations_preinit_buffer(void) {
     // Reservar el búfer de animación compartido UNA SOLA VEZ.
-    g_animation_player = animation_loader_init(NULL, 150, 230, 0);
+    g_animation_player = animation_loader_init(NULL, ANIM_CANVAS_W, ANIM_CANVAS_H, 0);
+#if CONFIG_DIYMON_ANIM_STREAM_DECODER
+    // Sin búfer compartido: LVGL pide al decodificador solo las filas que dibuja.
+    if (!animation_decoder_init(ANIM_CANVAS_W, ANIM_CANVAS_H)) {
+        g_animation_player.width = 0; // Sin decodificador no hay forma de mostrar fotogramas.
+    }
+    animation_prefetch_init(&g_animation_player); // Sin búfer queda en modo síncrono.
+#else
     if (g_animation_player.img_dsc.data == NULL) {
         ESP_LOGE(TAG, "FALLO CRÍTICO: No se pudo reservar memoria para el búfer de animación compartido.");
     } else {
         ESP_LOGI(TAG, "Búfer de animación compartido (150x230) pre-reservado correctamente.");
+        animation_prefetch_init(&g_animation_player);
     }
+#endif
 }
 
 void ui_action_animations_create(lv_obj_t *parent) {
-    if (g_animation_player.img_dsc.data == NULL) {
+    if (!animation_loader_is_ready(&g_animation_player)) {
         ESP_LOGE(TAG, "El búfer de animación compartido no fue pre-reservado. No se puede crear el objeto de animación.");
         return;
     }
     
     g_animation_img_obj = lv_image_create(parent);
-    lv_image_set_src(g_animation_img_obj, &g_animation_player.img_dsc);
+    if (g_animation_player.img_dsc.data) {
+        lv_image_set_src(g_animation_img_obj, &g_animation_player.img_dsc);
+    }
     
     lv_obj_set_style_bg_opa(g_animation_img_obj, LV_OPA_TRANSP, 0);
-    lv_obj_align(g_animation_img_obj, LV_ALIGN_BOTTOM_MID, 0, -30);
+    ui_helpers_cover_when_opaque(g_animation_img_obj);
+
+    // Mismo sitio que el antiguo lv_obj_align(LV_ALIGN_BOTTOM_MID, 0, -30) del lienzo completo.
+    lv_obj_update_layout(parent);
+    s_canvas_origin.x = (lv_obj_get_content_width(parent) - ANIM_CANVAS_W) / 2;
+    s_canvas_origin.y = lv_obj_get_content_height(parent) - ANIM_CANVAS_H - ANIM_CANVAS_BOTTOM_MARGIN;
+    lv_obj_set_pos(g_animation_img_obj, s_canvas_origin.x, s_canvas_origin.y);
+}
+
+bool ui_action_animations_get_canvas_area(lv_area_t *out) {
+    if (!g_animation_img_obj || !out) return false;
+    lv_area_set(out, s_canvas_origin.x, s_canvas_origin.y,
+                s_canvas_origin.x + ANIM_CANVAS_W - 1, s_canvas_origin.y + ANIM_CANVAS_H - 1);
+    return true;
 }
 
 void ui_action_animations_play(diymon_action_id_t action_id) {
-    if (s_is_action_in_progress || action_id >= ACTION_ID_COUNT) return;
-    if (g_animation_player.img_dsc.data == NULL) {
+    if (action_id >= ACTION_ID_COUNT) return;
+    if (!animation_loader_is_ready(&g_animation_player)) {
         ESP_LOGE(TAG, "No se puede iniciar la animación: el búfer compartido no está disponible.");
         return;
     }
 
-    s_is_action_in_progress = true;
-    
-    ui_idle_animation_pause();
-
-    const char *prefix = get_anim_prefix(action_id);
-    char path_buffer[128];
-    ui_helpers_build_asset_path(path_buffer, sizeof(path_buffer), "");
-    size_t len = strlen(path_buffer);
-    if (len > 0 && path_buffer[len - 1] == '/') path_buffer[len - 1] = '\0';
-    
-    uint16_t frame_count = animation_loader_count_frames(path_buffer, prefix);
-    if (frame_count == 0) {
-        ESP_LOGE(TAG, "No se encontraron fotogramas para la animación '%s' en '%s'.", prefix, path_buffer);
-        animation_finished(); 
+    if (s_is_action_in_progress) {
+        // Durante una acción el toque se encola; un toque repetido se fusiona con el último pendiente.
+        if (s_queue_count > 0 && s_queue[(s_queue_head + s_queue_count - 1) % ACTION_QUEUE_LEN].action_id == action_id) {
+            s_queue_stats.coalesced++;
+            return;
+        }
+        if (s_queue_count == ACTION_QUEUE_LEN) {
+            s_queue_stats.dropped++;
+            ESP_LOGW(TAG, "Cola de acciones llena (%d). Se descarta '%s'.", ACTION_QUEUE_LEN, get_anim_prefix(action_id));
+            return;
+        }
+        queued_action_t *slot = &s_queue[(s_queue_head + s_queue_count) % ACTION_QUEUE_LEN];
+        if (!resolve_action(action_id, slot)) return;
+        s_queue_count++;
+        s_queue_stats.queued++;
+        ESP_LOGI(TAG, "Acción '%s' encolada (%d pendientes).", get_anim_prefix(action_id), s_queue_count);
         return;
     }
-    
-    ESP_LOGI(TAG, "Reproduciendo animación '%s' (%d fotogramas) a %dms/frame.", prefix, frame_count, FRAME_INTERVAL_MS);
 
-    if (g_animation_player.base_path) free(g_animation_player.base_path);
-    g_animation_player.base_path = strdup(path_buffer);
-    g_animation_player.frame_count = frame_count;
-
-    s_current_frame_index = 0;
-    if (animation_loader_load_frame(&g_animation_player, s_current_frame_index, prefix)) {
-        lv_obj_invalidate(g_animation_img_obj);
-        s_anim_timer = lv_timer_create(animation_timer_cb, FRAME_INTERVAL_MS, (void*)(intptr_t)action_id);
-    } else {
-        ESP_LOGE(TAG, "Fallo al cargar el primer fotograma (%s).", prefix);
+    queued_action_t action;
+    s_is_action_in_progress = true;
+    ui_idle_animation_pause();
+    if (!resolve_action(action_id, &action)) {
         animation_finished();
+        return;
     }
+    start_action(&action);
 }
 
 void ui_action_animations_destroy(void) {
     ESP_LOGI(TAG, "Liberando búfer de animación compartido.");
+    animation_prefetch_deinit(&g_animation_player);
     animation_loader_free(&g_animation_player);
+    s_queue_head = 0;
+    s_queue_count = 0;
+#if CONFIG_DIYMON_ANIM_STREAM_DECODER
+    animation_decoder_deinit();
+#endif
+    animation_loader_close_pack();
+}
+
+bool ui_action_animations_is_playing(void) {
+    return s_is_action_in_progress;
 }
 
 animation_t* ui_action_animations_get_player(void) {
     return &g_animation_player;
 }
 
+void ui_action_animations_show_frame(animation_t *anim) {
+    if (!g_animation_img_obj || !anim) return;
+
+    int32_t x = s_canvas_origin.x + anim->frame_x;
+    int32_t y = s_canvas_origin.y + anim->frame_y;
+    bool moved = lv_obj_get_x(g_animation_img_obj) != x || lv_obj_get_y(g_animation_img_obj) != y;
+
+    // Con la caché del fondo el fotograma se compone sobre ella; el objeto ya no se mueve con el recorte.
+    if (anim->flash_dsc.data) {
+        if (ui_helpers_bg_cache_show(&anim->flash_dsc, anim->frame_x, anim->frame_y, NULL, 0)) return;
+    } else if (anim->img_dsc.data) {
+        if (ui_helpers_bg_cache_show(&anim->img_dsc, anim->frame_x, anim->frame_y, anim->dirty.areas, anim->dirty.count)) return;
+    }
+
+    if (anim->flash_dsc.data) {
+        // Fotograma sin copia desde la flash: siempre completo.
+        lv_obj_set_pos(g_animation_img_obj, x, y);
+        lv_image_set_src(g_animation_img_obj, &anim->flash_dsc);
+        return;
+    }
+
+    if (!anim->img_dsc.data) {
+        // Decodificación por bandas: la fuente es la ruta virtual del fotograma.
+        if (anim->frame_src[0] == '\0') return;
+        lv_obj_set_pos(g_animation_img_obj, x, y);
+        lv_image_set_src(g_animation_img_obj, anim->frame_src);
+        return;
+    }
+
+    if (moved || anim->dirty.count == 0 || lv_image_get_src(g_animation_img_obj) != &anim->img_dsc) {
+        // lv_obj_set_pos invalida la zona antigua y la nueva; set_src ajusta el tamaño al recorte.
+        lv_obj_set_pos(g_animation_img_obj, x, y);
+        lv_image_set_src(g_animation_img_obj, &anim->img_dsc);
+        return;
+    }
+
+    // Las zonas vienen en coordenadas del fotograma; se trasladan a las del objeto en pantalla.
+    lv_area_t coords;
+    lv_obj_get_coords(g_animation_img_obj, &coords);
+    for (uint8_t i = 0; i < anim->dirty.count; i++) {
+        lv_area_t area = anim->dirty.areas[i];
+        lv_area_move(&area, coords.x1, coords.y1);
+        lv_obj_invalidate_area(g_animation_img_obj, &area);
+    }
+}
+
 static void animation_timer_cb(lv_timer_t *timer) {
-    s_current_frame_index++;
-    if (s_current_frame_index >= g_animation_player.frame_count) {
+    uint32_t wait_ms;
+    int32_t next = animation_clock_poll(&s_action_clock, &wait_ms);
+    if (next == ANIM_CLOCK_END) {
         animation_finished();
         return;
     }
+    if (next == ANIM_CLOCK_WAIT) {
+        lv_timer_set_period(timer, wait_ms);
+        return;
+    }
 
     diymon_action_id_t action_id = (diymon_action_id_t)(intptr_t)timer->user_data;
     const char *prefix = get_anim_prefix(action_id);
 
-    if (animation_loader_load_frame(&g_animation_player, s_current_frame_index, prefix)) {
-        lv_obj_invalidate(g_animation_img_obj);
-    } else {
-        ESP_LOGW(TAG, "No se pudo cargar el fotograma %d para %s. Finalizando animación.", s_current_frame_index + 1, prefix);
-        animation_finished();
+    switch (animation_prefetch_present(&g_animation_player, prefix, next)) {
+        case ANIM_PREFETCH_PENDING:
+            // Se mantiene el fotograma actual en pantalla y se reintenta pronto.
+            lv_timer_set_period(timer, PREFETCH_POLL_MS);
+            return;
+        case ANIM_PREFETCH_FAILED:
+            if (animation_integrity_is_bad(g_animation_player.base_path, prefix, (uint16_t)next)) {
+                // Fotograma marcado como defectuoso: se salta y se mantiene el anterior en pantalla.
+                animation_clock_dropped(&s_action_clock);
+                break;
+            }
+            ESP_LOGW(TAG, "No se pudo cargar el fotograma %ld para %s. Finalizando animación.", (long)next + 1, prefix);
+            animation_finished();
+            return;
+        case ANIM_PREFETCH_PRESENTED:
+            animation_clock_presented(&s_action_clock);
+            ui_action_animations_show_frame(&g_animation_player);
+            break;
     }
+
+    uint16_t following = animation_integrity_next_good(g_animation_player.base_path, prefix, (uint16_t)(next + 1),
+                                                       g_animation_player.frame_count, false);
+    if (following < g_animation_player.frame_count) {
+        animation_prefetch_request(g_animation_player.base_path, prefix, following);
+    } else if (s_queue_count > 0) {
+        // Último fotograma en pantalla: se adelanta la lectura del primero de la acción encolada.
+        const queued_action_t *queued = &s_queue[s_queue_head];
+        animation_prefetch_request(queued->base_path, get_anim_prefix(queued->action_id), 0);
+    }
+    // Se despierta a la hora de salida del siguiente; si ya pasó, el próximo tick salta los vencidos.
+    lv_timer_set_period(timer, LV_MAX(1, animation_clock_wait_ms(&s_action_clock)));
 }
 
 static void animation_finished(void) {
@@ -131,13 +268,79 @@ static void animation_finished(void) {
         g_animation_player.base_path = NULL;
     }
     g_animation_player.frame_count = 0;
-    
+    animation_clock_stop(&s_action_clock);
+    animation_clock_log_stats(&s_action_clock);
+    animation_prefetch_log_stats();
+    animation_loader_cache_log_stats();
+#if CONFIG_DIYMON_ANIM_STREAM_DECODER
+    animation_decoder_log_stats();
+#endif
+    bsp_spi_arbiter_log_stats();
+    bsp_lcd_flush_log_stats();
+    ui_helpers_bg_cache_log_stats();
+    animation_flash_log_stats();
+    animation_integrity_log_stats();
+
+    while (s_queue_count > 0) {
+        // Siguiente acción encolada, sin volver a reposo entre medias.
+        queued_action_t action = s_queue[s_queue_head];
+        s_queue_head = (s_queue_head + 1) % ACTION_QUEUE_LEN;
+        s_queue_count--;
+
+        char path_buffer[sizeof(action.base_path)];
+        ui_helpers_build_asset_path(path_buffer, sizeof(path_buffer), "");
+        size_t len = strlen(path_buffer);
+        if (len > 0 && path_buffer[len - 1] == '/') path_buffer[len - 1] = '\0';
+        // Si la evolución cambió mientras esperaba, se vuelve a resolver en el directorio nuevo.
+        if (strcmp(path_buffer, action.base_path) != 0 && !resolve_action(action.action_id, &action)) continue;
+
+        s_queue_stats.chained++;
+        ESP_LOGI(TAG, "[cola] encoladas=%lu fusionadas=%lu descartadas=%lu encadenadas=%lu",
+                 (unsigned long)s_queue_stats.queued, (unsigned long)s_queue_stats.coalesced,
+                 (unsigned long)s_queue_stats.dropped, (unsigned long)s_queue_stats.chained);
+        start_action(&action);
+        return;
+    }
+
     ui_idle_animation_resume();
     
     s_is_action_in_progress = false;
     ESP_LOGI(TAG, "Animación de acción finalizada. Control devuelto a idle.");
 }
 
+static bool resolve_action(diymon_action_id_t action_id, queued_action_t *out) {
+    const char *prefix = get_anim_prefix(action_id);
+    out->action_id = action_id;
+    ui_helpers_build_asset_path(out->base_path, sizeof(out->base_path), "");
+    size_t len = strlen(out->base_path);
+    if (len > 0 && out->base_path[len - 1] == '/') out->base_path[len - 1] = '\0';
+
+    out->frame_count = animation_loader_count_frames(out->base_path, prefix);
+    if (out->frame_count == 0) {
+        ESP_LOGE(TAG, "No se encontraron fotogramas para la animación '%s' en '%s'.", prefix, out->base_path);
+        return false;
+    }
+    return true;
+}
+
+static void start_action(const queued_action_t *action) {
+    const char *prefix = get_anim_prefix(action->action_id);
+    ESP_LOGI(TAG, "Reproduciendo animación '%s' (%d fotogramas, %dms/frame por defecto).", prefix, action->frame_count, FRAME_INTERVAL_MS);
+
+    if (g_animation_player.base_path) free(g_animation_player.base_path);
+    g_animation_player.base_path = strdup(action->base_path);
+    g_animation_player.frame_count = action->frame_count;
+
+    // El primer fotograma se presenta en el primer tick, en cuanto el precargador lo tenga listo
+    // (si la acción venía de la cola, ya se pidió al mostrar el último fotograma de la anterior).
+    animation_clock_init(&s_action_clock, "accion", FRAME_INTERVAL_MS);
+    animation_clock_start(&s_action_clock, g_animation_player.base_path, prefix, action->frame_count, false);
+    animation_prefetch_attach(&g_animation_player);
+    animation_prefetch_request(g_animation_player.base_path, prefix, 0);
+    s_anim_timer = lv_timer_create(animation_timer_cb, PREFETCH_POLL_MS, (void*)(intptr_t)action->action_id);
+    lv_timer_ready(s_anim_timer);
+}
+
 static const char* get_anim_prefix(diymon_action_id_t action_id) {
     switch(action_id) {
         case ACTION_ID_COMER:     return "ANIM_EAT_";
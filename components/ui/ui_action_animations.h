@@ -1,8 +1,8 @@
 /*
 # Fichero: Z:\DIYTOGETHER\DIYtogether\components\diymon_ui\ui_action_animations.h
-# Fecha: $timestamp
-# Último cambio: Añadida la declaración de la función de pre-reserva de buffer.
-# Descripción: Interfaz pública para el módulo de animaciones de acción. Se añade la declaración de `ui_action_animations_preinit_buffer` para que la función sea visible para otros módulos y se resuelva así el error de compilación por declaración implícita.
+# Fecha: 18/10/2026 - 03:30
+# Último cambio: 'ui_action_animations_get_canvas_area' da la zona del lienzo para crear la caché del fondo.
+# Descripción: Interfaz pública para el módulo de animaciones de acción. 'ui_action_animations_play' inicia la acción o, si ya hay una en curso, la encola (cola acotada; los toques repetidos se fusionan) para encadenarla al terminar; 'ui_action_animations_is_playing' indica si hay una en curso. 'ui_action_animations_show_frame' muestra el fotograma recién presentado por un player invalidando solo las zonas que cambiaron (fotogramas delta) cuando es posible; la usan tanto las acciones como la animación de reposo. 'ui_action_animations_get_canvas_area' devuelve la zona del lienzo en coordenadas del padre, la que cubre la caché del fondo.
 */
 #ifndef UI_ACTION_ANIMATIONS_H
 #define UI_ACTION_ANIMATIONS_H
@@ -15,6 +15,10 @@
 extern "C" {
 #endif
 
+// Lienzo de las animaciones del personaje: tamaño de los '.bin' sueltos y del búfer compartido.
+#define ANIM_CANVAS_W     150
+#define ANIM_CANVAS_H     230
+
 // --- OBJETO GLOBAL COMPARTIDO ---
 extern lv_obj_t *g_animation_img_obj;
 
@@ -23,7 +27,10 @@ void ui_action_animations_preinit_buffer(void);
 void ui_action_animations_create(lv_obj_t *parent);
 void ui_action_animations_play(diymon_action_id_t action_id);
 void ui_action_animations_destroy(void);
+bool ui_action_animations_is_playing(void);
 animation_t* ui_action_animations_get_player(void);
+void ui_action_animations_show_frame(animation_t *anim);
+bool ui_action_animations_get_canvas_area(lv_area_t *out);
 
 #ifdef __cplusplus
 }
@@ -1,48 +1,100 @@
-/* Fecha: 17/08/2025 - 10:26  */
+/* Fecha: 18/10/2026 - 01:30  */
 /* Fichero: components/ui/ui_idle_animation.c */
-/* Último cambio: Corregida la declaración del buffer 'anim_path' de char a char[] para evitar corrupción de memoria. */
-/* Descripción: Se ha corregido un error crítico donde el buffer para la ruta de la animación se declaraba como un único carácter en lugar de un array. Esto causaba un desbordamiento de buffer y comportamiento indefinido al construir la ruta, impidiendo que la animación de reposo se cargara correctamente. */
+/* Último cambio: El precargador pide el siguiente fotograma de reposo que no esté marcado como defectuoso. */
+/* Descripción: Al cambiar de evolución, 'ui_idle_animation_switch_evolution' ya no detiene el reposo, oculta el personaje y cuenta fotogramas y carga el directorio nuevo dentro de la tarea de LVGL: pausa el reposo dejando visible el último fotograma, pide al precargador que resuelva el índice del directorio nuevo y lea su primer fotograma, y un temporizador de sondeo hace el cambio en cuanto está listo. Se registra la latencia visible del cambio (desde la petición hasta que el fotograma nuevo está en pantalla) y el tiempo que la tarea de LVGL estuvo ocupada; sin doble búfer, o con una acción en curso, se hace el cambio síncrono de siempre y se registran las mismas medidas. El bucle de reposo usa el mismo reloj de animación que las acciones: cada fotograma sale a su hora (IDLE_FRAME_INTERVAL o su 'duration_ms' del pack) y, si el player se retrasa, se saltan los vencidos en lugar de alargar el ciclo. Al pausar para una acción el reloj se detiene y registra sus contadores; al reanudar, el siguiente fotograma sale ya sin contar la pausa como retraso. Con un solo fotograma de reposo, mientras ese fotograma sigue en pantalla el tick no carga nada; al reanudar tras una acción (el búfer frontal contiene el último fotograma de la acción) se vuelve a presentar. Cada arranque del reposo y cada cambio de evolución piden a la copia en flash (animation_flash.c) que se ponga al día con el directorio actual; la copia se hace en segundo plano unos segundos después, cuando la precarga de la evolución nueva ya ha terminado. Los fotogramas que la comprobación de la SD (animation_integrity.c) tiene marcados como defectuosos no se piden al precargador: su carga fallaría al instante y el tick los salta como vencidos. */
 
 #include "ui_idle_animation.h"
 #include "ui_action_animations.h" 
 #include "animation_loader.h"
+#include "animation_prefetch.h"
+#include "animation_clock.h"
+#include "animation_flash.h"
+#include "animation_integrity.h"
 #include "helpers.h"
 #include "esp_log.h"
+#include "esp_timer.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
 static const char *TAG = "UI_IDLE_ANIM";
 
-#define IDLE_FRAME_INTERVAL 1500
+#define IDLE_FRAME_INTERVAL 1500 // Duración de los fotogramas sin 'duration_ms' en el pack.
+#define IDLE_PREFETCH_POLL_MS 10
 
 static lv_timer_t *g_anim_timer;
 static animation_t s_idle_animation_player; // Player local, pero usará un búfer compartido
 static int g_current_frame_index = -1;
 static bool g_is_idle_running = false;
+static bool s_idle_frame_on_screen = false; // El búfer frontal contiene el fotograma actual de reposo.
+static animation_clock_t s_idle_clock;
+
+// Cambio de evolución en curso.
+static lv_timer_t *s_swap_timer = NULL;
+static int64_t s_swap_start_us = 0;         // 0 = no hay cambio pendiente de medir.
+static uint32_t s_swap_blocked_us = 0;      // Tiempo dentro de la tarea de LVGL durante el cambio.
+static bool s_swap_async = false;
+
+static void log_swap_latency(void) {
+    if (s_swap_start_us == 0) return;
+    ESP_LOGI(TAG, "[cambio de evolución] %s: fotograma nuevo visible en %lu us, tarea de LVGL ocupada %lu us.",
+             s_swap_async ? "precarga en segundo plano" : "síncrono",
+             (unsigned long)(esp_timer_get_time() - s_swap_start_us), (unsigned long)s_swap_blocked_us);
+    s_swap_start_us = 0;
+}
 
 static void idle_animation_timer_cb(lv_timer_t *timer) {
     if (!g_is_idle_running || s_idle_animation_player.frame_count == 0) return;
-    
-    g_current_frame_index = (g_current_frame_index + 1) % s_idle_animation_player.frame_count;
-    
-    if (animation_loader_load_frame(&s_idle_animation_player, g_current_frame_index, "ANIM_IDLE_")) {
-        if (g_animation_img_obj) {
-            lv_image_set_src(g_animation_img_obj, &s_idle_animation_player.img_dsc);
-            lv_obj_invalidate(g_animation_img_obj);
-        }
+
+    uint32_t wait_ms;
+    int32_t next = animation_clock_poll(&s_idle_clock, &wait_ms);
+    if (next == ANIM_CLOCK_WAIT) {
+        lv_timer_set_period(timer, wait_ms);
+        return;
+    }
+    if (next < 0) return;
+
+    if (next == g_current_frame_index && s_idle_frame_on_screen) {
+        // Bucle de un fotograma: sigue en pantalla, no hay nada que cargar.
+        animation_clock_presented(&s_idle_clock);
+        lv_timer_set_period(timer, LV_MAX(1, animation_clock_wait_ms(&s_idle_clock)));
+        return;
     }
+
+    switch (animation_prefetch_present(&s_idle_animation_player, "ANIM_IDLE_", next)) {
+        case ANIM_PREFETCH_PENDING:
+            lv_timer_set_period(timer, IDLE_PREFETCH_POLL_MS);
+            return;
+        case ANIM_PREFETCH_FAILED:
+            // Se salta el fotograma defectuoso y se sigue con el ciclo.
+            g_current_frame_index = next;
+            animation_clock_dropped(&s_idle_clock);
+            break;
+        case ANIM_PREFETCH_PRESENTED:
+            g_current_frame_index = next;
+            s_idle_frame_on_screen = true;
+            animation_clock_presented(&s_idle_clock);
+            ui_action_animations_show_frame(&s_idle_animation_player);
+            log_swap_latency();
+            break;
+    }
+
+    uint16_t count = s_idle_animation_player.frame_count;
+    animation_prefetch_request(s_idle_animation_player.base_path, "ANIM_IDLE_",
+                               animation_integrity_next_good(s_idle_animation_player.base_path, "ANIM_IDLE_",
+                                                             (g_current_frame_index + 1) % count, count, true));
+    lv_timer_set_period(timer, LV_MAX(1, animation_clock_wait_ms(&s_idle_clock)));
 }
 
 lv_obj_t* ui_idle_animation_start(lv_obj_t *parent) {
     animation_t* shared_player = ui_action_animations_get_player();
-    if (shared_player == NULL || shared_player->img_dsc.data == NULL) {
+    if (!animation_loader_is_ready(shared_player)) {
         ESP_LOGE(TAG, "No se puede iniciar la animación idle: el búfer compartido no es válido.");
         return NULL;
     }
 
-    // Copiar el descriptor, que incluye el puntero al búfer compartido.
-    s_idle_animation_player.img_dsc = shared_player->img_dsc;
+    // Apuntar al búfer frontal del precargador (el búfer compartido si no hay doble búfer).
+    animation_prefetch_attach(&s_idle_animation_player);
 
     char anim_path[128]; // [CORRECCIÓN] Declarado como un array de caracteres.
     ui_helpers_build_asset_path(anim_path, sizeof(anim_path), "");
@@ -64,10 +116,13 @@ lv_obj_t* ui_idle_animation_start(lv_obj_t *parent) {
         return g_animation_img_obj;
     }
     ESP_LOGI(TAG, "Detectados %d fotogramas para la animación de reposo.", frame_count);
+    animation_flash_request_sync(anim_path);
     s_idle_animation_player.frame_count = frame_count;
+    animation_clock_init(&s_idle_clock, "reposo", IDLE_FRAME_INTERVAL);
+    animation_clock_start(&s_idle_clock, anim_path, "ANIM_IDLE_", frame_count, true);
 
     if(g_animation_img_obj) {
-        lv_image_set_src(g_animation_img_obj, &s_idle_animation_player.img_dsc);
+        ui_action_animations_show_frame(&s_idle_animation_player);
         lv_obj_clear_flag(g_animation_img_obj, LV_OBJ_FLAG_HIDDEN);
     }
     
@@ -82,34 +137,128 @@ lv_obj_t* ui_idle_animation_start(lv_obj_t *parent) {
 void ui_idle_animation_stop(void) {
     ESP_LOGI(TAG, "Deteniendo y limpiando animación de idle.");
     g_is_idle_running = false;
+    if (s_swap_timer) {
+        lv_timer_del(s_swap_timer);
+        s_swap_timer = NULL;
+    }
     if (g_anim_timer) {
         lv_timer_del(g_anim_timer);
         g_anim_timer = NULL;
+        animation_clock_stop(&s_idle_clock);
+        animation_clock_log_stats(&s_idle_clock);
     }
     if (s_idle_animation_player.base_path) {
         free(s_idle_animation_player.base_path);
         s_idle_animation_player.base_path = NULL;
     }
     g_current_frame_index = -1;
+    s_idle_frame_on_screen = false;
 }
 
 void ui_idle_animation_pause(void) {
     if (g_anim_timer && g_is_idle_running) {
         lv_timer_pause(g_anim_timer);
         g_is_idle_running = false;
+        s_idle_frame_on_screen = false; // La acción reutiliza el búfer de pantalla.
+        animation_clock_stop(&s_idle_clock);
+        animation_clock_log_stats(&s_idle_clock);
         ESP_LOGI(TAG, "Animación de Idle PAUSADA.");
     }
 }
 
 void ui_idle_animation_resume(void) {
+    if (s_swap_timer) return; // El cambio de evolución pendiente reanudará el reposo con el directorio nuevo.
     if (g_anim_timer && !g_is_idle_running) {
-        if (g_animation_img_obj) {
-             lv_image_set_src(g_animation_img_obj, &s_idle_animation_player.img_dsc);
-        }
+        animation_prefetch_attach(&s_idle_animation_player);
+        ui_action_animations_show_frame(&s_idle_animation_player);
         
         g_is_idle_running = true;
+        animation_clock_resume(&s_idle_clock);
         lv_timer_resume(g_anim_timer);
         idle_animation_timer_cb(g_anim_timer);
         ESP_LOGI(TAG, "Animación de Idle REANUDADA.");
     }
 }
+
+static void swap_timer_cb(lv_timer_t *timer) {
+    // Mientras una acción usa el precargador no se le disputa; se reintenta al terminar.
+    if (ui_action_animations_is_playing()) return;
+
+    int64_t t0 = esp_timer_get_time();
+    animation_prefetch_result_t result = animation_prefetch_present(&s_idle_animation_player, "ANIM_IDLE_", 0);
+    if (result == ANIM_PREFETCH_PENDING) {
+        s_swap_blocked_us += (uint32_t)(esp_timer_get_time() - t0);
+        return;
+    }
+    lv_obj_t *parent = lv_timer_get_user_data(timer);
+    lv_timer_del(timer);
+    s_swap_timer = NULL;
+
+    uint16_t frame_count = 0;
+    if (result == ANIM_PREFETCH_PRESENTED) {
+        // El índice ya lo resolvió la tarea de precarga: no toca la SD.
+        frame_count = animation_loader_count_frames(s_idle_animation_player.base_path, "ANIM_IDLE_");
+    }
+    if (frame_count == 0) {
+        ESP_LOGW(TAG, "La precarga de '%s' falló. Cambio síncrono.", s_idle_animation_player.base_path);
+        s_swap_async = false;
+        ui_idle_animation_stop();
+        ui_idle_animation_start(parent);
+        if (!g_anim_timer) s_swap_start_us = 0; // Sin reposo no habrá fotograma que medir.
+        return;
+    }
+
+    s_idle_animation_player.frame_count = frame_count;
+    animation_clock_init(&s_idle_clock, "reposo", IDLE_FRAME_INTERVAL);
+    animation_clock_start(&s_idle_clock, s_idle_animation_player.base_path, "ANIM_IDLE_", frame_count, true);
+    animation_clock_poll(&s_idle_clock, NULL);
+    animation_clock_presented(&s_idle_clock);
+    g_current_frame_index = 0;
+    s_idle_frame_on_screen = true;
+    ui_action_animations_show_frame(&s_idle_animation_player);
+    if (g_animation_img_obj) lv_obj_clear_flag(g_animation_img_obj, LV_OBJ_FLAG_HIDDEN);
+    animation_prefetch_request(s_idle_animation_player.base_path, "ANIM_IDLE_", 1 % frame_count);
+
+    g_is_idle_running = true;
+    lv_timer_set_period(g_anim_timer, LV_MAX(1, animation_clock_wait_ms(&s_idle_clock)));
+    lv_timer_resume(g_anim_timer);
+    s_swap_blocked_us += (uint32_t)(esp_timer_get_time() - t0);
+    ESP_LOGI(TAG, "Animación de Idle cambiada a %s (%d fotogramas).", s_idle_animation_player.base_path, frame_count);
+    log_swap_latency();
+}
+
+void ui_idle_animation_switch_evolution(lv_obj_t *parent) {
+    int64_t t0 = esp_timer_get_time();
+    char anim_path[128];
+    ui_helpers_build_asset_path(anim_path, sizeof(anim_path), "");
+    size_t len = strlen(anim_path);
+    if (len > 0 && anim_path[len - 1] == '/') anim_path[len - 1] = '\0';
+
+    if (s_swap_timer) {
+        // Un cambio anterior aún no había terminado: se sustituye por este.
+        lv_timer_del(s_swap_timer);
+        s_swap_timer = NULL;
+    }
+
+    s_swap_start_us = t0;
+    s_swap_blocked_us = 0;
+    s_swap_async = g_anim_timer && !ui_action_animations_is_playing() && animation_prefetch_warmup(anim_path, "ANIM_IDLE_");
+    if (!s_swap_async) {
+        // Sin tarea de precarga (o con una acción usándola): cambio síncrono, ocultando el personaje anterior.
+        if (g_animation_img_obj) lv_obj_add_flag(g_animation_img_obj, LV_OBJ_FLAG_HIDDEN);
+        ui_idle_animation_stop();
+        ui_idle_animation_start(parent);
+        s_swap_blocked_us = (uint32_t)(esp_timer_get_time() - t0);
+        if (!g_anim_timer) s_swap_start_us = 0;
+        return;
+    }
+
+    // El último fotograma de la evolución anterior sigue en pantalla hasta que el nuevo esté listo.
+    ui_idle_animation_pause();
+    free(s_idle_animation_player.base_path);
+    s_idle_animation_player.base_path = strdup(anim_path);
+    s_swap_timer = lv_timer_create(swap_timer_cb, IDLE_PREFETCH_POLL_MS, parent);
+    animation_flash_request_sync(anim_path);
+    s_swap_blocked_us = (uint32_t)(esp_timer_get_time() - t0);
+    ESP_LOGI(TAG, "Cambio de evolución: precargando '%s' en segundo plano.", anim_path);
+}
@@ -1,11 +1,11 @@
 /*
  * Fichero: ./components/diymon_ui/ui_idle_animation.h
- * Fecha: 13/08/2025 - 11:43 
- * Último cambio: Corregida la firma de la función de inicio.
- * Descripción: Interfaz pública para la animación de reposo. Se corrige la
- *              declaración de 'ui_idle_animation_start' para que acepte un
- *              parámetro y devuelva un puntero a objeto, solucionando el error
- *              de compilación.
+ * Fecha: 17/10/2026 - 21:40
+ * Último cambio: Añadida ui_idle_animation_switch_evolution.
+ * Descripción: Interfaz pública para la animación de reposo.
+ *              'ui_idle_animation_switch_evolution' cambia el reposo al directorio
+ *              de la evolución actual precargando su primer fotograma en segundo
+ *              plano, con el personaje anterior visible hasta que el nuevo está listo.
  */
 #ifndef UI_IDLE_ANIMATION_H
 #define UI_IDLE_ANIMATION_H
@@ -24,6 +24,14 @@ lv_obj_t* ui_idle_animation_start(lv_obj_t *parent);
  */
 void ui_idle_animation_stop(void);
 
+/**
+ * @brief Cambia la animación de idle al directorio de la evolución actual sin bloquear la tarea
+ *        de LVGL: el personaje anterior sigue en pantalla hasta que el primer fotograma del nuevo
+ *        está leído. Sin doble búfer hace el cambio síncrono (stop + start).
+ * @param parent El objeto padre (la pantalla principal), por si hay que reiniciar la animación.
+ */
+void ui_idle_animation_switch_evolution(lv_obj_t *parent);
+
 /**
  * @brief Pausa el temporizador de la animación de idle.
  */
@@ -1,7 +1,6 @@
 /* Fichero: components/web_server/web_server.c */
-/* Descripción: Diagnóstico de Causa Raíz: El error de socket 'error in send : 11' (EAGAIN) indica que el buffer de envío TCP se está llenando. Esto ocurre porque la tarea del servidor web no obtiene suficiente tiempo de CPU para enviar datos a la red, siendo interrumpida por otras tareas de menor prioridad pero de ejecución más frecuente, como la tarea de LVGL.
-Solución Definitiva: Se ha elevado la prioridad de la tarea del servidor HTTP de 3 a 2. Al ser una prioridad numéricamente más baja (y por tanto, mayor), se garantiza que el planificador de FreeRTOS le dará preferencia sobre la tarea de LVGL (prioridad 4), permitiéndole vaciar el buffer de envío de la red de manera más eficiente y evitando el desbordamiento que causa el error. */
-/* Último cambio: 20/08/2025 - 08:00 */
+/* Descripción: Arranque del servidor web y registro de sus URIs. Se registran '/sdbench' (banco de pruebas de la tarjeta SD), '/lcdbench' (banco de pruebas del dibujo en pantalla) y '/metrics' (métricas de E/S que aporta la aplicación con 'web_server_set_metrics_cb') y se amplía 'max_uri_handlers', que con el valor por defecto ya no alcanzaba. El aviso de cambios en el sistema de ficheros admite varios suscriptores ('web_server_add_fs_change_cb'), a los que 'web_server_notify_fs_change' llama en el orden en que se registraron; caben seis (índice de animaciones, caché de ficheros contiguos y pool del driver 'S:', copia en flash y margen). */
+/* Último cambio: 18/10/2026 - 03:00 */
 #include "web_server.h"
 #include "web_server_priv.h" // Cabecera privada con las declaraciones de los handlers
 #include "esp_http_server.h"
@@ -9,14 +8,46 @@ Solución Definitiva: Se ha elevado la prioridad de la tarea del servidor HTTP d
 
 static const char *TAG = "WEB_SERVER";
 
+#define MAX_FS_CHANGE_CBS 6
+
+static web_server_fs_change_cb_t s_fs_change_cbs[MAX_FS_CHANGE_CBS];
+static web_server_metrics_cb_t s_metrics_cb;
+
 // --- Funciones Públicas ---
 
+void web_server_add_fs_change_cb(web_server_fs_change_cb_t cb) {
+    if (!cb) return;
+    for (int i = 0; i < MAX_FS_CHANGE_CBS; i++) {
+        if (s_fs_change_cbs[i] == cb) return;
+        if (!s_fs_change_cbs[i]) {
+            s_fs_change_cbs[i] = cb;
+            return;
+        }
+    }
+    ESP_LOGW(TAG, "No caben más callbacks de cambios en el sistema de ficheros.");
+}
+
+void web_server_notify_fs_change(const char *vfs_path) {
+    for (int i = 0; i < MAX_FS_CHANGE_CBS && s_fs_change_cbs[i]; i++) {
+        s_fs_change_cbs[i](vfs_path);
+    }
+}
+
+void web_server_set_metrics_cb(web_server_metrics_cb_t cb) {
+    s_metrics_cb = cb;
+}
+
+web_server_metrics_cb_t web_server_get_metrics_cb(void) {
+    return s_metrics_cb;
+}
+
 httpd_handle_t web_server_start(void) {
     httpd_handle_t server = NULL;
     httpd_config_t config = HTTPD_DEFAULT_CONFIG();
     config.uri_match_fn = httpd_uri_match_wildcard;
     config.stack_size = 8192;
     config.task_priority = 2; // Prioridad elevada para garantizar el rendimiento de la red sobre la UI.
+    config.max_uri_handlers = 12; // El valor por defecto (8) ya no alcanza.
 
     ESP_LOGI(TAG, "Iniciando servidor web de configuracion (Prioridad Tarea: %d).", config.task_priority);
 
@@ -44,6 +75,15 @@ httpd_handle_t web_server_start(void) {
 
         httpd_uri_t save_uri = { .uri = "/save", .method = HTTP_POST, .handler = save_post_handler };
         httpd_register_uri_handler(server, &save_uri);
+
+        httpd_uri_t sdbench_uri = { .uri = "/sdbench", .method = HTTP_GET, .handler = sdbench_get_handler };
+        httpd_register_uri_handler(server, &sdbench_uri);
+
+        httpd_uri_t lcdbench_uri = { .uri = "/lcdbench", .method = HTTP_GET, .handler = lcdbench_get_handler };
+        httpd_register_uri_handler(server, &lcdbench_uri);
+
+        httpd_uri_t metrics_uri = { .uri = "/metrics", .method = HTTP_GET, .handler = metrics_get_handler };
+        httpd_register_uri_handler(server, &metrics_uri);
         
         ESP_LOGI(TAG, "Todos los handlers del servidor web registrados correctamente.");
         return server;
@@ -1,16 +1,42 @@
-/* Fecha: 18/08/2025 - 07:05  */
+/* Fecha: 18/10/2026 - 01:00  */
 /* Fichero: components/web_server/web_server.h */
-/* Último cambio: Modificadas las funciones start/stop para gestionar el handle del servidor y evitar errores de socket. */
-/* Descripción: Interfaz pública para el componente del servidor web. La función 'web_server_start' ahora devuelve un handle al servidor iniciado. Se ha añadido 'web_server_stop' para permitir un apagado controlado del servidor, solucionando los errores de socket ('error in send : 11') que ocurrían al salir del modo de configuración. */
+/* Último cambio: Añadido el proveedor de métricas que sirve '/metrics'. */
+/* Descripción: Interfaz pública para el componente del servidor web. 'web_server_add_fs_change_cb' permite que otros componentes (el índice de animaciones de la UI, el pool de ficheros del driver 'S:') sean notificados cuando el servidor sube, borra o crea ficheros en la SD, sin que el servidor web dependa de ellos. Del mismo modo, 'web_server_set_metrics_cb' deja que la aplicación (las métricas de E/S del driver 'S:') rellene la respuesta de '/metrics'. */
 #ifndef WEB_SERVER_H
 #define WEB_SERVER_H
 
 #include "esp_http_server.h" // Necesario para el tipo httpd_handle_t
+#include <stdbool.h>
+#include <stddef.h>
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+/**
+ * @brief Callback invocado tras modificar la SD desde el servidor web.
+ * @param vfs_path Ruta VFS del fichero o directorio afectado (ej: "/sdcard/diymon/0/ANIM_IDLE_1.bin").
+ *                 Se ejecuta en la tarea del servidor web.
+ */
+typedef void (*web_server_fs_change_cb_t)(const char *vfs_path);
+
+/**
+ * @brief Añade un callback de cambios en el sistema de ficheros (hasta 6; se llaman en orden de registro).
+ */
+void web_server_add_fs_change_cb(web_server_fs_change_cb_t cb);
+
+/**
+ * @brief Callback que escribe las métricas en JSON para '/metrics'.
+ * @param reset true si la petición pide poner los contadores a cero después de leerlos ('?reset=1').
+ * @return Longitud escrita en 'buf' (0 si no cabe). Se ejecuta en la tarea del servidor web.
+ */
+typedef size_t (*web_server_metrics_cb_t)(char *buf, size_t size, bool reset);
+
+/**
+ * @brief Fija el proveedor de '/metrics' (uno solo; sin él, la URI responde 404).
+ */
+void web_server_set_metrics_cb(web_server_metrics_cb_t cb);
+
 /**
  * @brief Inicia el servidor web y devuelve su handle.
  * @return El handle del servidor HTTPD si se inicia correctamente, NULL en caso de error.
@@ -1,9 +1,10 @@
-/* Fecha: 18/08/2025 - 07:48  */
+/* Fecha: 18/10/2026 - 03:00  */
 /* Fichero: components/web_server/web_server_handlers.c */
-/* Último cambio: Eliminado el calificador 'static' de las definiciones de los handlers para resolver un error de enlazado (linkage error). */
-/* Descripción: Se ha eliminado la palabra clave 'static' de la definición de todas las funciones handler. El error de compilación 'static declaration of '...' follows non-static declaration' ocurría porque las funciones se declaraban sin 'static' en la cabecera privada (web_server_priv.h) pero se definían con 'static' en este fichero, creando un conflicto de enlazado. Ahora las definiciones coinciden con las declaraciones, permitiendo que web_server.c las enlace correctamente. */
+/* Último cambio: Añadido el handler GET /lcdbench con el banco de pruebas del dibujo en pantalla. */
+/* Descripción: Handlers HTTP del portal de configuración. '/sdbench' devuelve en JSON el último resultado del banco de pruebas de la SD (velocidades de escritura y lectura, lectura aleatoria, latencia de apertura de ficheros pequeños y reloj SPI); con '?run=1' lanza una medida nueva (tarda unos segundos) y con '?retune=1' borra el reloj ajustado para que se vuelva a sondear al arrancar; si el fichero de prueba quedó contiguo, también da las velocidades leyendo por sectores sin VFS. Los ficheros '.pak' subidos se crean con todos sus clústeres contiguos (reserva de la cota superior del tamaño y recorte al final) para que el driver 'S:' los lea por sectores; el log indica su primer sector o si han quedado fragmentados. '/lcdbench' devuelve el último resultado del banco de pruebas de la pantalla (estrategia del búfer de dibujo, cola SPI y, por fotograma, render, flush y espera al SPI); con '?run=1' lanza una medida nueva, que ocupa la pantalla un par de segundos. '/metrics' devuelve el JSON que escribe el proveedor registrado por la aplicación (histogramas de latencia del driver 'S:'); con '?reset=1' los contadores vuelven a cero tras leerlos. Los handlers de subida, borrado y creación de directorios siguen notificando los cambios en la SD con 'web_server_notify_fs_change'. */
 
 #include "web_server_priv.h"
+#include "bsp_api.h"
 #include "esp_log.h"
 #include "esp_vfs.h"
 #include "nvs_flash.h"
@@ -17,6 +18,8 @@
 #include <fcntl.h>
 #include <dirent.h>
 #include <sys/stat.h>
+#include <strings.h>
+#include <unistd.h>
 
 static const char *TAG = "WEB_HANDLERS";
 
@@ -148,17 +151,29 @@ esp_err_t upload_post_handler(httpd_req_t *req) {
     }
 
     snprintf(filepath, sizeof(filepath), "%s%s/%s", WEB_MOUNT_POINT, strcmp(path, "/") == 0 ? "" : path, filename);
-    ESP_LOGI(TAG, "Abriendo fichero para escritura: %s", filepath);
-    fd = fopen(filepath, "wb");
-    if (!fd) { ESP_LOGE(TAG, "Fallo al abrir fichero."); httpd_resp_send_500(req); return ESP_FAIL; }
 
     char *data_start = strstr(filename_end, "\r\n\r\n");
-    if (!data_start) { ESP_LOGE(TAG, "No se encontró el delimitador de datos."); fclose(fd); return ESP_FAIL; }
-    
+    if (!data_start) { ESP_LOGE(TAG, "No se encontró el delimitador de datos."); return ESP_FAIL; }
     data_start += 4;
     int header_len = data_start - buf;
     int data_len = received - header_len;
-    fwrite(data_start, 1, data_len, fd);
+
+    // Los packs de animación se reservan contiguos para que el driver 'S:' los lea por sectores. El tamaño
+    // exacto no se conoce hasta el final (el cuerpo incluye el delimitador multipart): se reserva la cota
+    // superior y se recorta al terminar. Antes se avisa del cambio para que nadie siga leyendo el pack viejo.
+    size_t name_len = strlen(filename);
+    bool is_pak = name_len > 4 && strcasecmp(filename + name_len - 4, ".pak") == 0;
+    bool preallocated = false;
+    if (is_pak) {
+        web_server_notify_fs_change(filepath);
+        preallocated = bsp_sdcard_preallocate(filepath, (uint64_t)(req->content_len - header_len)) == ESP_OK;
+    }
+
+    ESP_LOGI(TAG, "Abriendo fichero para escritura: %s%s", filepath, preallocated ? " (reservado contiguo)" : "");
+    fd = fopen(filepath, preallocated ? "r+b" : "wb");
+    if (!fd) { ESP_LOGE(TAG, "Fallo al abrir fichero."); httpd_resp_send_500(req); return ESP_FAIL; }
+
+    size_t written = fwrite(data_start, 1, data_len, fd);
     remaining -= received;
 
     while (remaining > 0) {
@@ -167,15 +182,27 @@ esp_err_t upload_post_handler(httpd_req_t *req) {
         
         char *boundary_start = strstr(buf, "\r\n--");
         if (boundary_start) {
-             fwrite(buf, 1, boundary_start - buf, fd);
+             written += fwrite(buf, 1, boundary_start - buf, fd);
         } else {
-             fwrite(buf, 1, received, fd);
+             written += fwrite(buf, 1, received, fd);
         }
         remaining -= received;
     }
 
     fclose(fd);
+    if (preallocated && truncate(filepath, (off_t)written) != 0) {
+        ESP_LOGW(TAG, "No se pudo recortar %s a %u bytes.", filepath, (unsigned)written);
+    }
     ESP_LOGI(TAG, "Subida de archivo a %s completa.", filepath);
+    web_server_notify_fs_change(filepath);
+    if (is_pak) {
+        uint32_t first_sector;
+        if (bsp_sdcard_get_extent(filepath, &first_sector, NULL)) {
+            ESP_LOGI(TAG, "%s es contiguo desde el sector %lu; se leerá por sectores.", filepath, (unsigned long)first_sector);
+        } else {
+            ESP_LOGW(TAG, "%s ha quedado fragmentado; se leerá a través del VFS.", filepath);
+        }
+    }
     httpd_resp_send(req, "OK", HTTPD_RESP_USE_STRLEN);
     return ESP_OK;
 }
@@ -203,6 +230,7 @@ esp_err_t delete_file_handler(httpd_req_t *req) {
 
     if (unlink(filepath) == 0) {
         ESP_LOGI(TAG, "Archivo borrado: %s", filepath);
+        web_server_notify_fs_change(filepath);
         httpd_resp_send(req, "Archivo borrado.", HTTPD_RESP_USE_STRLEN);
     } else {
         ESP_LOGE(TAG, "Fallo al borrar el archivo: %s", filepath);
@@ -234,6 +262,7 @@ esp_err_t create_dir_handler(httpd_req_t *req) {
 
     if (mkdir(full_path, 0755) == 0) {
         ESP_LOGI(TAG, "Directorio creado: %s", full_path);
+        web_server_notify_fs_change(full_path);
         httpd_resp_send(req, "Directorio creado.", HTTPD_RESP_USE_STRLEN);
     } else {
         ESP_LOGE(TAG, "Fallo al crear directorio: %s", full_path);
@@ -276,3 +305,115 @@ esp_err_t save_post_handler(httpd_req_t *req) {
     
     return ESP_OK;
 }
+
+esp_err_t sdbench_get_handler(httpd_req_t *req) {
+    char query_buf[64];
+    char param[8];
+    bool run = false;
+    if (httpd_req_get_url_query_str(req, query_buf, sizeof(query_buf)) == ESP_OK) {
+        if (httpd_query_key_value(query_buf, "run", param, sizeof(param)) == ESP_OK) run = atoi(param) != 0;
+        if (httpd_query_key_value(query_buf, "retune", param, sizeof(param)) == ESP_OK && atoi(param) != 0) {
+            bsp_sdcard_forget_tuning();
+        }
+    }
+    ESP_LOGI(TAG, "Handler: GET /sdbench%s.", run ? " (medida nueva)" : "");
+
+    bsp_sdcard_bench_t res;
+    bool has_result = true;
+    if (run) {
+        bsp_sdcard_run_benchmark(&res);
+    } else {
+        has_result = bsp_sdcard_get_last_benchmark(&res);
+    }
+
+    char json[512];
+    if (!has_result) {
+        snprintf(json, sizeof(json), "{\"status\":\"none\",\"freq_khz\":%lu}", (unsigned long)bsp_sdcard_get_freq_khz());
+    } else {
+        snprintf(json, sizeof(json),
+                 "{\"status\":\"%s\",\"card\":\"%s\",\"freq_khz\":%lu,\"max_files\":%lu,\"allocation_unit\":%lu,"
+                 "\"file_bytes\":%lu,\"write_kbps\":%lu,\"seq_read_kbps\":%lu,\"rand_read_kbps\":%lu,"
+                 "\"rand_read_iops\":%lu,\"open_avg_us\":%lu,\"open_max_us\":%lu,\"contiguous\":%s,"
+                 "\"sector_read_kbps\":%lu,\"rand_sector_kbps\":%lu,\"duration_ms\":%lu}",
+                 res.status == ESP_OK ? "ok" : esp_err_to_name(res.status), res.card_name,
+                 (unsigned long)res.freq_khz, (unsigned long)res.max_files, (unsigned long)res.allocation_unit,
+                 (unsigned long)res.file_bytes, (unsigned long)res.write_kbps, (unsigned long)res.seq_read_kbps,
+                 (unsigned long)res.rand_read_kbps, (unsigned long)res.rand_read_iops,
+                 (unsigned long)res.open_avg_us, (unsigned long)res.open_max_us, res.contiguous ? "true" : "false",
+                 (unsigned long)res.sector_read_kbps, (unsigned long)res.rand_sector_kbps, (unsigned long)res.duration_ms);
+    }
+    httpd_resp_set_type(req, "application/json");
+    return httpd_resp_send(req, json, HTTPD_RESP_USE_STRLEN);
+}
+
+esp_err_t lcdbench_get_handler(httpd_req_t *req) {
+    char query_buf[32];
+    char param[8];
+    bool run = false;
+    if (httpd_req_get_url_query_str(req, query_buf, sizeof(query_buf)) == ESP_OK &&
+        httpd_query_key_value(query_buf, "run", param, sizeof(param)) == ESP_OK) {
+        run = atoi(param) != 0;
+    }
+    ESP_LOGI(TAG, "Handler: GET /lcdbench%s.", run ? " (medida nueva)" : "");
+
+    bsp_lcd_bench_t res;
+    bool has_result = true;
+    if (run) {
+        bsp_lcd_run_benchmark(&res);
+    } else {
+        has_result = bsp_lcd_get_last_benchmark(&res);
+    }
+    if (!has_result) {
+        memset(&res, 0, sizeof(res));
+        bsp_get_display_buffer_cfg(&res.buffer);
+    }
+
+    char json[512];
+    snprintf(json, sizeof(json),
+             "{\"status\":\"%s\",\"full_refresh\":%s,\"lines\":%lu,\"buffer_bytes\":%lu,\"double_buffer\":%s,"
+             "\"degraded\":%s,\"trans_queue_depth\":%lu,\"frames\":%lu,\"flushes_per_frame\":%lu,"
+             "\"frame_avg_us\":%lu,\"frame_max_us\":%lu,\"render_avg_us\":%lu,\"flush_avg_us\":%lu,"
+             "\"wait_avg_us\":%lu,\"fps_x10\":%lu,\"free_ram_kb\":%lu}",
+             !has_result ? "none" : res.status == ESP_OK ? "ok" : esp_err_to_name(res.status),
+             res.buffer.full_refresh ? "true" : "false", (unsigned long)res.buffer.lines,
+             (unsigned long)(res.buffer.buffer_px * sizeof(uint16_t)), res.buffer.double_buffer ? "true" : "false",
+             res.buffer.degraded ? "true" : "false", (unsigned long)res.buffer.trans_queue_depth,
+             (unsigned long)res.frames, (unsigned long)res.flushes_per_frame, (unsigned long)res.frame_avg_us,
+             (unsigned long)res.frame_max_us, (unsigned long)res.render_avg_us, (unsigned long)res.flush_avg_us,
+             (unsigned long)res.wait_avg_us, (unsigned long)res.fps_x10, (unsigned long)res.free_ram_kb);
+    httpd_resp_set_type(req, "application/json");
+    return httpd_resp_send(req, json, HTTPD_RESP_USE_STRLEN);
+}
+
+esp_err_t metrics_get_handler(httpd_req_t *req) {
+    char query_buf[32];
+    char param[8];
+    bool reset = false;
+    if (httpd_req_get_url_query_str(req, query_buf, sizeof(query_buf)) == ESP_OK &&
+        httpd_query_key_value(query_buf, "reset", param, sizeof(param)) == ESP_OK) {
+        reset = atoi(param) != 0;
+    }
+    ESP_LOGD(TAG, "Handler: GET /metrics%s.", reset ? " (con puesta a cero)" : "");
+
+    web_server_metrics_cb_t cb = web_server_get_metrics_cb();
+    if (!cb) {
+        httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "No hay métricas disponibles.");
+        return ESP_FAIL;
+    }
+    char *json = malloc(METRICS_JSON_SIZE);
+    if (!json) {
+        httpd_resp_send_500(req);
+        return ESP_ERR_NO_MEM;
+    }
+    size_t len = cb(json, METRICS_JSON_SIZE, reset);
+    esp_err_t ret;
+    if (len == 0) {
+        httpd_resp_send_500(req);
+        ret = ESP_FAIL;
+    } else {
+        httpd_resp_set_type(req, "application/json");
+        ret = httpd_resp_send(req, json, len);
+    }
+    free(json);
+    return ret;
+}
@@ -1,12 +1,13 @@
-/* Fecha: 18/08/2025 - 07:41  */
+/* Fecha: 18/10/2026 - 03:00  */
 /* Fichero: components/web_server/web_server_priv.h */
-/* Último cambio: Creación del fichero como parte de la refactorización para declarar handlers y helpers internos. */
-/* Descripción: Cabecera privada para el componente web_server. Declara las funciones de los handlers y helpers que son compartidas internamente entre los ficheros del componente, pero no expuestas públicamente. Esto permite a web_server.c registrar los handlers mientras que sus implementaciones residen en web_server_handlers.c. */
+/* Último cambio: Declarado el handler '/lcdbench'. */
+/* Descripción: Cabecera privada para el componente web_server. Declara las funciones de los handlers y helpers que son compartidas internamente entre los ficheros del componente, pero no expuestas públicamente. Se añade la notificación de cambios en la SD, implementada en web_server.c. */
 
 #ifndef WEB_SERVER_PRIV_H
 #define WEB_SERVER_PRIV_H
 
 #include "esp_http_server.h"
+#include "web_server.h"
 #include <stdbool.h>
 
 #ifdef __cplusplus
@@ -16,6 +17,7 @@ extern "C" {
 // --- Constantes internas del componente ---
 #define WEB_MOUNT_POINT "/sdcard"
 #define UPLOAD_BUFFER_SIZE 2048
+#define METRICS_JSON_SIZE 4096
 
 // --- Declaraciones de Handlers (implementados en web_server_handlers.c) ---
 esp_err_t root_get_handler(httpd_req_t *req);
@@ -25,6 +27,13 @@ esp_err_t upload_post_handler(httpd_req_t *req);
 esp_err_t delete_file_handler(httpd_req_t *req);
 esp_err_t create_dir_handler(httpd_req_t *req);
 esp_err_t save_post_handler(httpd_req_t *req);
+esp_err_t sdbench_get_handler(httpd_req_t *req);
+esp_err_t lcdbench_get_handler(httpd_req_t *req);
+esp_err_t metrics_get_handler(httpd_req_t *req);
+
+// --- Notificación de cambios en la SD (implementada en web_server.c) ---
+void web_server_notify_fs_change(const char *vfs_path);
+web_server_metrics_cb_t web_server_get_metrics_cb(void);
 
 // --- Declaraciones de Helpers (implementados en web_server_helpers.c) ---
 esp_err_t serve_file_from_sd(httpd_req_t *req, const char *filepath);
@@ -22,30 +22,82 @@ extern "C" {
  *      DEFINES
  *********************/
 
+/* Big-endian RGB565 draw buffers (the SPI panel byte order): every blend to RGB565 must go through a byte order
+ * aware function, LVGL's C code would mix swapped pixels. The BE functions always return LV_RESULT_OK.
+ * The simple fill and the opaque RGB565 copy keep the assembly kernels: the fill gets a pre-swapped color
+ * and a copy does not care about the byte order */
+#if CONFIG_LVGL_PORT_RGB565_BIG_ENDIAN
+#define LV_DRAW_SW_COLOR_BLEND_TO_RGB565(dsc) \
+    _lv_color_blend_to_rgb565_be_esp(dsc)
+#define LV_DRAW_SW_COLOR_BLEND_TO_RGB565_WITH_OPA(dsc) \
+    lv_color_blend_to_rgb565_with_opa_be(dsc)
+#define LV_DRAW_SW_COLOR_BLEND_TO_RGB565_WITH_MASK(dsc) \
+    lv_color_blend_to_rgb565_with_mask_be(dsc)
+#define LV_DRAW_SW_COLOR_BLEND_TO_RGB565_MIX_MASK_OPA(dsc) \
+    lv_color_blend_to_rgb565_mix_mask_opa_be(dsc)
+#define LV_DRAW_SW_RGB565_BLEND_NORMAL_TO_RGB565_WITH_OPA(dsc) \
+    lv_rgb565_blend_normal_to_rgb565_with_opa_be(dsc)
+#define LV_DRAW_SW_RGB565_BLEND_NORMAL_TO_RGB565_WITH_MASK(dsc) \
+    lv_rgb565_blend_normal_to_rgb565_with_mask_be(dsc)
+#define LV_DRAW_SW_RGB565_BLEND_NORMAL_TO_RGB565_MIX_MASK_OPA(dsc) \
+    lv_rgb565_blend_normal_to_rgb565_mix_mask_opa_be(dsc)
+#define LV_DRAW_SW_RGB888_BLEND_NORMAL_TO_RGB565(dsc, src_px_size) \
+    lv_rgb888_blend_normal_to_rgb565_be(dsc, src_px_size)
+#define LV_DRAW_SW_RGB888_BLEND_NORMAL_TO_RGB565_WITH_OPA(dsc, src_px_size) \
+    lv_rgb888_blend_normal_to_rgb565_with_opa_be(dsc, src_px_size)
+#define LV_DRAW_SW_RGB888_BLEND_NORMAL_TO_RGB565_WITH_MASK(dsc, src_px_size) \
+    lv_rgb888_blend_normal_to_rgb565_with_mask_be(dsc, src_px_size)
+#define LV_DRAW_SW_RGB888_BLEND_NORMAL_TO_RGB565_MIX_MASK_OPA(dsc, src_px_size) \
+    lv_rgb888_blend_normal_to_rgb565_mix_mask_opa_be(dsc, src_px_size)
+#define LV_DRAW_SW_ARGB8888_BLEND_NORMAL_TO_RGB565(dsc) \
+    lv_argb8888_blend_normal_to_rgb565_be(dsc)
+#define LV_DRAW_SW_ARGB8888_BLEND_NORMAL_TO_RGB565_WITH_OPA(dsc) \
+    lv_argb8888_blend_normal_to_rgb565_with_opa_be(dsc)
+#define LV_DRAW_SW_ARGB8888_BLEND_NORMAL_TO_RGB565_WITH_MASK(dsc) \
+    lv_argb8888_blend_normal_to_rgb565_with_mask_be(dsc)
+#define LV_DRAW_SW_ARGB8888_BLEND_NORMAL_TO_RGB565_MIX_MASK_OPA(dsc) \
+    lv_argb8888_blend_normal_to_rgb565_mix_mask_opa_be(dsc)
+#endif
+
+/* ESP32-C6 (RV32IMAC) has RGB565 kernels only, the other color formats stay in LVGL's C code */
+#if !CONFIG_IDF_TARGET_ESP32C6
 #ifndef LV_DRAW_SW_COLOR_BLEND_TO_ARGB8888
 #define LV_DRAW_SW_COLOR_BLEND_TO_ARGB8888(dsc) \
     _lv_color_blend_to_argb8888_esp(dsc)
 #endif
+#endif
 
 #ifndef LV_DRAW_SW_COLOR_BLEND_TO_RGB565
 #define LV_DRAW_SW_COLOR_BLEND_TO_RGB565(dsc) \
     _lv_color_blend_to_rgb565_esp(dsc)
 #endif
 
+#if !CONFIG_IDF_TARGET_ESP32C6
 #ifndef LV_DRAW_SW_COLOR_BLEND_TO_RGB888
 #define LV_DRAW_SW_COLOR_BLEND_TO_RGB888(dsc, dest_px_size) \
     _lv_color_blend_to_rgb888_esp(dsc, dest_px_size)
 #endif
+#endif
 
 #ifndef LV_DRAW_SW_RGB565_BLEND_NORMAL_TO_RGB565
 #define LV_DRAW_SW_RGB565_BLEND_NORMAL_TO_RGB565(dsc)  \
     _lv_rgb565_blend_normal_to_rgb565_esp(dsc)
 #endif
 
+/* RGB565A8 images reach the blender as RGB565 with their alpha plane as mask */
+#if CONFIG_IDF_TARGET_ESP32C6
+#ifndef LV_DRAW_SW_RGB565_BLEND_NORMAL_TO_RGB565_WITH_MASK
+#define LV_DRAW_SW_RGB565_BLEND_NORMAL_TO_RGB565_WITH_MASK(dsc)  \
+    _lv_rgb565_blend_normal_to_rgb565_with_mask_esp(dsc)
+#endif
+#endif
+
+#if !CONFIG_IDF_TARGET_ESP32C6
 #ifndef LV_DRAW_SW_RGB888_BLEND_NORMAL_TO_RGB888
 #define LV_DRAW_SW_RGB888_BLEND_NORMAL_TO_RGB888(dsc, dest_px_size, src_px_size)  \
     _lv_rgb888_blend_normal_to_rgb888_esp(dsc, dest_px_size, src_px_size)
 #endif
+#endif
 
 /**********************
  *      TYPEDEFS
@@ -131,6 +183,66 @@ static inline lv_result_t _lv_rgb565_blend_normal_to_rgb565_esp(_lv_draw_sw_blen
     return lv_rgb565_blend_normal_to_rgb565_esp(&asm_dsc);
 }
 
+extern int lv_rgb565_blend_normal_to_rgb565_with_mask_esp(asm_dsc_t *asm_dsc);
+
+static inline lv_result_t _lv_rgb565_blend_normal_to_rgb565_with_mask_esp(_lv_draw_sw_blend_image_dsc_t *dsc)
+{
+    asm_dsc_t asm_dsc = {
+        .dst_buf = dsc->dest_buf,
+        .dst_w = dsc->dest_w,
+        .dst_h = dsc->dest_h,
+        .dst_stride = dsc->dest_stride,
+        .src_buf = dsc->src_buf,
+        .src_stride = dsc->src_stride,
+        .mask_buf = dsc->mask_buf,
+        .mask_stride = dsc->mask_stride
+    };
+
+    return lv_rgb565_blend_normal_to_rgb565_with_mask_esp(&asm_dsc);
+}
+
+#if CONFIG_LVGL_PORT_RGB565_BIG_ENDIAN
+lv_result_t lv_color_blend_to_rgb565_be(_lv_draw_sw_blend_fill_dsc_t *dsc);
+lv_result_t lv_color_blend_to_rgb565_with_opa_be(_lv_draw_sw_blend_fill_dsc_t *dsc);
+lv_result_t lv_color_blend_to_rgb565_with_mask_be(_lv_draw_sw_blend_fill_dsc_t *dsc);
+lv_result_t lv_color_blend_to_rgb565_mix_mask_opa_be(_lv_draw_sw_blend_fill_dsc_t *dsc);
+lv_result_t lv_rgb565_blend_normal_to_rgb565_with_opa_be(_lv_draw_sw_blend_image_dsc_t *dsc);
+lv_result_t lv_rgb565_blend_normal_to_rgb565_with_mask_be(_lv_draw_sw_blend_image_dsc_t *dsc);
+lv_result_t lv_rgb565_blend_normal_to_rgb565_mix_mask_opa_be(_lv_draw_sw_blend_image_dsc_t *dsc);
+lv_result_t lv_rgb888_blend_normal_to_rgb565_be(_lv_draw_sw_blend_image_dsc_t *dsc, uint32_t src_px_size);
+lv_result_t lv_rgb888_blend_normal_to_rgb565_with_opa_be(_lv_draw_sw_blend_image_dsc_t *dsc, uint32_t src_px_size);
+lv_result_t lv_rgb888_blend_normal_to_rgb565_with_mask_be(_lv_draw_sw_blend_image_dsc_t *dsc, uint32_t src_px_size);
+lv_result_t lv_rgb888_blend_normal_to_rgb565_mix_mask_opa_be(_lv_draw_sw_blend_image_dsc_t *dsc, uint32_t src_px_size);
+lv_result_t lv_argb8888_blend_normal_to_rgb565_be(_lv_draw_sw_blend_image_dsc_t *dsc);
+lv_result_t lv_argb8888_blend_normal_to_rgb565_with_opa_be(_lv_draw_sw_blend_image_dsc_t *dsc);
+lv_result_t lv_argb8888_blend_normal_to_rgb565_with_mask_be(_lv_draw_sw_blend_image_dsc_t *dsc);
+lv_result_t lv_argb8888_blend_normal_to_rgb565_mix_mask_opa_be(_lv_draw_sw_blend_image_dsc_t *dsc);
+
+static inline lv_result_t _lv_color_blend_to_rgb565_be_esp(_lv_draw_sw_blend_fill_dsc_t *dsc)
+{
+    /* The assembly fill converts an lv_color_t to RGB565, build the color that converts to the swapped value */
+    uint16_t c = lv_color_to_u16(dsc->color);
+    c = (uint16_t)((c >> 8) | (c << 8));
+    lv_color_t color_be = {
+        .blue = (uint8_t)((c & 0x1F) << 3),
+        .green = (uint8_t)((c >> 3) & 0xFC),
+        .red = (uint8_t)((c >> 8) & 0xF8),
+    };
+    asm_dsc_t asm_dsc = {
+        .dst_buf = dsc->dest_buf,
+        .dst_w = dsc->dest_w,
+        .dst_h = dsc->dest_h,
+        .dst_stride = dsc->dest_stride,
+        .src_buf = &color_be,
+    };
+
+    if (lv_color_blend_to_rgb565_esp(&asm_dsc) == LV_RESULT_OK) {
+        return LV_RESULT_OK;
+    }
+    return lv_color_blend_to_rgb565_be(dsc);
+}
+#endif
+
 extern int lv_rgb888_blend_normal_to_rgb888_esp(asm_dsc_t *asm_dsc);
 
 static inline lv_result_t _lv_rgb888_blend_normal_to_rgb888_esp(_lv_draw_sw_blend_image_dsc_t *dsc, uint32_t dest_px_size, uint32_t src_px_size)
@@ -0,0 +1,361 @@
+/*
+ * SPDX-FileCopyrightText: 2026 DIYtogether contributors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * RGB565 blending into big-endian draw buffers (CONFIG_LVGL_PORT_RGB565_BIG_ENDIAN)
+ *
+ * SPI panels take RGB565 pixels MSB first. With this option LVGL renders straight into that byte order, so the
+ * flush callback does not need to swap the draw buffer. Every RGB565 pixel in memory (draw buffers, RGB565 and
+ * RGB565A8 images) is big-endian. These functions replace LVGL's RGB565 blenders through the
+ * LV_DRAW_SW_*_TO_RGB565 hooks of esp_lvgl_port_lv_blend.h: the results are the byte-swapped results of
+ * LVGL's C code, bit for bit. They always return LV_RESULT_OK, LVGL's C code must never touch these buffers.
+ */
+
+#include "sdkconfig.h"
+
+#if CONFIG_LVGL_PORT_RGB565_BIG_ENDIAN
+
+#include <stdint.h>
+#include "lvgl.h"
+#include "esp_lvgl_port_lv_blend.h"
+
+/*********************
+ *      DEFINES
+ *********************/
+
+#define DRAWBUF_NEXT_ROW(buf, stride)   ((void *)((uint8_t *)(buf) + (stride)))
+
+/**********************
+ *  STATIC FUNCTIONS
+ **********************/
+
+static inline uint16_t swap16(uint16_t c)
+{
+    return (uint16_t)((c >> 8) | (c << 8));
+}
+
+/* lv_color_16_16_mix() with a big-endian background, returns a big-endian color */
+static inline uint16_t mix_16_be(uint16_t fg, uint16_t bg_be, uint8_t mix)
+{
+    if (mix == 0) {
+        return bg_be;
+    }
+    return swap16(lv_color_16_16_mix(fg, swap16(bg_be), mix));
+}
+
+/* Same as lv_color_24_16_mix() of lv_draw_sw_blend_to_rgb565.c (static there), little-endian in and out */
+static inline uint16_t mix_24_16(const uint8_t *c1, uint16_t c2, uint8_t mix)
+{
+    if (mix == 0) {
+        return c2;
+    } else if (mix == 255) {
+        return ((c1[2] & 0xF8) << 8) + ((c1[1] & 0xFC) << 3) + ((c1[0] & 0xF8) >> 3);
+    } else {
+        lv_opa_t mix_inv = 255 - mix;
+
+        return ((((c1[2] >> 3) * mix + ((c2 >> 11) & 0x1F) * mix_inv) << 3) & 0xF800) +
+               ((((c1[1] >> 2) * mix + ((c2 >> 5) & 0x3F) * mix_inv) >> 3) & 0x07E0) +
+               (((c1[0] >> 3) * mix + (c2 & 0x1F) * mix_inv) >> 8);
+    }
+}
+
+static inline uint16_t mix_24_16_be(const uint8_t *c1, uint16_t c2_be, uint8_t mix)
+{
+    if (mix == 0) {
+        return c2_be;
+    }
+    return swap16(mix_24_16(c1, swap16(c2_be), mix));
+}
+
+/**********************
+ *   GLOBAL FUNCTIONS
+ **********************/
+
+lv_result_t lv_color_blend_to_rgb565_be(_lv_draw_sw_blend_fill_dsc_t *dsc)
+{
+    const uint16_t color_be = swap16(lv_color_to_u16(dsc->color));
+    const uint32_t color32 = ((uint32_t)color_be << 16) | color_be;
+    uint16_t *dest_buf_u16 = dsc->dest_buf;
+
+    for (int32_t y = 0; y < dsc->dest_h; y++) {
+        int32_t x = 0;
+        if (((uintptr_t)dest_buf_u16 & 0x3) && x < dsc->dest_w) {
+            dest_buf_u16[x++] = color_be;
+        }
+        uint32_t *dest32 = (uint32_t *)&dest_buf_u16[x];
+        for (; x < dsc->dest_w - 1; x += 2) {
+            *dest32++ = color32;
+        }
+        if (x < dsc->dest_w) {
+            dest_buf_u16[x] = color_be;
+        }
+        dest_buf_u16 = DRAWBUF_NEXT_ROW(dest_buf_u16, dsc->dest_stride);
+    }
+    return LV_RESULT_OK;
+}
+
+lv_result_t lv_color_blend_to_rgb565_with_opa_be(_lv_draw_sw_blend_fill_dsc_t *dsc)
+{
+    const uint16_t color16 = lv_color_to_u16(dsc->color);
+    const lv_opa_t opa = dsc->opa;
+    uint16_t *dest_buf_u16 = dsc->dest_buf;
+
+    /* Backgrounds are mostly flat: remember the last destination color and its result */
+    uint16_t last_dest = dest_buf_u16[0];
+    uint16_t last_res = mix_16_be(color16, last_dest, opa);
+
+    for (int32_t y = 0; y < dsc->dest_h; y++) {
+        for (int32_t x = 0; x < dsc->dest_w; x++) {
+            if (dest_buf_u16[x] != last_dest) {
+                last_dest = dest_buf_u16[x];
+                last_res = mix_16_be(color16, last_dest, opa);
+            }
+            dest_buf_u16[x] = last_res;
+        }
+        dest_buf_u16 = DRAWBUF_NEXT_ROW(dest_buf_u16, dsc->dest_stride);
+    }
+    return LV_RESULT_OK;
+}
+
+lv_result_t lv_color_blend_to_rgb565_with_mask_be(_lv_draw_sw_blend_fill_dsc_t *dsc)
+{
+    const uint16_t color16 = lv_color_to_u16(dsc->color);
+    const uint16_t color_be = swap16(color16);
+    uint16_t *dest_buf_u16 = dsc->dest_buf;
+    const lv_opa_t *mask = dsc->mask_buf;
+
+    for (int32_t y = 0; y < dsc->dest_h; y++) {
+        for (int32_t x = 0; x < dsc->dest_w; x++) {
+            lv_opa_t m = mask[x];
+            if (m == LV_OPA_COVER) {
+                dest_buf_u16[x] = color_be;
+            } else if (m != LV_OPA_TRANSP) {
+                dest_buf_u16[x] = mix_16_be(color16, dest_buf_u16[x], m);
+            }
+        }
+        dest_buf_u16 = DRAWBUF_NEXT_ROW(dest_buf_u16, dsc->dest_stride);
+        mask += dsc->mask_stride;
+    }
+    return LV_RESULT_OK;
+}
+
+lv_result_t lv_color_blend_to_rgb565_mix_mask_opa_be(_lv_draw_sw_blend_fill_dsc_t *dsc)
+{
+    const uint16_t color16 = lv_color_to_u16(dsc->color);
+    const lv_opa_t opa = dsc->opa;
+    uint16_t *dest_buf_u16 = dsc->dest_buf;
+    const lv_opa_t *mask = dsc->mask_buf;
+
+    for (int32_t y = 0; y < dsc->dest_h; y++) {
+        for (int32_t x = 0; x < dsc->dest_w; x++) {
+            dest_buf_u16[x] = mix_16_be(color16, dest_buf_u16[x], LV_OPA_MIX2(mask[x], opa));
+        }
+        dest_buf_u16 = DRAWBUF_NEXT_ROW(dest_buf_u16, dsc->dest_stride);
+        mask += dsc->mask_stride;
+    }
+    return LV_RESULT_OK;
+}
+
+lv_result_t lv_rgb565_blend_normal_to_rgb565_with_opa_be(_lv_draw_sw_blend_image_dsc_t *dsc)
+{
+    const lv_opa_t opa = dsc->opa;
+    uint16_t *dest_buf_u16 = dsc->dest_buf;
+    const uint16_t *src_buf_u16 = dsc->src_buf;
+
+    for (int32_t y = 0; y < dsc->dest_h; y++) {
+        for (int32_t x = 0; x < dsc->dest_w; x++) {
+            dest_buf_u16[x] = mix_16_be(swap16(src_buf_u16[x]), dest_buf_u16[x], opa);
+        }
+        dest_buf_u16 = DRAWBUF_NEXT_ROW(dest_buf_u16, dsc->dest_stride);
+        src_buf_u16 = DRAWBUF_NEXT_ROW(src_buf_u16, dsc->src_stride);
+    }
+    return LV_RESULT_OK;
+}
+
+lv_result_t lv_rgb565_blend_normal_to_rgb565_with_mask_be(_lv_draw_sw_blend_image_dsc_t *dsc)
+{
+    /* RGB565A8 sprites: the mask is their alpha plane, mostly transparent and opaque runs */
+    uint16_t *dest_buf_u16 = dsc->dest_buf;
+    const uint16_t *src_buf_u16 = dsc->src_buf;
+    const lv_opa_t *mask = dsc->mask_buf;
+
+    for (int32_t y = 0; y < dsc->dest_h; y++) {
+        for (int32_t x = 0; x < dsc->dest_w; x++) {
+            lv_opa_t m = mask[x];
+            if (m == LV_OPA_COVER) {
+                dest_buf_u16[x] = src_buf_u16[x];
+            } else if (m != LV_OPA_TRANSP) {
+                dest_buf_u16[x] = mix_16_be(swap16(src_buf_u16[x]), dest_buf_u16[x], m);
+            }
+        }
+        dest_buf_u16 = DRAWBUF_NEXT_ROW(dest_buf_u16, dsc->dest_stride);
+        src_buf_u16 = DRAWBUF_NEXT_ROW(src_buf_u16, dsc->src_stride);
+        mask += dsc->mask_stride;
+    }
+    return LV_RESULT_OK;
+}
+
+lv_result_t lv_rgb565_blend_normal_to_rgb565_mix_mask_opa_be(_lv_draw_sw_blend_image_dsc_t *dsc)
+{
+    const lv_opa_t opa = dsc->opa;
+    uint16_t *dest_buf_u16 = dsc->dest_buf;
+    const uint16_t *src_buf_u16 = dsc->src_buf;
+    const lv_opa_t *mask = dsc->mask_buf;
+
+    for (int32_t y = 0; y < dsc->dest_h; y++) {
+        for (int32_t x = 0; x < dsc->dest_w; x++) {
+            dest_buf_u16[x] = mix_16_be(swap16(src_buf_u16[x]), dest_buf_u16[x], LV_OPA_MIX2(mask[x], opa));
+        }
+        dest_buf_u16 = DRAWBUF_NEXT_ROW(dest_buf_u16, dsc->dest_stride);
+        src_buf_u16 = DRAWBUF_NEXT_ROW(src_buf_u16, dsc->src_stride);
+        mask += dsc->mask_stride;
+    }
+    return LV_RESULT_OK;
+}
+
+lv_result_t lv_rgb888_blend_normal_to_rgb565_be(_lv_draw_sw_blend_image_dsc_t *dsc, uint32_t src_px_size)
+{
+    uint16_t *dest_buf_u16 = dsc->dest_buf;
+    const uint8_t *src_buf_u8 = dsc->src_buf;
+
+    for (int32_t y = 0; y < dsc->dest_h; y++) {
+        const uint8_t *src = src_buf_u8;
+        for (int32_t x = 0; x < dsc->dest_w; x++, src += src_px_size) {
+            /* Big-endian RGB565: RRRRRGGG in the low byte, GGGBBBBB in the high byte */
+            dest_buf_u16[x] = (uint16_t)((src[2] & 0xF8) | (src[1] >> 5) |
+                                         ((((src[1] & 0x1C) << 3) | (src[0] >> 3)) << 8));
+        }
+        dest_buf_u16 = DRAWBUF_NEXT_ROW(dest_buf_u16, dsc->dest_stride);
+        src_buf_u8 += dsc->src_stride;
+    }
+    return LV_RESULT_OK;
+}
+
+lv_result_t lv_rgb888_blend_normal_to_rgb565_with_opa_be(_lv_draw_sw_blend_image_dsc_t *dsc, uint32_t src_px_size)
+{
+    const lv_opa_t opa = dsc->opa;
+    uint16_t *dest_buf_u16 = dsc->dest_buf;
+    const uint8_t *src_buf_u8 = dsc->src_buf;
+
+    for (int32_t y = 0; y < dsc->dest_h; y++) {
+        const uint8_t *src = src_buf_u8;
+        for (int32_t x = 0; x < dsc->dest_w; x++, src += src_px_size) {
+            dest_buf_u16[x] = mix_24_16_be(src, dest_buf_u16[x], opa);
+        }
+        dest_buf_u16 = DRAWBUF_NEXT_ROW(dest_buf_u16, dsc->dest_stride);
+        src_buf_u8 += dsc->src_stride;
+    }
+    return LV_RESULT_OK;
+}
+
+lv_result_t lv_rgb888_blend_normal_to_rgb565_with_mask_be(_lv_draw_sw_blend_image_dsc_t *dsc, uint32_t src_px_size)
+{
+    uint16_t *dest_buf_u16 = dsc->dest_buf;
+    const uint8_t *src_buf_u8 = dsc->src_buf;
+    const lv_opa_t *mask = dsc->mask_buf;
+
+    for (int32_t y = 0; y < dsc->dest_h; y++) {
+        const uint8_t *src = src_buf_u8;
+        for (int32_t x = 0; x < dsc->dest_w; x++, src += src_px_size) {
+            dest_buf_u16[x] = mix_24_16_be(src, dest_buf_u16[x], mask[x]);
+        }
+        dest_buf_u16 = DRAWBUF_NEXT_ROW(dest_buf_u16, dsc->dest_stride);
+        src_buf_u8 += dsc->src_stride;
+        mask += dsc->mask_stride;
+    }
+    return LV_RESULT_OK;
+}
+
+lv_result_t lv_rgb888_blend_normal_to_rgb565_mix_mask_opa_be(_lv_draw_sw_blend_image_dsc_t *dsc, uint32_t src_px_size)
+{
+    const lv_opa_t opa = dsc->opa;
+    uint16_t *dest_buf_u16 = dsc->dest_buf;
+    const uint8_t *src_buf_u8 = dsc->src_buf;
+    const lv_opa_t *mask = dsc->mask_buf;
+
+    for (int32_t y = 0; y < dsc->dest_h; y++) {
+        const uint8_t *src = src_buf_u8;
+        for (int32_t x = 0; x < dsc->dest_w; x++, src += src_px_size) {
+            dest_buf_u16[x] = mix_24_16_be(src, dest_buf_u16[x], LV_OPA_MIX2(mask[x], opa));
+        }
+        dest_buf_u16 = DRAWBUF_NEXT_ROW(dest_buf_u16, dsc->dest_stride);
+        src_buf_u8 += dsc->src_stride;
+        mask += dsc->mask_stride;
+    }
+    return LV_RESULT_OK;
+}
+
+lv_result_t lv_argb8888_blend_normal_to_rgb565_be(_lv_draw_sw_blend_image_dsc_t *dsc)
+{
+    uint16_t *dest_buf_u16 = dsc->dest_buf;
+    const uint8_t *src_buf_u8 = dsc->src_buf;
+
+    for (int32_t y = 0; y < dsc->dest_h; y++) {
+        const uint8_t *src = src_buf_u8;
+        for (int32_t x = 0; x < dsc->dest_w; x++, src += 4) {
+            dest_buf_u16[x] = mix_24_16_be(src, dest_buf_u16[x], src[3]);
+        }
+        dest_buf_u16 = DRAWBUF_NEXT_ROW(dest_buf_u16, dsc->dest_stride);
+        src_buf_u8 += dsc->src_stride;
+    }
+    return LV_RESULT_OK;
+}
+
+lv_result_t lv_argb8888_blend_normal_to_rgb565_with_opa_be(_lv_draw_sw_blend_image_dsc_t *dsc)
+{
+    const lv_opa_t opa = dsc->opa;
+    uint16_t *dest_buf_u16 = dsc->dest_buf;
+    const uint8_t *src_buf_u8 = dsc->src_buf;
+
+    for (int32_t y = 0; y < dsc->dest_h; y++) {
+        const uint8_t *src = src_buf_u8;
+        for (int32_t x = 0; x < dsc->dest_w; x++, src += 4) {
+            dest_buf_u16[x] = mix_24_16_be(src, dest_buf_u16[x], LV_OPA_MIX2(src[3], opa));
+        }
+        dest_buf_u16 = DRAWBUF_NEXT_ROW(dest_buf_u16, dsc->dest_stride);
+        src_buf_u8 += dsc->src_stride;
+    }
+    return LV_RESULT_OK;
+}
+
+lv_result_t lv_argb8888_blend_normal_to_rgb565_with_mask_be(_lv_draw_sw_blend_image_dsc_t *dsc)
+{
+    uint16_t *dest_buf_u16 = dsc->dest_buf;
+    const uint8_t *src_buf_u8 = dsc->src_buf;
+    const lv_opa_t *mask = dsc->mask_buf;
+
+    for (int32_t y = 0; y < dsc->dest_h; y++) {
+        const uint8_t *src = src_buf_u8;
+        for (int32_t x = 0; x < dsc->dest_w; x++, src += 4) {
+            dest_buf_u16[x] = mix_24_16_be(src, dest_buf_u16[x], LV_OPA_MIX2(src[3], mask[x]));
+        }
+        dest_buf_u16 = DRAWBUF_NEXT_ROW(dest_buf_u16, dsc->dest_stride);
+        src_buf_u8 += dsc->src_stride;
+        mask += dsc->mask_stride;
+    }
+    return LV_RESULT_OK;
+}
+
+lv_result_t lv_argb8888_blend_normal_to_rgb565_mix_mask_opa_be(_lv_draw_sw_blend_image_dsc_t *dsc)
+{
+    const lv_opa_t opa = dsc->opa;
+    uint16_t *dest_buf_u16 = dsc->dest_buf;
+    const uint8_t *src_buf_u8 = dsc->src_buf;
+    const lv_opa_t *mask = dsc->mask_buf;
+
+    for (int32_t y = 0; y < dsc->dest_h; y++) {
+        const uint8_t *src = src_buf_u8;
+        for (int32_t x = 0; x < dsc->dest_w; x++, src += 4) {
+            dest_buf_u16[x] = mix_24_16_be(src, dest_buf_u16[x], LV_OPA_MIX3(src[3], mask[x], opa));
+        }
+        dest_buf_u16 = DRAWBUF_NEXT_ROW(dest_buf_u16, dsc->dest_stride);
+        src_buf_u8 += dsc->src_stride;
+        mask += dsc->mask_stride;
+    }
+    return LV_RESULT_OK;
+}
+
+#endif /* CONFIG_LVGL_PORT_RGB565_BIG_ENDIAN */
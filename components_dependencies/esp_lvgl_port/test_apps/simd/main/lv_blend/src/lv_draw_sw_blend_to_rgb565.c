@@ -622,7 +622,8 @@ static void LV_ATTRIBUTE_FAST_MEM rgb565_image_blend(_lv_draw_sw_blend_image_dsc
                 }
             }
         } else if (mask_buf && opa >= LV_OPA_MAX) {
-            if (LV_RESULT_INVALID == LV_DRAW_SW_RGB565_BLEND_NORMAL_TO_RGB565_WITH_MASK(dsc)) {
+            // The assembly may refuse unaligned buffers (LV_RESULT_INVALID), the ANSI code takes over then, as in LVGL
+            if (!dsc->use_asm || LV_RESULT_INVALID == LV_DRAW_SW_RGB565_BLEND_NORMAL_TO_RGB565_WITH_MASK(dsc)) {
                 for (y = 0; y < h; y++) {
                     for (x = 0; x < w; x++) {
                         dest_buf_u16[x] = lv_color_16_16_mix(src_buf_u16[x], dest_buf_u16[x], mask_buf[x]);
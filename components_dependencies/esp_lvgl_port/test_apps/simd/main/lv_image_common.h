@@ -23,6 +23,7 @@ extern "C" {
 typedef enum {
     OPERATION_FILL,
     OPERATION_FILL_WITH_OPA,
+    OPERATION_FILL_WITH_MASK,                                 /*!< RGB565A8 image: RGB565 source with its alpha plane as mask */
 } blend_operation_t;
 
 /**
@@ -70,6 +71,8 @@ typedef struct {
         void *p_dest_ansi;                                    /*!< pointer to the destination ANSI test buf */
         void *p_dest_asm_alloc;                               /*!< pointer to the beginning of the memory allocated for the destination ASM test buf, used in free() */
         void *p_dest_ansi_alloc;                              /*!< pointer to the beginning of the memory allocated for the destination ANSI test buf, used in free() */
+        void *p_mask;                                         /*!< pointer to the mask test buf (common for both the ANSI and ASM), NULL without mask */
+        void *p_mask_alloc;                                   /*!< pointer to the beginning of the memory allocated for the mask test buf, used in free() */
     } buf;
     void (*blend_api_func)(_lv_draw_sw_blend_image_dsc_t *);                    /*!< pointer to LVGL API function */
     void (*blend_api_func_px_size)(_lv_draw_sw_blend_image_dsc_t *, uint32_t);  /*!< pointer to LVGL API function, with additional parameter: pixel size */
@@ -106,6 +109,8 @@ typedef struct {
     void *src_array_align1;                                   /*!< Source test array with 1 byte alignment - testing worst case */
     void *dest_array_align16;                                 /*!< Destination test array with 16 byte alignment - testing most ideal case */
     void *dest_array_align1;                                  /*!< Destination test array with 1 byte alignment - testing worst case */
+    void *mask_array_align16;                                 /*!< Mask test array with 16 byte alignment - testing most ideal case, NULL without mask */
+    void *mask_array_align1;                                  /*!< Mask test array with 1 byte alignment - testing worst case, NULL without mask */
     void (*blend_api_func)(_lv_draw_sw_blend_image_dsc_t *);                     /*!< pointer to LVGL API function */
     void (*blend_api_func_px_size)(_lv_draw_sw_blend_image_dsc_t *, uint32_t);   /*!< pointer to LVGL API function, with additional parameter: pixel size */
     lv_color_format_t color_format;                           /*!< LV color format */
@@ -7,6 +7,7 @@
 #include <string.h>
 #include <malloc.h>
 #include <inttypes.h>
+#include "sdkconfig.h"
 #include "unity.h"
 #include "esp_log.h"
 #include "lv_fill_common.h"
@@ -107,6 +108,7 @@ Procedure:
 
 // ------------------------------------------------ Test cases stages --------------------------------------------------
 
+#if !CONFIG_IDF_TARGET_ESP32C6     // ESP32-C6 has RGB565 kernels only
 TEST_CASE("Test fill functionality ARGB8888", "[fill][functionality][ARGB8888]")
 {
     test_matrix_params_t test_matrix = {
@@ -130,6 +132,7 @@ TEST_CASE("Test fill functionality ARGB8888", "[fill][functionality][ARGB8888]")
     ESP_LOGI(TAG_LV_FILL_FUNC, "running test for ARGB8888 color format");
     functionality_test_matrix(&test_matrix, &test_case);
 }
+#endif
 
 TEST_CASE("Test fill functionality RGB565", "[fill][functionality][RGB565]")
 {
@@ -155,6 +158,7 @@ TEST_CASE("Test fill functionality RGB565", "[fill][functionality][RGB565]")
     functionality_test_matrix(&test_matrix, &test_case);
 }
 
+#if !CONFIG_IDF_TARGET_ESP32C6     // ESP32-C6 has RGB565 kernels only
 TEST_CASE("Test fill functionality RGB888", "[fill][functionality][RGB888]")
 {
     test_matrix_params_t test_matrix = {
@@ -178,6 +182,7 @@ TEST_CASE("Test fill functionality RGB888", "[fill][functionality][RGB888]")
     ESP_LOGI(TAG_LV_FILL_FUNC, "running test for RGB888 color format");
     functionality_test_matrix(&test_matrix, &test_case);
 }
+#endif
 // ------------------------------------------------ Static test functions ----------------------------------------------
 
 static void functionality_test_matrix(test_matrix_params_t *test_matrix, func_test_case_params_t *test_case)
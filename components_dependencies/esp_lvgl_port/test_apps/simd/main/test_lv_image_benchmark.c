@@ -10,7 +10,7 @@
 
 #include "unity.h"
 #include "esp_log.h"
-#include "freertos/FreeRTOS.h"  // for xthal_get_ccount()
+#include "esp_cpu.h"             // for esp_cpu_get_cycle_count(), Xtensa and RISC-V
 #include "lv_image_common.h"
 #include "lv_draw_sw_blend.h"
 #include "lv_draw_sw_blend_to_rgb565.h"
@@ -111,6 +111,66 @@ TEST_CASE("LV Image benchmark RGB565 blend to RGB565", "[image][benchmark][RGB56
     free(src_array_align16);
 }
 
+#if CONFIG_IDF_TARGET_ESP32C6
+TEST_CASE("LV Image benchmark RGB565A8 blend to RGB565", "[image][benchmark][RGB565A8]")
+{
+    uint16_t *dest_array_align16  = (uint16_t *)memalign(16, STRIDE * HEIGHT * sizeof(uint16_t) + UNALIGN_BYTES);
+    uint16_t *src_array_align16  = (uint16_t *)memalign(16, STRIDE * HEIGHT * sizeof(uint16_t) + UNALIGN_BYTES);
+    uint8_t *mask_array_align16  = (uint8_t *)memalign(16, STRIDE * HEIGHT * sizeof(uint8_t) + UNALIGN_BYTES);
+    TEST_ASSERT_NOT_EQUAL_MESSAGE(NULL, dest_array_align16, "Lack of memory");
+    TEST_ASSERT_NOT_EQUAL_MESSAGE(NULL, src_array_align16, "Lack of memory");
+    TEST_ASSERT_NOT_EQUAL_MESSAGE(NULL, mask_array_align16, "Lack of memory");
+
+    // LVGL images and draw buffers are always 2-byte aligned (odd addresses are left to the ANSI code),
+    // the worst case keeps the pixels 2-byte aligned, with different 4-byte alignment, and the mask 1-byte aligned
+    uint16_t *dest_array_align1 = (uint16_t *)((uint8_t *)dest_array_align16 + UNALIGN_BYTES - 1);
+    uint16_t *src_array_align1 = src_array_align16;
+    uint8_t *mask_array_align1 = mask_array_align16 + UNALIGN_BYTES;
+
+    // Sprite-like mask: transparent margins, an opaque body and 4 pixels wide anti-aliased edges on every row
+    for (int y = 0; y < HEIGHT; y++) {
+        for (int x = 0; x < STRIDE; x++) {
+            uint8_t opa = LV_OPA_TRANSP;
+            if (x >= WIDTH / 4 + 4 && x < (WIDTH * 3) / 4) {
+                opa = LV_OPA_COVER;
+            } else if (x >= WIDTH / 4 && x < WIDTH / 4 + 4) {
+                opa = (x - WIDTH / 4 + 1) * 0x3F;
+            } else if (x >= (WIDTH * 3) / 4 && x < (WIDTH * 3) / 4 + 4) {
+                opa = (4 - (x - (WIDTH * 3) / 4)) * 0x3F;
+            }
+            mask_array_align16[y * STRIDE + x] = opa;
+        }
+    }
+    memcpy(mask_array_align1, mask_array_align16, STRIDE * HEIGHT);
+    memset(src_array_align16, 0x5A, STRIDE * HEIGHT * sizeof(uint16_t));
+
+    bench_test_case_lv_image_params_t test_params = {
+        .height = HEIGHT,
+        .width = WIDTH,
+        .dest_stride = STRIDE * sizeof(uint16_t),
+        .src_stride = STRIDE * sizeof(uint16_t),
+        .cc_height = HEIGHT,
+        .cc_width = WIDTH - 1,
+        .benchmark_cycles = BENCHMARK_CYCLES,
+        .src_array_align16 = (void *)src_array_align16,
+        .src_array_align1 = (void *)src_array_align1,
+        .dest_array_align16 = (void *)dest_array_align16,
+        .dest_array_align1 = (void *)dest_array_align1,
+        .mask_array_align16 = (void *)mask_array_align16,
+        .mask_array_align1 = (void *)mask_array_align1,
+        .blend_api_func = &lv_draw_sw_blend_image_to_rgb565,
+        .color_format = LV_COLOR_FORMAT_RGB565,
+    };
+
+    ESP_LOGI(TAG_LV_IMAGE_BENCH, "running test for RGB565A8 color format");
+    lv_image_benchmark_init(&test_params);
+    free(dest_array_align16);
+    free(src_array_align16);
+    free(mask_array_align16);
+}
+#endif
+
+#if !CONFIG_IDF_TARGET_ESP32C6     // ESP32-C6 has RGB565 kernels only
 TEST_CASE("LV Image benchmark RGB888 blend to RGB888", "[image][benchmark][RGB888]")
 {
     uint8_t *dest_array_align16  = (uint8_t *)memalign(16, (STRIDE * HEIGHT * sizeof(uint8_t) * 3) + UNALIGN_BYTES);
@@ -143,6 +203,7 @@ TEST_CASE("LV Image benchmark RGB888 blend to RGB888", "[image][benchmark][RGB88
     free(dest_array_align16);
     free(src_array_align16);
 }
+#endif
 // ------------------------------------------------ Static test functions ----------------------------------------------
 
 static void lv_image_benchmark_init(bench_test_case_lv_image_params_t *test_params)
@@ -153,7 +214,8 @@ static void lv_image_benchmark_init(bench_test_case_lv_image_params_t *test_para
         .dest_w = test_params->width,
         .dest_h = test_params->height,
         .dest_stride = test_params->dest_stride,  // stride * sizeof()
-        .mask_buf = NULL,
+        .mask_buf = test_params->mask_array_align16,
+        .mask_stride = test_params->src_stride / 2,  // One mask byte per source pixel, as RGB565A8
         .src_buf = test_params->src_array_align16,
         .src_stride = test_params->src_stride,
         .src_color_format = test_params->color_format,
@@ -168,6 +230,7 @@ static void lv_image_benchmark_init(bench_test_case_lv_image_params_t *test_para
     dsc_cc.dest_w = test_params->cc_width;
     dsc_cc.dest_h = test_params->cc_height;
     dsc_cc.src_buf = test_params->src_array_align1;
+    dsc_cc.mask_buf = test_params->mask_array_align1;
 
     // Run benchmark 2 times:
     // First run using assembly, second run using ANSI
@@ -202,7 +265,7 @@ static float lv_image_benchmark_run(bench_test_case_lv_image_params_t *test_para
 
 
     // Run the benchmark
-    const unsigned int start_b = xthal_get_ccount();
+    const unsigned int start_b = esp_cpu_get_cycle_count();
     if (test_params->blend_api_func != NULL) {
 
         for (int i = 0; i < test_params->benchmark_cycles; i++) {
@@ -215,7 +278,7 @@ static float lv_image_benchmark_run(bench_test_case_lv_image_params_t *test_para
             test_params->blend_api_func_px_size(dsc, 3);
         }
     }
-    const unsigned int end_b = xthal_get_ccount();
+    const unsigned int end_b = esp_cpu_get_cycle_count();
 
     const float total_b = end_b - start_b;
     const float cycles = total_b / (test_params->benchmark_cycles);
@@ -146,6 +146,28 @@ TEST_CASE("LV Image functionality RGB565 blend to RGB565", "[image][functionalit
     functionality_test_matrix(&test_matrix, &test_case);
 }
 
+#if CONFIG_IDF_TARGET_ESP32C6
+TEST_CASE("LV Image functionality RGB565A8 blend to RGB565", "[image][functionality][RGB565A8]")
+{
+    test_matrix_lv_image_params_t test_matrix = default_test_matrix_image_blend;
+
+    // LVGL blends an RGB565A8 image as an RGB565 source with its alpha plane as mask_buf
+    func_test_case_lv_image_params_t test_case = {
+        .blend_api_func = &lv_draw_sw_blend_image_to_rgb565,
+        .color_format = LV_COLOR_FORMAT_RGB565,
+        .canary_pixels = CANARY_PIXELS_RGB565,
+        .memory_alignment_offset = 0,
+        .src_data_type_size = sizeof(uint16_t),
+        .dest_data_type_size = sizeof(uint16_t),
+        .operation_type = OPERATION_FILL_WITH_MASK,
+    };
+
+    ESP_LOGI(TAG_LV_IMAGE_FUNC, "running test for RGB565A8 color format");
+    functionality_test_matrix(&test_matrix, &test_case);
+}
+#endif
+
+#if !CONFIG_IDF_TARGET_ESP32C6     // ESP32-C6 has RGB565 kernels only
 TEST_CASE("LV Image functionality RGB888 blend to RGB888", "[image][functionality][RGB888]")
 {
     test_matrix_lv_image_params_t test_matrix = default_test_matrix_image_blend;
@@ -163,6 +185,7 @@ TEST_CASE("LV Image functionality RGB888 blend to RGB888", "[image][functionalit
     ESP_LOGI(TAG_LV_IMAGE_FUNC, "running test for RGB888 color format");
     functionality_test_matrix(&test_matrix, &test_case);
 }
+#endif
 
 // ------------------------------------------------ Static test functions ----------------------------------------------
 
@@ -208,8 +231,8 @@ static void lv_image_functionality(func_test_case_lv_image_params_t *test_case)
         .dest_w = test_case->dest_w,
         .dest_h = test_case->dest_h,
         .dest_stride = test_case->dest_stride * test_case->dest_data_type_size,  // dest_stride * sizeof(data_type)
-        .mask_buf = NULL,
-        .mask_stride = 0,
+        .mask_buf = test_case->buf.p_mask,
+        .mask_stride = test_case->src_stride,                                    // One mask byte per source pixel, as RGB565A8
         .src_buf = test_case->buf.p_src,
         .src_stride = test_case->src_stride * test_case->src_data_type_size,     // src_stride * sizeof(data_type)
         .src_color_format = test_case->color_format,
@@ -259,6 +282,7 @@ static void lv_image_functionality(func_test_case_lv_image_params_t *test_case)
     free(test_case->buf.p_dest_asm_alloc);
     free(test_case->buf.p_dest_ansi_alloc);
     free(test_case->buf.p_src_alloc);
+    free(test_case->buf.p_mask_alloc);
 }
 
 static void fill_test_bufs(func_test_case_lv_image_params_t *test_case)
@@ -298,6 +322,7 @@ static void fill_test_bufs(func_test_case_lv_image_params_t *test_case)
 
     switch (test_case->operation_type) {
     case OPERATION_FILL:
+    case OPERATION_FILL_WITH_MASK:
         // Fill the actual part of the destination buffers with known values,
         // Values must be same, because of the stride
 
@@ -341,6 +366,31 @@ static void fill_test_bufs(func_test_case_lv_image_params_t *test_case)
         break;
     }
 
+    // Mask buffer uses the source stride and unalignment (one byte per source pixel)
+    // Runs of transparent and opaque groups of 4 bytes, for the word-wide paths of the assembly, and mixed values in between
+    test_case->buf.p_mask = NULL;
+    test_case->buf.p_mask_alloc = NULL;
+    if (test_case->operation_type == OPERATION_FILL_WITH_MASK) {
+        void *mask_mem_common = memalign(16, src_buf_len + src_unalign_byte);
+        TEST_ASSERT_NOT_NULL_MESSAGE(mask_mem_common, "Lack of memory");
+        uint8_t *mask_buf_common = (uint8_t *)mask_mem_common + src_unalign_byte;
+        for (int i = 0; i < src_buf_len; i++) {
+            switch ((i / 4) % 3) {
+            case 0:
+                mask_buf_common[i] = LV_OPA_TRANSP;
+                break;
+            case 1:
+                mask_buf_common[i] = LV_OPA_COVER;
+                break;
+            default:
+                mask_buf_common[i] = (uint8_t)(i * 37);
+                break;
+            }
+        }
+        test_case->buf.p_mask_alloc = mask_mem_common;
+        test_case->buf.p_mask = (void *)mask_buf_common;
+    }
+
     // Shift array pointers by (Canary pixels amount * data type length) forward
     dest_buf_asm += canary_pixels * dest_data_type_size;
     dest_buf_ansi += canary_pixels * dest_data_type_size;
@@ -392,12 +442,15 @@ static void test_eval_image_16bit_data(func_test_case_lv_image_params_t *test_ca
     TEST_ASSERT_EQUAL_UINT16_ARRAY_MESSAGE((uint16_t *)test_case->buf.p_dest_ansi + canary_pixels, (uint16_t *)test_case->buf.p_dest_asm + canary_pixels, test_case->active_dest_buf_len, test_msg_buf);
 
     // Data part of the destination buffer and source buffer (not considering matrix padding) must be equal
-    uint16_t *dest_row_begin = (uint16_t *)test_case->buf.p_dest_asm + canary_pixels;
-    uint16_t *src_row_begin = (uint16_t *)test_case->buf.p_src;
-    for (int row = 0; row < test_case->dest_h; row++) {
-        TEST_ASSERT_EQUAL_UINT16_ARRAY_MESSAGE(dest_row_begin, src_row_begin, test_case->dest_w, test_msg_buf);
-        dest_row_begin += test_case->dest_stride;   // Move pointer of the destination buffer to the next row
-        src_row_begin += test_case->src_stride;     // Move pointer of the source buffer to the next row
+    // A masked blend mixes the two, there only the ANSI comparison above applies
+    if (test_case->operation_type == OPERATION_FILL) {
+        uint16_t *dest_row_begin = (uint16_t *)test_case->buf.p_dest_asm + canary_pixels;
+        uint16_t *src_row_begin = (uint16_t *)test_case->buf.p_src;
+        for (int row = 0; row < test_case->dest_h; row++) {
+            TEST_ASSERT_EQUAL_UINT16_ARRAY_MESSAGE(dest_row_begin, src_row_begin, test_case->dest_w, test_msg_buf);
+            dest_row_begin += test_case->dest_stride;   // Move pointer of the destination buffer to the next row
+            src_row_begin += test_case->src_stride;     // Move pointer of the source buffer to the next row
+        }
     }
 
     // Canary pixels area must stay 0
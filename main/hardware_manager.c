@@ -1,78 +1,122 @@
 /* Fichero: main/hardware_manager.c */
-/* Descripción: Diagnóstico de Causa Raíz: El conteo de fotogramas de animación fallaba porque el callback del driver VFS (s_dir_read_cb) no se adhería a la especificación de la API de LVGL, que requiere que los nombres de directorio se prefijen con el carácter '/'.
-Solución Definitiva: Se ha restaurado la lógica original en s_dir_read_cb que comprueba el tipo de entrada de directorio (nt->d_type) y añade el prefijo '/' a los directorios. Esto asegura que el driver VFS proporciona los datos en el formato que LVGL y el código de la aplicación esperan, permitiendo que el filtrado de directorios en nimation_loader_count_frames funcione correctamente. */
-/* Último cambio: 21/08/2025 - 18:04 */
+/* Descripción: El display de LVGL se crea con la estrategia de búfer que elige el BSP según Kconfig y la RAM libre (tamaño en píxeles, doble búfer y refresco completo), en RAM apta para DMA. Con CONFIG_LVGL_PORT_RGB565_BIG_ENDIAN, LVGL dibuja el RGB565 ya en el orden de bytes del panel y el display se crea sin 'swap_bytes', así el flush no recorre cada píxel antes de enviarlo. El display se engancha además a la medida del tiempo de CPU del flush del BSP, que '/metrics' sirve en 'lcd_flush' junto con las latencias del driver 'S:' y los contadores de sd_file_io, para comparar los dos modos. */
+/* Último cambio: 18/10/2026 - 03:00 */
 #include "hardware_manager.h"
 #include "esp_log.h"
 #include "bsp_api.h"
 #include "esp_lvgl_port.h"
 #include "lvgl.h"
 #include "sdkconfig.h"
+#include "sd_file_io.h"
+#include "vfs_metrics.h"
+#include "web_server.h"
+#include "esp_timer.h"
 
 #include <stdio.h>
 #include <string.h>
+#include <strings.h>
 #include <dirent.h>
 #include <unistd.h>
 
 static const char *TAG = "HW_MANAGER";
 #define BASE_PATH "/sdcard"
 
-// --- Implementación del driver de LVGL v9 usando el VFS de ESP-IDF ---
+// --- Implementación del driver de LVGL v9 sobre la capa POSIX de la SD (sd_file_io) ---
 
-static void * fs_open_cb(lv_fs_drv_t * drv, const char * path, lv_fs_mode_t mode) {
-    char vfs_path[256];
+static void build_vfs_path(char *out, size_t out_size, const char *path) {
     if (path[0] == '/') {
-        snprintf(vfs_path, sizeof(vfs_path), "%s%s", BASE_PATH, path);
+        snprintf(out, out_size, "%s%s", BASE_PATH, path);
     } else {
-        snprintf(vfs_path, sizeof(vfs_path), "%s/%s", BASE_PATH, path);
+        snprintf(out, out_size, "%s/%s", BASE_PATH, path);
     }
+}
+
+// Cada callback anota su duración en vfs_metrics (un par de lecturas del temporizador y unos contadores).
+static inline uint32_t elapsed_us(int64_t t0) {
+    return (uint32_t)(esp_timer_get_time() - t0);
+}
+
+static void * fs_open_cb(lv_fs_drv_t * drv, const char * path, lv_fs_mode_t mode) {
+    int64_t t0 = esp_timer_get_time();
+    char vfs_path[256];
+    build_vfs_path(vfs_path, sizeof(vfs_path), path);
 
-    const char * fmode_str;
-    if(mode == LV_FS_MODE_WR) fmode_str = "wb";
-    else if(mode == LV_FS_MODE_RD) fmode_str = "rb";
-    else if(mode == (LV_FS_MODE_WR | LV_FS_MODE_RD)) fmode_str = "rb+";
-    else return NULL;
+    uint8_t io_mode = 0;
+    if (mode & LV_FS_MODE_RD) io_mode |= SD_FILE_MODE_RD;
+    if (mode & LV_FS_MODE_WR) io_mode |= SD_FILE_MODE_WR;
+    if (io_mode == 0) return NULL;
 
-    return fopen(vfs_path, fmode_str);
+    sd_file_t *f = sd_file_open(vfs_path, io_mode);
+    vfs_metrics_record_open(vfs_path, elapsed_us(t0), f != NULL);
+    return f;
 }
 
 static lv_fs_res_t fs_close_cb(lv_fs_drv_t * drv, void * file_p) {
-    fclose((FILE *)file_p);
+    int64_t t0 = esp_timer_get_time();
+    sd_file_close((sd_file_t *)file_p);
+    vfs_metrics_record(VFS_OP_CLOSE, elapsed_us(t0), 0, true);
     return LV_FS_RES_OK;
 }
 
 static lv_fs_res_t fs_read_cb(lv_fs_drv_t * drv, void * file_p, void * buf, uint32_t btr, uint32_t * br) {
-    *br = fread(buf, 1, btr, (FILE *)file_p);
-    return LV_FS_RES_OK;
+    int64_t t0 = esp_timer_get_time();
+    size_t n = 0;
+    int ret = sd_file_read((sd_file_t *)file_p, buf, btr, &n);
+    *br = (uint32_t)n;
+    vfs_metrics_record(VFS_OP_READ, elapsed_us(t0), (uint32_t)n, ret == 0);
+    return ret == 0 ? LV_FS_RES_OK : LV_FS_RES_HW_ERR;
+}
+
+#if CONFIG_DIYMON_SD_SECTOR_READS
+// Solo los packs de animación: son los únicos que el servidor web reserva contiguos.
+static bool sd_extent_get(const char *path, uint32_t *first_sector, uint32_t *size) {
+    size_t len = strlen(path);
+    if (len < 4 || strcasecmp(path + len - 4, ".pak") != 0) return false;
+    return bsp_sdcard_get_extent(path, first_sector, size);
 }
 
+static int sd_sector_read(void *dst, uint32_t sector, uint32_t count) {
+    return bsp_sdcard_read_sectors(dst, sector, count) == ESP_OK ? 0 : -1;
+}
+#endif
+
 static lv_fs_res_t fs_write_cb(lv_fs_drv_t * drv, void * file_p, const void * buf, uint32_t btw, uint32_t * bw) {
-    *bw = fwrite(buf, 1, btw, (FILE *)file_p);
-    return LV_FS_RES_OK;
+    size_t n = 0;
+    int ret = sd_file_write((sd_file_t *)file_p, buf, btw, &n);
+    *bw = (uint32_t)n;
+    return ret == 0 ? LV_FS_RES_OK : LV_FS_RES_HW_ERR;
 }
 
 static lv_fs_res_t fs_seek_cb(lv_fs_drv_t * drv, void * file_p, uint32_t pos, lv_fs_whence_t whence) {
-    fseek((FILE *)file_p, pos, SEEK_SET);
-    return LV_FS_RES_OK;
+    // Con SEEK_CUR/SEEK_END el desplazamiento puede ser negativo (LVGL lo pasa como uint32_t).
+    int64_t offset = (int64_t)pos;
+    int w = SEEK_SET;
+    if (whence == LV_FS_SEEK_CUR) { w = SEEK_CUR; offset = (int32_t)pos; }
+    else if (whence == LV_FS_SEEK_END) { w = SEEK_END; offset = (int32_t)pos; }
+    int64_t t0 = esp_timer_get_time();
+    int ret = sd_file_seek((sd_file_t *)file_p, offset, w);
+    vfs_metrics_record(VFS_OP_SEEK, elapsed_us(t0), 0, ret == 0);
+    return ret == 0 ? LV_FS_RES_OK : LV_FS_RES_INV_PARAM;
 }
 
 static lv_fs_res_t fs_tell_cb(lv_fs_drv_t * drv, void * file_p, uint32_t * pos_p) {
-    *pos_p = ftell((FILE *)file_p);
+    *pos_p = (uint32_t)sd_file_tell((sd_file_t *)file_p);
     return LV_FS_RES_OK;
 }
 
 static void * fs_dir_open_cb(lv_fs_drv_t * drv, const char *path) {
+    int64_t t0 = esp_timer_get_time();
     char vfs_path[256];
-    if (path[0] == '/') {
-        snprintf(vfs_path, sizeof(vfs_path), "%s%s", BASE_PATH, path);
-    } else {
-        snprintf(vfs_path, sizeof(vfs_path), "%s/%s", BASE_PATH, path);
-    }
-    return opendir(vfs_path);
+    build_vfs_path(vfs_path, sizeof(vfs_path), path);
+    DIR *dir = opendir(vfs_path);
+    vfs_metrics_record(VFS_OP_DIR, elapsed_us(t0), 0, dir != NULL);
+    return dir;
 }
 
 static lv_fs_res_t fs_dir_read_cb(lv_fs_drv_t * drv, void * rddir_p, char * fn, uint32_t fn_len) {
+    int64_t t0 = esp_timer_get_time();
     struct dirent *ent = readdir((DIR *)rddir_p);
+    vfs_metrics_record(VFS_OP_DIR, elapsed_us(t0), 0, true);
     if(ent == NULL) {
         fn[0] = '\0';
         return LV_FS_RES_OK;
@@ -89,10 +133,49 @@ static lv_fs_res_t fs_dir_read_cb(lv_fs_drv_t * drv, void * rddir_p, char * fn,
 }
 
 static lv_fs_res_t fs_dir_close_cb(lv_fs_drv_t * drv, void * rddir_p) {
+    int64_t t0 = esp_timer_get_time();
     closedir((DIR *)rddir_p);
+    vfs_metrics_record(VFS_OP_DIR, elapsed_us(t0), 0, true);
     return LV_FS_RES_OK;
 }
 
+// '/metrics': latencias del driver 'S:' y, acumulados desde el arranque, los contadores de sd_file_io
+// (pool, lecturas directas o por sectores), que dicen si el tiempo se va en la SD o en la FAT,
+// y el tiempo de CPU del flush de la pantalla (con o sin intercambio de bytes).
+static size_t metrics_json(char *buf, size_t size, bool reset) {
+    size_t len = (size_t)snprintf(buf, size, "{\"vfs\":");
+    size_t n = vfs_metrics_to_json(buf + len, size - len);
+    if (n == 0) return 0;
+    len += n;
+
+    sd_file_io_stats_t st;
+    sd_file_io_get_stats(&st);
+    int r = snprintf(buf + len, size - len,
+                     ",\"sd_file_io\":{\"opens\":%lu,\"pool_hits\":%lu,\"reads\":%lu,\"direct_reads\":%lu,\"fills\":%lu,"
+                     "\"seeks\":%lu,\"sector_reads\":%lu,\"sector_fallbacks\":%lu,\"bytes_read\":%llu,\"bytes_buffered\":%llu}",
+                     (unsigned long)st.opens, (unsigned long)st.pool_hits, (unsigned long)st.reads,
+                     (unsigned long)st.direct_reads, (unsigned long)st.fills, (unsigned long)st.seeks,
+                     (unsigned long)st.sector_reads, (unsigned long)st.sector_fallbacks,
+                     (unsigned long long)st.bytes_read, (unsigned long long)st.bytes_buffered);
+    if (r < 0 || (size_t)r >= size - len) return 0;
+    len += (size_t)r;
+
+    bsp_lcd_flush_stats_t fl;
+    bsp_lcd_flush_get_stats(&fl);
+    r = snprintf(buf + len, size - len,
+                 ",\"lcd_flush\":{\"swap_bytes\":%s,\"flushes\":%lu,\"pixels\":%llu,\"cpu_us\":%llu,\"max_us\":%lu,"
+                 "\"swap_ns_per_px\":%lu}}",
+                 fl.swap_bytes ? "true" : "false", (unsigned long)fl.flushes, (unsigned long long)fl.pixels,
+                 (unsigned long long)fl.cpu_us, (unsigned long)fl.max_us, (unsigned long)fl.swap_ns_per_px);
+    if (r < 0 || (size_t)r >= size - len) return 0;
+    len += (size_t)r;
+    if (reset) {
+        vfs_metrics_reset();
+        bsp_lcd_flush_reset_stats();
+    }
+    return len;
+}
+
 esp_err_t hardware_manager_init(void) {
     ESP_LOGI(TAG, "Initializing BSP...");
     bsp_init(); 
@@ -107,19 +190,37 @@ esp_err_t hardware_manager_init(void) {
     };
     ESP_ERROR_CHECK(lvgl_port_init(&lvgl_cfg));
     
+    bsp_display_buffer_cfg_t buf_cfg;
+    bsp_get_display_buffer_cfg(&buf_cfg);
     lvgl_port_display_cfg_t disp_cfg = {
         .io_handle = bsp_get_panel_io_handle(),
         .panel_handle = bsp_get_display_handle(),
-        .buffer_size = bsp_get_display_buffer_size(),
-        .double_buffer = 1,
+        .buffer_size = buf_cfg.buffer_px,
+        .double_buffer = buf_cfg.double_buffer,
         .hres = bsp_get_display_hres(),
         .vres = bsp_get_display_vres(),
-        .flags = { .swap_bytes = true }
+        .flags = {
+            .buff_dma = true,
+            .full_refresh = buf_cfg.full_refresh,
+#if CONFIG_LVGL_PORT_RGB565_BIG_ENDIAN
+            // LVGL ya dibuja en el orden de bytes del panel: el flush envía el búfer tal cual.
+            .swap_bytes = false,
+#else
+            .swap_bytes = true,
+#endif
+        }
     };
 
     lv_disp_t * disp = lvgl_port_add_disp(&disp_cfg);
     lv_display_set_color_format(disp, LV_COLOR_FORMAT_RGB565);
 
+    // La SD comparte el bus SPI con la pantalla: el árbitro reparte el bus entre envíos y lecturas.
+    if (lvgl_port_lock(0)) {
+        bsp_spi_arbiter_attach_display(disp, bsp_get_panel_io_handle());
+        bsp_lcd_flush_attach(disp, disp_cfg.flags.swap_bytes);
+        lvgl_port_unlock();
+    }
+
     ESP_LOGI(TAG, "Configuring touch driver orientation to match display rotation...");
     esp_lcd_touch_handle_t touch_handle = bsp_get_touch_handle();
     
@@ -142,11 +243,30 @@ esp_err_t hardware_manager_init(void) {
 void hardware_manager_mount_lvgl_filesystem(void)
 {
     ESP_LOGI(TAG, "Registrando el sistema de ficheros VFS (/sdcard) con LVGL...");
+
+    const sd_file_io_cfg_t io_cfg = {
+        .read_ahead_bytes = CONFIG_DIYMON_SD_READ_AHEAD_KB * 1024,
+        .pool_size = CONFIG_DIYMON_SD_FILE_POOL,
+        .slice_bytes = CONFIG_DIYMON_SD_READ_SLICE_KB * 1024,
+        .io_begin = bsp_spi_arbiter_sd_begin,
+        .io_end = bsp_spi_arbiter_sd_end,
+#if CONFIG_DIYMON_SD_SECTOR_READS
+        .extent_get = sd_extent_get,
+        .sector_read = sd_sector_read,
+#endif
+    };
+    sd_file_io_init(&io_cfg);
+    // Los ficheros que el servidor web sube o borra no pueden seguir sirviéndose desde el pool
+    // ni leyéndose en los sectores que ocupaban.
+    web_server_add_fs_change_cb(bsp_sdcard_forget_extent);
+    web_server_add_fs_change_cb(sd_file_io_invalidate);
+    web_server_set_metrics_cb(metrics_json);
     
     static lv_fs_drv_t fs_drv;
     lv_fs_drv_init(&fs_drv);
 
     fs_drv.letter = 'S';
+    fs_drv.cache_size = 0; // La lectura anticipada la hace sd_file_io.
     fs_drv.open_cb = fs_open_cb;
     fs_drv.close_cb = fs_close_cb;
     fs_drv.read_cb = fs_read_cb;
@@ -1,7 +1,7 @@
-/* Fecha: 18/08/2025 - 08:25  */
+/* Fecha: 18/10/2026 - 01:30  */
 /* Fichero: main/main.c */
-/* Último cambio: Eliminada la inicialización y conexión automática de WiFi en el arranque. */
-/* Descripción: Se ha eliminado toda la lógica de inicialización de WiFi del arranque principal (app_main). Ahora, el dispositivo arranca sin activar la red. La responsabilidad de gestionar el ciclo de vida de WiFi (activar, conectar, desactivar) se delega completamente al módulo 'action_config_mode', que se invoca por interacción del usuario. */
+/* Último cambio: Con la SD montada se arranca la comprobación en segundo plano de los fotogramas de animación. */
+/* Descripción: El arranque principal no activa la red: la gestión de WiFi se delega al módulo 'action_config_mode', que se invoca por interacción del usuario. Tras inicializar el hardware se valida la copia del pack de animaciones de la partición de assets (animation_flash.c). Si la tarjeta SD falla pero esa copia corresponde a la evolución actual, el personaje se anima desde la flash y el arranque sigue en modo normal en lugar de entrar en el modo de configuración. La verificación de la SD del arranque solo abre '/sdcard/diymon'; con la SD correcta se programa además la comprobación completa de los fotogramas (animation_integrity.c), que corre en segundo plano con la UI ya en marcha. Al terminar se arranca la consola serie, con la que se consultan las métricas de E/S del driver 'S:' sin activar la red. */
 
 #include <stdio.h>
 #include <string.h>
@@ -18,6 +18,7 @@
 
 #include "bsp_api.h"
 #include "hardware_manager.h"
+#include "serial_console.h"
 #include "diymon_evolution.h"
 #include "core/ui.h"
 #include "web_server.h"
@@ -26,6 +27,9 @@
 #include "actions.h"
 #include "core/state_manager.h"
 #include "telemetry/telemetry_task.h"
+#include "animation_flash.h"
+#include "animation_integrity.h"
+#include "helpers.h"
 
 #include "esp_err.h"
 #include "esp_check.h"
@@ -35,6 +39,7 @@ static const char *TAG = "DIYMON_MAIN";
 // --- Declaraciones de funciones ---
 static void run_main_application_mode(void);
 static bool verify_sdcard_contents(void);
+static bool has_flash_animations(void);
 
 void app_main(void) {
     // 1. Inicializar la memoria no volátil.
@@ -68,11 +73,21 @@ static bool verify_sdcard_contents(void) {
     return true;
 }
 
+// Indica si la copia en flash del pack corresponde a la evolución actual.
+static bool has_flash_animations(void) {
+    char anim_path[128];
+    ui_helpers_build_asset_path(anim_path, sizeof(anim_path), "");
+    size_t len = strlen(anim_path);
+    if (len > 0 && anim_path[len - 1] == '/') anim_path[len - 1] = '\0';
+    return animation_flash_has_image(anim_path);
+}
+
 static void run_main_application_mode(void) {
     ESP_LOGI(TAG, "Cargando aplicación principal...");
     
     // 1. Inicializa todo el hardware y LVGL.
     hardware_manager_init();
+    animation_flash_init();
     
     // 2. Verifica la tarjeta SD.
     bool is_sd_ok = verify_sdcard_contents();
@@ -80,6 +95,7 @@ static void run_main_application_mode(void) {
     // 3. Inicializa los sistemas de software (Evolución y Assets).
     diymon_evolution_init();
     ui_assets_init();
+    bool is_flash_ok = !is_sd_ok && has_flash_animations();
 
     // 4. Construye la UI completa.
     if (lvgl_port_lock(0)) {
@@ -94,7 +110,12 @@ static void run_main_application_mode(void) {
     ESP_LOGI(TAG, "Interfaz de Usuario principal inicializada.");
 
     // 5. Decide el siguiente paso basado en el estado de la SD.
-    if (!is_sd_ok) {
+    if (is_flash_ok) {
+        // Sin SD, pero con la copia en flash de la evolución actual: el personaje se anima igual.
+        ESP_LOGW(TAG, "Fallo en la SD. Las animaciones se reproducen desde la copia en flash.");
+        telemetry_task_start();
+        ESP_LOGI(TAG, "¡Firmware DIYMON en marcha!");
+    } else if (!is_sd_ok) {
         // Si la SD falla, se invoca la acción de modo configuración.
         ESP_LOGW(TAG, "Fallo en la SD. Entrando automáticamente en modo de configuración WiFi...");
         vTaskDelay(pdMS_TO_TICKS(500));
@@ -104,4 +125,12 @@ static void run_main_application_mode(void) {
         telemetry_task_start();
         ESP_LOGI(TAG, "¡Firmware DIYMON en marcha!");
     }
+
+    // 6. Comprobación en segundo plano de los fotogramas de la SD (empieza unos segundos después).
+    if (is_sd_ok) {
+        animation_integrity_start();
+    }
+
+    // 7. Consola serie ('vfs': métricas de E/S del driver 'S:').
+    serial_console_start();
 }
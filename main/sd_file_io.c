@@ -0,0 +1,456 @@
+/* Fichero: main/sd_file_io.c */
+/* Descripción: Capa de lectura de la SD sobre POSIX para el driver 'S:' de LVGL. El driver anterior usaba fopen/fread, que pasa cada lectura por el búfer de 128 bytes de newlib y repite la apertura del fichero (búsqueda de la entrada en el directorio FAT) cada vez que el cargador abre un pack o un .bin. Ahora cada fichero es un descriptor con su propia posición lógica: las lecturas del tamaño del búfer de lectura anticipada o mayores van directas al búfer del llamador hasta el último sector completo (FatFs lee esos sectores sin copia intermedia) y el resto se sirve de un búfer alineado a sector que se rellena de una vez. Los lseek solo se hacen cuando la posición del descriptor no coincide con la pedida, y SEEK_END usa el tamaño guardado. Los ficheros abiertos en lectura no se cierran al soltarlos: quedan en un pool indexado por ruta (con su búfer ya cargado) y la siguiente apertura de esa ruta los reutiliza. Abrir una ruta para escritura o un aviso de cambio en la SD los descarta. Las lecturas del descriptor se pueden partir en trozos alineados a sector con un aviso antes y después de cada uno, para que el árbitro del bus SPI intercale los envíos a la pantalla entre ellos. Un fichero abierto en lectura cuyo contenido ocupa sectores contiguos de la tarjeta ('extent_get', que lo comprueba recorriendo su cadena de clústeres) se lee con 'sector_read' a partir de su primer sector: los sectores completos van directos al búfer del llamador en una sola lectura multibloque por trozo y los parciales pasan por un sector intermedio, sin lseek ni recorrido de la FAT. Si una lectura de sectores falla, el fichero sigue por el VFS. */
+/* Último cambio: 18/10/2026 - 00:30 */
+#include "sd_file_io.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#ifdef ESP_PLATFORM
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+// El búfer debe poder recibir DMA: si no, el driver de la SD lee sector a sector por un búfer temporal.
+#define SD_BUF_ALLOC(size)  heap_caps_malloc((size), MALLOC_CAP_DMA | MALLOC_CAP_8BIT)
+#define SD_BUF_FREE(ptr)    heap_caps_free(ptr)
+#else
+#define ESP_LOGI(tag, fmt, ...) printf("I (%s) " fmt "\n", tag, ##__VA_ARGS__)
+#define ESP_LOGW(tag, fmt, ...) printf("W (%s) " fmt "\n", tag, ##__VA_ARGS__)
+#define SD_BUF_ALLOC(size)  malloc(size)
+#define SD_BUF_FREE(ptr)    free(ptr)
+#endif
+
+static const char *TAG = "SD_FILE_IO";
+
+#define SD_FILE_PATH_MAX    160
+#define SD_POOL_MAX         16
+#define SECTOR_MASK         ((uint64_t)SD_FILE_SECTOR_SIZE - 1)
+
+struct sd_file {
+    int fd;
+    uint8_t mode;
+    bool pooled;                // Ocupa un hueco del pool.
+    bool in_use;                // Abierto por un llamador.
+    bool stale;                 // Invalidado mientras estaba abierto: se cierra al soltarlo.
+    uint32_t last_use;          // Para desalojar el menos usado.
+    uint64_t pos;               // Posición lógica.
+    uint64_t fd_pos;            // Posición real del descriptor (UINT64_MAX si se desconoce).
+    int64_t size;               // Tamaño guardado (-1 si se desconoce o el fichero se escribe).
+    uint8_t *buf;               // Búfer de lectura anticipada (se reserva en la primera lectura pequeña).
+    uint64_t buf_off;           // Posición del fichero del primer byte de 'buf'.
+    uint32_t buf_len;           // Bytes válidos en 'buf'.
+    bool extent;                // Se lee por sectores desde 'first_sector'.
+    uint32_t first_sector;
+    uint8_t *sector_buf;        // Sector intermedio para los trozos que no son sectores completos.
+    char path[SD_FILE_PATH_MAX];
+};
+
+static pthread_mutex_t s_lock = PTHREAD_MUTEX_INITIALIZER;
+static sd_file_t *s_pool[SD_POOL_MAX];
+static uint8_t s_pool_size;
+static uint32_t s_read_ahead;
+static uint32_t s_slice;
+static void (*s_io_begin)(size_t bytes);
+static void (*s_io_end)(size_t bytes);
+static bool (*s_extent_get)(const char *path, uint32_t *first_sector, uint32_t *size);
+static int (*s_sector_read)(void *dst, uint32_t sector, uint32_t count);
+static uint32_t s_tick;
+static sd_file_io_stats_t s_stats;
+
+// --- Descriptores ---
+
+static void file_free(sd_file_t *f) {
+    if (f->fd >= 0) close(f->fd);
+    if (f->buf) SD_BUF_FREE(f->buf);
+    if (f->sector_buf) SD_BUF_FREE(f->sector_buf);
+    free(f);
+}
+
+static bool path_matches(const char *entry, const char *path) {
+    size_t len = strlen(path);
+    if (strncmp(entry, path, len) != 0) return false;
+    // Coincidencia exacta o ruta de dentro de un directorio modificado.
+    return entry[len] == '\0' || entry[len] == '/' || (len > 0 && path[len - 1] == '/');
+}
+
+// Lectura por sectores de un fichero contiguo. Mismo contrato que raw_read.
+static ssize_t extent_read(sd_file_t *f, uint64_t off, void *dst, size_t len) {
+    if (off >= (uint64_t)f->size) return 0;
+    if (len > (uint64_t)f->size - off) len = (size_t)((uint64_t)f->size - off);
+    size_t done = 0;
+    while (done < len) {
+        uint64_t pos = off + done;
+        uint32_t sector = f->first_sector + (uint32_t)(pos / SD_FILE_SECTOR_SIZE);
+        uint32_t in_sector = (uint32_t)(pos & SECTOR_MASK);
+        uint8_t *out = (uint8_t *)dst + done;
+        size_t n = len - done;
+        int ret;
+        if (in_sector == 0 && n >= SD_FILE_SECTOR_SIZE && ((uintptr_t)out & 3) == 0) {
+            // Sectores completos: directos al búfer del llamador.
+            n &= ~(size_t)SECTOR_MASK;
+            if (s_slice && n > s_slice) n = s_slice;
+            if (s_io_begin) s_io_begin(n);
+            ret = s_sector_read(out, sector, (uint32_t)(n / SD_FILE_SECTOR_SIZE));
+            if (s_io_end) s_io_end(ret == 0 ? n : 0);
+        } else {
+            if (!f->sector_buf) {
+                f->sector_buf = SD_BUF_ALLOC(SD_FILE_SECTOR_SIZE);
+                if (!f->sector_buf) return -1;
+            }
+            if (n > SD_FILE_SECTOR_SIZE - in_sector) n = SD_FILE_SECTOR_SIZE - in_sector;
+            if (s_io_begin) s_io_begin(SD_FILE_SECTOR_SIZE);
+            ret = s_sector_read(f->sector_buf, sector, 1);
+            if (s_io_end) s_io_end(ret == 0 ? SD_FILE_SECTOR_SIZE : 0);
+            if (ret == 0) memcpy(out, f->sector_buf + in_sector, n);
+        }
+        if (ret != 0) return -1;
+        s_stats.sector_reads++;
+        done += n;
+    }
+    return (ssize_t)done;
+}
+
+// Lee 'len' bytes en 'off' (menos solo al final del fichero); evita el lseek si el descriptor ya está ahí.
+static ssize_t raw_read(sd_file_t *f, uint64_t off, void *dst, size_t len) {
+    if (f->extent) {
+        ssize_t r = extent_read(f, off, dst, len);
+        if (r >= 0) return r;
+        // El descriptor sigue abierto: el fichero continúa por el VFS.
+        f->extent = false;
+        s_stats.sector_fallbacks++;
+        ESP_LOGW(TAG, "Fallo al leer sectores de '%s': se vuelve a leer por el VFS.", f->path);
+    }
+    if (f->fd_pos != off) {
+        if (lseek(f->fd, (off_t)off, SEEK_SET) < 0) {
+            f->fd_pos = UINT64_MAX;
+            return -1;
+        }
+        s_stats.seeks++;
+        f->fd_pos = off;
+    }
+    size_t done = 0;
+    while (done < len) {
+        // Con trozos configurados, cada read() se anuncia al árbitro del bus, que puede retrasarlo.
+        size_t n = len - done;
+        if (s_slice && n > s_slice) n = s_slice;
+        if (s_io_begin) s_io_begin(n);
+        ssize_t r = read(f->fd, (uint8_t *)dst + done, n);
+        if (s_io_end) s_io_end(r > 0 ? (size_t)r : 0);
+        if (r < 0) {
+            if (errno == EINTR) continue;
+            f->fd_pos = UINT64_MAX;
+            return -1;
+        }
+        if (r == 0) break;
+        done += (size_t)r;
+    }
+    f->fd_pos = off + done;
+    return (ssize_t)done;
+}
+
+// --- Pool ---
+
+// Con el cerrojo tomado. Devuelve un hueco libre o el del fichero inactivo usado hace más tiempo.
+static int pool_take_slot_locked(void) {
+    int lru = -1;
+    for (int i = 0; i < s_pool_size; i++) {
+        if (!s_pool[i]) return i;
+        if (!s_pool[i]->in_use && (lru < 0 || (int32_t)(s_pool[i]->last_use - s_pool[lru]->last_use) < 0)) lru = i;
+    }
+    if (lru >= 0) {
+        file_free(s_pool[lru]);
+        s_pool[lru] = NULL;
+        s_stats.pool_evictions++;
+    }
+    return lru;
+}
+
+static void pool_invalidate_locked(const char *path) {
+    for (int i = 0; i < s_pool_size; i++) {
+        sd_file_t *f = s_pool[i];
+        if (!f || (path && !path_matches(f->path, path))) continue;
+        s_stats.invalidations++;
+        if (f->in_use) {
+            f->stale = true;
+        } else {
+            file_free(f);
+            s_pool[i] = NULL;
+        }
+    }
+}
+
+// --- Funciones públicas ---
+
+void sd_file_io_init(const sd_file_io_cfg_t *cfg) {
+    pthread_mutex_lock(&s_lock);
+    pool_invalidate_locked(NULL);
+    // Los que siguen abiertos quedan fuera del pool: se cierran al soltarlos.
+    for (int i = 0; i < SD_POOL_MAX; i++) {
+        if (s_pool[i]) {
+            s_pool[i]->pooled = false;
+            s_pool[i] = NULL;
+        }
+    }
+    s_pool_size = cfg ? (cfg->pool_size > SD_POOL_MAX ? SD_POOL_MAX : cfg->pool_size) : 0;
+    s_read_ahead = cfg ? (uint32_t)((cfg->read_ahead_bytes + SECTOR_MASK) & ~SECTOR_MASK) : 0;
+    s_slice = cfg ? (uint32_t)((cfg->slice_bytes + SECTOR_MASK) & ~SECTOR_MASK) : 0;
+    s_io_begin = cfg ? cfg->io_begin : NULL;
+    s_io_end = cfg ? cfg->io_end : NULL;
+    bool sectors = cfg && cfg->extent_get && cfg->sector_read;
+    s_extent_get = sectors ? cfg->extent_get : NULL;
+    s_sector_read = sectors ? cfg->sector_read : NULL;
+    pthread_mutex_unlock(&s_lock);
+    ESP_LOGI(TAG, "Lectura anticipada de %lu bytes, pool de %u ficheros, trozos de %lu bytes, lectura por sectores %s.",
+             (unsigned long)s_read_ahead, (unsigned)s_pool_size, (unsigned long)s_slice, sectors ? "sí" : "no");
+}
+
+sd_file_t *sd_file_open(const char *path, uint8_t mode) {
+    if (!path || !mode || strlen(path) >= SD_FILE_PATH_MAX) {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    pthread_mutex_lock(&s_lock);
+    s_stats.opens++;
+    if (mode == SD_FILE_MODE_RD) {
+        for (int i = 0; i < s_pool_size; i++) {
+            sd_file_t *f = s_pool[i];
+            if (f && !f->in_use && !f->stale && strcmp(f->path, path) == 0) {
+                f->in_use = true;
+                f->pos = 0;
+                f->last_use = ++s_tick;
+                s_stats.pool_hits++;
+                pthread_mutex_unlock(&s_lock);
+                return f;
+            }
+        }
+    } else {
+        // Las copias de lectura de esta ruta dejarían de reflejar el contenido del fichero.
+        pool_invalidate_locked(path);
+    }
+    pthread_mutex_unlock(&s_lock);
+
+    int flags = O_RDONLY;
+    if (mode == SD_FILE_MODE_WR) flags = O_WRONLY | O_CREAT | O_TRUNC;
+    else if (mode == (SD_FILE_MODE_RD | SD_FILE_MODE_WR)) flags = O_RDWR;
+    int fd = open(path, flags, 0644);
+    if (fd < 0) return NULL;
+
+    sd_file_t *f = calloc(1, sizeof(*f));
+    if (!f) {
+        close(fd);
+        errno = ENOMEM;
+        return NULL;
+    }
+    f->fd = fd;
+    f->mode = mode;
+    f->in_use = true;
+    f->fd_pos = 0;
+    f->size = -1;
+    strcpy(f->path, path);
+
+    uint32_t first_sector, size;
+    if (mode == SD_FILE_MODE_RD && s_extent_get && s_extent_get(path, &first_sector, &size)) {
+        f->extent = true;
+        f->first_sector = first_sector;
+        f->size = size;
+        s_stats.extent_opens++;
+    }
+
+    if (mode == SD_FILE_MODE_RD) {
+        pthread_mutex_lock(&s_lock);
+        int slot = pool_take_slot_locked();
+        if (slot >= 0) {
+            f->pooled = true;
+            f->last_use = ++s_tick;
+            s_pool[slot] = f;
+        }
+        pthread_mutex_unlock(&s_lock);
+    }
+    return f;
+}
+
+void sd_file_close(sd_file_t *f) {
+    if (!f) return;
+    pthread_mutex_lock(&s_lock);
+    if (f->pooled && !f->stale) {
+        f->in_use = false;
+        f = NULL;
+    } else if (f->pooled) {
+        for (int i = 0; i < s_pool_size; i++) {
+            if (s_pool[i] == f) s_pool[i] = NULL;
+        }
+    }
+    pthread_mutex_unlock(&s_lock);
+    if (f) file_free(f);
+}
+
+int sd_file_read(sd_file_t *f, void *buf, size_t len, size_t *out_read) {
+    if (out_read) *out_read = 0;
+    if (!f || !(f->mode & SD_FILE_MODE_RD)) {
+        errno = EBADF;
+        return -1;
+    }
+
+    uint8_t *dst = buf;
+    size_t done = 0;
+    s_stats.reads++;
+    while (done < len) {
+        size_t left = len - done;
+
+        // 1. Lo que ya está en el búfer de lectura anticipada.
+        if (f->buf_len && f->pos >= f->buf_off && f->pos < f->buf_off + f->buf_len) {
+            size_t n = (size_t)(f->buf_off + f->buf_len - f->pos);
+            if (n > left) n = left;
+            memcpy(dst + done, f->buf + (f->pos - f->buf_off), n);
+            f->pos += n;
+            done += n;
+            s_stats.bytes_buffered += n;
+            continue;
+        }
+
+        // 2. Lecturas grandes: directas hasta el último sector completo; la cola pasa por el búfer.
+        if (s_read_ahead == 0 || left >= s_read_ahead) {
+            size_t n = left;
+            uint64_t end = (f->pos + left) & ~SECTOR_MASK;
+            if (s_read_ahead && end > f->pos) n = (size_t)(end - f->pos);
+            ssize_t r = raw_read(f, f->pos, dst + done, n);
+            if (r < 0) return -1;
+            s_stats.direct_reads++;
+            f->pos += (uint64_t)r;
+            done += (size_t)r;
+            if ((size_t)r < n) break; // Final del fichero.
+            continue;
+        }
+
+        // 3. Lecturas pequeñas: se rellena el búfer desde el sector que contiene la posición.
+        if (!f->buf) {
+            f->buf = SD_BUF_ALLOC(s_read_ahead);
+            if (!f->buf) {
+                // Sin memoria se lee directamente; más lento, pero correcto.
+                ssize_t r = raw_read(f, f->pos, dst + done, left);
+                if (r < 0) return -1;
+                f->pos += (uint64_t)r;
+                done += (size_t)r;
+                break;
+            }
+        }
+        uint64_t start = f->pos & ~SECTOR_MASK;
+        f->buf_len = 0;
+        ssize_t r = raw_read(f, start, f->buf, s_read_ahead);
+        if (r < 0) return -1;
+        s_stats.fills++;
+        f->buf_off = start;
+        f->buf_len = (uint32_t)r;
+        if (start + (uint64_t)r <= f->pos) break; // Final del fichero.
+    }
+
+    s_stats.bytes_read += done;
+    if (out_read) *out_read = done;
+    return 0;
+}
+
+int sd_file_write(sd_file_t *f, const void *buf, size_t len, size_t *out_written) {
+    if (out_written) *out_written = 0;
+    if (!f || !(f->mode & SD_FILE_MODE_WR)) {
+        errno = EBADF;
+        return -1;
+    }
+    f->buf_len = 0;
+    f->size = -1;
+    if (f->fd_pos != f->pos) {
+        if (lseek(f->fd, (off_t)f->pos, SEEK_SET) < 0) {
+            f->fd_pos = UINT64_MAX;
+            return -1;
+        }
+        s_stats.seeks++;
+        f->fd_pos = f->pos;
+    }
+
+    size_t done = 0;
+    while (done < len) {
+        ssize_t w = write(f->fd, (const uint8_t *)buf + done, len - done);
+        if (w < 0) {
+            if (errno == EINTR) continue;
+            f->fd_pos = UINT64_MAX;
+            break;
+        }
+        if (w == 0) break;
+        done += (size_t)w;
+    }
+    f->pos += done;
+    if (f->fd_pos != UINT64_MAX) f->fd_pos = f->pos;
+    if (out_written) *out_written = done;
+    return done == len ? 0 : -1;
+}
+
+int sd_file_seek(sd_file_t *f, int64_t offset, int whence) {
+    if (!f) {
+        errno = EBADF;
+        return -1;
+    }
+    int64_t base;
+    switch (whence) {
+        case SEEK_SET: base = 0; break;
+        case SEEK_CUR: base = (int64_t)f->pos; break;
+        case SEEK_END:
+            if (f->size < 0) {
+                off_t end = lseek(f->fd, 0, SEEK_END);
+                if (end < 0) {
+                    f->fd_pos = UINT64_MAX;
+                    return -1;
+                }
+                s_stats.seeks++;
+                f->fd_pos = (uint64_t)end;
+                // Solo se guarda en lectura: quien escribe puede hacer crecer el fichero.
+                if (f->mode == SD_FILE_MODE_RD) f->size = end;
+                base = end;
+            } else {
+                base = f->size;
+            }
+            break;
+        default:
+            errno = EINVAL;
+            return -1;
+    }
+    if (base + offset < 0) {
+        errno = EINVAL;
+        return -1;
+    }
+    // El lseek real se aplaza hasta la siguiente lectura, y solo si hace falta.
+    f->pos = (uint64_t)(base + offset);
+    return 0;
+}
+
+uint64_t sd_file_tell(const sd_file_t *f) {
+    return f ? f->pos : 0;
+}
+
+void sd_file_io_invalidate(const char *path) {
+    pthread_mutex_lock(&s_lock);
+    pool_invalidate_locked(path);
+    pthread_mutex_unlock(&s_lock);
+}
+
+void sd_file_io_get_stats(sd_file_io_stats_t *out) {
+    if (!out) return;
+    pthread_mutex_lock(&s_lock);
+    *out = s_stats;
+    pthread_mutex_unlock(&s_lock);
+}
+
+void sd_file_io_log_stats(void) {
+    sd_file_io_stats_t st;
+    sd_file_io_get_stats(&st);
+    ESP_LOGI(TAG, "aperturas=%lu (pool %lu, desalojos %lu, invalidados %lu, contiguos %lu) lecturas=%lu directas=%lu "
+             "rellenos=%lu lseek=%lu sectores=%lu (vuelta al VFS %lu) bytes=%llu (del búfer %llu)",
+             (unsigned long)st.opens, (unsigned long)st.pool_hits, (unsigned long)st.pool_evictions,
+             (unsigned long)st.invalidations, (unsigned long)st.extent_opens, (unsigned long)st.reads,
+             (unsigned long)st.direct_reads, (unsigned long)st.fills, (unsigned long)st.seeks,
+             (unsigned long)st.sector_reads, (unsigned long)st.sector_fallbacks,
+             (unsigned long long)st.bytes_read, (unsigned long long)st.bytes_buffered);
+}
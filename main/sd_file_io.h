@@ -0,0 +1,113 @@
+/* Fichero: main/sd_file_io.h */
+/* Descripción: Interfaz de la capa de lectura de la SD sobre POSIX (open/read/lseek) que usa el driver 'S:' de LVGL. Sustituye a fopen/fread con el búfer por defecto de newlib: las lecturas grandes van directas al búfer del llamador, las pequeñas se sirven de un búfer de lectura anticipada alineado a sector, y los ficheros abiertos en lectura se guardan en un pool indexado por ruta para no repetir la apertura (búsqueda de directorio en FAT) en cada fotograma. No depende de LVGL ni de ESP-IDF, así que también se compila en el host para medir su rendimiento. Se añade la lectura directa por sectores de los ficheros que ocupan sectores contiguos en la SD: si la configuración da 'extent_get' y 'sector_read', al abrir un fichero en lectura se pregunta por su primer sector y sus lecturas dejan de pasar por el VFS y la FAT. */
+/* Último cambio: 18/10/2026 - 00:30 */
+#ifndef SD_FILE_IO_H
+#define SD_FILE_IO_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SD_FILE_SECTOR_SIZE     512     // Alineación de las lecturas de la SD.
+
+#define SD_FILE_MODE_RD         0x01
+#define SD_FILE_MODE_WR         0x02
+
+typedef struct sd_file sd_file_t;
+
+typedef struct {
+    uint32_t read_ahead_bytes;  // Tamaño del búfer de lectura anticipada (se redondea a sector; 0 lo desactiva).
+    uint8_t pool_size;          // Ficheros de lectura que se mantienen abiertos tras cerrarlos (0 lo desactiva).
+    uint32_t slice_bytes;       // Tamaño máximo de cada read() a la SD (se redondea a sector; 0 = sin trocear).
+    void (*io_begin)(size_t bytes); // Opcional: antes de cada read() a la SD (puede bloquear).
+    void (*io_end)(size_t bytes);   // Opcional: después de cada read(), con los bytes leídos.
+    // Opcional: primer sector y tamaño de un fichero guardado en sectores contiguos (false si no lo está).
+    bool (*extent_get)(const char *path, uint32_t *first_sector, uint32_t *size);
+    // Opcional: lectura directa de 'count' sectores de la SD en 'dst' (alineado a 4 bytes). 0 = correcto.
+    int (*sector_read)(void *dst, uint32_t sector, uint32_t count);
+} sd_file_io_cfg_t;
+
+typedef struct {
+    uint32_t opens;             // Aperturas pedidas por los llamadores.
+    uint32_t pool_hits;         // Aperturas servidas con un fichero ya abierto del pool.
+    uint32_t pool_evictions;    // Ficheros cerrados para hacer sitio en el pool.
+    uint32_t invalidations;     // Ficheros del pool descartados porque cambiaron en la SD.
+    uint32_t reads;             // Llamadas de lectura.
+    uint32_t direct_reads;      // read() directos al búfer del llamador.
+    uint32_t fills;             // Rellenos del búfer de lectura anticipada.
+    uint32_t seeks;             // lseek() reales (los que no se pudieron evitar).
+    uint32_t extent_opens;      // Aperturas de ficheros contiguos (leídos por sectores).
+    uint32_t sector_reads;      // Lecturas directas de sectores (en lugar de read()).
+    uint32_t sector_fallbacks;  // Ficheros que volvieron al VFS tras fallar una lectura de sectores.
+    uint64_t bytes_read;        // Bytes entregados a los llamadores.
+    uint64_t bytes_buffered;    // De ellos, servidos desde el búfer de lectura anticipada.
+} sd_file_io_stats_t;
+
+/**
+ * @brief Configura la capa. Debe llamarse antes de abrir ningún fichero; una segunda llamada
+ *        cierra los ficheros del pool y aplica la nueva configuración.
+ */
+void sd_file_io_init(const sd_file_io_cfg_t *cfg);
+
+/**
+ * @brief Abre un fichero. En lectura se reutiliza, si lo hay, un descriptor del pool para la misma ruta.
+ *        Abrir para escritura descarta del pool las copias de esa ruta.
+ * @param mode SD_FILE_MODE_RD, SD_FILE_MODE_WR (crea o trunca) o ambos (lectura/escritura sin truncar).
+ * @return El fichero o NULL (errno indica la causa).
+ */
+sd_file_t *sd_file_open(const char *path, uint8_t mode);
+
+/**
+ * @brief Cierra un fichero. Los de lectura vuelven al pool (si no se invalidaron mientras estaban abiertos).
+ */
+void sd_file_close(sd_file_t *f);
+
+/**
+ * @brief Lee hasta 'len' bytes desde la posición actual.
+ * @param out_read Salida: bytes leídos (menos que 'len' solo al llegar al final del fichero).
+ * @return 0 o -1 si falla la lectura.
+ */
+int sd_file_read(sd_file_t *f, void *buf, size_t len, size_t *out_read);
+
+/**
+ * @brief Escribe 'len' bytes en la posición actual.
+ * @return 0 o -1 si falla la escritura.
+ */
+int sd_file_write(sd_file_t *f, const void *buf, size_t len, size_t *out_written);
+
+/**
+ * @brief Mueve la posición. 'whence' es SEEK_SET, SEEK_CUR o SEEK_END; el resultado no puede ser negativo.
+ * @return 0 o -1 si la posición resultante no es válida.
+ */
+int sd_file_seek(sd_file_t *f, int64_t offset, int whence);
+
+/**
+ * @brief Posición actual del fichero.
+ */
+uint64_t sd_file_tell(const sd_file_t *f);
+
+/**
+ * @brief Descarta del pool los ficheros de 'path' (o los de dentro si es un directorio).
+ *        Los que estén abiertos se cierran de verdad al soltarlos. NULL descarta todo el pool.
+ */
+void sd_file_io_invalidate(const char *path);
+
+/**
+ * @brief Copia los contadores de la capa.
+ */
+void sd_file_io_get_stats(sd_file_io_stats_t *out);
+
+/**
+ * @brief Escribe los contadores en el log.
+ */
+void sd_file_io_log_stats(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SD_FILE_IO_H
@@ -0,0 +1,82 @@
+/* Fichero: main/serial_console.c */
+/* Descripción: Consola de comandos por el puerto serie sobre el REPL de 'esp_console'. El comando 'vfs' vuelca al log las métricas de E/S del driver 'S:' (latencias por operación, aperturas por directorio) y los contadores de sd_file_io; 'vfs json' imprime en JSON las métricas del driver (la parte 'vfs' de '/metrics') y 'vfs reset' pone las métricas a cero. Sirve para medir sin activar la red, que en el arranque normal está apagada. */
+/* Último cambio: 18/10/2026 - 01:00 */
+#include "serial_console.h"
+#include "esp_log.h"
+#include "sdkconfig.h"
+
+#if CONFIG_DIYMON_SERIAL_CONSOLE
+#include "esp_console.h"
+#include "sd_file_io.h"
+#include "vfs_metrics.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#endif
+
+static const char *TAG = "SERIAL_CONSOLE";
+
+#if CONFIG_DIYMON_SERIAL_CONSOLE
+
+#define JSON_SIZE 4096
+
+static int cmd_vfs(int argc, char **argv) {
+    if (argc < 2) {
+        vfs_metrics_log();
+        sd_file_io_log_stats();
+        return 0;
+    }
+    if (strcmp(argv[1], "reset") == 0) {
+        vfs_metrics_reset();
+        printf("Métricas del driver 'S:' a cero.\n");
+        return 0;
+    }
+    if (strcmp(argv[1], "json") == 0) {
+        char *json = malloc(JSON_SIZE);
+        if (!json) return 1;
+        size_t len = vfs_metrics_to_json(json, JSON_SIZE);
+        if (len) printf("%.*s\n", (int)len, json);
+        free(json);
+        return len ? 0 : 1;
+    }
+    printf("Uso: vfs [json|reset]\n");
+    return 1;
+}
+
+void serial_console_start(void) {
+    esp_console_repl_t *repl = NULL;
+    esp_console_repl_config_t repl_config = ESP_CONSOLE_REPL_CONFIG_DEFAULT();
+    repl_config.prompt = "diymon>";
+    repl_config.max_cmdline_length = 64;
+    repl_config.task_priority = 1;     // Por debajo de LVGL y del precargador de animaciones.
+    esp_console_dev_uart_config_t uart_config = ESP_CONSOLE_DEV_UART_CONFIG_DEFAULT();
+    esp_err_t ret = esp_console_new_repl_uart(&uart_config, &repl_config, &repl);
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "No se pudo crear la consola serie (%s).", esp_err_to_name(ret));
+        return;
+    }
+
+    esp_console_register_help_command();
+    const esp_console_cmd_t vfs_cmd = {
+        .command = "vfs",
+        .help = "Métricas de E/S del driver 'S:' (latencias, bytes, aperturas por directorio).",
+        .hint = "[json|reset]",
+        .func = cmd_vfs,
+    };
+    esp_console_cmd_register(&vfs_cmd);
+
+    ret = esp_console_start_repl(repl);
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "No se pudo arrancar la consola serie (%s).", esp_err_to_name(ret));
+        return;
+    }
+    ESP_LOGI(TAG, "Consola serie activa. Escribe 'help' para ver los comandos.");
+}
+
+#else
+
+void serial_console_start(void) {
+    ESP_LOGD(TAG, "Consola serie desactivada (DIYMON_SERIAL_CONSOLE).");
+}
+
+#endif
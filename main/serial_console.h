@@ -0,0 +1,12 @@
+/* Fichero: main/serial_console.h */
+/* Descripción: Consola de comandos por el puerto serie (UART de la consola de ESP-IDF). De momento solo tiene 'vfs', que vuelca las métricas de E/S del driver 'S:'. Se activa con 'DIYMON_SERIAL_CONSOLE'. */
+/* Último cambio: 18/10/2026 - 01:00 */
+#ifndef SERIAL_CONSOLE_H
+#define SERIAL_CONSOLE_H
+
+/**
+ * @brief Arranca la consola serie en su propia tarea. Sin 'DIYMON_SERIAL_CONSOLE' no hace nada.
+ */
+void serial_console_start(void);
+
+#endif // SERIAL_CONSOLE_H
@@ -0,0 +1,195 @@
+/* Fichero: main/vfs_metrics.c */
+/* Descripción: Métricas de E/S del driver 'S:' de LVGL. Anotar una operación es buscar su cubo (posición del bit más alto de la latencia) y sumar unos contadores con el cerrojo tomado; las aperturas buscan además su directorio por un hash calculado fuera del cerrojo. Los percentiles del log y del JSON se estiman con el techo del cubo, suficiente para distinguir una lectura servida del búfer (microsegundos), una de la SD (milisegundos) y una apertura que recorre la FAT (decenas de milisegundos). */
+/* Último cambio: 18/10/2026 - 01:00 */
+#include "vfs_metrics.h"
+
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef ESP_PLATFORM
+#include "esp_log.h"
+#else
+#define ESP_LOGI(tag, fmt, ...) printf("I (%s) " fmt "\n", tag, ##__VA_ARGS__)
+#endif
+
+static const char *TAG = "VFS_METRICS";
+
+static const char *const OP_NAMES[VFS_OP_COUNT] = { "open", "read", "seek", "close", "dir" };
+
+static pthread_mutex_t s_lock = PTHREAD_MUTEX_INITIALIZER;
+static vfs_metrics_t s_metrics;
+static uint32_t s_dir_hash[VFS_METRICS_DIRS];
+
+static unsigned bucket_of(uint32_t us) {
+    if (us < 2) return 0;
+    unsigned b = 31 - (unsigned)__builtin_clz(us);
+    return b < VFS_METRICS_BUCKETS ? b : VFS_METRICS_BUCKETS - 1;
+}
+
+static void record_locked(vfs_metrics_op_stats_t *st, uint32_t us, uint32_t bytes, bool ok) {
+    st->count++;
+    if (!ok) st->errors++;
+    st->total_us += us;
+    if (us > st->max_us) st->max_us = us;
+    st->bytes += bytes;
+    st->hist[bucket_of(us)]++;
+}
+
+// Directorio de la ruta sin el punto de montaje ni la letra de LVGL: "/sdcard/diymon/0/ANIM.pak" -> "/diymon/0".
+static size_t dir_of(const char *path, const char **start) {
+    if (strncmp(path, "/sdcard", 7) == 0) path += 7;
+    else if (path[0] && path[1] == ':') path += 2;
+    const char *slash = strrchr(path, '/');
+    *start = path;
+    return slash ? (size_t)(slash - path) : 0;
+}
+
+static uint32_t hash_of(const char *s, size_t len) {
+    uint32_t h = 2166136261u;   // FNV-1a.
+    for (size_t i = 0; i < len; i++) {
+        h ^= (uint8_t)s[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static bool emit(char *buf, size_t size, size_t *len, const char *fmt, ...) {
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(buf + *len, size - *len, fmt, ap);
+    va_end(ap);
+    if (n < 0 || (size_t)n >= size - *len) return false;
+    *len += (size_t)n;
+    return true;
+}
+
+static size_t write_json(const vfs_metrics_t *m, char *buf, size_t size) {
+    size_t len = 0;
+#define EMIT(...) do { if (!emit(buf, size, &len, __VA_ARGS__)) return 0; } while (0)
+    // Límite inferior de cada cubo; el del cubo 0 es 0 us.
+    EMIT("{\"bucket_us\":[");
+    for (unsigned b = 0; b < VFS_METRICS_BUCKETS; b++) EMIT("%s%lu", b ? "," : "", b ? (unsigned long)(1ul << b) : 0ul);
+    EMIT("],\"ops\":{");
+    for (int op = 0; op < VFS_OP_COUNT; op++) {
+        const vfs_metrics_op_stats_t *st = &m->op[op];
+        EMIT("%s\"%s\":{\"count\":%lu,\"errors\":%lu,\"total_us\":%llu,\"max_us\":%lu,\"p50_us\":%lu,\"p99_us\":%lu,",
+             op ? "," : "", OP_NAMES[op], (unsigned long)st->count, (unsigned long)st->errors,
+             (unsigned long long)st->total_us, (unsigned long)st->max_us,
+             (unsigned long)vfs_metrics_percentile_us(st, 50), (unsigned long)vfs_metrics_percentile_us(st, 99));
+        if (op == VFS_OP_READ) EMIT("\"bytes\":%llu,", (unsigned long long)st->bytes);
+        EMIT("\"hist\":[");
+        for (unsigned b = 0; b < VFS_METRICS_BUCKETS; b++) EMIT("%s%lu", b ? "," : "", (unsigned long)st->hist[b]);
+        EMIT("]}");
+    }
+    EMIT("},\"dirs\":[");
+    for (uint32_t i = 0; i < m->dir_count; i++) {
+        EMIT("%s{\"dir\":\"%s\",\"opens\":%lu,\"failed\":%lu}", i ? "," : "", m->dir[i].dir[0] ? m->dir[i].dir : "/",
+             (unsigned long)m->dir[i].opens, (unsigned long)m->dir[i].failed);
+    }
+    EMIT("],\"other_dir_opens\":%lu}", (unsigned long)m->other_dir_opens);
+#undef EMIT
+    return len;
+}
+
+// --- Funciones públicas ---
+
+void vfs_metrics_record(vfs_metrics_op_t op, uint32_t us, uint32_t bytes, bool ok) {
+    if (op >= VFS_OP_COUNT) return;
+    pthread_mutex_lock(&s_lock);
+    record_locked(&s_metrics.op[op], us, op == VFS_OP_READ ? bytes : 0, ok);
+    pthread_mutex_unlock(&s_lock);
+}
+
+void vfs_metrics_record_open(const char *path, uint32_t us, bool ok) {
+    const char *dir = "";
+    size_t len = path ? dir_of(path, &dir) : 0;
+    if (len >= VFS_METRICS_DIR_MAX) len = VFS_METRICS_DIR_MAX - 1;
+    uint32_t h = hash_of(dir, len);
+
+    pthread_mutex_lock(&s_lock);
+    record_locked(&s_metrics.op[VFS_OP_OPEN], us, 0, ok);
+    vfs_metrics_dir_stats_t *d = NULL;
+    for (uint32_t i = 0; i < s_metrics.dir_count; i++) {
+        if (s_dir_hash[i] == h) {
+            d = &s_metrics.dir[i];
+            break;
+        }
+    }
+    if (!d && s_metrics.dir_count < VFS_METRICS_DIRS) {
+        s_dir_hash[s_metrics.dir_count] = h;
+        d = &s_metrics.dir[s_metrics.dir_count++];
+        memcpy(d->dir, dir, len);
+        d->dir[len] = '\0';
+    }
+    if (d) {
+        d->opens++;
+        if (!ok) d->failed++;
+    } else {
+        s_metrics.other_dir_opens++;
+    }
+    pthread_mutex_unlock(&s_lock);
+}
+
+void vfs_metrics_get(vfs_metrics_t *out) {
+    if (!out) return;
+    pthread_mutex_lock(&s_lock);
+    *out = s_metrics;
+    pthread_mutex_unlock(&s_lock);
+}
+
+void vfs_metrics_reset(void) {
+    pthread_mutex_lock(&s_lock);
+    memset(&s_metrics, 0, sizeof(s_metrics));
+    memset(s_dir_hash, 0, sizeof(s_dir_hash));
+    pthread_mutex_unlock(&s_lock);
+}
+
+uint32_t vfs_metrics_percentile_us(const vfs_metrics_op_stats_t *st, uint32_t pct) {
+    if (!st || st->count == 0) return 0;
+    uint64_t target = ((uint64_t)st->count * pct + 99) / 100;
+    uint64_t acc = 0;
+    for (unsigned b = 0; b < VFS_METRICS_BUCKETS; b++) {
+        acc += st->hist[b];
+        // El techo del cubo nunca pasa del máximo observado (el último cubo no tiene techo).
+        if (acc >= target) return b == VFS_METRICS_BUCKETS - 1 || (2u << b) > st->max_us ? st->max_us : (2u << b);
+    }
+    return st->max_us;
+}
+
+size_t vfs_metrics_to_json(char *buf, size_t size) {
+    // Copia en el montón: pesa más de 1 KB y se llama desde tareas con poca pila (consola).
+    vfs_metrics_t *m = malloc(sizeof(*m));
+    if (!m || !buf) {
+        free(m);
+        return 0;
+    }
+    vfs_metrics_get(m);
+    size_t len = write_json(m, buf, size);
+    free(m);
+    return len;
+}
+
+void vfs_metrics_log(void) {
+    vfs_metrics_t *m = malloc(sizeof(*m));
+    if (!m) return;
+    vfs_metrics_get(m);
+    for (int op = 0; op < VFS_OP_COUNT; op++) {
+        const vfs_metrics_op_stats_t *st = &m->op[op];
+        if (st->count == 0) continue;
+        ESP_LOGI(TAG, "%-5s %lu llamadas (%lu errores), media %lu us, p50 %lu us, p99 %lu us, máx %lu us.",
+                 OP_NAMES[op], (unsigned long)st->count, (unsigned long)st->errors,
+                 (unsigned long)(st->total_us / st->count),
+                 (unsigned long)vfs_metrics_percentile_us(st, 50), (unsigned long)vfs_metrics_percentile_us(st, 99),
+                 (unsigned long)st->max_us);
+    }
+    for (uint32_t i = 0; i < m->dir_count; i++) {
+        ESP_LOGI(TAG, "Aperturas en '%s': %lu (%lu fallidas).", m->dir[i].dir[0] ? m->dir[i].dir : "/",
+                 (unsigned long)m->dir[i].opens, (unsigned long)m->dir[i].failed);
+    }
+    ESP_LOGI(TAG, "Leídos %llu KB.", (unsigned long long)(m->op[VFS_OP_READ].bytes / 1024));
+    if (m->other_dir_opens) ESP_LOGI(TAG, "Aperturas en otros directorios: %lu.", (unsigned long)m->other_dir_opens);
+    free(m);
+}
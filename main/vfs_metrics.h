@@ -0,0 +1,79 @@
+/* Fichero: main/vfs_metrics.h */
+/* Descripción: Interfaz de las métricas de E/S del driver 'S:' de LVGL. Cada callback del driver mide su duración y la anota aquí: por tipo de operación (abrir, leer, posicionar, cerrar, directorio) se guarda un histograma de latencias en cubos logarítmicos (potencias de 2 en microsegundos), el número de llamadas, los errores, la suma y el máximo; las lecturas suman además los bytes leídos. Las aperturas se cuentan por directorio. Es lo bastante barato para dejarlo siempre activo, y se consulta desde el servidor web ('/metrics') o desde la consola serie ('vfs'). Igual que sd_file_io, no depende de LVGL ni de ESP-IDF. */
+/* Último cambio: 18/10/2026 - 01:00 */
+#ifndef VFS_METRICS_H
+#define VFS_METRICS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define VFS_METRICS_BUCKETS     16      // Cubo i: [2^i, 2^(i+1)) us; el 0 incluye 0 us y el último no tiene techo.
+#define VFS_METRICS_DIRS        16      // Directorios con contador propio; el resto se suma aparte.
+#define VFS_METRICS_DIR_MAX     48
+
+typedef enum {
+    VFS_OP_OPEN = 0,
+    VFS_OP_READ,
+    VFS_OP_SEEK,
+    VFS_OP_CLOSE,
+    VFS_OP_DIR,                 // Abrir, leer o cerrar un directorio.
+    VFS_OP_COUNT
+} vfs_metrics_op_t;
+
+typedef struct {
+    uint32_t count;
+    uint32_t errors;
+    uint32_t max_us;
+    uint64_t total_us;
+    uint64_t bytes;             // Solo lecturas.
+    uint32_t hist[VFS_METRICS_BUCKETS];
+} vfs_metrics_op_stats_t;
+
+typedef struct {
+    char dir[VFS_METRICS_DIR_MAX];
+    uint32_t opens;
+    uint32_t failed;            // Aperturas que no encontraron el fichero.
+} vfs_metrics_dir_stats_t;
+
+typedef struct {
+    vfs_metrics_op_stats_t op[VFS_OP_COUNT];
+    vfs_metrics_dir_stats_t dir[VFS_METRICS_DIRS];
+    uint32_t dir_count;
+    uint32_t other_dir_opens;   // Aperturas en directorios que ya no cabían en la tabla.
+} vfs_metrics_t;
+
+/**
+ * @brief Anota una operación de 'us' microsegundos. 'bytes' solo cuenta en VFS_OP_READ.
+ */
+void vfs_metrics_record(vfs_metrics_op_t op, uint32_t us, uint32_t bytes, bool ok);
+
+/**
+ * @brief Anota una apertura de fichero: su latencia y el directorio de 'path' (ruta VFS o de LVGL).
+ */
+void vfs_metrics_record_open(const char *path, uint32_t us, bool ok);
+
+void vfs_metrics_get(vfs_metrics_t *out);
+void vfs_metrics_reset(void);
+
+/**
+ * @brief Percentil 'pct' (0-100) estimado con el histograma: devuelve el techo del cubo en que cae.
+ */
+uint32_t vfs_metrics_percentile_us(const vfs_metrics_op_stats_t *st, uint32_t pct);
+
+/**
+ * @brief Escribe las métricas en JSON en 'buf'. Devuelve la longitud escrita (0 si no cabe).
+ */
+size_t vfs_metrics_to_json(char *buf, size_t size);
+
+void vfs_metrics_log(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // VFS_METRICS_H